@@ -0,0 +1,515 @@
+#include "address.h"
+#include "log.h"
+#include <string.h>
+#include <stddef.h>
+#include <netdb.h>
+#include <stdexcept>
+
+namespace sylar{
+
+static Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+namespace {
+
+static const char s_hex[] = "0123456789abcdef";
+
+// 十进制追加, 返回写入后的位置
+char* AppendUint(char* p, uint32_t v)
+{
+    char tmp[10];
+    size_t n = 0;
+    do{
+        tmp[n++] = '0' + v % 10;
+        v /= 10;
+    } while(v);
+    while(n){
+        *p++ = tmp[--n];
+    }
+    return p;
+}
+
+// 十六进制追加, 不带前导零
+char* AppendHex16(char* p, uint16_t v)
+{
+    bool started = false;
+    for(int shift = 12; shift >= 0; shift -= 4){
+        uint8_t d = (v >> shift) & 0xF;
+        if(d || started || shift == 0){
+            *p++ = s_hex[d];
+            started = true;
+        }
+    }
+    return p;
+}
+
+char* AppendStr(char* p, const char* s, size_t len)
+{
+    memcpy(p, s, len);
+    return p + len;
+}
+
+}
+
+Address::ptr Address::Create(const sockaddr* addr, socklen_t addrlen)
+{
+    if(addr == nullptr){
+        return nullptr;
+    }
+
+    Address::ptr result;
+    switch(addr->sa_family){
+        case AF_INET:
+            result.reset(new IPv4Address(*(const sockaddr_in*)addr));
+            break;
+        case AF_INET6:
+            result.reset(new IPv6Address(*(const sockaddr_in6*)addr));
+            break;
+        case AF_UNIX:
+            {
+                UnixAddress::ptr ua(new UnixAddress);
+                memcpy(ua->getAddr(), addr, std::min<socklen_t>(addrlen, sizeof(sockaddr_un)));
+                ua->setAddrLen(std::min<socklen_t>(addrlen, sizeof(sockaddr_un)));
+                result = ua;
+            }
+            break;
+        default:
+            result.reset(new UnknownAddress(*addr));
+            break;
+    }
+    return result;
+}
+
+bool Address::Lookup(std::vector<Address::ptr>& result, const std::string& host,
+                     int family, int type, int protocol)
+{
+    addrinfo hints, *results, *next;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = family;
+    hints.ai_socktype = type;
+    hints.ai_protocol = protocol;
+
+    std::string node;
+    const char* service = nullptr;
+
+    // [IPv6]:port
+    if(!host.empty() && host[0] == '['){
+        const char* endipv6 = (const char*)memchr(host.c_str() + 1, ']', host.size() - 1);
+        if(endipv6){
+            if(*(endipv6 + 1) == ':'){
+                service = endipv6 + 2;
+            }
+            node = host.substr(1, endipv6 - host.c_str() - 1);
+        }
+    }
+
+    // host:port, 只有一个冒号时才认为带端口, 否则是不带括号的IPv6
+    if(node.empty()){
+        service = (const char*)memchr(host.c_str(), ':', host.size());
+        if(service){
+            if(!memchr(service + 1, ':', host.c_str() + host.size() - service - 1)){
+                node = host.substr(0, service - host.c_str());
+                ++service;
+            }
+            else{
+                service = nullptr;
+            }
+        }
+    }
+
+    if(node.empty()){
+        node = host;
+    }
+    int error = getaddrinfo(node.c_str(), service, &hints, &results);
+    if(error){
+        SYLAR_LOG_DEBUG(g_logger) << "Address::Lookup getaddrinfo(" << host << ", "
+            << family << ", " << type << ") err=" << error << " errstr="
+            << gai_strerror(error);
+        return false;
+    }
+
+    next = results;
+    while(next){
+        Address::ptr addr = Create(next->ai_addr, (socklen_t)next->ai_addrlen);
+        if(addr){
+            result.push_back(addr);
+        }
+        next = next->ai_next;
+    }
+
+    freeaddrinfo(results);
+    return !result.empty();
+}
+
+Address::ptr Address::LookupAny(const std::string& host,
+                                int family, int type, int protocol)
+{
+    std::vector<Address::ptr> result;
+    if(Lookup(result, host, family, type, protocol)){
+        return result[0];
+    }
+    return nullptr;
+}
+
+IPAddress::ptr Address::LookupAnyIPAddress(const std::string& host,
+                                           int family, int type, int protocol)
+{
+    std::vector<Address::ptr> result;
+    if(Lookup(result, host, family, type, protocol)){
+        for(auto& i : result){
+            IPAddress::ptr v = std::dynamic_pointer_cast<IPAddress>(i);
+            if(v){
+                return v;
+            }
+        }
+    }
+    return nullptr;
+}
+
+int Address::getFamily() const
+{
+    return getAddr()->sa_family;
+}
+
+std::ostream& Address::insert(std::ostream& os) const
+{
+    char buf[MAX_FORMAT_LEN];
+    return os.write(buf, format(buf));
+}
+
+std::string Address::toString() const
+{
+    char buf[MAX_FORMAT_LEN];
+    return std::string(buf, format(buf));
+}
+
+bool Address::operator<(const Address& rhs) const
+{
+    socklen_t minlen = std::min(getAddrLen(), rhs.getAddrLen());
+    int result = memcmp(getAddr(), rhs.getAddr(), minlen);
+    if(result < 0){
+        return true;
+    }
+    else if(result > 0){
+        return false;
+    }
+    return getAddrLen() < rhs.getAddrLen();
+}
+
+bool Address::operator==(const Address& rhs) const
+{
+    return getAddrLen() == rhs.getAddrLen()
+        && memcmp(getAddr(), rhs.getAddr(), getAddrLen()) == 0;
+}
+
+bool Address::operator!=(const Address& rhs) const
+{
+    return !(*this == rhs);
+}
+
+IPAddress::ptr IPAddress::Create(const char* address, uint16_t port)
+{
+    addrinfo hints, *results;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_flags = AI_NUMERICHOST;
+    hints.ai_family = AF_UNSPEC;
+
+    int error = getaddrinfo(address, nullptr, &hints, &results);
+    if(error){
+        SYLAR_LOG_DEBUG(g_logger) << "IPAddress::Create(" << address << ", " << port
+            << ") error=" << error << " errstr=" << gai_strerror(error);
+        return nullptr;
+    }
+
+    IPAddress::ptr result = std::dynamic_pointer_cast<IPAddress>(
+            Address::Create(results->ai_addr, (socklen_t)results->ai_addrlen));
+    if(result){
+        result->setPort(port);
+    }
+    freeaddrinfo(results);
+    return result;
+}
+
+IPv4Address::ptr IPv4Address::Create(const char* address, uint16_t port)
+{
+    IPv4Address::ptr rt(new IPv4Address);
+    rt->m_addr.sin_port = htons(port);
+    int result = inet_pton(AF_INET, address, &rt->m_addr.sin_addr);
+    if(result <= 0){
+        SYLAR_LOG_DEBUG(g_logger) << "IPv4Address::Create(" << address << ", "
+            << port << ") rt=" << result << " errno=" << errno;
+        return nullptr;
+    }
+    return rt;
+}
+
+IPv4Address::IPv4Address(const sockaddr_in& address)
+{
+    m_addr = address;
+}
+
+IPv4Address::IPv4Address(uint32_t address, uint16_t port)
+{
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_addr.sin_family = AF_INET;
+    m_addr.sin_port = htons(port);
+    m_addr.sin_addr.s_addr = htonl(address);
+}
+
+const sockaddr* IPv4Address::getAddr() const
+{
+    return (const sockaddr*)&m_addr;
+}
+
+sockaddr* IPv4Address::getAddr()
+{
+    return (sockaddr*)&m_addr;
+}
+
+socklen_t IPv4Address::getAddrLen() const
+{
+    return sizeof(m_addr);
+}
+
+size_t IPv4Address::format(char* buf) const
+{
+    // s_addr是网络字节序, 按内存顺序就是点分的顺序
+    const uint8_t* a = (const uint8_t*)&m_addr.sin_addr.s_addr;
+    char* p = buf;
+    for(int i = 0; i < 4; ++i){
+        if(i){
+            *p++ = '.';
+        }
+        p = AppendUint(p, a[i]);
+    }
+    *p++ = ':';
+    p = AppendUint(p, ntohs(m_addr.sin_port));
+    return p - buf;
+}
+
+uint16_t IPv4Address::getPort() const
+{
+    return ntohs(m_addr.sin_port);
+}
+
+void IPv4Address::setPort(uint16_t v)
+{
+    m_addr.sin_port = htons(v);
+}
+
+IPv6Address::ptr IPv6Address::Create(const char* address, uint16_t port)
+{
+    IPv6Address::ptr rt(new IPv6Address);
+    rt->m_addr.sin6_port = htons(port);
+    int result = inet_pton(AF_INET6, address, &rt->m_addr.sin6_addr);
+    if(result <= 0){
+        SYLAR_LOG_DEBUG(g_logger) << "IPv6Address::Create(" << address << ", "
+            << port << ") rt=" << result << " errno=" << errno;
+        return nullptr;
+    }
+    return rt;
+}
+
+IPv6Address::IPv6Address()
+{
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_addr.sin6_family = AF_INET6;
+}
+
+IPv6Address::IPv6Address(const sockaddr_in6& address)
+{
+    m_addr = address;
+}
+
+IPv6Address::IPv6Address(const uint8_t address[16], uint16_t port)
+{
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_addr.sin6_family = AF_INET6;
+    m_addr.sin6_port = htons(port);
+    memcpy(&m_addr.sin6_addr.s6_addr, address, 16);
+}
+
+const sockaddr* IPv6Address::getAddr() const
+{
+    return (const sockaddr*)&m_addr;
+}
+
+sockaddr* IPv6Address::getAddr()
+{
+    return (sockaddr*)&m_addr;
+}
+
+socklen_t IPv6Address::getAddrLen() const
+{
+    return sizeof(m_addr);
+}
+
+size_t IPv6Address::format(char* buf) const
+{
+    const uint8_t* a = m_addr.sin6_addr.s6_addr;
+    uint16_t groups[8];
+    for(int i = 0; i < 8; ++i){
+        groups[i] = (uint16_t)(a[i * 2] << 8 | a[i * 2 + 1]);
+    }
+
+    // 最长的连续零组(至少两组)压缩成 ::, 长度相同取第一段
+    int best = -1;
+    int best_len = 0;
+    for(int i = 0; i < 8;){
+        if(groups[i]){
+            ++i;
+            continue;
+        }
+        int j = i;
+        while(j < 8 && groups[j] == 0){
+            ++j;
+        }
+        if(j - i > best_len){
+            best = i;
+            best_len = j - i;
+        }
+        i = j;
+    }
+    if(best_len < 2){
+        best = -1;
+    }
+
+    char* p = buf;
+    *p++ = '[';
+    for(int i = 0; i < 8; ++i){
+        if(i == best){
+            *p++ = ':';
+            if(i == 0){
+                *p++ = ':';
+            }
+            i += best_len - 1;
+            continue;
+        }
+        p = AppendHex16(p, groups[i]);
+        if(i < 7){
+            *p++ = ':';
+        }
+    }
+    *p++ = ']';
+    *p++ = ':';
+    p = AppendUint(p, ntohs(m_addr.sin6_port));
+    return p - buf;
+}
+
+uint16_t IPv6Address::getPort() const
+{
+    return ntohs(m_addr.sin6_port);
+}
+
+void IPv6Address::setPort(uint16_t v)
+{
+    m_addr.sin6_port = htons(v);
+}
+
+static const size_t MAX_PATH_LEN = sizeof(((sockaddr_un*)0)->sun_path) - 1;
+
+UnixAddress::UnixAddress()
+{
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_addr.sun_family = AF_UNIX;
+    m_length = offsetof(sockaddr_un, sun_path) + MAX_PATH_LEN;
+}
+
+UnixAddress::UnixAddress(const std::string& path)
+{
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_addr.sun_family = AF_UNIX;
+    m_length = path.size() + 1;
+
+    // 抽象命名空间的地址不需要结尾的'\0'
+    if(!path.empty() && path[0] == '\0'){
+        --m_length;
+    }
+    if(m_length > sizeof(m_addr.sun_path)){
+        throw std::logic_error("path too long");
+    }
+    memcpy(m_addr.sun_path, path.c_str(), m_length);
+    m_length += offsetof(sockaddr_un, sun_path);
+}
+
+const sockaddr* UnixAddress::getAddr() const
+{
+    return (const sockaddr*)&m_addr;
+}
+
+sockaddr* UnixAddress::getAddr()
+{
+    return (sockaddr*)&m_addr;
+}
+
+socklen_t UnixAddress::getAddrLen() const
+{
+    return m_length;
+}
+
+void UnixAddress::setAddrLen(socklen_t v)
+{
+    m_length = v;
+}
+
+std::string UnixAddress::getPath() const
+{
+    char buf[MAX_FORMAT_LEN];
+    return std::string(buf, format(buf));
+}
+
+size_t UnixAddress::format(char* buf) const
+{
+    size_t path_len = m_length > offsetof(sockaddr_un, sun_path)
+                    ? m_length - offsetof(sockaddr_un, sun_path) : 0;
+    char* p = buf;
+    if(path_len > 0 && m_addr.sun_path[0] == '\0'){
+        p = AppendStr(p, "\\0", 2);
+        p = AppendStr(p, m_addr.sun_path + 1, path_len - 1);
+    }
+    else{
+        p = AppendStr(p, m_addr.sun_path, strnlen(m_addr.sun_path, path_len));
+    }
+    return p - buf;
+}
+
+UnknownAddress::UnknownAddress(int family)
+{
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_addr.sa_family = family;
+}
+
+UnknownAddress::UnknownAddress(const sockaddr& addr)
+{
+    m_addr = addr;
+}
+
+const sockaddr* UnknownAddress::getAddr() const
+{
+    return &m_addr;
+}
+
+sockaddr* UnknownAddress::getAddr()
+{
+    return &m_addr;
+}
+
+socklen_t UnknownAddress::getAddrLen() const
+{
+    return sizeof(m_addr);
+}
+
+size_t UnknownAddress::format(char* buf) const
+{
+    char* p = buf;
+    p = AppendStr(p, "[UnknownAddress family=", 23);
+    p = AppendUint(p, m_addr.sa_family);
+    *p++ = ']';
+    return p - buf;
+}
+
+std::ostream& operator<<(std::ostream& os, const Address& addr)
+{
+    return addr.insert(os);
+}
+
+}
@@ -0,0 +1,157 @@
+#ifndef __SYLAR_ADDRESS_H__
+#define __SYLAR_ADDRESS_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+namespace sylar{
+
+class IPAddress;
+
+// 网络地址基类, 封装sockaddr
+// toString/insert 直接在栈上的字符数组里格式化, 不经过ostream逐段输出和inet_ntop,
+// 日志和访问记录里频繁打印地址时开销很小
+class Address{
+public:
+    typedef std::shared_ptr<Address> ptr;
+
+    // 格式化结果的最大长度, 足够容纳 [IPv6]:port 和unix路径
+    static const size_t MAX_FORMAT_LEN = 128;
+
+    // 按sockaddr的地址族创建对应的地址对象, 失败返回nullptr
+    static Address::ptr Create(const sockaddr* addr, socklen_t addrlen);
+
+    // 解析 host[:port], host可以是域名、IPv4、[IPv6], 结果追加到result
+    // family/type/protocol 作为getaddrinfo的过滤条件
+    static bool Lookup(std::vector<Address::ptr>& result, const std::string& host,
+            int family = AF_INET, int type = 0, int protocol = 0);
+    // 返回第一个解析结果
+    static Address::ptr LookupAny(const std::string& host,
+            int family = AF_INET, int type = 0, int protocol = 0);
+    // 返回第一个IP地址
+    static std::shared_ptr<IPAddress> LookupAnyIPAddress(const std::string& host,
+            int family = AF_INET, int type = 0, int protocol = 0);
+
+    virtual ~Address() {}
+
+    int getFamily() const;
+
+    virtual const sockaddr* getAddr() const = 0;
+    virtual sockaddr* getAddr() = 0;
+    virtual socklen_t getAddrLen() const = 0;
+
+    // 把地址格式化到buf(至少MAX_FORMAT_LEN字节), 返回长度, 不以'\0'结尾
+    virtual size_t format(char* buf) const = 0;
+
+    std::ostream& insert(std::ostream& os) const;
+    std::string toString() const;
+
+    bool operator<(const Address& rhs) const;
+    bool operator==(const Address& rhs) const;
+    bool operator!=(const Address& rhs) const;
+};
+
+// IP地址
+class IPAddress : public Address{
+public:
+    typedef std::shared_ptr<IPAddress> ptr;
+
+    // 数字形式的IPv4/IPv6地址, 不做域名解析
+    static IPAddress::ptr Create(const char* address, uint16_t port = 0);
+
+    virtual uint16_t getPort() const = 0;
+    virtual void setPort(uint16_t v) = 0;
+};
+
+class IPv4Address : public IPAddress{
+public:
+    typedef std::shared_ptr<IPv4Address> ptr;
+
+    // 点分十进制地址, 失败返回nullptr
+    static IPv4Address::ptr Create(const char* address, uint16_t port = 0);
+
+    IPv4Address(const sockaddr_in& address);
+    // address 为主机字节序
+    IPv4Address(uint32_t address = INADDR_ANY, uint16_t port = 0);
+
+    const sockaddr* getAddr() const override;
+    sockaddr* getAddr() override;
+    socklen_t getAddrLen() const override;
+    size_t format(char* buf) const override;
+
+    uint16_t getPort() const override;
+    void setPort(uint16_t v) override;
+private:
+    sockaddr_in m_addr;
+};
+
+class IPv6Address : public IPAddress{
+public:
+    typedef std::shared_ptr<IPv6Address> ptr;
+
+    static IPv6Address::ptr Create(const char* address, uint16_t port = 0);
+
+    IPv6Address();
+    IPv6Address(const sockaddr_in6& address);
+    // address 为网络字节序的16字节地址
+    IPv6Address(const uint8_t address[16], uint16_t port = 0);
+
+    const sockaddr* getAddr() const override;
+    sockaddr* getAddr() override;
+    socklen_t getAddrLen() const override;
+    size_t format(char* buf) const override;
+
+    uint16_t getPort() const override;
+    void setPort(uint16_t v) override;
+private:
+    sockaddr_in6 m_addr;
+};
+
+// Unix域地址, 以'\0'开头的路径为抽象命名空间
+class UnixAddress : public Address{
+public:
+    typedef std::shared_ptr<UnixAddress> ptr;
+
+    UnixAddress();
+    UnixAddress(const std::string& path);
+
+    const sockaddr* getAddr() const override;
+    sockaddr* getAddr() override;
+    socklen_t getAddrLen() const override;
+    void setAddrLen(socklen_t v);
+    std::string getPath() const;
+    size_t format(char* buf) const override;
+private:
+    sockaddr_un m_addr;
+    socklen_t m_length;
+};
+
+// 不支持的地址族
+class UnknownAddress : public Address{
+public:
+    typedef std::shared_ptr<UnknownAddress> ptr;
+
+    UnknownAddress(int family);
+    UnknownAddress(const sockaddr& addr);
+
+    const sockaddr* getAddr() const override;
+    sockaddr* getAddr() override;
+    socklen_t getAddrLen() const override;
+    size_t format(char* buf) const override;
+private:
+    sockaddr m_addr;
+};
+
+std::ostream& operator<<(std::ostream& os, const Address& addr);
+
+}
+
+#endif
@@ -0,0 +1,164 @@
+#include "backtrace.h"
+#include "mutex.h"
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <cxxabi.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <sstream>
+#include <unordered_map>
+
+namespace sylar{
+
+// glibc的backtrace第一次调用时会加载libgcc_s, 提前做掉, 之后的捕获不再有动态加载和内存分配
+struct BacktraceIniter{
+    BacktraceIniter(){
+        void* buf[1];
+        ::backtrace(buf, 1);
+    }
+};
+
+static BacktraceIniter __backtrace_init;
+
+const int Backtrace::MAX_FRAMES;
+
+static thread_local bool t_capturing = false;
+
+struct SymbolInfo{
+    std::string symbol;     // 函数+偏移 (模块+偏移)
+    std::string name;       // 函数名
+};
+
+typedef std::unordered_map<void*, SymbolInfo> SymbolCache;
+
+// 不析构, 进程退出时其它静态对象的析构函数里仍可以输出调用栈
+static SymbolCache& GetCache()
+{
+    static SymbolCache* s_cache = new SymbolCache;
+    return *s_cache;
+}
+
+static RWMutex& GetCacheMutex()
+{
+    static RWMutex* s_mutex = new RWMutex;
+    return *s_mutex;
+}
+
+Backtrace::ptr Backtrace::Capture(int skip, int max_frames)
+{
+    max_frames = std::min(std::max(max_frames, 1), MAX_FRAMES);
+    skip = std::max(skip, 0);
+    // 多取一层Capture本身
+    void* buf[MAX_FRAMES * 2 + 1];
+    t_capturing = true;
+    int n = ::backtrace(buf, std::min(max_frames + skip + 1, MAX_FRAMES * 2 + 1));
+    t_capturing = false;
+    Backtrace::ptr bt(new Backtrace);
+    if(n > skip + 1){
+        bt->m_frames.assign(buf + skip + 1, buf + n);
+    }
+    return bt;
+}
+
+bool Backtrace::IsCapturing()
+{
+    return t_capturing;
+}
+
+std::string Backtrace::Demangle(const char* name)
+{
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    if(status != 0 || !demangled){
+        return name;
+    }
+    std::string rt(demangled);
+    free(demangled);
+    return rt;
+}
+
+static SymbolInfo DoSymbolize(void* addr)
+{
+    char buf[64];
+    SymbolInfo rt;
+    Dl_info info;
+    memset(&info, 0, sizeof(info));
+    if(!dladdr(addr, &info)){
+        rt.symbol = "??";
+        rt.name = "[unknown]";
+        return rt;
+    }
+    const char* module = nullptr;
+    if(info.dli_fname){
+        module = strrchr(info.dli_fname, '/');
+        module = module ? module + 1 : info.dli_fname;
+    }
+    if(info.dli_sname && info.dli_saddr){
+        rt.name = Backtrace::Demangle(info.dli_sname);
+        snprintf(buf, sizeof(buf), "+0x%lx", (unsigned long)((char*)addr - (char*)info.dli_saddr));
+        rt.symbol = rt.name + buf;
+    }
+    else{
+        rt.symbol = "??";
+        rt.name = std::string("[") + (module ? module : "unknown") + "]";
+    }
+    if(module){
+        // 偏移相对于模块加载地址, 可直接交给addr2line
+        snprintf(buf, sizeof(buf), "+0x%lx)", (unsigned long)((char*)addr - (char*)info.dli_fbase));
+        rt.symbol = rt.symbol + " (" + module + buf;
+    }
+    return rt;
+}
+
+static const SymbolInfo& Lookup(void* addr)
+{
+    // 缓存只增不删, unordered_map的元素地址在rehash后不变
+    {
+        RWMutex::ReadLock lock(GetCacheMutex());
+        auto it = GetCache().find(addr);
+        if(it != GetCache().end()){
+            return it->second;
+        }
+    }
+    SymbolInfo info = DoSymbolize(addr);
+    RWMutex::WriteLock lock(GetCacheMutex());
+    return GetCache().insert(std::make_pair(addr, std::move(info))).first->second;
+}
+
+std::string Backtrace::Symbolize(void* addr)
+{
+    return Lookup(addr).symbol;
+}
+
+std::string Backtrace::SymbolName(void* addr)
+{
+    return Lookup(addr).name;
+}
+
+std::ostream& Backtrace::dump(std::ostream& os, const std::string& prefix, size_t max_frames) const
+{
+    char buf[48];
+    size_t n = std::min(max_frames, m_frames.size());
+    for(size_t i = 0; i < n; ++i){
+        snprintf(buf, sizeof(buf), "#%-2lu %p ", (unsigned long)i, m_frames[i]);
+        // 除第一层外都是返回地址, 减1落回call指令, 与profiler的处理一致,
+        // 避免函数末尾的调用算到下一个函数, 偏移也对应addr2line的调用行
+        void* addr = i == 0 ? m_frames[0] : (void*)((char*)m_frames[i] - 1);
+        os << prefix << buf << Symbolize(addr);
+        if(i + 1 < n){
+            os << "\n";
+        }
+    }
+    return os;
+}
+
+std::string Backtrace::toString(const std::string& prefix, size_t max_frames) const
+{
+    std::stringstream ss;
+    dump(ss, prefix, max_frames);
+    return ss.str();
+}
+
+}
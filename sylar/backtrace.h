@@ -0,0 +1,47 @@
+#ifndef __SYLAR_BACKTRACE_H__
+#define __SYLAR_BACKTRACE_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <ostream>
+
+namespace sylar{
+
+// 调用栈
+// Capture 只保存各层的返回地址, 不做符号化, 开销在微秒级
+// 输出时才用 dladdr 查找符号并反修饰, 结果按地址缓存, 同一个地址只解析一次
+// 可执行文件需要以 -rdynamic 链接(本项目已开启)才能查到其中的符号;
+// static函数等没有导出的符号只输出 模块+偏移, 可以用 addr2line -e 模块 偏移 解析
+class Backtrace{
+public:
+    typedef std::shared_ptr<Backtrace> ptr;
+    static const int MAX_FRAMES = 64;
+
+    // skip 为跳过的层数, 0 表示从调用Capture的函数开始
+    static Backtrace::ptr Capture(int skip = 0, int max_frames = MAX_FRAMES);
+    // 当前线程是否正在Capture中展开调用栈, 供信号处理函数判断能否再次展开
+    static bool IsCapturing();
+
+    const std::vector<void*>& getFrames() const { return m_frames;}
+    size_t size() const { return m_frames.size();}
+
+    // 每层一行: prefix#序号 地址 符号+偏移 (模块+偏移)
+    // 第一层之外的地址是返回地址, 按 地址-1 (call指令) 解析符号
+    std::ostream& dump(std::ostream& os, const std::string& prefix = "    "
+                       ,size_t max_frames = MAX_FRAMES) const;
+    std::string toString(const std::string& prefix = "    ", size_t max_frames = MAX_FRAMES) const;
+
+    // 单个地址的符号, 带缓存
+    static std::string Symbolize(void* addr);
+    // 只有函数名, 不带偏移和模块; 没有符号时为 [模块名], 用于按函数聚合
+    static std::string SymbolName(void* addr);
+    // 反修饰C++符号名, 失败时原样返回
+    static std::string Demangle(const char* name);
+private:
+    std::vector<void*> m_frames;
+};
+
+}
+
+#endif
@@ -0,0 +1,690 @@
+#include "bytearray.h"
+#include "endian.h"
+#include "log.h"
+#include "lockfree/object_pool.h"
+#include <string.h>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <limits>
+
+namespace sylar{
+
+static Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+namespace {
+
+// 默认大小的内存块, 从对象池分配
+// 构造函数什么都不做, 避免New()时把4K内存清零
+struct PoolBlock{
+    PoolBlock(){}
+    char data[4096];
+};
+
+typedef ObjectPool<PoolBlock> BlockPool;
+
+char* AllocBlock(size_t s)
+{
+    if(s == sizeof(PoolBlock)){
+        return BlockPool::New()->data;
+    }
+    return new char[s];
+}
+
+void FreeBlock(char* p, size_t s)
+{
+    if(s == sizeof(PoolBlock)){
+        BlockPool::Delete(reinterpret_cast<PoolBlock*>(p));
+    }
+    else{
+        delete[] p;
+    }
+}
+
+uint32_t EncodeZigzag32(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+uint64_t EncodeZigzag64(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+int32_t DecodeZigzag32(uint32_t v)
+{
+    return (int32_t)((v >> 1) ^ -(v & 1));
+}
+
+int64_t DecodeZigzag64(uint64_t v)
+{
+    return (int64_t)((v >> 1) ^ -(v & 1));
+}
+
+// 编码varint, 返回字节数, tmp至少要有(sizeof(T) * 8 + 6) / 7字节
+template<class T>
+size_t EncodeVarint(T v, uint8_t* tmp)
+{
+    size_t i = 0;
+    while(v >= 0x80){
+        tmp[i++] = (uint8_t)((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    tmp[i++] = (uint8_t)v;
+    return i;
+}
+
+}
+
+ByteArray::Node::Node(size_t s)
+    :ptr(AllocBlock(s))
+    ,next(nullptr)
+    ,size(s){
+}
+
+ByteArray::Node::Node()
+    :ptr(nullptr)
+    ,next(nullptr)
+    ,size(0){
+}
+
+ByteArray::Node::~Node()
+{
+    if(ptr){
+        FreeBlock(ptr, size);
+    }
+}
+
+ByteArray::ByteArray(size_t base_size)
+    :m_baseSize(base_size ? base_size : 4096)
+    ,m_position(0)
+    ,m_capacity(m_baseSize)
+    ,m_size(0)
+    ,m_endian(SYLAR_BIG_ENDIAN)
+    ,m_root(new Node(m_baseSize))
+    ,m_tail(m_root)
+    ,m_cur(m_root){
+}
+
+ByteArray::~ByteArray()
+{
+    Node* tmp = m_root;
+    while(tmp){
+        m_cur = tmp;
+        tmp = tmp->next;
+        delete m_cur;
+    }
+}
+
+bool ByteArray::isLittleEndian() const
+{
+    return m_endian == SYLAR_LITTLE_ENDIAN;
+}
+
+void ByteArray::setIsLittleEndian(bool val)
+{
+    m_endian = val ? SYLAR_LITTLE_ENDIAN : SYLAR_BIG_ENDIAN;
+}
+
+void ByteArray::writeFint8(int8_t value)
+{
+    write(&value, sizeof(value));
+}
+
+void ByteArray::writeFuint8(uint8_t value)
+{
+    write(&value, sizeof(value));
+}
+
+#define XX(type, value) \
+    if(m_endian != SYLAR_BYTE_ORDER){ \
+        value = byteswap(value); \
+    } \
+    write(&value, sizeof(type));
+
+void ByteArray::writeFint16(int16_t value)
+{
+    XX(int16_t, value);
+}
+
+void ByteArray::writeFuint16(uint16_t value)
+{
+    XX(uint16_t, value);
+}
+
+void ByteArray::writeFint32(int32_t value)
+{
+    XX(int32_t, value);
+}
+
+void ByteArray::writeFuint32(uint32_t value)
+{
+    XX(uint32_t, value);
+}
+
+void ByteArray::writeFint64(int64_t value)
+{
+    XX(int64_t, value);
+}
+
+void ByteArray::writeFuint64(uint64_t value)
+{
+    XX(uint64_t, value);
+}
+
+#undef XX
+
+void ByteArray::writeInt32(int32_t value)
+{
+    writeUint32(EncodeZigzag32(value));
+}
+
+void ByteArray::writeUint32(uint32_t value)
+{
+    uint8_t tmp[5];
+    write(tmp, EncodeVarint(value, tmp));
+}
+
+void ByteArray::writeInt64(int64_t value)
+{
+    writeUint64(EncodeZigzag64(value));
+}
+
+void ByteArray::writeUint64(uint64_t value)
+{
+    uint8_t tmp[10];
+    write(tmp, EncodeVarint(value, tmp));
+}
+
+void ByteArray::writeFloat(float value)
+{
+    uint32_t v;
+    memcpy(&v, &value, sizeof(value));
+    writeFuint32(v);
+}
+
+void ByteArray::writeDouble(double value)
+{
+    uint64_t v;
+    memcpy(&v, &value, sizeof(value));
+    writeFuint64(v);
+}
+
+void ByteArray::writeStringF16(const std::string& value)
+{
+    if(value.size() > std::numeric_limits<uint16_t>::max()){
+        throw std::length_error("writeStringF16 string too long");
+    }
+    writeFuint16(value.size());
+    write(value.c_str(), value.size());
+}
+
+void ByteArray::writeStringF32(const std::string& value)
+{
+    if(value.size() > std::numeric_limits<uint32_t>::max()){
+        throw std::length_error("writeStringF32 string too long");
+    }
+    writeFuint32(value.size());
+    write(value.c_str(), value.size());
+}
+
+void ByteArray::writeStringF64(const std::string& value)
+{
+    writeFuint64(value.size());
+    write(value.c_str(), value.size());
+}
+
+void ByteArray::writeStringVint(const std::string& value)
+{
+    writeUint64(value.size());
+    write(value.c_str(), value.size());
+}
+
+void ByteArray::writeStringWithoutLength(const std::string& value)
+{
+    write(value.c_str(), value.size());
+}
+
+int8_t ByteArray::readFint8()
+{
+    int8_t v;
+    read(&v, sizeof(v));
+    return v;
+}
+
+uint8_t ByteArray::readFuint8()
+{
+    uint8_t v;
+    read(&v, sizeof(v));
+    return v;
+}
+
+#define XX(type) \
+    type v; \
+    read(&v, sizeof(v)); \
+    if(m_endian == SYLAR_BYTE_ORDER){ \
+        return v; \
+    } \
+    return byteswap(v);
+
+int16_t ByteArray::readFint16()
+{
+    XX(int16_t);
+}
+
+uint16_t ByteArray::readFuint16()
+{
+    XX(uint16_t);
+}
+
+int32_t ByteArray::readFint32()
+{
+    XX(int32_t);
+}
+
+uint32_t ByteArray::readFuint32()
+{
+    XX(uint32_t);
+}
+
+int64_t ByteArray::readFint64()
+{
+    XX(int64_t);
+}
+
+uint64_t ByteArray::readFuint64()
+{
+    XX(uint64_t);
+}
+
+#undef XX
+
+int32_t ByteArray::readInt32()
+{
+    return DecodeZigzag32(readUint32());
+}
+
+int64_t ByteArray::readInt64()
+{
+    return DecodeZigzag64(readUint64());
+}
+
+// 当前块里连续可读的字节足够容纳最长编码时直接在块内解码,
+// 否则(跨块或接近数据末尾)逐字节读取
+#define XX(type, maxlen) \
+    type result = 0; \
+    if(m_cur && getReadSize() >= maxlen && contiguous() >= maxlen){ \
+        const uint8_t* p = (const uint8_t*)m_cur->ptr + m_position % m_baseSize; \
+        size_t n = 0; \
+        for(size_t i = 0; n < maxlen; i += 7){ \
+            uint8_t b = p[n++]; \
+            result |= ((type)(b & 0x7F)) << i; \
+            if(b < 0x80){ \
+                break; \
+            } \
+        } \
+        advance(n); \
+        return result; \
+    } \
+    for(size_t i = 0, n = 0; n < maxlen; i += 7, ++n){ \
+        uint8_t b = readFuint8(); \
+        result |= ((type)(b & 0x7F)) << i; \
+        if(b < 0x80){ \
+            break; \
+        } \
+    } \
+    return result;
+
+uint32_t ByteArray::readUint32()
+{
+    XX(uint32_t, 5);
+}
+
+uint64_t ByteArray::readUint64()
+{
+    XX(uint64_t, 10);
+}
+
+#undef XX
+
+float ByteArray::readFloat()
+{
+    uint32_t v = readFuint32();
+    float value;
+    memcpy(&value, &v, sizeof(v));
+    return value;
+}
+
+double ByteArray::readDouble()
+{
+    uint64_t v = readFuint64();
+    double value;
+    memcpy(&value, &v, sizeof(v));
+    return value;
+}
+
+#define XX(len) \
+    if(len > getReadSize()){ \
+        throw std::out_of_range("not enough len"); \
+    } \
+    std::string buff; \
+    buff.resize(len); \
+    read(&buff[0], len); \
+    return buff;
+
+std::string ByteArray::readStringF16()
+{
+    uint16_t len = readFuint16();
+    XX(len);
+}
+
+std::string ByteArray::readStringF32()
+{
+    uint32_t len = readFuint32();
+    XX(len);
+}
+
+std::string ByteArray::readStringF64()
+{
+    uint64_t len = readFuint64();
+    XX(len);
+}
+
+std::string ByteArray::readStringVint()
+{
+    uint64_t len = readUint64();
+    XX(len);
+}
+
+#undef XX
+
+void ByteArray::clear()
+{
+    m_position = m_size = 0;
+    m_capacity = m_baseSize;
+    Node* tmp = m_root->next;
+    while(tmp){
+        m_cur = tmp;
+        tmp = tmp->next;
+        delete m_cur;
+    }
+    m_cur = m_root;
+    m_tail = m_root;
+    m_root->next = nullptr;
+}
+
+size_t ByteArray::contiguous() const
+{
+    return m_cur->size - m_position % m_baseSize;
+}
+
+void ByteArray::advance(size_t n)
+{
+    size_t npos = m_position % m_baseSize;
+    m_position += n;
+    if(npos + n == m_cur->size){
+        m_cur = m_cur->next;
+    }
+    if(m_position > m_size){
+        m_size = m_position;
+    }
+}
+
+void ByteArray::write(const void* buf, size_t size)
+{
+    if(size == 0){
+        return;
+    }
+    const char* src = (const char*)buf;
+    size_t npos = m_position % m_baseSize;
+    // 大多数写入落在当前块内且不到块尾, 只需要一次memcpy
+    if(m_cur && npos + size < m_cur->size){
+        memcpy(m_cur->ptr + npos, src, size);
+        m_position += size;
+        if(m_position > m_size){
+            m_size = m_position;
+        }
+        return;
+    }
+    addCapacity(size);
+
+    size_t ncap = m_cur->size - npos;
+    while(size > 0){
+        size_t n = std::min(ncap, size);
+        memcpy(m_cur->ptr + npos, src, n);
+        src += n;
+        size -= n;
+        advance(n);
+        if(size > 0){
+            npos = 0;
+            ncap = m_cur->size;
+        }
+    }
+}
+
+void ByteArray::read(void* buf, size_t size)
+{
+    if(size > getReadSize()){
+        throw std::out_of_range("not enough len");
+    }
+    if(size == 0){
+        return;
+    }
+
+    char* dst = (char*)buf;
+    size_t npos = m_position % m_baseSize;
+    if(npos + size < m_cur->size){
+        memcpy(dst, m_cur->ptr + npos, size);
+        m_position += size;
+        return;
+    }
+    size_t ncap = m_cur->size - npos;
+    while(size > 0){
+        size_t n = std::min(ncap, size);
+        memcpy(dst, m_cur->ptr + npos, n);
+        dst += n;
+        size -= n;
+        advance(n);
+        if(size > 0){
+            npos = 0;
+            ncap = m_cur->size;
+        }
+    }
+}
+
+void ByteArray::read(void* buf, size_t size, size_t position) const
+{
+    if(position > m_size || size > m_size - position){
+        throw std::out_of_range("not enough len");
+    }
+
+    Node* cur = m_root;
+    size_t count = position / m_baseSize;
+    while(count > 0){
+        cur = cur->next;
+        --count;
+    }
+
+    char* dst = (char*)buf;
+    size_t npos = position % m_baseSize;
+    size_t ncap = m_baseSize - npos;
+    while(size > 0){
+        size_t n = std::min(ncap, size);
+        memcpy(dst, cur->ptr + npos, n);
+        dst += n;
+        size -= n;
+        cur = cur->next;
+        npos = 0;
+        ncap = m_baseSize;
+    }
+}
+
+void ByteArray::setPosition(size_t v)
+{
+    if(v > m_capacity){
+        throw std::out_of_range("set_position out of range");
+    }
+    m_position = v;
+    if(m_position > m_size){
+        m_size = m_position;
+    }
+    m_cur = m_root;
+    while(m_cur && v >= m_cur->size){
+        v -= m_cur->size;
+        m_cur = m_cur->next;
+    }
+}
+
+bool ByteArray::writeToFile(const std::string& name) const
+{
+    std::ofstream ofs;
+    ofs.open(name, std::ios::trunc | std::ios::binary);
+    if(!ofs){
+        SYLAR_LOG_ERROR(g_logger) << "writeToFile name=" << name
+            << " error, errno=" << errno << " errstr=" << strerror(errno);
+        return false;
+    }
+
+    std::vector<iovec> iovs;
+    getReadBuffers(iovs);
+    for(auto& i : iovs){
+        ofs.write((const char*)i.iov_base, i.iov_len);
+    }
+    return (bool)ofs;
+}
+
+bool ByteArray::readFromFile(const std::string& name)
+{
+    std::ifstream ifs;
+    ifs.open(name, std::ios::binary);
+    if(!ifs){
+        SYLAR_LOG_ERROR(g_logger) << "readFromFile name=" << name
+            << " error, errno=" << errno << " errstr=" << strerror(errno);
+        return false;
+    }
+
+    std::vector<char> buff(m_baseSize);
+    while(ifs.read(&buff[0], buff.size()) || ifs.gcount() > 0){
+        write(&buff[0], ifs.gcount());
+    }
+    return true;
+}
+
+std::string ByteArray::toString() const
+{
+    std::string str;
+    str.resize(getReadSize());
+    if(str.empty()){
+        return str;
+    }
+    read(&str[0], str.size(), m_position);
+    return str;
+}
+
+std::string ByteArray::toHexString() const
+{
+    std::string str = toString();
+    std::stringstream ss;
+
+    for(size_t i = 0; i < str.size(); ++i){
+        if(i > 0 && i % 32 == 0){
+            ss << std::endl;
+        }
+        ss << std::setw(2) << std::setfill('0') << std::hex
+           << (int)(uint8_t)str[i] << " ";
+    }
+
+    return ss.str();
+}
+
+uint64_t ByteArray::getReadBuffers(std::vector<iovec>& buffers, uint64_t len) const
+{
+    return getReadBuffers(buffers, len, m_position);
+}
+
+uint64_t ByteArray::getReadBuffers(std::vector<iovec>& buffers
+                                   ,uint64_t len, uint64_t position) const{
+    if(position >= m_size){
+        return 0;
+    }
+    len = std::min<uint64_t>(len, m_size - position);
+    if(len == 0){
+        return 0;
+    }
+
+    Node* cur = m_root;
+    size_t count = position / m_baseSize;
+    while(count > 0){
+        cur = cur->next;
+        --count;
+    }
+
+    uint64_t size = len;
+    size_t npos = position % m_baseSize;
+    size_t ncap = cur->size - npos;
+    iovec iov;
+    while(len > 0){
+        size_t n = std::min<uint64_t>(ncap, len);
+        iov.iov_base = cur->ptr + npos;
+        iov.iov_len = n;
+        buffers.push_back(iov);
+        len -= n;
+        cur = cur->next;
+        npos = 0;
+        ncap = m_baseSize;
+    }
+    return size;
+}
+
+uint64_t ByteArray::getWriteBuffers(std::vector<iovec>& buffers, uint64_t len)
+{
+    if(len == 0){
+        return 0;
+    }
+    addCapacity(len);
+    uint64_t size = len;
+
+    Node* cur = m_cur;
+    size_t npos = m_position % m_baseSize;
+    size_t ncap = cur->size - npos;
+    iovec iov;
+    while(len > 0){
+        size_t n = std::min<uint64_t>(ncap, len);
+        iov.iov_base = cur->ptr + npos;
+        iov.iov_len = n;
+        buffers.push_back(iov);
+        len -= n;
+        cur = cur->next;
+        npos = 0;
+        ncap = m_baseSize;
+    }
+    return size;
+}
+
+void ByteArray::addCapacity(size_t size)
+{
+    size_t old_cap = getCapacity();
+    if(old_cap >= size){
+        return;
+    }
+
+    size = size - old_cap;
+    size_t count = (size + m_baseSize - 1) / m_baseSize;
+    Node* first = nullptr;
+    for(size_t i = 0; i < count; ++i){
+        m_tail->next = new Node(m_baseSize);
+        m_tail = m_tail->next;
+        if(!first){
+            first = m_tail;
+        }
+        m_capacity += m_baseSize;
+    }
+
+    // 原来的位置恰好在容量末尾, 当前块落到第一个新块上
+    if(old_cap == 0){
+        m_cur = first;
+    }
+}
+
+}
@@ -0,0 +1,147 @@
+#ifndef __SYLAR_BYTEARRAY_H__
+#define __SYLAR_BYTEARRAY_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "noncopyable.h"
+
+namespace sylar{
+
+// 二进制序列化缓冲区
+// 数据存放在固定大小内存块组成的链表中, 扩容只追加块, 不搬移已有数据
+// 默认大小(4K)的块从对象池分配, 反复创建销毁ByteArray不会频繁走malloc
+// 定长整数按设定的字节序(默认网络字节序)写入; 变长整数用varint, 有符号数先做zigzag
+// 读和写共用一个位置(position), 写完后setPosition(0)再读
+// 可读/可写区域能以iovec数组的形式导出, 直接用于readv/writev, 不需要额外拷贝
+// 持有内存块链表, 不可复制
+class ByteArray : Noncopyable{
+public:
+    typedef std::shared_ptr<ByteArray> ptr;
+
+    // 内存块
+    struct Node{
+        Node(size_t s);
+        Node();
+        ~Node();
+
+        char* ptr;
+        Node* next;
+        size_t size;
+    };
+
+    // base_size 每个内存块的大小
+    ByteArray(size_t base_size = 4096);
+    ~ByteArray();
+
+    // 定长整数
+    void writeFint8(int8_t value);
+    void writeFuint8(uint8_t value);
+    void writeFint16(int16_t value);
+    void writeFuint16(uint16_t value);
+    void writeFint32(int32_t value);
+    void writeFuint32(uint32_t value);
+    void writeFint64(int64_t value);
+    void writeFuint64(uint64_t value);
+
+    // 变长整数, 有符号数使用zigzag编码, 小的负数也只占很少的字节
+    void writeInt32(int32_t value);
+    void writeUint32(uint32_t value);
+    void writeInt64(int64_t value);
+    void writeUint64(uint64_t value);
+
+    void writeFloat(float value);
+    void writeDouble(double value);
+
+    // 长度前缀分别为 uint16_t/uint32_t/uint64_t 定长和varint
+    // 长度超出前缀的表示范围时抛出 std::length_error, 不写入任何数据
+    void writeStringF16(const std::string& value);
+    void writeStringF32(const std::string& value);
+    void writeStringF64(const std::string& value);
+    void writeStringVint(const std::string& value);
+    // 不带长度
+    void writeStringWithoutLength(const std::string& value);
+
+    // 可读数据不足时抛出 std::out_of_range
+    int8_t readFint8();
+    uint8_t readFuint8();
+    int16_t readFint16();
+    uint16_t readFuint16();
+    int32_t readFint32();
+    uint32_t readFuint32();
+    int64_t readFint64();
+    uint64_t readFuint64();
+
+    int32_t readInt32();
+    uint32_t readUint32();
+    int64_t readInt64();
+    uint64_t readUint64();
+
+    float readFloat();
+    double readDouble();
+
+    std::string readStringF16();
+    std::string readStringF32();
+    std::string readStringF64();
+    std::string readStringVint();
+
+    // 清空数据, 只保留第一个内存块
+    void clear();
+
+    void write(const void* buf, size_t size);
+    void read(void* buf, size_t size);
+    // 从position读取, 不改变当前位置
+    void read(void* buf, size_t size, size_t position) const;
+
+    size_t getPosition() const { return m_position;}
+    // 设置当前位置, 超过数据大小时数据大小随之增加
+    void setPosition(size_t v);
+
+    bool writeToFile(const std::string& name) const;
+    bool readFromFile(const std::string& name);
+
+    size_t getBaseSize() const { return m_baseSize;}
+    // 从当前位置起可读的字节数
+    size_t getReadSize() const { return m_size - m_position;}
+    size_t getSize() const { return m_size;}
+
+    bool isLittleEndian() const;
+    void setIsLittleEndian(bool val);
+
+    // 从当前位置起的可读数据
+    std::string toString() const;
+    std::string toHexString() const;
+
+    // 当前位置起最多len字节的可读区域, 返回实际长度, 不改变当前位置
+    uint64_t getReadBuffers(std::vector<iovec>& buffers, uint64_t len = ~0ull) const;
+    // 从position起最多len字节的可读区域
+    uint64_t getReadBuffers(std::vector<iovec>& buffers, uint64_t len, uint64_t position) const;
+    // 当前位置起len字节的可写区域, 容量不足时扩容, 写入后需要自己setPosition
+    uint64_t getWriteBuffers(std::vector<iovec>& buffers, uint64_t len);
+private:
+    // 保证从当前位置起至少有size字节的容量
+    void addCapacity(size_t size);
+    // 从当前位置起剩余的容量
+    size_t getCapacity() const { return m_capacity - m_position;}
+    // 当前块中从当前位置起连续的字节数
+    size_t contiguous() const;
+    // 在当前块内前进n字节, 不跨块
+    void advance(size_t n);
+private:
+    size_t m_baseSize;
+    size_t m_position;
+    size_t m_capacity;
+    size_t m_size;
+    int8_t m_endian;
+    Node* m_root;
+    Node* m_tail;
+    // 当前位置所在的块, 位置恰好在容量末尾时为nullptr
+    Node* m_cur;
+};
+
+}
+
+#endif
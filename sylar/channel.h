@@ -0,0 +1,152 @@
+#ifndef __SYLAR_CHANNEL_H__
+#define __SYLAR_CHANNEL_H__
+
+#include <deque>
+#include <memory>
+#include "fiber_sync.h"
+#include "macro.h"
+
+namespace sylar{
+
+// 有界协程通道, 类似Go的带缓冲channel
+// push在满时、pop在空时挂起当前协程; tryPush/tryPop从不挂起, 可以轮询多个通道实现select
+// close之后push失败, pop取完剩余元素后失败, 所有等待者都被唤醒
+// 被唤醒的协程重新检查状态, 名额可能已被其它协程抢走, 这时继续等待
+template<class T>
+class Channel : Noncopyable{
+public:
+    typedef std::shared_ptr<Channel> ptr;
+    typedef Spinlock MutexType;
+
+    // capacity至少为1
+    Channel(size_t capacity)
+        :m_capacity(capacity ? capacity : 1)
+        ,m_closed(false){
+    }
+
+    ~Channel(){
+        SYLAR_ASSERT(m_pushWaiters.empty() && m_popWaiters.empty());
+    }
+
+    // 通道已关闭返回false
+    bool push(const T& v){
+        return emplace(v, true);
+    }
+
+    bool push(T&& v){
+        return emplace(std::move(v), true);
+    }
+
+    // 已满或已关闭时立即返回false
+    bool tryPush(const T& v){
+        return emplace(v, false);
+    }
+
+    bool tryPush(T&& v){
+        return emplace(std::move(v), false);
+    }
+
+    // 通道已关闭且没有剩余元素时返回false
+    bool pop(T& v){
+        return take(v, true);
+    }
+
+    // 为空时立即返回false
+    bool tryPop(T& v){
+        return take(v, false);
+    }
+
+    void close(){
+        std::deque<FiberWaitQueue::Waiter> ws;
+        {
+            MutexType::Lock lock(m_mutex);
+            if(m_closed){
+                return;
+            }
+            m_closed = true;
+            m_pushWaiters.popAll(ws);
+            std::deque<FiberWaitQueue::Waiter> pop_ws;
+            m_popWaiters.popAll(pop_ws);
+            ws.insert(ws.end(), pop_ws.begin(), pop_ws.end());
+        }
+        for(auto& i : ws){
+            i.wake();
+        }
+    }
+
+    bool isClosed(){
+        MutexType::Lock lock(m_mutex);
+        return m_closed;
+    }
+
+    size_t size(){
+        MutexType::Lock lock(m_mutex);
+        return m_queue.size();
+    }
+
+    size_t capacity() const { return m_capacity;}
+private:
+    template<class U>
+    bool emplace(U&& v, bool block){
+        while(true){
+            FiberWaitQueue::Waiter w;
+            {
+                MutexType::Lock lock(m_mutex);
+                if(m_closed){
+                    return false;
+                }
+                if(m_queue.size() < m_capacity){
+                    m_queue.push_back(std::forward<U>(v));
+                    m_popWaiters.pop(w);
+                }
+                else if(!block){
+                    return false;
+                }
+                else{
+                    m_pushWaiters.push();
+                    lock.unlock();
+                    Fiber::YieldToHold();
+                    continue;
+                }
+            }
+            w.wake();
+            return true;
+        }
+    }
+
+    bool take(T& v, bool block){
+        while(true){
+            FiberWaitQueue::Waiter w;
+            {
+                MutexType::Lock lock(m_mutex);
+                if(!m_queue.empty()){
+                    v = std::move(m_queue.front());
+                    m_queue.pop_front();
+                    m_pushWaiters.pop(w);
+                }
+                else if(m_closed || !block){
+                    return false;
+                }
+                else{
+                    m_popWaiters.push();
+                    lock.unlock();
+                    Fiber::YieldToHold();
+                    continue;
+                }
+            }
+            w.wake();
+            return true;
+        }
+    }
+private:
+    MutexType m_mutex;
+    std::deque<T> m_queue;
+    size_t m_capacity;
+    bool m_closed;
+    FiberWaitQueue m_pushWaiters;
+    FiberWaitQueue m_popWaiters;
+};
+
+}
+
+#endif
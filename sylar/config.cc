@@ -1,17 +1,67 @@
 #include "config.h"
+#include "util.h"
+#include "thread.h"
+#include <atomic>
+#include <chrono>
 
 namespace sylar{
 
 // Config::ConfigVarMap Config::s_datas;
 
+ConfigKey::ConfigKey(const std::string& name)
+    :m_id(Config::Intern(name))
+    ,m_name(name){
+}
+
 ConfigVarBase::ptr Config::LookupBase(const std::string &name)
 {
-    auto it = GetDatas().find(name);
-    // std::cout << (it == GetDatas().end()) << std::endl;
-    return it == GetDatas().end() ? nullptr : it->second;
+    RWMutexType::ReadLock lock(GetMutex());
+    auto it = GetIds().find(name);
+    // std::cout << (it == GetIds().end()) << std::endl;
+    return it == GetIds().end() ? nullptr : GetDatas()[it->second];
+}
+
+ConfigVarBase::ptr Config::LookupBase(const ConfigKey& key)
+{
+    RWMutexType::ReadLock lock(GetMutex());
+    return GetDatas()[key.getId()];
 }
 
-static void ListAllMember(const std::string& prefix, const YAML::Node& node, 
+uint32_t Config::InternLocked(const std::string& name)
+{
+    // insert 在key已存在时不会覆盖, 返回已有的元素
+    auto rt = GetIds().insert(std::make_pair(name, (uint32_t)GetDatas().size()));
+    if(rt.second){
+        GetDatas().push_back(nullptr);
+    }
+    return rt.first->second;
+}
+
+uint32_t Config::Intern(const std::string& name)
+{
+    {
+        RWMutexType::ReadLock lock(GetMutex());
+        auto it = GetIds().find(name);
+        if(it != GetIds().end()){
+            return it->second;
+        }
+    }
+    RWMutexType::WriteLock lock(GetMutex());
+    return InternLocked(name);
+}
+
+ConfigVarBase::ptr Config::Register(ConfigVarBase::ptr var)
+{
+    RWMutexType::WriteLock lock(GetMutex());
+    ConfigVarBase::ptr& slot = GetDatas()[InternLocked(var->getName())];
+    // 同名配置已存在时不覆盖
+    if(!slot){
+        slot = var;
+    }
+    return slot;
+}
+
+void Config::ListAllMember(const std::string& prefix, const YAML::Node& node, 
         std::list<std::pair<std::string, const YAML::Node>>& output){
     if(prefix.find_last_not_of("abcdefghijklmnopqrstuvwxyz._0123456789") != std::string::npos){
         SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "Config invalid name: " << prefix << " : " << node;
@@ -57,4 +107,75 @@ void Config::LoadFromYaml(const YAML::Node &root)
 }
 
 
-}
\ No newline at end of file
+
+// 将src合并进dst: 双方都是map时逐个key递归合并, 否则src覆盖dst
+static void MergeNode(YAML::Node dst, const YAML::Node& src){
+    for(auto it = src.begin(); it != src.end(); ++it){
+        const std::string& key = it->first.Scalar();
+        YAML::Node child = dst[key];
+        if(child.IsMap() && it->second.IsMap()){
+            MergeNode(child, it->second);
+        }
+        else{
+            dst[key] = it->second;
+        }
+    }
+}
+
+void Config::LoadFromConfDir(const std::string &path)
+{
+    static sylar::Logger::ptr s_logger = SYLAR_LOG_NAME("system");
+    std::vector<std::string> files;
+    FSUtil::ListAllFile(files, path, ".yml");
+    std::sort(files.begin(), files.end());
+    if(files.empty()){
+        return;
+    }
+
+    // 每个线程领取下一个未解析的文件, 解析结果按下标存放, 合并顺序与解析顺序无关
+    std::vector<YAML::Node> nodes(files.size());
+    std::vector<std::string> errors(files.size());
+    std::vector<uint64_t> costs(files.size(), 0);
+    std::atomic<size_t> next(0);
+    auto worker = [&](){
+        size_t i = 0;
+        while((i = next++) < files.size()){
+            auto begin = std::chrono::steady_clock::now();
+            try{
+                nodes[i] = YAML::LoadFile(files[i]);
+            }catch(std::exception& e){
+                errors[i] = e.what();
+            }
+            costs[i] = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - begin).count();
+        }
+    };
+
+    size_t thread_num = std::min<size_t>(files.size(), 
+            std::max<unsigned>(1, std::min<unsigned>(4, std::thread::hardware_concurrency())));
+    std::vector<Thread::ptr> thrs;
+    for(size_t i = 1; i < thread_num; ++i){
+        thrs.push_back(Thread::ptr(new Thread(worker, "conf_load_" + std::to_string(i))));
+    }
+    worker();
+    for(auto& i : thrs){
+        i->join();
+    }
+
+    YAML::Node root(YAML::NodeType::Map);
+    for(size_t i = 0; i < files.size(); ++i){
+        if(!errors[i].empty()){
+            SYLAR_LOG_ERROR(s_logger) << "LoadConfFile file=" << files[i]
+                << " failed: " << errors[i];
+            continue;
+        }
+        SYLAR_LOG_INFO(s_logger) << "LoadConfFile file=" << files[i]
+            << " parse_us=" << costs[i];
+        if(nodes[i].IsMap()){
+            MergeNode(root, nodes[i]);
+        }
+    }
+    LoadFromYaml(root);
+}
+
+}
@@ -8,6 +8,9 @@
 #include <map>
 #include <boost/lexical_cast.hpp>
 #include "log.h"
+#include "mutex.h"
+#include "macro.h"
+#include "lexical_cast.h"
 #include <yaml-cpp/yaml.h>
 #include <vector>
 #include <list>
@@ -16,14 +19,22 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <functional>
+#include <atomic>
 
 namespace sylar{
 
+// 每个类型一个唯一的地址, 用于配置项的类型检查, 代替dynamic_cast
+template<class T>
+const void* ConfigTypeId(){
+    static const char s_id = 0;
+    return &s_id;
+}
+
 class ConfigVarBase {
 public:
     typedef std::shared_ptr<ConfigVarBase> ptr;
     ConfigVarBase(const std::string& name, const std::string& description = "")
-        :m_name(name), m_description(description){
+        :m_name(name), m_description(description), m_typeId(nullptr){
             // std::transform 用来对一段序列中的每个元素进行操作, 前两个参数是输入，第三个参数是输出，第四个参数是单目操作
             // 由于 tolower 是一个 C 函数，它可以通过全局作用域 :: 调用，确保调用的是 C 标准库中的 tolower
             std::transform(m_name.begin(), m_name.end(), m_name.begin(), ::tolower);
@@ -39,10 +50,13 @@ public:
     virtual std::string toString() = 0;
     virtual bool fromString(const std::string& val) = 0;
     virtual std::string getTypeName() const = 0;
+    // 具体ConfigVar类型的ConfigTypeId
+    const void* getTypeId() const { return m_typeId;}
 
 protected:
     std::string m_name;
     std::string m_description;
+    const void* m_typeId;
 };
 
 // F from_type, T to_type
@@ -54,6 +68,44 @@ public:
     }
 };
 
+// 标量特化: 不经过 boost::lexical_cast 的 iostream/locale, 见 lexical_cast.h
+#define SYLAR_LEXICAL_CAST_SCALAR(T, parse, to_str) \
+template<> \
+class LexicalCast<std::string, T>{ \
+public: \
+    T operator()(const std::string& v){ \
+        return parse; \
+    } \
+}; \
+template<> \
+class LexicalCast<T, std::string>{ \
+public: \
+    std::string operator()(const T& v){ \
+        return to_str; \
+    } \
+};
+
+SYLAR_LEXICAL_CAST_SCALAR(short, ParseSigned<short>(v), Int64ToString(v))
+SYLAR_LEXICAL_CAST_SCALAR(int, ParseSigned<int>(v), Int64ToString(v))
+SYLAR_LEXICAL_CAST_SCALAR(long, ParseSigned<long>(v), Int64ToString(v))
+SYLAR_LEXICAL_CAST_SCALAR(long long, ParseSigned<long long>(v), Int64ToString(v))
+SYLAR_LEXICAL_CAST_SCALAR(unsigned short, ParseUnsigned<unsigned short>(v), UInt64ToString(v))
+SYLAR_LEXICAL_CAST_SCALAR(unsigned int, ParseUnsigned<unsigned int>(v), UInt64ToString(v))
+SYLAR_LEXICAL_CAST_SCALAR(unsigned long, ParseUnsigned<unsigned long>(v), UInt64ToString(v))
+SYLAR_LEXICAL_CAST_SCALAR(unsigned long long, ParseUnsigned<unsigned long long>(v), UInt64ToString(v))
+SYLAR_LEXICAL_CAST_SCALAR(float, ParseFloat(v.c_str(), v.size()), FloatToString(v))
+SYLAR_LEXICAL_CAST_SCALAR(double, ParseDouble(v.c_str(), v.size()), DoubleToString(v))
+SYLAR_LEXICAL_CAST_SCALAR(bool, ParseBool(v.c_str(), v.size()), std::string(v ? "true" : "false"))
+#undef SYLAR_LEXICAL_CAST_SCALAR
+
+template<>
+class LexicalCast<std::string, std::string>{
+public:
+    std::string operator()(const std::string& v){
+        return v;
+    }
+};
+
 // 容器偏特化
 // vector
 template<class T>
@@ -253,17 +305,22 @@ template<class T ,class FromStr = LexicalCast<std::string, T> ,
 class ConfigVar : public ConfigVarBase{
 public:
     typedef std::shared_ptr<ConfigVar> ptr;
+    typedef RWMutex RWMutexType;
+    typedef Mutex MutexType;
     // std::function 是 C++11 引入的一个模板类，它位于 <functional> 头文件中，
     // 用来封装任何可调用的目标（如普通函数、成员函数、函数对象、lambda 表达式等）。
     // 它提供了一个统一的接口，使得可以将这些不同的可调用对象作为参数传递或存储。
     typedef std::function<void (const T& old_value, const T& new_value)> on_change_cb;
 
     ConfigVar (const std::string& name, const T& default_value, const std::string& description = "")
-        : ConfigVarBase(name, description), m_val(default_value) {}
+        : ConfigVarBase(name, description), m_val(default_value) {
+        m_typeId = ConfigTypeId<ConfigVar>();
+    }
     
     std::string toString() override{
         try{
             // return boost::lexical_cast<std::string>(m_val);  // boost::lexical_cast 是类型转换工具
+            RWMutexType::ReadLock lock(m_mutex);
             return ToStr()(m_val);
         }catch(std::exception& e){
             // e.what() 返回发生异常时的错误信息
@@ -286,100 +343,220 @@ public:
         return false;
     }
 
-    const T getValue() const { return m_val;}
+    const T getValue() const {
+        RWMutexType::ReadLock lock(m_mutex);
+        return m_val;
+    }
+
     void setValue(const T& v) { 
-        // m_val = v;
+        // 修改依次进行, 回调按修改的顺序执行, 看到的旧值都是上一次修改的结果
+        // 回调在读写锁之外执行, 可以读取本配置项和增删回调, 但不能再修改本配置项
+        SYLAR_ASSERT2(m_notifyThread != GetThreadID(), "setValue in listener of " << m_name);
+        MutexType::Lock notify_lock(m_notifyMutex);
+        RWMutexType::WriteLock lock(m_mutex);
         if(v == m_val){
             return;
         }
-        for(auto& i : m_cbs){
-            i.second(m_val, v);
-        }
+        T old_value = m_val;
         m_val = v;
+        std::map<uint64_t, on_change_cb> cbs = m_cbs;
+        lock.unlock();
+
+        m_notifyThread = GetThreadID();
+        try{
+            for(auto& i : cbs){
+                i.second(old_value, v);
+            }
+        }catch(...){
+            m_notifyThread = 0;
+            throw;
+        }
+        m_notifyThread = 0;
     }
 
     std::string getTypeName() const override { return typeid(T).name();}
 
     void addListener(uint64_t key, on_change_cb cb){
+        RWMutexType::WriteLock lock(m_mutex);
         m_cbs[key] = cb;
     }
 
     void delListener(uint64_t key){
+        RWMutexType::WriteLock lock(m_mutex);
         m_cbs.erase(key);
     }
 
     on_change_cb getListener(uint64_t key){
+        RWMutexType::ReadLock lock(m_mutex);
         auto it = m_cbs.find(key);
         return it == m_cbs.end() ? nullptr : it->second;
     }
 
     void clearListener() {
+        RWMutexType::WriteLock lock(m_mutex);
         m_cbs.clear();
     }
 private:
+    mutable RWMutexType m_mutex;
+    // 串行化修改和回调
+    MutexType m_notifyMutex;
+    // 正在执行回调的线程
+    std::atomic<int> m_notifyThread {0};
     T m_val;
     // function函数没有比较函数，所以用map封装
     // 变更回调函数组, uint64_t key要求唯一，一般可以用hash
     std::map<uint64_t, on_change_cb> m_cbs;
 };
 
+// 配置项的轻量句柄, 只保存裸指针
+// 配置项注册后不会被删除, 句柄可长期持有, 访问时不再需要字符串查找和dynamic_cast
+template<class T>
+class ConfigHandle{
+public:
+    ConfigHandle()
+        :m_var(nullptr){}
+    ConfigHandle(const typename ConfigVar<T>::ptr& var)
+        :m_var(var.get()){}
+
+    bool isValid() const { return m_var != nullptr;}
+    ConfigVar<T>* get() const { return m_var;}
+    ConfigVar<T>* operator->() const { return m_var;}
+    const T getValue() const { return m_var->getValue();}
+private:
+    ConfigVar<T>* m_var;
+};
+
+// 驻留的配置名, 构造时对名称哈希一次换取id, 之后按id直接访问注册表
+// id在进程内不变, 可以定义为静态变量长期使用
+class ConfigKey{
+public:
+    explicit ConfigKey(const std::string& name);
+
+    uint32_t getId() const { return m_id;}
+    const std::string& getName() const { return m_name;}
+private:
+    uint32_t m_id;
+    std::string m_name;
+};
+
 class Config{
 public:
-    typedef std::map<std::string, ConfigVarBase::ptr> ConfigVarMap;
+    // 名称 -> id
+    typedef std::unordered_map<std::string, uint32_t> ConfigIdMap;
+    // id -> 配置项, 已驻留但未注册的名称为空
+    typedef std::vector<ConfigVarBase::ptr> ConfigVarVec;
+    typedef RWMutex RWMutexType;
 
     template<class T>
     // typename 关键字在这里的作用是明确声明 ConfigVar<T>::ptr 是一个类型，而不是一个变量、函数或其他对象。
     static typename ConfigVar<T>::ptr Lookup(const std::string& name, 
         const T& default_value,  const std::string& description = ""){
-        // auto tmp = Lookup<T>(name);
-        // if(tmp){
-        //     SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "Lookup name= " << name << " exists";
-        //     return tmp;
-        // }     
-        auto it = GetDatas().find(name);
-        if(it != GetDatas().end()){
-            auto tmp = std::dynamic_pointer_cast<ConfigVar<T>> (it->second);
-            if(tmp){
-                SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "Lookup name= " << name << " exists";
-                return tmp;
+        ConfigVarBase::ptr base = LookupBase(name);
+        if(!base){
+            // find_last_not_of() 返回的是字符串中最后一个不在给定字符集中的字符的位置，如果没有找到，则返回 std::string::npos
+            if(name.find_last_not_of("abcdefghijklmnopqrstuvwxyz._0123456789") 
+                    != std::string::npos){
+                SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "Lookup name invalid " << name;
+                throw std::invalid_argument(name);
             }
-            else{
-                SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "Lookup name= " << name << " exists but type not"
-                    << typeid(T).name() << " real_type=" << it->second->getTypeName() << " " 
-                    << it->second->toString();
-                return tmp;
+            typename ConfigVar<T>::ptr v(new ConfigVar<T>(name, default_value, description));
+            // 并发注册同名配置时以先注册的为准
+            base = Register(v);
+            if(base == v){
+                return v;
             }
         }
-        // find_last_not_of() 返回的是字符串中最后一个不在给定字符集中的字符的位置，如果没有找到，则返回 std::string::npos
-        if(name.find_last_not_of("abcdefghijklmnopqrstuvwxyz._0123456789") 
-                != std::string::npos){
-            SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "Lookup name invalid " << name;
-            throw std::invalid_argument(name);
-        }                                    
-        typename ConfigVar<T>::ptr v(new ConfigVar<T>(name, default_value, description));
-        GetDatas()[name] = v;
-        return v;
+        auto tmp = Cast<T>(base);
+        if(!tmp){
+            SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "Lookup name= " << name << " exists but type not"
+                << typeid(T).name() << " real_type=" << base->getTypeName() << " " 
+                << base->toString();
+        }
+        return tmp;
     }
 
     template<class T>
     static typename ConfigVar<T>::ptr Lookup(const std::string& name){
-        auto it = GetDatas().find(name);
-        if(it == GetDatas().end()) {
-            return nullptr;
-        }
-        // dynamic_pointer_cast 是 std::shared_ptr 提供的安全类型转换方法，用于将基类指针转换为派生类指针，如果类型不匹配，会返回 nullptr
-        return std::dynamic_pointer_cast<ConfigVar<T>> (it->second);
+        // 类型不匹配时返回 nullptr
+        return Cast<T>(LookupBase(name));
+    }
+
+    // 按驻留的名称查找, 不再哈希字符串
+    template<class T>
+    static typename ConfigVar<T>::ptr Lookup(const ConfigKey& key){
+        return Cast<T>(LookupBase(key));
+    }
+
+    template<class T>
+    static typename ConfigVar<T>::ptr Lookup(const ConfigKey& key,
+        const T& default_value,  const std::string& description = ""){
+        auto v = Lookup<T>(key);
+        return v ? v : Lookup(key.getName(), default_value, description);
+    }
+
+    // 查找或注册配置项并返回句柄, 只在此处付出一次查找和类型检查的开销
+    template<class T>
+    static ConfigHandle<T> GetHandle(const std::string& name, 
+        const T& default_value,  const std::string& description = ""){
+        return ConfigHandle<T>(Lookup(name, default_value, description));
+    }
+
+    template<class T>
+    static ConfigHandle<T> GetHandle(const std::string& name){
+        return ConfigHandle<T>(Lookup<T>(name));
+    }
+
+    template<class T>
+    static ConfigHandle<T> GetHandle(const ConfigKey& key){
+        return ConfigHandle<T>(Lookup<T>(key));
     }
 
     static void LoadFromYaml(const YAML::Node& root);
 
+    // 加载目录下所有 *.yml 文件
+    // 文件并行解析, 按文件路径字典序合并: map逐层合并, 标量和序列由后面的文件覆盖
+    // 合并后统一调用一次 LoadFromYaml, 每个文件的解析耗时输出到 system 日志
+    static void LoadFromConfDir(const std::string& path);
+
     static ConfigVarBase::ptr LookupBase(const std::string& name);
+    static ConfigVarBase::ptr LookupBase(const ConfigKey& key);
+
+    // 驻留名称, 返回其id, 同一名称总是得到同一个id
+    static uint32_t Intern(const std::string& name);
+
+    // 注册配置项, 同名配置已存在时返回已有的配置项
+    static ConfigVarBase::ptr Register(ConfigVarBase::ptr var);
+
+    // 将YAML树展开为 <点分名称, 节点> 列表, 如 system.port
+    static void ListAllMember(const std::string& prefix, const YAML::Node& node, 
+        std::list<std::pair<std::string, const YAML::Node>>& output);
 
 private:
-    static ConfigVarMap& GetDatas(){
-        static ConfigVarMap s_datas;
+    template<class T>
+    static typename ConfigVar<T>::ptr Cast(const ConfigVarBase::ptr& base){
+        if(base && base->getTypeId() == ConfigTypeId<ConfigVar<T> >()){
+            return std::static_pointer_cast<ConfigVar<T> >(base);
+        }
+        return nullptr;
+    }
+
+    // 调用时持有写锁
+    static uint32_t InternLocked(const std::string& name);
+
+    static ConfigIdMap& GetIds(){
+        static ConfigIdMap s_ids;
+        return s_ids;
+    }
+
+    static ConfigVarVec& GetDatas(){
+        static ConfigVarVec s_datas;
         return s_datas;
     }
+
+    static RWMutexType& GetMutex(){
+        static RWMutexType s_mutex;
+        return s_mutex;
+    }
 };
 
 
@@ -0,0 +1,228 @@
+#include "config_cache.h"
+#include "config.h"
+#include <fstream>
+#include <algorithm>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdio.h>
+
+namespace sylar{
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+namespace {
+
+struct CacheHeader{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t source_hash;
+    uint32_t count;
+} __attribute__((packed));
+
+// 只读映射整个文件, 析构时自动解除映射
+class MappedFile{
+public:
+    MappedFile(const std::string& file){
+        int fd = open(file.c_str(), O_RDONLY);
+        if(fd < 0){
+            return;
+        }
+        struct stat st;
+        if(fstat(fd, &st) == 0){
+            if(st.st_size == 0){
+                m_empty = true;
+            }
+            else{
+                void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if(p != MAP_FAILED){
+                    m_data = (const char*)p;
+                    m_size = st.st_size;
+                }
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile(){
+        if(m_data){
+            munmap((void*)m_data, m_size);
+        }
+    }
+
+    bool isValid() const { return m_data || m_empty;}
+    const char* data() const { return m_data;}
+    size_t size() const { return m_size;}
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_empty = false;
+};
+
+uint64_t Fnv1a64(const char* data, size_t len){
+    uint64_t h = 14695981039346656037ULL;
+    for(size_t i = 0; i < len; ++i){
+        h ^= (uint8_t)data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+void WriteString(std::ofstream& ofs, const std::string& str){
+    uint32_t len = str.size();
+    ofs.write((const char*)&len, sizeof(len));
+    ofs.write(str.c_str(), len);
+}
+
+// 从镜像中读出一个长度前缀的字段, 越界返回false
+bool ReadField(const char*& ptr, const char* end, const char*& data, uint32_t& len){
+    if((size_t)(end - ptr) < sizeof(len)){
+        return false;
+    }
+    memcpy(&len, ptr, sizeof(len));
+    ptr += sizeof(len);
+    if((size_t)(end - ptr) < len){
+        return false;
+    }
+    data = ptr;
+    ptr += len;
+    return true;
+}
+
+}
+
+bool ConfigCache::HashFile(const std::string& file, uint64_t& hash){
+    MappedFile mf(file);
+    if(!mf.isValid()){
+        return false;
+    }
+    hash = Fnv1a64(mf.data(), mf.size());
+    return true;
+}
+
+bool ConfigCache::Compile(const YAML::Node& root, uint64_t src_hash, const std::string& cache_file){
+    std::list<std::pair<std::string, const YAML::Node>> all_nodes;
+    Config::ListAllMember("", root, all_nodes);
+
+    // 先写临时文件再rename, 避免并发启动的进程读到写了一半的镜像
+    std::string tmp_file = cache_file + ".tmp";
+    std::ofstream ofs(tmp_file, std::ios::binary | std::ios::trunc);
+    if(!ofs){
+        SYLAR_LOG_ERROR(g_logger) << "ConfigCache::Compile open " << tmp_file << " failed";
+        return false;
+    }
+
+    CacheHeader header;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.source_hash = src_hash;
+    header.count = 0;
+    ofs.write((const char*)&header, sizeof(header));
+
+    std::stringstream ss;
+    for(auto& i : all_nodes){
+        std::string key = i.first;
+        if(key.empty()){
+            continue;
+        }
+        std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+        // 与LoadFromYaml保持一致: 标量存原值, 其它存YAML文本
+        WriteString(ofs, key);
+        if(i.second.IsScalar()){
+            WriteString(ofs, i.second.Scalar());
+        }
+        else{
+            ss.str("");
+            ss << i.second;
+            WriteString(ofs, ss.str());
+        }
+        ++header.count;
+    }
+
+    ofs.seekp(0);
+    ofs.write((const char*)&header, sizeof(header));
+    ofs.close();
+    if(!ofs){
+        SYLAR_LOG_ERROR(g_logger) << "ConfigCache::Compile write " << tmp_file << " failed";
+        unlink(tmp_file.c_str());
+        return false;
+    }
+    if(rename(tmp_file.c_str(), cache_file.c_str())){
+        SYLAR_LOG_ERROR(g_logger) << "ConfigCache::Compile rename " << tmp_file
+            << " to " << cache_file << " failed errno=" << errno;
+        unlink(tmp_file.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ConfigCache::Load(const std::string& cache_file, uint64_t src_hash){
+    MappedFile mf(cache_file);
+    if(!mf.data() || mf.size() < sizeof(CacheHeader)){
+        return false;
+    }
+    CacheHeader header;
+    memcpy(&header, mf.data(), sizeof(header));
+    if(header.magic != MAGIC || header.version != VERSION
+            || header.source_hash != src_hash){
+        SYLAR_LOG_INFO(g_logger) << "ConfigCache::Load " << cache_file << " is stale";
+        return false;
+    }
+
+    // 先完整校验一遍, 损坏的镜像不应写入任何配置
+    const char* begin = mf.data() + sizeof(header);
+    const char* end = mf.data() + mf.size();
+    const char* ptr = begin;
+    const char* key = nullptr;
+    const char* val = nullptr;
+    uint32_t key_len = 0;
+    uint32_t val_len = 0;
+    for(uint32_t i = 0; i < header.count; ++i){
+        if(!ReadField(ptr, end, key, key_len) || !ReadField(ptr, end, val, val_len)){
+            SYLAR_LOG_ERROR(g_logger) << "ConfigCache::Load " << cache_file << " is corrupted";
+            return false;
+        }
+    }
+
+    ptr = begin;
+    std::string name;
+    for(uint32_t i = 0; i < header.count; ++i){
+        ReadField(ptr, end, key, key_len);
+        ReadField(ptr, end, val, val_len);
+        name.assign(key, key_len);
+        ConfigVarBase::ptr var = Config::LookupBase(name);
+        if(var){
+            var->fromString(std::string(val, val_len));
+        }
+    }
+    return true;
+}
+
+bool ConfigCache::LoadFile(const std::string& yml_file, const std::string& cache_file){
+    std::string cache = cache_file.empty() ? yml_file + ".cache" : cache_file;
+    uint64_t hash = 0;
+    if(!HashFile(yml_file, hash)){
+        SYLAR_LOG_ERROR(g_logger) << "ConfigCache::LoadFile open " << yml_file << " failed";
+        return false;
+    }
+    if(Load(cache, hash)){
+        return true;
+    }
+
+    YAML::Node root;
+    try{
+        root = YAML::LoadFile(yml_file);
+    }catch(std::exception& e){
+        SYLAR_LOG_ERROR(g_logger) << "ConfigCache::LoadFile parse " << yml_file
+            << " failed: " << e.what();
+        return false;
+    }
+    Config::LoadFromYaml(root);
+    Compile(root, hash, cache);
+    return true;
+}
+
+}
@@ -0,0 +1,36 @@
+#ifndef __SYLAR_CONFIG_CACHE_H__
+#define __SYLAR_CONFIG_CACHE_H__
+
+#include <string>
+#include <stdint.h>
+#include <yaml-cpp/yaml.h>
+
+namespace sylar{
+
+// 配置二进制缓存
+// 将YAML配置树预编译为紧凑的二进制镜像, 启动时mmap载入, 跳过YAML解析
+// 镜像格式(本机字节序):
+//   Header: magic(4) | version(4) | source_hash(8) | count(4)
+//   Entry:  key_len(4) | key | val_len(4) | val     key与ListAllMember产生的点分名称一致
+class ConfigCache{
+public:
+    static const uint32_t MAGIC = 0x43435953;   // "SYCC"
+    static const uint32_t VERSION = 1;
+
+    // 计算文件内容的FNV-1a 64位hash, 文件不可读返回false
+    static bool HashFile(const std::string& file, uint64_t& hash);
+
+    // 将YAML树编译为二进制镜像写入cache_file, src_hash为源文件hash
+    static bool Compile(const YAML::Node& root, uint64_t src_hash, const std::string& cache_file);
+
+    // mmap载入镜像并写入已注册的ConfigVar, 镜像不存在/版本不符/hash不符返回false
+    static bool Load(const std::string& cache_file, uint64_t src_hash);
+
+    // 优先从缓存加载yml_file, 缓存失效时解析YAML并重新生成缓存
+    // cache_file为空时使用 yml_file + ".cache"
+    static bool LoadFile(const std::string& yml_file, const std::string& cache_file = "");
+};
+
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef __SYLAR_FD_MANAGER_H__
+#define __SYLAR_FD_MANAGER_H__
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include "thread.h"
+#include "mutex.h"
+#include "singleton.h"
+
+namespace sylar{
+
+// 文件句柄上下文, 记录hook需要的fd状态
+// socket在hook层总是设置成非阻塞(系统非阻塞), 用户自己设置的非阻塞单独记录,
+// 用户要求非阻塞的fd不做协程化处理, 直接返回EAGAIN
+class FdCtx : public std::enable_shared_from_this<FdCtx>{
+public:
+    typedef std::shared_ptr<FdCtx> ptr;
+
+    FdCtx(int fd);
+    ~FdCtx();
+
+    bool isInit() const { return m_isInit;}
+    bool isSocket() const { return m_isSocket;}
+    bool isClose() const { return m_isClosed;}
+
+    void setUserNonblock(bool v) { m_userNonblock = v;}
+    bool getUserNonblock() const { return m_userNonblock;}
+
+    void setSysNonblock(bool v) { m_sysNonblock = v;}
+    bool getSysNonblock() const { return m_sysNonblock;}
+
+    // type 为 SO_RCVTIMEO 或 SO_SNDTIMEO, v 为毫秒, -1表示不超时
+    void setTimeout(int type, uint64_t v);
+    uint64_t getTimeout(int type);
+private:
+    bool init();
+private:
+    bool m_isInit: 1;
+    bool m_isSocket: 1;
+    bool m_sysNonblock: 1;
+    bool m_userNonblock: 1;
+    bool m_isClosed: 1;
+    int m_fd;
+    uint64_t m_recvTimeout;
+    uint64_t m_sendTimeout;
+};
+
+// 按fd下标存放FdCtx
+class FdManager{
+public:
+    typedef RWMutex RWMutexType;
+
+    FdManager();
+
+    // auto_create为true时不存在则创建
+    FdCtx::ptr get(int fd, bool auto_create = false);
+    void del(int fd);
+private:
+    RWMutexType m_mutex;
+    std::vector<FdCtx::ptr> m_datas;
+};
+
+typedef Singleton<FdManager> FdMgr;
+
+}
+
+#endif
@@ -0,0 +1,369 @@
+#include "fiber.h"
+#include "fiber_stack.h"
+#include "config.h"
+#include "scheduler.h"
+#include "macro.h"
+#include "log.h"
+#include <atomic>
+#include <string.h>
+
+namespace sylar{
+
+static Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+static std::atomic<uint64_t> s_fiber_id {0};
+static std::atomic<uint64_t> s_fiber_count {0};
+
+static thread_local Fiber* t_fiber = nullptr;
+static thread_local Fiber::ptr t_threadFiber = nullptr;
+static thread_local uint64_t t_traceSpan = 0;
+
+static ConfigVar<uint32_t>::ptr g_fiber_stack_size =
+    Config::Lookup<uint32_t>("fiber.stack_size", 128 * 1024, "fiber stack size");
+
+#if !SYLAR_FIBER_USE_UCONTEXT
+// sylar_fiber_switch(from_sp, to_sp):
+//   把callee-saved寄存器压到当前栈上, 栈指针存入*from_sp, 再切到to_sp弹出对方保存的寄存器并返回
+// sylar_fiber_entry: 新协程第一次被切入时从这里开始, 调用保存在寄存器中的入口函数, 入口函数不会返回
+extern "C" void sylar_fiber_switch(void** from_sp, void* to_sp);
+extern "C" void sylar_fiber_entry();
+
+#if defined(__x86_64__)
+// 栈布局(低地址到高地址): mxcsr/x87控制字 | r12 | r13 | r14 | r15 | rbx | rbp | 返回地址
+__asm__(
+    ".text\n"
+    ".p2align 4\n"
+    ".globl sylar_fiber_switch\n"
+    ".hidden sylar_fiber_switch\n"
+    ".type sylar_fiber_switch,@function\n"
+    "sylar_fiber_switch:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r15\n"
+    "    pushq %r14\n"
+    "    pushq %r13\n"
+    "    pushq %r12\n"
+    "    leaq -8(%rsp), %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    leaq 8(%rsp), %rsp\n"
+    "    popq %r12\n"
+    "    popq %r13\n"
+    "    popq %r14\n"
+    "    popq %r15\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size sylar_fiber_switch,.-sylar_fiber_switch\n"
+    ".p2align 4\n"
+    ".globl sylar_fiber_entry\n"
+    ".hidden sylar_fiber_entry\n"
+    ".type sylar_fiber_entry,@function\n"
+    "sylar_fiber_entry:\n"
+    "    callq *%r12\n"
+    "    ud2\n"
+    ".size sylar_fiber_entry,.-sylar_fiber_entry\n"
+);
+
+static const size_t s_context_size = 64;
+static void* InitContext(void* top, void (*fn)()){
+    uint64_t* sp = (uint64_t*)((char*)top - s_context_size);
+    memset(sp, 0, s_context_size);
+    ((uint32_t*)sp)[0] = 0x1F80;        // mxcsr 默认值
+    ((uint16_t*)sp)[2] = 0x037F;        // x87 控制字默认值
+    sp[1] = (uint64_t)fn;               // r12
+    sp[7] = (uint64_t)&sylar_fiber_entry;   // 返回地址
+    return sp;
+}
+#elif defined(__aarch64__)
+// 栈布局(低地址到高地址): d8-d15 | x19-x28 | x29 | x30(返回地址)
+__asm__(
+    ".text\n"
+    ".p2align 2\n"
+    ".globl sylar_fiber_switch\n"
+    ".hidden sylar_fiber_switch\n"
+    ".type sylar_fiber_switch,%function\n"
+    "sylar_fiber_switch:\n"
+    "    sub sp, sp, #0xa0\n"
+    "    stp d8, d9, [sp, #0x00]\n"
+    "    stp d10, d11, [sp, #0x10]\n"
+    "    stp d12, d13, [sp, #0x20]\n"
+    "    stp d14, d15, [sp, #0x30]\n"
+    "    stp x19, x20, [sp, #0x40]\n"
+    "    stp x21, x22, [sp, #0x50]\n"
+    "    stp x23, x24, [sp, #0x60]\n"
+    "    stp x25, x26, [sp, #0x70]\n"
+    "    stp x27, x28, [sp, #0x80]\n"
+    "    stp x29, x30, [sp, #0x90]\n"
+    "    mov x9, sp\n"
+    "    str x9, [x0]\n"
+    "    mov sp, x1\n"
+    "    ldp d8, d9, [sp, #0x00]\n"
+    "    ldp d10, d11, [sp, #0x10]\n"
+    "    ldp d12, d13, [sp, #0x20]\n"
+    "    ldp d14, d15, [sp, #0x30]\n"
+    "    ldp x19, x20, [sp, #0x40]\n"
+    "    ldp x21, x22, [sp, #0x50]\n"
+    "    ldp x23, x24, [sp, #0x60]\n"
+    "    ldp x25, x26, [sp, #0x70]\n"
+    "    ldp x27, x28, [sp, #0x80]\n"
+    "    ldp x29, x30, [sp, #0x90]\n"
+    "    add sp, sp, #0xa0\n"
+    "    ret\n"
+    ".size sylar_fiber_switch,.-sylar_fiber_switch\n"
+    ".p2align 2\n"
+    ".globl sylar_fiber_entry\n"
+    ".hidden sylar_fiber_entry\n"
+    ".type sylar_fiber_entry,%function\n"
+    "sylar_fiber_entry:\n"
+    "    blr x19\n"
+    "    brk #0\n"
+    ".size sylar_fiber_entry,.-sylar_fiber_entry\n"
+);
+
+static const size_t s_context_size = 0xa0;
+static void* InitContext(void* top, void (*fn)()){
+    uint64_t* sp = (uint64_t*)((char*)top - s_context_size);
+    memset(sp, 0, s_context_size);
+    sp[8] = (uint64_t)fn;                   // x19
+    sp[19] = (uint64_t)&sylar_fiber_entry;  // x30
+    return sp;
+}
+#endif
+#endif
+
+Fiber::Fiber()
+{
+    m_state = EXEC;
+    // 线程在区间内第一次用到协程时, 主协程接着线程的区间
+    m_traceSpan = t_traceSpan;
+    SetThis(this);
+#if SYLAR_FIBER_USE_UCONTEXT
+    if(getcontext(&m_ctx)){
+        SYLAR_ASSERT2(false, "getcontext");
+    }
+#endif
+    ++s_fiber_count;
+    SYLAR_LOG_DEBUG(g_logger) << "Fiber::Fiber main";
+}
+
+Fiber::Fiber(std::function<void()> cb, size_t stacksize, bool use_caller)
+    :m_id(++s_fiber_id)
+    ,m_cb(cb){
+    ++s_fiber_count;
+    size_t size = stacksize ? stacksize : g_fiber_stack_size->getValue();
+    // 栈大小会被向上取整到分配器的大小分级
+    m_stack = FiberStackPool::Alloc(size);
+    m_stacksize = size;
+    makeContext(use_caller ? &Fiber::CallerMainFunc : &Fiber::MainFunc);
+    SYLAR_LOG_DEBUG(g_logger) << "Fiber::Fiber id=" << m_id;
+}
+
+Fiber::~Fiber()
+{
+    --s_fiber_count;
+    if(m_stack){
+        SYLAR_ASSERT(m_state == TERM || m_state == EXCEPT || m_state == INIT);
+        FiberStackPool::Dealloc(m_stack, m_stacksize);
+    }
+    else{
+        // 主协程没有独立的栈
+        SYLAR_ASSERT(!m_cb);
+        SYLAR_ASSERT(m_state == EXEC);
+        Fiber* cur = t_fiber;
+        if(cur == this){
+            SetThis(nullptr);
+        }
+    }
+    SYLAR_LOG_DEBUG(g_logger) << "Fiber::~Fiber id=" << m_id
+        << " total=" << s_fiber_count;
+}
+
+void Fiber::makeContext(void (*func)())
+{
+#if SYLAR_FIBER_USE_UCONTEXT
+    if(getcontext(&m_ctx)){
+        SYLAR_ASSERT2(false, "getcontext");
+    }
+    m_ctx.uc_link = nullptr;
+    m_ctx.uc_stack.ss_sp = m_stack;
+    m_ctx.uc_stack.ss_size = m_stacksize;
+    makecontext(&m_ctx, func, 0);
+#else
+    // 栈顶按16字节对齐
+    uintptr_t top = ((uintptr_t)m_stack + m_stacksize) & ~(uintptr_t)15;
+    m_sp = InitContext((void*)top, func);
+#endif
+}
+
+void Fiber::SwapContext(Fiber* from, Fiber* to)
+{
+#if SYLAR_FIBER_USE_UCONTEXT
+    if(swapcontext(&from->m_ctx, &to->m_ctx)){
+        SYLAR_ASSERT2(false, "swapcontext");
+    }
+#else
+    sylar_fiber_switch(&from->m_sp, to->m_sp);
+#endif
+}
+
+void Fiber::reset(std::function<void()> cb)
+{
+    SYLAR_ASSERT(m_stack);
+    SYLAR_ASSERT(m_state == TERM || m_state == EXCEPT || m_state == INIT);
+    m_cb = cb;
+    m_traceSpan = 0;
+    makeContext(&Fiber::MainFunc);
+    m_state = INIT;
+}
+
+// 调度协程, 线程不属于任何调度器时就是线程的主协程
+static Fiber* GetSchedulerFiber(){
+    Fiber* f = Scheduler::GetMainFiber();
+    return f ? f : t_threadFiber.get();
+}
+
+void Fiber::swapIn()
+{
+    SetThis(this);
+    SYLAR_ASSERT(m_state != EXEC);
+    m_state = EXEC;
+    SwapContext(GetSchedulerFiber(), this);
+}
+
+void Fiber::swapOut()
+{
+    Fiber* main = GetSchedulerFiber();
+    SetThis(main);
+    SwapContext(this, main);
+}
+
+void Fiber::call()
+{
+    SetThis(this);
+    m_state = EXEC;
+    SwapContext(t_threadFiber.get(), this);
+}
+
+void Fiber::back()
+{
+    SetThis(t_threadFiber.get());
+    SwapContext(this, t_threadFiber.get());
+}
+
+void Fiber::SetThis(Fiber* f)
+{
+    t_fiber = f;
+}
+
+Fiber::ptr Fiber::GetThis()
+{
+    if(t_fiber){
+        return t_fiber->shared_from_this();
+    }
+    Fiber::ptr main_fiber(new Fiber);
+    SYLAR_ASSERT(t_fiber == main_fiber.get());
+    t_threadFiber = main_fiber;
+    return t_fiber->shared_from_this();
+}
+
+void Fiber::YieldToReady()
+{
+    Fiber::ptr cur = GetThis();
+    SYLAR_ASSERT(cur->m_state == EXEC);
+    cur->m_state = READY;
+    cur->swapOut();
+}
+
+void Fiber::YieldToHold()
+{
+    Fiber::ptr cur = GetThis();
+    SYLAR_ASSERT(cur->m_state == EXEC);
+    cur->m_state = HOLD;
+    cur->swapOut();
+}
+
+uint64_t Fiber::TotalFibers()
+{
+    return s_fiber_count;
+}
+
+void Fiber::MainFunc()
+{
+    Fiber::ptr cur = GetThis();
+    SYLAR_ASSERT(cur);
+    try{
+        cur->m_cb();
+        cur->m_cb = nullptr;
+        cur->m_state = TERM;
+    }catch(std::exception& ex){
+        cur->m_state = EXCEPT;
+        SYLAR_LOG_ERROR(g_logger) << "Fiber Except: " << ex.what()
+            << " fiber_id=" << cur->getId();
+    }catch(...){
+        cur->m_state = EXCEPT;
+        SYLAR_LOG_ERROR(g_logger) << "Fiber Except"
+            << " fiber_id=" << cur->getId();
+    }
+
+    // 切出前释放自己持有的引用, 否则协程对象永远不会析构
+    auto raw_ptr = cur.get();
+    cur.reset();
+    raw_ptr->swapOut();
+
+    SYLAR_ASSERT2(false, "never reach fiber_id=" << raw_ptr->getId());
+}
+
+void Fiber::CallerMainFunc()
+{
+    Fiber::ptr cur = GetThis();
+    SYLAR_ASSERT(cur);
+    try{
+        cur->m_cb();
+        cur->m_cb = nullptr;
+        cur->m_state = TERM;
+    }catch(std::exception& ex){
+        cur->m_state = EXCEPT;
+        SYLAR_LOG_ERROR(g_logger) << "Fiber Except: " << ex.what()
+            << " fiber_id=" << cur->getId();
+    }catch(...){
+        cur->m_state = EXCEPT;
+        SYLAR_LOG_ERROR(g_logger) << "Fiber Except"
+            << " fiber_id=" << cur->getId();
+    }
+
+    auto raw_ptr = cur.get();
+    cur.reset();
+    raw_ptr->back();
+
+    SYLAR_ASSERT2(false, "never reach fiber_id=" << raw_ptr->getId());
+}
+
+uint64_t Fiber::GetFiberId()
+{
+    if(t_fiber){
+        return t_fiber->getId();
+    }
+    return 0;
+}
+
+uint64_t Fiber::GetTraceSpan()
+{
+    return t_fiber ? t_fiber->m_traceSpan : t_traceSpan;
+}
+
+void Fiber::SetTraceSpan(uint64_t span)
+{
+    if(t_fiber){
+        t_fiber->m_traceSpan = span;
+    }
+    else{
+        t_traceSpan = span;
+    }
+}
+
+}
@@ -0,0 +1,102 @@
+#ifndef __SYLAR_FIBER_H__
+#define __SYLAR_FIBER_H__
+
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <stdint.h>
+
+// x86-64/aarch64 使用手写汇编切换上下文, 其它平台或定义了 SYLAR_FIBER_UCONTEXT 时退回 ucontext
+#if defined(SYLAR_FIBER_UCONTEXT) || !(defined(__x86_64__) || defined(__aarch64__))
+#define SYLAR_FIBER_USE_UCONTEXT 1
+#include <ucontext.h>
+#else
+#define SYLAR_FIBER_USE_UCONTEXT 0
+#endif
+
+namespace sylar{
+
+// 有栈协程
+class Fiber : public std::enable_shared_from_this<Fiber>{
+friend class Scheduler;
+public:
+    typedef std::shared_ptr<Fiber> ptr;
+
+    enum State{
+        INIT,   // 初始化
+        HOLD,   // 暂停
+        EXEC,   // 执行中
+        TERM,   // 结束
+        READY,  // 可执行
+        EXCEPT  // 异常
+    };
+private:
+    // 线程的主协程, 只能由GetThis()创建
+    Fiber();
+
+public:
+    // stacksize 为0时使用配置 fiber.stack_size
+    // use_caller 为true时协程和线程的主协程切换(call/back), 用于调度器在创建它的线程上的调度协程
+    Fiber(std::function<void()> cb, size_t stacksize = 0, bool use_caller = false);
+    ~Fiber();
+
+    // 重置协程函数, 复用已结束协程的栈
+    void reset(std::function<void()> cb);
+    // 从调度协程切换到当前协程执行, 没有调度器时和线程的主协程切换
+    void swapIn();
+    // 切换回调度协程
+    void swapOut();
+    // 从线程的主协程切换到当前协程执行
+    void call();
+    // 切换回线程的主协程
+    void back();
+
+    uint64_t getId() const { return m_id;}
+    State getState() const { return m_state;}
+public:
+    // 设置当前协程
+    static void SetThis(Fiber* f);
+    // 返回当前协程, 线程第一次调用时创建主协程
+    static Fiber::ptr GetThis();
+    // 协程切换到后台, 并设置为Ready状态
+    static void YieldToReady();
+    // 协程切换到后台, 并设置为Hold状态
+    static void YieldToHold();
+    // 总协程数
+    static uint64_t TotalFibers();
+
+    static void MainFunc();
+    // use_caller协程的入口, 结束时切换回线程的主协程
+    static void CallerMainFunc();
+    // 当前协程id, 不在协程中返回0
+    static uint64_t GetFiberId();
+    // 当前协程所在的追踪区间(见trace.h), 随协程切换, 不在协程中时按线程保存
+    static uint64_t GetTraceSpan();
+    static void SetTraceSpan(uint64_t span);
+private:
+    // 保存当前上下文到from, 恢复to
+    static void SwapContext(Fiber* from, Fiber* to);
+    // 在协程栈上构造初始上下文, 恢复后从MainFunc开始执行
+    void makeContext(void (*func)());
+private:
+    uint64_t m_id = 0;
+    uint32_t m_stacksize = 0;
+    State m_state = INIT;
+
+#if SYLAR_FIBER_USE_UCONTEXT
+    ucontext_t m_ctx;
+#else
+    void* m_sp = nullptr;   // 切出时保存的栈指针, 寄存器保存在栈上
+#endif
+    void* m_stack = nullptr;
+    // 调度器使用: 协程正在某个线程上运行或还没有完全切出
+    // 协程可能先注册唤醒条件再挂起, 其它线程在它切出前就会尝试切入
+    std::atomic<bool> m_running {false};
+    uint64_t m_traceSpan = 0;
+
+    std::function<void()> m_cb;
+};
+
+}
+
+#endif
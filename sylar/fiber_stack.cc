@@ -0,0 +1,337 @@
+#include "fiber_stack.h"
+#include "config.h"
+#include "log.h"
+#include "macro.h"
+#include "mutex.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <new>
+
+namespace sylar{
+
+static Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+static ConfigVar<uint32_t>::ptr g_stack_cache_max =
+    Config::Lookup<uint32_t>("fiber.stack_cache_max", 256, "idle fiber stacks cached per size class per thread");
+static ConfigVar<uint32_t>::ptr g_stack_hot_count =
+    Config::Lookup<uint32_t>("fiber.stack_hot_count", 8, "idle fiber stacks per size class kept resident, colder ones are trimmed");
+static ConfigVar<bool>::ptr g_stack_guard =
+    Config::Lookup<bool>("fiber.stack_guard", true, "protect the lowest page of every fiber stack");
+
+// 分配路径上不走配置项的读锁, 由监听器同步到原子变量
+static std::atomic<uint32_t> s_cache_max {256};
+static std::atomic<uint32_t> s_hot_count {8};
+static std::atomic<bool> s_guard {true};
+
+struct FiberStackIniter{
+    FiberStackIniter(){
+        s_cache_max = g_stack_cache_max->getValue();
+        s_hot_count = g_stack_hot_count->getValue();
+        s_guard = g_stack_guard->getValue();
+        g_stack_cache_max->addListener(0x5EC0A1, [](const uint32_t& old_value, const uint32_t& new_value){
+            s_cache_max = new_value;
+        });
+        g_stack_hot_count->addListener(0x5EC0A2, [](const uint32_t& old_value, const uint32_t& new_value){
+            s_hot_count = new_value;
+        });
+        g_stack_guard->addListener(0x5EC0A3, [](const bool& old_value, const bool& new_value){
+            s_guard = new_value;
+        });
+    }
+};
+
+static FiberStackIniter __fiber_stack_init;
+
+// 缓存的大小分级: 16K, 32K ... 1M, 更大的栈不缓存
+static const size_t s_min_shift = 14;
+static const size_t s_max_shift = 20;
+static const size_t s_class_count = s_max_shift - s_min_shift + 1;
+
+// 系统调用路径上的计数直接用全局原子变量
+static std::atomic<uint64_t> s_mmaps {0};
+static std::atomic<uint64_t> s_munmaps {0};
+static std::atomic<uint64_t> s_trims {0};
+static std::atomic<uint64_t> s_stacks {0};
+static std::atomic<uint64_t> s_stacks_peak {0};
+static std::atomic<uint64_t> s_mapped_bytes {0};
+static std::atomic<uint64_t> s_mapped_peak {0};
+
+// 分配/释放路径上的计数放在线程私有结构里, 只有所属线程写, 不需要带lock前缀的原子指令
+// GetStats时汇总所有线程, 线程退出时并入s_retired
+struct ThreadCounters{
+    std::atomic<uint64_t> allocs {0};
+    std::atomic<uint64_t> deallocs {0};
+    std::atomic<uint64_t> cache_hits {0};
+    std::atomic<uint64_t> cached {0};
+
+    static void Inc(std::atomic<uint64_t>& v, int64_t n = 1){
+        v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+};
+
+static ThreadCounters s_retired;
+
+static Mutex& GetCountersMutex(){
+    static Mutex* s_mutex = new Mutex;
+    return *s_mutex;
+}
+
+static std::vector<ThreadCounters*>& GetAllCounters(){
+    static std::vector<ThreadCounters*>* s_counters = new std::vector<ThreadCounters*>;
+    return *s_counters;
+}
+
+static void UpdatePeak(std::atomic<uint64_t>& peak, uint64_t v){
+    uint64_t cur = peak.load(std::memory_order_relaxed);
+    while(cur < v && !peak.compare_exchange_weak(cur, v, std::memory_order_relaxed)){
+    }
+}
+
+static size_t PageSize(){
+    static size_t s_page = sysconf(_SC_PAGESIZE);
+    return s_page;
+}
+
+// 返回大小分级的下标, 不缓存的返回-1
+static int SizeClass(size_t size){
+    if(size > ((size_t)1 << s_max_shift)){
+        return -1;
+    }
+    size_t shift = s_min_shift;
+    while(((size_t)1 << shift) < size){
+        ++shift;
+    }
+    return shift - s_min_shift;
+}
+
+static size_t RoundSize(size_t size){
+    size_t page = PageSize();
+    size = (size + page - 1) & ~(page - 1);
+    int c = SizeClass(size);
+    if(c >= 0){
+        return (size_t)1 << (c + s_min_shift);
+    }
+    return size;
+}
+
+// 映射区域 = 保护页 + 栈, 保护页总是预留, 只在开启fiber.stack_guard时设置为不可访问
+static void* MapStack(size_t size){
+    size_t page = PageSize();
+    void* base = mmap(nullptr, size + page, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if(base == MAP_FAILED){
+        // 每个保护页会把映射拆成两段, 协程数很多时可能先撞到vm.max_map_count
+        SYLAR_LOG_ERROR(g_logger) << "mmap fiber stack size=" << size
+            << " failed errno=" << errno << " errstr=" << strerror(errno)
+            << " mapped_bytes=" << s_mapped_bytes;
+        throw std::bad_alloc();
+    }
+    if(s_guard && mprotect(base, page, PROT_NONE)){
+        SYLAR_LOG_ERROR(g_logger) << "mprotect fiber stack guard failed errno="
+            << errno << " errstr=" << strerror(errno);
+    }
+    ++s_mmaps;
+    UpdatePeak(s_stacks_peak, ++s_stacks);
+    UpdatePeak(s_mapped_peak, s_mapped_bytes += size + page);
+    return (char*)base + page;
+}
+
+static void UnmapStack(void* vp, size_t size){
+    size_t page = PageSize();
+    if(munmap((char*)vp - page, size + page)){
+        SYLAR_LOG_ERROR(g_logger) << "munmap fiber stack failed errno=" << errno
+            << " errstr=" << strerror(errno);
+        return;
+    }
+    ++s_munmaps;
+    --s_stacks;
+    s_mapped_bytes -= size + page;
+}
+
+// 释放栈的物理页, 保留栈顶一页(初始上下文就写在那里, 复用时马上会访问)
+static void TrimStack(void* vp, size_t size){
+    size_t page = PageSize();
+    if(madvise(vp, size - page, MADV_DONTNEED)){
+        SYLAR_LOG_ERROR(g_logger) << "madvise fiber stack failed errno=" << errno
+            << " errstr=" << strerror(errno);
+        return;
+    }
+    ++s_trims;
+}
+
+// 线程私有的空闲栈缓存, 每个分级是一个栈(LIFO), 尾部是最近释放的热栈
+class StackCache{
+public:
+    struct Item{
+        void* stack;
+        bool trimmed;
+    };
+
+    StackCache();
+    ~StackCache();
+
+    void* alloc(size_t size);
+    void dealloc(void* vp, size_t size);
+    void clear();
+private:
+    std::vector<Item> m_free[s_class_count];
+    ThreadCounters m_counters;
+};
+
+// 线程退出时缓存先于部分协程析构, 之后归还的栈直接解除映射
+static thread_local bool t_cache_dead = false;
+static thread_local StackCache t_cache;
+
+StackCache::StackCache()
+{
+    Mutex::Lock lock(GetCountersMutex());
+    GetAllCounters().push_back(&m_counters);
+}
+
+StackCache::~StackCache()
+{
+    clear();
+    t_cache_dead = true;
+
+    Mutex::Lock lock(GetCountersMutex());
+    auto& all = GetAllCounters();
+    all.erase(std::find(all.begin(), all.end(), &m_counters));
+    s_retired.allocs += m_counters.allocs;
+    s_retired.deallocs += m_counters.deallocs;
+    s_retired.cache_hits += m_counters.cache_hits;
+}
+
+void* StackCache::alloc(size_t size)
+{
+    ThreadCounters::Inc(m_counters.allocs);
+    int c = SizeClass(size);
+    if(c >= 0 && !m_free[c].empty()){
+        auto& list = m_free[c];
+        void* vp = list.back().stack;
+        list.pop_back();
+        ThreadCounters::Inc(m_counters.cached, -1);
+        ThreadCounters::Inc(m_counters.cache_hits);
+        return vp;
+    }
+    return MapStack(size);
+}
+
+void StackCache::dealloc(void* vp, size_t size)
+{
+    ThreadCounters::Inc(m_counters.deallocs);
+    int c = SizeClass(size);
+    if(c < 0){
+        UnmapStack(vp, size);
+        return;
+    }
+    auto& list = m_free[c];
+    if(list.size() >= s_cache_max){
+        UnmapStack(vp, size);
+        return;
+    }
+    list.push_back({vp, false});
+    ThreadCounters::Inc(m_counters.cached);
+    // 超出热点数量的那个空闲栈变冷, 归还物理页
+    uint32_t hot = s_hot_count;
+    if(list.size() > hot){
+        Item& cold = list[list.size() - 1 - hot];
+        if(!cold.trimmed){
+            TrimStack(cold.stack, size);
+            cold.trimmed = true;
+        }
+    }
+}
+
+void StackCache::clear()
+{
+    for(size_t c = 0; c < s_class_count; ++c){
+        size_t size = (size_t)1 << (c + s_min_shift);
+        for(auto& i : m_free[c]){
+            UnmapStack(i.stack, size);
+        }
+        ThreadCounters::Inc(m_counters.cached, -(int64_t)m_free[c].size());
+        m_free[c].clear();
+    }
+}
+
+void* FiberStackPool::Alloc(size_t& size)
+{
+    size = RoundSize(size);
+    if(SYLAR_UNLIKELY(t_cache_dead)){
+        ++s_retired.allocs;
+        return MapStack(size);
+    }
+    return t_cache.alloc(size);
+}
+
+void FiberStackPool::Dealloc(void* vp, size_t size)
+{
+    if(SYLAR_UNLIKELY(t_cache_dead)){
+        ++s_retired.deallocs;
+        UnmapStack(vp, size);
+        return;
+    }
+    t_cache.dealloc(vp, size);
+}
+
+void FiberStackPool::Trim()
+{
+    if(!t_cache_dead){
+        t_cache.clear();
+    }
+}
+
+FiberStackPool::Stats FiberStackPool::GetStats()
+{
+    Stats s;
+    uint64_t deallocs = 0;
+    {
+        Mutex::Lock lock(GetCountersMutex());
+        s.allocs = s_retired.allocs;
+        s.cache_hits = s_retired.cache_hits;
+        deallocs = s_retired.deallocs;
+        for(auto i : GetAllCounters()){
+            s.allocs += i->allocs.load(std::memory_order_relaxed);
+            s.cache_hits += i->cache_hits.load(std::memory_order_relaxed);
+            s.cached += i->cached.load(std::memory_order_relaxed);
+            deallocs += i->deallocs.load(std::memory_order_relaxed);
+        }
+    }
+    s.in_use = s.allocs - deallocs;
+    s.mmaps = s_mmaps;
+    s.munmaps = s_munmaps;
+    s.trims = s_trims;
+    s.stacks = s_stacks;
+    s.stacks_peak = s_stacks_peak;
+    s.mapped_bytes = s_mapped_bytes;
+    s.mapped_peak = s_mapped_peak;
+    return s;
+}
+
+std::string FiberStackPool::Stats::toYamlString() const
+{
+    YAML::Node node;
+#define XX(name) node[#name] = name
+    XX(allocs);
+    XX(cache_hits);
+    XX(mmaps);
+    XX(munmaps);
+    XX(trims);
+    XX(in_use);
+    XX(cached);
+    XX(stacks);
+    XX(stacks_peak);
+    XX(mapped_bytes);
+    XX(mapped_peak);
+#undef XX
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
+}
@@ -0,0 +1,45 @@
+#ifndef __SYLAR_FIBER_STACK_H__
+#define __SYLAR_FIBER_STACK_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+namespace sylar{
+
+// 协程栈分配器
+// 栈用mmap申请, 低地址端放一个PROT_NONE保护页, 栈溢出时立即段错误而不是踩坏相邻内存
+// 物理页在第一次访问时才提交, RSS只和实际用到的栈深度相关
+// 每个线程按大小分级缓存释放的栈, 超出热点数量的空闲栈用MADV_DONTNEED归还物理页
+class FiberStackPool{
+public:
+    // 全局统计, 汇总所有线程, 各项计数不是同一时刻的快照
+    struct Stats{
+        uint64_t allocs = 0;         // Alloc调用次数
+        uint64_t cache_hits = 0;     // 从线程缓存直接复用的次数
+        uint64_t mmaps = 0;          // 新映射的栈数
+        uint64_t munmaps = 0;        // 解除映射的栈数
+        uint64_t trims = 0;          // MADV_DONTNEED次数
+        uint64_t in_use = 0;         // 正在被协程使用的栈数
+        uint64_t cached = 0;         // 线程缓存中的空闲栈数
+        uint64_t stacks = 0;         // 当前映射的栈数(使用中 + 缓存)
+        uint64_t stacks_peak = 0;    // stacks的高水位
+        uint64_t mapped_bytes = 0;   // 当前映射的虚拟内存(含保护页)
+        uint64_t mapped_peak = 0;    // mapped_bytes的高水位
+
+        std::string toYamlString() const;
+    };
+
+    // 申请栈, size按页对齐后向上取整到2的幂, 实际可用大小通过size返回
+    static void* Alloc(size_t& size);
+    // 归还栈, size为Alloc返回的大小
+    static void Dealloc(void* vp, size_t size);
+    // 释放当前线程缓存的全部空闲栈
+    static void Trim();
+
+    static Stats GetStats();
+};
+
+}
+
+#endif
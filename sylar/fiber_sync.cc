@@ -0,0 +1,166 @@
+#include "fiber_sync.h"
+#include "macro.h"
+
+namespace sylar{
+
+void FiberWaitQueue::Waiter::wake()
+{
+    if(fiber){
+        scheduler->schedule(&fiber);
+        scheduler = nullptr;
+    }
+}
+
+void FiberWaitQueue::push()
+{
+    Waiter w;
+    w.scheduler = Scheduler::GetThis();
+    SYLAR_ASSERT2(w.scheduler, "fiber sync primitives must wait inside a scheduler");
+    w.fiber = Fiber::GetThis();
+    SYLAR_ASSERT2(w.fiber.get() != Scheduler::GetMainFiber(), "can not wait on scheduler fiber");
+    m_waiters.push_back(std::move(w));
+}
+
+bool FiberWaitQueue::pop(Waiter& w)
+{
+    if(m_waiters.empty()){
+        return false;
+    }
+    w = std::move(m_waiters.front());
+    m_waiters.pop_front();
+    return true;
+}
+
+void FiberWaitQueue::popAll(std::deque<Waiter>& ws)
+{
+    ws.swap(m_waiters);
+    m_waiters.clear();
+}
+
+FiberSemaphore::FiberSemaphore(size_t initial_concurrency)
+    :m_concurrency(initial_concurrency){
+}
+
+FiberSemaphore::~FiberSemaphore()
+{
+    SYLAR_ASSERT(m_waiters.empty());
+}
+
+bool FiberSemaphore::tryWait()
+{
+    MutexType::Lock lock(m_mutex);
+    if(m_concurrency > 0u){
+        --m_concurrency;
+        return true;
+    }
+    return false;
+}
+
+void FiberSemaphore::wait()
+{
+    {
+        MutexType::Lock lock(m_mutex);
+        if(m_concurrency > 0u){
+            --m_concurrency;
+            return;
+        }
+        m_waiters.push();
+    }
+    // 被唤醒时名额已经直接转交给本协程
+    Fiber::YieldToHold();
+}
+
+void FiberSemaphore::notify()
+{
+    FiberWaitQueue::Waiter w;
+    {
+        MutexType::Lock lock(m_mutex);
+        if(!m_waiters.pop(w)){
+            ++m_concurrency;
+            return;
+        }
+    }
+    w.wake();
+}
+
+FiberMutex::FiberMutex()
+    :m_locked(false){
+}
+
+FiberMutex::~FiberMutex()
+{
+    SYLAR_ASSERT(m_waiters.empty());
+}
+
+void FiberMutex::lock()
+{
+    {
+        MutexType::Lock lock(m_mutex);
+        if(!m_locked){
+            m_locked = true;
+            return;
+        }
+        m_waiters.push();
+    }
+    // 被唤醒时锁已经直接转交给本协程
+    Fiber::YieldToHold();
+}
+
+bool FiberMutex::tryLock()
+{
+    MutexType::Lock lock(m_mutex);
+    if(m_locked){
+        return false;
+    }
+    m_locked = true;
+    return true;
+}
+
+void FiberMutex::unlock()
+{
+    FiberWaitQueue::Waiter w;
+    {
+        MutexType::Lock lock(m_mutex);
+        SYLAR_ASSERT(m_locked);
+        if(!m_waiters.pop(w)){
+            m_locked = false;
+            return;
+        }
+    }
+    w.wake();
+}
+
+void FiberCondition::wait(FiberMutex::Lock& lock)
+{
+    {
+        MutexType::Lock lock2(m_mutex);
+        m_waiters.push();
+    }
+    lock.unlock();
+    Fiber::YieldToHold();
+    lock.lock();
+}
+
+void FiberCondition::notify()
+{
+    FiberWaitQueue::Waiter w;
+    {
+        MutexType::Lock lock(m_mutex);
+        m_waiters.pop(w);
+    }
+    w.wake();
+}
+
+void FiberCondition::notifyAll()
+{
+    std::deque<FiberWaitQueue::Waiter> ws;
+    {
+        MutexType::Lock lock(m_mutex);
+        m_waiters.popAll(ws);
+    }
+    for(auto& i : ws){
+        i.wake();
+    }
+}
+
+}
@@ -0,0 +1,103 @@
+#ifndef __SYLAR_FIBER_SYNC_H__
+#define __SYLAR_FIBER_SYNC_H__
+
+#include <deque>
+#include <utility>
+#include "fiber.h"
+#include "scheduler.h"
+#include "mutex.h"
+#include "noncopyable.h"
+
+namespace sylar{
+
+// 协程级同步原语
+// 等待者作为协程挂起, 交还工作线程去执行其它任务, 被唤醒时重新提交到原来的调度器
+// 只能在调度器中的协程里调用会挂起的接口; 内部状态用自旋锁保护, 临界区只有几条指令
+// 唤醒方可能在等待者真正切出之前就把它提交出去, 由调度器等待协程切出后再恢复执行
+
+// 挂起协程的队列, 不加锁, 由使用者的锁保护
+// 提交协程可能要唤醒工作线程(系统调用), 取出等待者后在锁外调用wake
+class FiberWaitQueue{
+public:
+    struct Waiter{
+        Scheduler* scheduler = nullptr;
+        Fiber::ptr fiber;
+
+        // 重新提交到挂起时所在的调度器, 没有等待者时什么也不做
+        void wake();
+    };
+
+    // 当前协程入队, 之后由调用者释放锁并YieldToHold
+    void push();
+    // 取出最早入队的协程, 队列为空返回false
+    bool pop(Waiter& w);
+    // 取出全部协程
+    void popAll(std::deque<Waiter>& ws);
+    bool empty() const { return m_waiters.empty();}
+    size_t size() const { return m_waiters.size();}
+private:
+    std::deque<Waiter> m_waiters;
+};
+
+// 协程信号量
+class FiberSemaphore : Noncopyable{
+public:
+    typedef Spinlock MutexType;
+
+    FiberSemaphore(size_t initial_concurrency = 0);
+    ~FiberSemaphore();
+
+    bool tryWait();
+    void wait();
+    void notify();
+
+    size_t getConcurrency() const { return m_concurrency;}
+private:
+    MutexType m_mutex;
+    FiberWaitQueue m_waiters;
+    size_t m_concurrency;
+};
+
+// 协程互斥锁, 解锁时直接把锁交给最早的等待者(不会被新来的协程插队)
+class FiberMutex : Noncopyable{
+public:
+    typedef ScopedLockImpl<FiberMutex> Lock;
+    typedef Spinlock MutexType;
+
+    FiberMutex();
+    ~FiberMutex();
+
+    void lock();
+    bool tryLock();
+    void unlock();
+private:
+    MutexType m_mutex;
+    FiberWaitQueue m_waiters;
+    bool m_locked;
+};
+
+// 协程条件变量, 配合FiberMutex使用
+class FiberCondition : Noncopyable{
+public:
+    typedef Spinlock MutexType;
+
+    // 释放lock并挂起, 被唤醒后重新加锁; 可能虚假唤醒, 调用者需要循环检查条件
+    void wait(FiberMutex::Lock& lock);
+
+    template<class Predicate>
+    void wait(FiberMutex::Lock& lock, Predicate pred){
+        while(!pred()){
+            wait(lock);
+        }
+    }
+
+    void notify();
+    void notifyAll();
+private:
+    MutexType m_mutex;
+    FiberWaitQueue m_waiters;
+};
+
+}
+
+#endif
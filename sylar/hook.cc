@@ -0,0 +1,562 @@
+#include "hook.h"
+#include "fd_manager.h"
+#include "iomanager.h"
+#include "config.h"
+#include "macro.h"
+#include "log.h"
+#include <dlfcn.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+namespace sylar{
+
+static sylar::ConfigVar<int>::ptr g_tcp_connect_timeout =
+    sylar::Config::Lookup("tcp.connect.timeout", 5000, "tcp connect timeout(ms)");
+
+static thread_local bool t_hook_enable = false;
+
+#define HOOK_FUN(XX) \
+    XX(sleep) \
+    XX(usleep) \
+    XX(nanosleep) \
+    XX(socket) \
+    XX(connect) \
+    XX(accept) \
+    XX(read) \
+    XX(readv) \
+    XX(recv) \
+    XX(recvfrom) \
+    XX(recvmsg) \
+    XX(write) \
+    XX(writev) \
+    XX(send) \
+    XX(sendto) \
+    XX(sendmsg) \
+    XX(sendfile) \
+    XX(splice) \
+    XX(close) \
+    XX(fcntl) \
+    XX(ioctl) \
+    XX(getsockopt) \
+    XX(setsockopt)
+
+// 原函数指针要在任何静态对象(可能在构造时读写fd)之前就位, 用高优先级的构造函数初始化
+__attribute__((constructor(101)))
+static void hook_init()
+{
+    static bool is_inited = false;
+    if(is_inited){
+        return;
+    }
+    is_inited = true;
+#define XX(name) name ## _f = (name ## _fun)dlsym(RTLD_NEXT, #name);
+    HOOK_FUN(XX);
+#undef XX
+}
+
+// connect的默认超时在热路径上读取, 由监听器同步
+static std::atomic<uint64_t> s_connect_timeout {(uint64_t)-1};
+
+struct HookIniter{
+    HookIniter(){
+        hook_init();
+        s_connect_timeout = g_tcp_connect_timeout->getValue();
+        g_tcp_connect_timeout->addListener(0x400C0A, [](const int& old_value, const int& new_value){
+            SYLAR_LOG_INFO(g_logger) << "tcp connect timeout changed from "
+                                     << old_value << " to " << new_value;
+            s_connect_timeout = new_value;
+        });
+    }
+};
+
+static HookIniter s_hook_initer;
+
+bool is_hook_enable()
+{
+    return t_hook_enable;
+}
+
+void set_hook_enable(bool flag)
+{
+    t_hook_enable = flag;
+}
+
+// 需要协程化处理时返回当前线程的IOManager
+static IOManager* GetHookIOManager()
+{
+    if(!t_hook_enable){
+        return nullptr;
+    }
+    return IOManager::GetThis();
+}
+
+}
+
+// 超时定时器和等待的协程共享, cancelled记录超时原因
+struct TimerInfo{
+    int cancelled = 0;
+};
+
+// socket读写的公共流程: 先直接调用, EAGAIN时注册事件(和可选的超时定时器)并让出协程, 被唤醒后重试
+template<typename OriginFun, typename... Args>
+static ssize_t do_io(int fd, OriginFun fun, const char* hook_fun_name,
+                     uint32_t event, int timeout_so, Args&&... args)
+{
+    sylar::IOManager* iom = sylar::GetHookIOManager();
+    if(!iom){
+        return fun(fd, std::forward<Args>(args)...);
+    }
+
+    sylar::FdCtx::ptr ctx = sylar::FdMgr::GetInstance()->get(fd);
+    if(!ctx){
+        return fun(fd, std::forward<Args>(args)...);
+    }
+    if(ctx->isClose()){
+        errno = EBADF;
+        return -1;
+    }
+    if(!ctx->isSocket() || ctx->getUserNonblock()){
+        return fun(fd, std::forward<Args>(args)...);
+    }
+
+    uint64_t to = ctx->getTimeout(timeout_so);
+    std::shared_ptr<TimerInfo> tinfo(new TimerInfo);
+
+retry:
+    ssize_t n = fun(fd, std::forward<Args>(args)...);
+    while(n == -1 && errno == EINTR){
+        n = fun(fd, std::forward<Args>(args)...);
+    }
+    if(n == -1 && errno == EAGAIN){
+        sylar::Timer::ptr timer;
+        std::weak_ptr<TimerInfo> winfo(tinfo);
+
+        if(to != (uint64_t)-1){
+            timer = iom->addConditionTimer(to, [winfo, fd, iom, event](){
+                auto t = winfo.lock();
+                if(!t || t->cancelled){
+                    return;
+                }
+                t->cancelled = ETIMEDOUT;
+                iom->cancelEvent(fd, (sylar::IOManager::Event)(event));
+            }, winfo);
+        }
+
+        int rt = iom->addEvent(fd, (sylar::IOManager::Event)(event));
+        if(SYLAR_UNLIKELY(rt)){
+            SYLAR_LOG_ERROR(g_logger) << hook_fun_name << " addEvent("
+                << fd << ", " << event << ")";
+            if(timer){
+                timer->cancel();
+            }
+            return -1;
+        }
+        else{
+            sylar::Fiber::YieldToHold();
+            if(timer){
+                timer->cancel();
+            }
+            if(tinfo->cancelled){
+                errno = tinfo->cancelled;
+                return -1;
+            }
+            goto retry;
+        }
+    }
+    return n;
+}
+
+extern "C"{
+
+#define XX(name) name ## _fun name ## _f = nullptr;
+    HOOK_FUN(XX);
+#undef XX
+
+unsigned int sleep(unsigned int seconds)
+{
+    sylar::IOManager* iom = sylar::GetHookIOManager();
+    if(!iom){
+        return sleep_f(seconds);
+    }
+
+    sylar::Fiber::ptr fiber = sylar::Fiber::GetThis();
+    iom->addTimer((uint64_t)seconds * 1000, [iom, fiber](){
+        iom->schedule(fiber);
+    });
+    sylar::Fiber::YieldToHold();
+    return 0;
+}
+
+int usleep(useconds_t usec)
+{
+    sylar::IOManager* iom = sylar::GetHookIOManager();
+    if(!iom){
+        return usleep_f(usec);
+    }
+
+    sylar::Fiber::ptr fiber = sylar::Fiber::GetThis();
+    // 不足1ms的按1ms, 否则定时器立即到期, 只相当于让出一次
+    iom->addTimer((usec + 999) / 1000, [iom, fiber](){
+        iom->schedule(fiber);
+    });
+    sylar::Fiber::YieldToHold();
+    return 0;
+}
+
+int nanosleep(const struct timespec* req, struct timespec* rem)
+{
+    sylar::IOManager* iom = sylar::GetHookIOManager();
+    if(!iom){
+        return nanosleep_f(req, rem);
+    }
+
+    if(!req || req->tv_sec < 0 || req->tv_nsec < 0 || req->tv_nsec >= 1000000000){
+        errno = EINVAL;
+        return -1;
+    }
+    uint64_t timeout_ms = req->tv_sec * 1000 + (req->tv_nsec + 999999) / 1000000;
+    sylar::Fiber::ptr fiber = sylar::Fiber::GetThis();
+    iom->addTimer(timeout_ms, [iom, fiber](){
+        iom->schedule(fiber);
+    });
+    sylar::Fiber::YieldToHold();
+    // 协程睡眠不会被信号打断, 总是睡满
+    if(rem){
+        rem->tv_sec = 0;
+        rem->tv_nsec = 0;
+    }
+    return 0;
+}
+
+int socket(int domain, int type, int protocol)
+{
+    if(!sylar::GetHookIOManager()){
+        return socket_f(domain, type, protocol);
+    }
+    int fd = socket_f(domain, type, protocol);
+    if(fd == -1){
+        return fd;
+    }
+    // fd可能被没有开启hook的线程关闭过, 丢弃旧的上下文
+    sylar::FdMgr::GetInstance()->del(fd);
+    sylar::FdCtx::ptr ctx = sylar::FdMgr::GetInstance()->get(fd, true);
+    if(ctx && (type & SOCK_NONBLOCK)){
+        ctx->setUserNonblock(true);
+    }
+    return fd;
+}
+
+int connect_with_timeout(int fd, const struct sockaddr* addr,
+                         socklen_t addrlen, uint64_t timeout_ms)
+{
+    sylar::IOManager* iom = sylar::GetHookIOManager();
+    if(!iom){
+        return connect_f(fd, addr, addrlen);
+    }
+    sylar::FdCtx::ptr ctx = sylar::FdMgr::GetInstance()->get(fd);
+    if(!ctx){
+        return connect_f(fd, addr, addrlen);
+    }
+    if(ctx->isClose()){
+        errno = EBADF;
+        return -1;
+    }
+    if(!ctx->isSocket() || ctx->getUserNonblock()){
+        return connect_f(fd, addr, addrlen);
+    }
+
+    int n = connect_f(fd, addr, addrlen);
+    if(n == 0){
+        return 0;
+    }
+    else if(n != -1 || errno != EINPROGRESS){
+        return n;
+    }
+
+    sylar::Timer::ptr timer;
+    std::shared_ptr<TimerInfo> tinfo(new TimerInfo);
+    std::weak_ptr<TimerInfo> winfo(tinfo);
+
+    if(timeout_ms != (uint64_t)-1){
+        timer = iom->addConditionTimer(timeout_ms, [winfo, fd, iom](){
+            auto t = winfo.lock();
+            if(!t || t->cancelled){
+                return;
+            }
+            t->cancelled = ETIMEDOUT;
+            iom->cancelEvent(fd, sylar::IOManager::WRITE);
+        }, winfo);
+    }
+
+    int rt = iom->addEvent(fd, sylar::IOManager::WRITE);
+    if(rt == 0){
+        sylar::Fiber::YieldToHold();
+        if(timer){
+            timer->cancel();
+        }
+        if(tinfo->cancelled){
+            errno = tinfo->cancelled;
+            return -1;
+        }
+    }
+    else{
+        if(timer){
+            timer->cancel();
+        }
+        SYLAR_LOG_ERROR(g_logger) << "connect addEvent(" << fd << ", WRITE) error";
+    }
+
+    int error = 0;
+    socklen_t len = sizeof(int);
+    if(-1 == getsockopt_f(fd, SOL_SOCKET, SO_ERROR, &error, &len)){
+        return -1;
+    }
+    if(!error){
+        return 0;
+    }
+    else{
+        errno = error;
+        return -1;
+    }
+}
+
+int connect(int sockfd, const struct sockaddr* addr, socklen_t addrlen)
+{
+    return connect_with_timeout(sockfd, addr, addrlen, sylar::s_connect_timeout);
+}
+
+int accept(int s, struct sockaddr* addr, socklen_t* addrlen)
+{
+    int fd = do_io(s, accept_f, "accept", sylar::IOManager::READ, SO_RCVTIMEO, addr, addrlen);
+    if(fd >= 0 && sylar::GetHookIOManager()){
+        sylar::FdMgr::GetInstance()->del(fd);
+        sylar::FdMgr::GetInstance()->get(fd, true);
+    }
+    return fd;
+}
+
+ssize_t read(int fd, void* buf, size_t count)
+{
+    return do_io(fd, read_f, "read", sylar::IOManager::READ, SO_RCVTIMEO, buf, count);
+}
+
+ssize_t readv(int fd, const struct iovec* iov, int iovcnt)
+{
+    return do_io(fd, readv_f, "readv", sylar::IOManager::READ, SO_RCVTIMEO, iov, iovcnt);
+}
+
+ssize_t recv(int sockfd, void* buf, size_t len, int flags)
+{
+    return do_io(sockfd, recv_f, "recv", sylar::IOManager::READ, SO_RCVTIMEO, buf, len, flags);
+}
+
+ssize_t recvfrom(int sockfd, void* buf, size_t len, int flags,
+                 struct sockaddr* src_addr, socklen_t* addrlen)
+{
+    return do_io(sockfd, recvfrom_f, "recvfrom", sylar::IOManager::READ, SO_RCVTIMEO,
+                 buf, len, flags, src_addr, addrlen);
+}
+
+ssize_t recvmsg(int sockfd, struct msghdr* msg, int flags)
+{
+    return do_io(sockfd, recvmsg_f, "recvmsg", sylar::IOManager::READ, SO_RCVTIMEO, msg, flags);
+}
+
+ssize_t write(int fd, const void* buf, size_t count)
+{
+    return do_io(fd, write_f, "write", sylar::IOManager::WRITE, SO_SNDTIMEO, buf, count);
+}
+
+ssize_t writev(int fd, const struct iovec* iov, int iovcnt)
+{
+    return do_io(fd, writev_f, "writev", sylar::IOManager::WRITE, SO_SNDTIMEO, iov, iovcnt);
+}
+
+ssize_t send(int s, const void* msg, size_t len, int flags)
+{
+    return do_io(s, send_f, "send", sylar::IOManager::WRITE, SO_SNDTIMEO, msg, len, flags);
+}
+
+ssize_t sendto(int s, const void* msg, size_t len, int flags,
+               const struct sockaddr* to, socklen_t tolen)
+{
+    return do_io(s, sendto_f, "sendto", sylar::IOManager::WRITE, SO_SNDTIMEO,
+                 msg, len, flags, to, tolen);
+}
+
+ssize_t sendmsg(int s, const struct msghdr* msg, int flags)
+{
+    return do_io(s, sendmsg_f, "sendmsg", sylar::IOManager::WRITE, SO_SNDTIMEO, msg, flags);
+}
+
+ssize_t sendfile(int out_fd, int in_fd, off_t* offset, size_t count)
+{
+    return do_io(out_fd, sendfile_f, "sendfile", sylar::IOManager::WRITE, SO_SNDTIMEO,
+                 in_fd, offset, count);
+}
+
+// do_io按第一个参数的fd等待, 把splice的输出fd调整到第一个参数
+static ssize_t splice_out(int fd_out, int fd_in, loff_t* off_in,
+                          loff_t* off_out, size_t len, unsigned int flags)
+{
+    return splice_f(fd_in, off_in, fd_out, off_out, len, flags);
+}
+
+ssize_t splice(int fd_in, loff_t* off_in, int fd_out, loff_t* off_out,
+               size_t len, unsigned int flags)
+{
+    // 输出端是socket时等待可写, 否则输入端是socket时等待可读
+    if(sylar::GetHookIOManager()){
+        sylar::FdCtx::ptr ctx = sylar::FdMgr::GetInstance()->get(fd_out);
+        if(ctx && ctx->isSocket()){
+            return do_io(fd_out, splice_out, "splice", sylar::IOManager::WRITE, SO_SNDTIMEO,
+                         fd_in, off_in, off_out, len, flags);
+        }
+    }
+    return do_io(fd_in, splice_f, "splice", sylar::IOManager::READ, SO_RCVTIMEO,
+                 off_in, fd_out, off_out, len, flags);
+}
+
+int close(int fd)
+{
+    if(!sylar::is_hook_enable()){
+        return close_f(fd);
+    }
+
+    sylar::FdCtx::ptr ctx = sylar::FdMgr::GetInstance()->get(fd);
+    if(ctx){
+        // 唤醒等在这个fd上的协程
+        auto iom = sylar::IOManager::GetThis();
+        if(iom){
+            iom->cancelAll(fd);
+        }
+        sylar::FdMgr::GetInstance()->del(fd);
+    }
+    return close_f(fd);
+}
+
+int fcntl(int fd, int cmd, ... /* arg */ )
+{
+    va_list va;
+    va_start(va, cmd);
+    switch(cmd){
+        case F_SETFL:
+            {
+                int arg = va_arg(va, int);
+                va_end(va);
+                sylar::FdCtx::ptr ctx = sylar::FdMgr::GetInstance()->get(fd);
+                if(!ctx || ctx->isClose() || !ctx->isSocket()){
+                    return fcntl_f(fd, cmd, arg);
+                }
+                // 记录用户要求的非阻塞, 系统层面保持hook设置的状态
+                ctx->setUserNonblock(arg & O_NONBLOCK);
+                if(ctx->getSysNonblock()){
+                    arg |= O_NONBLOCK;
+                }
+                else{
+                    arg &= ~O_NONBLOCK;
+                }
+                return fcntl_f(fd, cmd, arg);
+            }
+            break;
+        case F_GETFL:
+            {
+                va_end(va);
+                int arg = fcntl_f(fd, cmd);
+                sylar::FdCtx::ptr ctx = sylar::FdMgr::GetInstance()->get(fd);
+                if(!ctx || ctx->isClose() || !ctx->isSocket()){
+                    return arg;
+                }
+                if(ctx->getUserNonblock()){
+                    return arg | O_NONBLOCK;
+                }
+                else{
+                    return arg & ~O_NONBLOCK;
+                }
+            }
+            break;
+        case F_DUPFD:
+        case F_DUPFD_CLOEXEC:
+        case F_SETFD:
+        case F_SETOWN:
+        case F_SETSIG:
+        case F_SETLEASE:
+        case F_NOTIFY:
+#ifdef F_SETPIPE_SZ
+        case F_SETPIPE_SZ:
+#endif
+            {
+                int arg = va_arg(va, int);
+                va_end(va);
+                return fcntl_f(fd, cmd, arg);
+            }
+            break;
+        case F_GETFD:
+        case F_GETOWN:
+        case F_GETSIG:
+        case F_GETLEASE:
+#ifdef F_GETPIPE_SZ
+        case F_GETPIPE_SZ:
+#endif
+            {
+                va_end(va);
+                return fcntl_f(fd, cmd);
+            }
+            break;
+        default:
+            {
+                // 其余命令的参数都是指针(flock, f_owner_ex等)
+                void* arg = va_arg(va, void*);
+                va_end(va);
+                return fcntl_f(fd, cmd, arg);
+            }
+            break;
+    }
+}
+
+int ioctl(int d, unsigned long int request, ...)
+{
+    va_list va;
+    va_start(va, request);
+    void* arg = va_arg(va, void*);
+    va_end(va);
+
+    if(FIONBIO == request){
+        bool user_nonblock = !!*(int*)arg;
+        sylar::FdCtx::ptr ctx = sylar::FdMgr::GetInstance()->get(d);
+        if(!ctx || ctx->isClose() || !ctx->isSocket()){
+            return ioctl_f(d, request, arg);
+        }
+        ctx->setUserNonblock(user_nonblock);
+        // 系统层面保持非阻塞
+        int nonblock = ctx->getSysNonblock() ? 1 : 0;
+        return ioctl_f(d, request, &nonblock);
+    }
+    return ioctl_f(d, request, arg);
+}
+
+int getsockopt(int sockfd, int level, int optname, void* optval, socklen_t* optlen)
+{
+    return getsockopt_f(sockfd, level, optname, optval, optlen);
+}
+
+int setsockopt(int sockfd, int level, int optname, const void* optval, socklen_t optlen)
+{
+    if(level == SOL_SOCKET
+            && (optname == SO_RCVTIMEO || optname == SO_SNDTIMEO)){
+        sylar::FdCtx::ptr ctx = sylar::FdMgr::GetInstance()->get(sockfd);
+        if(ctx){
+            const timeval* v = (const timeval*)optval;
+            uint64_t ms = v->tv_sec * 1000 + v->tv_usec / 1000;
+            // 0表示不超时
+            ctx->setTimeout(optname, ms ? ms : (uint64_t)-1);
+        }
+    }
+    return setsockopt_f(sockfd, level, optname, optval, optlen);
+}
+
+}
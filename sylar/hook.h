@@ -0,0 +1,114 @@
+#ifndef __SYLAR_HOOK_H__
+#define __SYLAR_HOOK_H__
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+// 系统调用hook
+// 同名函数覆盖libc的符号, 原函数通过dlsym(RTLD_NEXT)取得并保存在 xxx_f 中
+// 只在开启了hook的线程(调度器的工作线程)且运行在IOManager中时生效:
+//   sleep/usleep/nanosleep 变成定时器 + 让出协程
+//   socket上的读写/connect/accept/sendfile/splice 在EAGAIN时注册事件并让出协程, 支持SO_RCVTIMEO/SO_SNDTIMEO超时
+// 用户自己设置了非阻塞的fd保持原来的语义
+namespace sylar{
+
+// 当前线程是否开启hook
+bool is_hook_enable();
+void set_hook_enable(bool flag);
+
+}
+
+extern "C"{
+
+// sleep
+typedef unsigned int (*sleep_fun)(unsigned int seconds);
+extern sleep_fun sleep_f;
+
+typedef int (*usleep_fun)(useconds_t usec);
+extern usleep_fun usleep_f;
+
+typedef int (*nanosleep_fun)(const struct timespec* req, struct timespec* rem);
+extern nanosleep_fun nanosleep_f;
+
+// socket
+typedef int (*socket_fun)(int domain, int type, int protocol);
+extern socket_fun socket_f;
+
+typedef int (*connect_fun)(int sockfd, const struct sockaddr* addr, socklen_t addrlen);
+extern connect_fun connect_f;
+
+typedef int (*accept_fun)(int s, struct sockaddr* addr, socklen_t* addrlen);
+extern accept_fun accept_f;
+
+// read
+typedef ssize_t (*read_fun)(int fd, void* buf, size_t count);
+extern read_fun read_f;
+
+typedef ssize_t (*readv_fun)(int fd, const struct iovec* iov, int iovcnt);
+extern readv_fun readv_f;
+
+typedef ssize_t (*recv_fun)(int sockfd, void* buf, size_t len, int flags);
+extern recv_fun recv_f;
+
+typedef ssize_t (*recvfrom_fun)(int sockfd, void* buf, size_t len, int flags,
+                                struct sockaddr* src_addr, socklen_t* addrlen);
+extern recvfrom_fun recvfrom_f;
+
+typedef ssize_t (*recvmsg_fun)(int sockfd, struct msghdr* msg, int flags);
+extern recvmsg_fun recvmsg_f;
+
+// write
+typedef ssize_t (*write_fun)(int fd, const void* buf, size_t count);
+extern write_fun write_f;
+
+typedef ssize_t (*writev_fun)(int fd, const struct iovec* iov, int iovcnt);
+extern writev_fun writev_f;
+
+typedef ssize_t (*send_fun)(int s, const void* msg, size_t len, int flags);
+extern send_fun send_f;
+
+typedef ssize_t (*sendto_fun)(int s, const void* msg, size_t len, int flags,
+                              const struct sockaddr* to, socklen_t tolen);
+extern sendto_fun sendto_f;
+
+typedef ssize_t (*sendmsg_fun)(int s, const struct msghdr* msg, int flags);
+extern sendmsg_fun sendmsg_f;
+
+// 文件到socket的零拷贝传输
+typedef ssize_t (*sendfile_fun)(int out_fd, int in_fd, off_t* offset, size_t count);
+extern sendfile_fun sendfile_f;
+
+typedef ssize_t (*splice_fun)(int fd_in, loff_t* off_in, int fd_out, loff_t* off_out,
+                              size_t len, unsigned int flags);
+extern splice_fun splice_f;
+
+// fd状态
+typedef int (*close_fun)(int fd);
+extern close_fun close_f;
+
+typedef int (*fcntl_fun)(int fd, int cmd, ...);
+extern fcntl_fun fcntl_f;
+
+typedef int (*ioctl_fun)(int d, unsigned long int request, ...);
+extern ioctl_fun ioctl_f;
+
+typedef int (*getsockopt_fun)(int sockfd, int level, int optname,
+                              void* optval, socklen_t* optlen);
+extern getsockopt_fun getsockopt_f;
+
+typedef int (*setsockopt_fun)(int sockfd, int level, int optname,
+                              const void* optval, socklen_t optlen);
+extern setsockopt_fun setsockopt_f;
+
+// 带超时的connect, timeout_ms为-1时不超时; 普通connect使用配置 tcp.connect.timeout
+extern int connect_with_timeout(int fd, const struct sockaddr* addr,
+                                socklen_t addrlen, uint64_t timeout_ms);
+
+}
+
+#endif
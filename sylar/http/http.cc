@@ -0,0 +1,228 @@
+#include "http.h"
+#include <sstream>
+#include <stdio.h>
+
+namespace sylar{
+namespace http{
+
+HttpMethod StringToHttpMethod(const std::string& m)
+{
+    return CharsToHttpMethod(m.c_str(), m.size());
+}
+
+HttpMethod CharsToHttpMethod(const char* m, size_t len)
+{
+#define XX(num, name, string) \
+    if(len == sizeof(#string) - 1 && memcmp(m, #string, len) == 0){ \
+        return HttpMethod::name; \
+    }
+    HTTP_METHOD_MAP(XX);
+#undef XX
+    return HttpMethod::INVALID_METHOD;
+}
+
+static const char* s_method_string[] = {
+#define XX(num, name, string) #string,
+    HTTP_METHOD_MAP(XX)
+#undef XX
+};
+
+const char* HttpMethodToString(const HttpMethod& m)
+{
+    uint32_t idx = (uint32_t)m;
+    if(idx >= (sizeof(s_method_string) / sizeof(s_method_string[0]))){
+        return "<unknown>";
+    }
+    return s_method_string[idx];
+}
+
+const char* HttpStatusToString(const HttpStatus& s)
+{
+    switch(s){
+#define XX(code, name, msg) \
+        case HttpStatus::name: \
+            return #msg;
+        HTTP_STATUS_MAP(XX);
+#undef XX
+        default:
+            return "<unknown>";
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const StringView& v)
+{
+    return os.write(v.data(), v.size());
+}
+
+bool CaseInsensitiveLess::operator()(const std::string& lhs
+                            ,const std::string& rhs) const
+{
+    return strcasecmp(lhs.c_str(), rhs.c_str()) < 0;
+}
+
+HttpRequest::HttpRequest()
+    :m_base(nullptr)
+    ,m_method(HttpMethod::GET)
+    ,m_version(0x11)
+    ,m_close(false)
+    ,m_chunked(false)
+    ,m_contentLength(0){
+}
+
+StringView HttpRequest::getPath() const
+{
+    if(m_path.len == 0){
+        return StringView("/", 1);
+    }
+    return view(m_path);
+}
+
+StringView HttpRequest::getHeader(const StringView& key) const
+{
+    for(auto& i : m_headers){
+        StringView name = view(i.name);
+        if(name.equalsIgnoreCase(key)){
+            return view(i.value);
+        }
+    }
+    return StringView();
+}
+
+bool HttpRequest::hasHeader(const StringView& key, StringView* val) const
+{
+    for(auto& i : m_headers){
+        if(view(i.name).equalsIgnoreCase(key)){
+            if(val){
+                *val = view(i.value);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+std::ostream& HttpRequest::dump(std::ostream& os) const
+{
+    os << HttpMethodToString(m_method) << " "
+       << getUri()
+       << " HTTP/" << ((uint32_t)(m_version >> 4))
+       << "." << ((uint32_t)(m_version & 0x0F))
+       << "\r\n";
+    for(size_t i = 0; i < m_headers.size(); ++i){
+        os << getHeaderName(i) << ": " << getHeaderValue(i) << "\r\n";
+    }
+    os << "\r\n" << getBody();
+    return os;
+}
+
+std::string HttpRequest::toString() const
+{
+    std::stringstream ss;
+    dump(ss);
+    return ss.str();
+}
+
+HttpResponse::HttpResponse(uint8_t version, bool close)
+    :m_status(HttpStatus::OK)
+    ,m_version(version)
+    ,m_close(close){
+}
+
+std::string HttpResponse::getHeader(const std::string& key, const std::string& def) const
+{
+    auto it = m_headers.find(key);
+    return it == m_headers.end() ? def : it->second;
+}
+
+void HttpResponse::setHeader(const std::string& key, const std::string& val)
+{
+    m_headers[key] = val;
+}
+
+void HttpResponse::delHeader(const std::string& key)
+{
+    m_headers.erase(key);
+}
+
+std::ostream& HttpResponse::dump(std::ostream& os) const
+{
+    os << "HTTP/" << ((uint32_t)(m_version >> 4))
+       << "." << ((uint32_t)(m_version & 0x0F))
+       << " " << (uint32_t)m_status
+       << " " << (m_reason.empty() ? HttpStatusToString(m_status) : m_reason)
+       << "\r\n";
+    for(auto& i : m_headers){
+        if(strcasecmp(i.first.c_str(), "connection") == 0
+                || strcasecmp(i.first.c_str(), "content-length") == 0){
+            continue;
+        }
+        os << i.first << ": " << i.second << "\r\n";
+    }
+    os << "connection: " << (m_close ? "close" : "keep-alive") << "\r\n";
+    // 1xx/204/304没有消息体; 其余即使消息体为空也要给出长度, 否则保持连接的对端无法判断响应结束
+    uint32_t status = (uint32_t)m_status;
+    if(status >= 200 && status != 204 && status != 304){
+        os << "content-length: " << m_body.size() << "\r\n";
+    }
+    os << "\r\n" << m_body;
+    return os;
+}
+
+void HttpResponse::dump(ByteArray::ptr ba) const
+{
+    char buf[64];
+    int n = snprintf(buf, sizeof(buf), "HTTP/%u.%u %u ", (uint32_t)(m_version >> 4)
+                     ,(uint32_t)(m_version & 0x0F), (uint32_t)m_status);
+    ba->write(buf, n);
+    if(m_reason.empty()){
+        const char* reason = HttpStatusToString(m_status);
+        ba->write(reason, strlen(reason));
+    }
+    else{
+        ba->write(m_reason.c_str(), m_reason.size());
+    }
+    ba->write("\r\n", 2);
+    for(auto& i : m_headers){
+        if(strcasecmp(i.first.c_str(), "connection") == 0
+                || strcasecmp(i.first.c_str(), "content-length") == 0){
+            continue;
+        }
+        ba->write(i.first.c_str(), i.first.size());
+        ba->write(": ", 2);
+        ba->write(i.second.c_str(), i.second.size());
+        ba->write("\r\n", 2);
+    }
+    if(m_close){
+        ba->write("connection: close\r\n", 19);
+    }
+    else{
+        ba->write("connection: keep-alive\r\n", 24);
+    }
+    uint32_t status = (uint32_t)m_status;
+    if(status >= 200 && status != 204 && status != 304){
+        n = snprintf(buf, sizeof(buf), "content-length: %zu\r\n", m_body.size());
+        ba->write(buf, n);
+    }
+    ba->write("\r\n", 2);
+    ba->write(m_body.c_str(), m_body.size());
+}
+
+std::string HttpResponse::toString() const
+{
+    std::stringstream ss;
+    dump(ss);
+    return ss.str();
+}
+
+std::ostream& operator<<(std::ostream& os, const HttpRequest& req)
+{
+    return req.dump(os);
+}
+
+std::ostream& operator<<(std::ostream& os, const HttpResponse& rsp)
+{
+    return rsp.dump(os);
+}
+
+}
+}
@@ -0,0 +1,251 @@
+#ifndef __SYLAR_HTTP_HTTP_H__
+#define __SYLAR_HTTP_HTTP_H__
+
+#include <memory>
+#include <string>
+#include <map>
+#include <vector>
+#include <ostream>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include "../bytearray.h"
+
+namespace sylar{
+namespace http{
+
+/* Request Methods */
+#define HTTP_METHOD_MAP(XX)         \
+  XX(0,  DELETE,      DELETE)       \
+  XX(1,  GET,         GET)          \
+  XX(2,  HEAD,        HEAD)         \
+  XX(3,  POST,        POST)         \
+  XX(4,  PUT,         PUT)          \
+  XX(5,  CONNECT,     CONNECT)      \
+  XX(6,  OPTIONS,     OPTIONS)      \
+  XX(7,  TRACE,       TRACE)        \
+  XX(8,  PATCH,       PATCH)        \
+
+/* Status Codes */
+#define HTTP_STATUS_MAP(XX)                                                 \
+  XX(100, CONTINUE,                        Continue)                        \
+  XX(101, SWITCHING_PROTOCOLS,             Switching Protocols)             \
+  XX(200, OK,                              OK)                              \
+  XX(201, CREATED,                         Created)                         \
+  XX(202, ACCEPTED,                        Accepted)                        \
+  XX(203, NON_AUTHORITATIVE_INFORMATION,   Non-Authoritative Information)   \
+  XX(204, NO_CONTENT,                      No Content)                      \
+  XX(205, RESET_CONTENT,                   Reset Content)                   \
+  XX(206, PARTIAL_CONTENT,                 Partial Content)                 \
+  XX(300, MULTIPLE_CHOICES,                Multiple Choices)                \
+  XX(301, MOVED_PERMANENTLY,               Moved Permanently)               \
+  XX(302, FOUND,                           Found)                           \
+  XX(303, SEE_OTHER,                       See Other)                       \
+  XX(304, NOT_MODIFIED,                    Not Modified)                    \
+  XX(307, TEMPORARY_REDIRECT,              Temporary Redirect)              \
+  XX(308, PERMANENT_REDIRECT,              Permanent Redirect)              \
+  XX(400, BAD_REQUEST,                     Bad Request)                     \
+  XX(401, UNAUTHORIZED,                    Unauthorized)                    \
+  XX(403, FORBIDDEN,                       Forbidden)                       \
+  XX(404, NOT_FOUND,                       Not Found)                       \
+  XX(405, METHOD_NOT_ALLOWED,              Method Not Allowed)              \
+  XX(408, REQUEST_TIMEOUT,                 Request Timeout)                 \
+  XX(411, LENGTH_REQUIRED,                 Length Required)                 \
+  XX(413, PAYLOAD_TOO_LARGE,               Payload Too Large)               \
+  XX(414, URI_TOO_LONG,                    URI Too Long)                    \
+  XX(431, REQUEST_HEADER_FIELDS_TOO_LARGE, Request Header Fields Too Large) \
+  XX(500, INTERNAL_SERVER_ERROR,           Internal Server Error)           \
+  XX(501, NOT_IMPLEMENTED,                 Not Implemented)                 \
+  XX(502, BAD_GATEWAY,                     Bad Gateway)                     \
+  XX(503, SERVICE_UNAVAILABLE,             Service Unavailable)             \
+  XX(504, GATEWAY_TIMEOUT,                 Gateway Timeout)                 \
+  XX(505, HTTP_VERSION_NOT_SUPPORTED,      HTTP Version Not Supported)      \
+
+enum class HttpMethod{
+#define XX(num, name, string) name = num,
+    HTTP_METHOD_MAP(XX)
+#undef XX
+    INVALID_METHOD
+};
+
+enum class HttpStatus{
+#define XX(code, name, desc) name = code,
+    HTTP_STATUS_MAP(XX)
+#undef XX
+};
+
+HttpMethod StringToHttpMethod(const std::string& m);
+HttpMethod CharsToHttpMethod(const char* m, size_t len);
+const char* HttpMethodToString(const HttpMethod& m);
+// 不认识的状态码返回"<unknown>"
+const char* HttpStatusToString(const HttpStatus& s);
+
+// 指向外部内存的一段字符, 不拥有内存, 内存失效后不能再使用
+class StringView{
+public:
+    StringView()
+        :m_data(nullptr)
+        ,m_size(0){
+    }
+    StringView(const char* data, size_t size)
+        :m_data(data)
+        ,m_size(size){
+    }
+    StringView(const char* str)
+        :m_data(str)
+        ,m_size(strlen(str)){
+    }
+    StringView(const std::string& str)
+        :m_data(str.c_str())
+        ,m_size(str.size()){
+    }
+
+    const char* data() const { return m_data;}
+    size_t size() const { return m_size;}
+    bool empty() const { return m_size == 0;}
+    char operator[](size_t i) const { return m_data[i];}
+    const char* begin() const { return m_data;}
+    const char* end() const { return m_data + m_size;}
+
+    std::string toString() const { return std::string(m_data, m_size);}
+
+    bool operator==(const StringView& rhs) const {
+        return m_size == rhs.m_size && memcmp(m_data, rhs.m_data, m_size) == 0;
+    }
+    bool operator!=(const StringView& rhs) const { return !(*this == rhs);}
+    bool equalsIgnoreCase(const StringView& rhs) const {
+        return m_size == rhs.m_size && strncasecmp(m_data, rhs.m_data, m_size) == 0;
+    }
+private:
+    const char* m_data;
+    size_t m_size;
+};
+
+std::ostream& operator<<(std::ostream& os, const StringView& v);
+
+struct CaseInsensitiveLess{
+    bool operator()(const std::string& lhs, const std::string& rhs) const;
+};
+
+// 消息中的一段内容, 偏移相对于消息的第一个字节
+struct HttpRange{
+    uint32_t off = 0;
+    uint32_t len = 0;
+};
+
+// 一个头部字段
+struct HttpField{
+    HttpRange name;
+    HttpRange value;
+};
+
+// 解析得到的HTTP请求
+// 起始行、头部和消息体都不拷贝, 只记录在接收缓冲区中的位置, 取值时返回指向缓冲区的StringView
+// 因此在请求处理完之前, 接收缓冲区中这个请求的内容不能修改或释放
+class HttpRequest{
+public:
+    typedef std::shared_ptr<HttpRequest> ptr;
+
+    HttpRequest();
+
+    HttpMethod getMethod() const { return m_method;}
+    // 0x11 HTTP/1.1, 0x10 HTTP/1.0
+    uint8_t getVersion() const { return m_version;}
+
+    // 请求行中的请求目标
+    StringView getUri() const { return view(m_uri);}
+    // 绝对形式(http://host/path)的请求目标只取路径部分, 路径为空时返回"/"
+    StringView getPath() const;
+    StringView getQuery() const { return view(m_query);}
+    StringView getFragment() const { return view(m_fragment);}
+    StringView getBody() const { return view(m_body);}
+
+    size_t getHeaderCount() const { return m_headers.size();}
+    StringView getHeaderName(size_t idx) const { return view(m_headers[idx].name);}
+    StringView getHeaderValue(size_t idx) const { return view(m_headers[idx].value);}
+    // 名字不区分大小写, 有多个同名字段时返回第一个, 没有时返回空的StringView
+    StringView getHeader(const StringView& key) const;
+    bool hasHeader(const StringView& key, StringView* val = nullptr) const;
+
+    // 处理完这个请求后是否关闭连接, 由版本和Connection头决定
+    bool isClose() const { return m_close;}
+    bool isChunked() const { return m_chunked;}
+    // 没有Content-Length时为0
+    uint64_t getContentLength() const { return m_contentLength;}
+
+    // 请求内容所在的内存, 即请求的第一个字节
+    const char* getBase() const { return m_base;}
+
+    std::ostream& dump(std::ostream& os) const;
+    std::string toString() const;
+private:
+    StringView view(const HttpRange& r) const { return StringView(m_base + r.off, r.len);}
+private:
+    friend class HttpRequestParser;
+
+    const char* m_base;
+    HttpMethod m_method;
+    uint8_t m_version;
+    bool m_close;
+    bool m_chunked;
+    uint64_t m_contentLength;
+    HttpRange m_uri;
+    HttpRange m_path;
+    HttpRange m_query;
+    HttpRange m_fragment;
+    HttpRange m_body;
+    std::vector<HttpField> m_headers;
+};
+
+// HTTP响应, 自己持有所有内容, 用于构造要发送的响应
+class HttpResponse{
+public:
+    typedef std::shared_ptr<HttpResponse> ptr;
+    typedef std::map<std::string, std::string, CaseInsensitiveLess> MapType;
+
+    HttpResponse(uint8_t version = 0x11, bool close = true);
+
+    HttpStatus getStatus() const { return m_status;}
+    void setStatus(HttpStatus v) { m_status = v;}
+
+    uint8_t getVersion() const { return m_version;}
+    void setVersion(uint8_t v) { m_version = v;}
+
+    const std::string& getBody() const { return m_body;}
+    void setBody(const std::string& v) { m_body = v;}
+
+    // 为空时使用状态码的标准描述
+    const std::string& getReason() const { return m_reason;}
+    void setReason(const std::string& v) { m_reason = v;}
+
+    const MapType& getHeaders() const { return m_headers;}
+    void setHeaders(const MapType& v) { m_headers = v;}
+
+    bool isClose() const { return m_close;}
+    void setClose(bool v) { m_close = v;}
+
+    std::string getHeader(const std::string& key, const std::string& def = "") const;
+    void setHeader(const std::string& key, const std::string& val);
+    void delHeader(const std::string& key);
+
+    // Connection和Content-Length由isClose和消息体生成, headers中的同名字段被忽略
+    std::ostream& dump(std::ostream& os) const;
+    // 同上, 直接写入ByteArray的当前位置, 不经过stringstream, 用于发送
+    void dump(ByteArray::ptr ba) const;
+    std::string toString() const;
+private:
+    HttpStatus m_status;
+    uint8_t m_version;
+    bool m_close;
+    std::string m_body;
+    std::string m_reason;
+    MapType m_headers;
+};
+
+std::ostream& operator<<(std::ostream& os, const HttpRequest& req);
+std::ostream& operator<<(std::ostream& os, const HttpResponse& rsp);
+
+}
+}
+
+#endif
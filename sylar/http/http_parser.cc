@@ -0,0 +1,778 @@
+#include "http_parser.h"
+#include "../config.h"
+#include "../log.h"
+#include <algorithm>
+#include <atomic>
+
+namespace sylar{
+namespace http{
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+static sylar::ConfigVar<uint64_t>::ptr g_http_request_buffer_size =
+    sylar::Config::Lookup("http.request.buffer_size"
+                ,(uint64_t)(4 * 1024), "http request line and headers max size");
+static sylar::ConfigVar<uint64_t>::ptr g_http_request_max_body_size =
+    sylar::Config::Lookup("http.request.max_body_size"
+                ,(uint64_t)(64 * 1024 * 1024), "http request max body size");
+static sylar::ConfigVar<uint64_t>::ptr g_http_response_buffer_size =
+    sylar::Config::Lookup("http.response.buffer_size"
+                ,(uint64_t)(4 * 1024), "http status line and headers max size");
+static sylar::ConfigVar<uint64_t>::ptr g_http_response_max_body_size =
+    sylar::Config::Lookup("http.response.max_body_size"
+                ,(uint64_t)(64 * 1024 * 1024), "http response max body size");
+
+// 每个解析器创建时都要读取, 由监听器同步到原子变量
+static std::atomic<uint64_t> s_http_request_buffer_size {0};
+static std::atomic<uint64_t> s_http_request_max_body_size {0};
+static std::atomic<uint64_t> s_http_response_buffer_size {0};
+static std::atomic<uint64_t> s_http_response_max_body_size {0};
+
+struct _RequestSizeIniter{
+    _RequestSizeIniter(){
+        s_http_request_buffer_size = g_http_request_buffer_size->getValue();
+        s_http_request_max_body_size = g_http_request_max_body_size->getValue();
+        s_http_response_buffer_size = g_http_response_buffer_size->getValue();
+        s_http_response_max_body_size = g_http_response_max_body_size->getValue();
+
+        g_http_request_buffer_size->addListener(0x477001, [](const uint64_t& ov, const uint64_t& nv){
+            s_http_request_buffer_size = nv;
+        });
+        g_http_request_max_body_size->addListener(0x477002, [](const uint64_t& ov, const uint64_t& nv){
+            s_http_request_max_body_size = nv;
+        });
+        g_http_response_buffer_size->addListener(0x477003, [](const uint64_t& ov, const uint64_t& nv){
+            s_http_response_buffer_size = nv;
+        });
+        g_http_response_max_body_size->addListener(0x477004, [](const uint64_t& ov, const uint64_t& nv){
+            s_http_response_max_body_size = nv;
+        });
+    }
+};
+static _RequestSizeIniter _init;
+
+// 区间用32位表示, 单个消息不能超过这个大小
+static const uint64_t MAX_MESSAGE_SIZE = 0x7FFFFFFF;
+// 块长度行(含扩展)的最大长度
+static const size_t MAX_CHUNK_SIZE_LINE = 1024;
+
+// RFC 7230 tchar, 头部字段名允许的字符
+static const bool s_token_char[256] = {
+#define T(c) (((c) >= '0' && (c) <= '9') || ((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z') \
+        || (c) == '!' || (c) == '#' || (c) == '$' || (c) == '%' || (c) == '&' || (c) == '\'' \
+        || (c) == '*' || (c) == '+' || (c) == '-' || (c) == '.' || (c) == '^' || (c) == '_' \
+        || (c) == '`' || (c) == '|' || (c) == '~')
+#define R(n) T(n), T(n + 1), T(n + 2), T(n + 3), T(n + 4), T(n + 5), T(n + 6), T(n + 7), \
+        T(n + 8), T(n + 9), T(n + 10), T(n + 11), T(n + 12), T(n + 13), T(n + 14), T(n + 15)
+    R(0), R(16), R(32), R(48), R(64), R(80), R(96), R(112),
+    R(128), R(144), R(160), R(176), R(192), R(208), R(224), R(240)
+#undef R
+#undef T
+};
+
+// 头部字段值中不允许的控制字符(HTAB除外)
+// 写成无分支的形式, 调用它的循环不提前退出, 编译器可以向量化
+static inline uint8_t IsCtl(uint8_t c){
+    return ((c < 0x20) & (c != '\t')) | (c == 0x7F);
+}
+
+static inline bool IsOws(char c){
+    return c == ' ' || c == '\t';
+}
+
+// 去掉两端的空白
+static void TrimOws(const char* data, HttpRange& r){
+    while(r.len > 0 && IsOws(data[r.off])){
+        ++r.off;
+        --r.len;
+    }
+    while(r.len > 0 && IsOws(data[r.off + r.len - 1])){
+        --r.len;
+    }
+}
+
+// 逗号分隔的列表, 对每一项(去掉空白后)调用cb
+template<class CallBack>
+static void ForEachToken(const char* data, const HttpRange& value, CallBack cb){
+    size_t begin = value.off;
+    size_t end = value.off + value.len;
+    while(begin <= end){
+        const char* comma = (const char*)memchr(data + begin, ',', end - begin);
+        size_t pos = comma ? comma - data : end;
+        HttpRange token;
+        token.off = begin;
+        token.len = pos - begin;
+        TrimOws(data, token);
+        if(token.len){
+            cb(StringView(data + token.off, token.len));
+        }
+        begin = pos + 1;
+    }
+}
+
+HttpParser::HttpParser(bool is_request, uint64_t header_limit, uint64_t body_limit)
+    :m_isRequest(is_request)
+    ,m_headerLimit(std::min(header_limit, MAX_MESSAGE_SIZE))
+    ,m_bodyLimit(std::min(body_limit, MAX_MESSAGE_SIZE)){
+    HttpParser::reset();
+}
+
+void HttpParser::reset()
+{
+    m_state = START_LINE;
+    m_error = OK;
+    m_version = 0x11;
+    m_close = false;
+    m_chunked = false;
+    m_noBody = false;
+    m_contentLength = 0;
+    // 上一个消息的字段已经交给结果对象, 预留容量避免逐个插入时反复扩容
+    m_fields.clear();
+    m_fields.reserve(16);
+    m_body = HttpRange();
+    m_nread = 0;
+    m_scan = 0;
+    m_hasContentLength = false;
+    m_connClose = false;
+    m_connKeepAlive = false;
+    m_unknownEncoding = false;
+    m_chunkLeft = 0;
+    m_trailerStart = 0;
+}
+
+void HttpParser::setHeaderLimit(uint64_t v)
+{
+    m_headerLimit = std::min(v, MAX_MESSAGE_SIZE);
+}
+
+void HttpParser::setBodyLimit(uint64_t v)
+{
+    m_bodyLimit = std::min(v, MAX_MESSAGE_SIZE);
+}
+
+bool HttpParser::setError(int error)
+{
+    m_state = ERROR;
+    m_error = error;
+    return false;
+}
+
+bool HttpParser::nextLine(const char* data, size_t len, HttpRange& line)
+{
+    if(m_scan < m_nread){
+        m_scan = m_nread;
+    }
+    if(m_scan >= len){
+        return false;
+    }
+    const char* nl = (const char*)memchr(data + m_scan, '\n', len - m_scan);
+    if(!nl){
+        m_scan = len;
+        return false;
+    }
+    size_t end = nl - data;
+    line.off = m_nread;
+    line.len = end - m_nread;
+    if(line.len > 0 && data[end - 1] == '\r'){
+        --line.len;
+    }
+    m_nread = m_scan = end + 1;
+    return true;
+}
+
+int HttpParser::execute(char* data, size_t len)
+{
+    if(len > MAX_MESSAGE_SIZE){
+        len = MAX_MESSAGE_SIZE;
+    }
+    while(true){
+        switch(m_state){
+            case START_LINE:
+            case HEADER:{
+                HttpRange line;
+                if(!nextLine(data, len, line)){
+                    return len > m_headerLimit ? (setError(HEADER_TOO_LARGE), -1) : 0;
+                }
+                if(m_nread > m_headerLimit){
+                    setError(HEADER_TOO_LARGE);
+                    return -1;
+                }
+                bool ok = true;
+                if(m_state == START_LINE){
+                    // 忽略消息前多余的空行(如上一个请求的消息体后面多发的CRLF)
+                    if(line.len > 0){
+                        ok = parseStartLine(data, line);
+                    }
+                }
+                else if(line.len == 0){
+                    ok = headerComplete(data);
+                }
+                else{
+                    ok = parseHeader(data, line);
+                }
+                if(!ok){
+                    return -1;
+                }
+                break;
+            }
+            case BODY:{
+                size_t end = m_body.off + m_contentLength;
+                if(len < end){
+                    return 0;
+                }
+                m_nread = end;
+                m_body.len = m_contentLength;
+                messageComplete(data);
+                return 1;
+            }
+            case CHUNK_SIZE:{
+                HttpRange line;
+                if(!nextLine(data, len, line)){
+                    return len - m_nread > MAX_CHUNK_SIZE_LINE ? (setError(INVALID_CHUNK), -1) : 0;
+                }
+                if(!parseChunkSize(data, line)){
+                    return -1;
+                }
+                break;
+            }
+            case CHUNK_DATA:{
+                size_t n = std::min((uint64_t)(len - m_nread), m_chunkLeft);
+                if(n == 0){
+                    return 0;
+                }
+                // 块数据前移, 紧接在已经拼好的消息体后面
+                size_t dst = m_body.off + m_body.len;
+                if(dst != m_nread){
+                    memmove(data + dst, data + m_nread, n);
+                }
+                m_body.len += n;
+                m_nread += n;
+                m_chunkLeft -= n;
+                if(m_chunkLeft){
+                    return 0;
+                }
+                m_state = CHUNK_DATA_END;
+                break;
+            }
+            case CHUNK_DATA_END:{
+                HttpRange line;
+                if(!nextLine(data, len, line)){
+                    return len - m_nread > 2 ? (setError(INVALID_CHUNK), -1) : 0;
+                }
+                if(line.len){
+                    setError(INVALID_CHUNK);
+                    return -1;
+                }
+                m_state = CHUNK_SIZE;
+                break;
+            }
+            case CHUNK_TRAILER:{
+                // trailer字段不保存
+                HttpRange line;
+                if(!nextLine(data, len, line)){
+                    return len - m_trailerStart > m_headerLimit ? (setError(HEADER_TOO_LARGE), -1) : 0;
+                }
+                if(m_nread - m_trailerStart > m_headerLimit){
+                    setError(HEADER_TOO_LARGE);
+                    return -1;
+                }
+                if(line.len == 0){
+                    messageComplete(data);
+                    return 1;
+                }
+                break;
+            }
+            case BODY_UNTIL_CLOSE:{
+                if(len - m_body.off > m_bodyLimit){
+                    setError(BODY_TOO_LARGE);
+                    return -1;
+                }
+                m_nread = len;
+                m_body.len = len - m_body.off;
+                return 0;
+            }
+            case FINISHED:
+                return 1;
+            case ERROR:
+            default:
+                return -1;
+        }
+    }
+}
+
+int HttpParser::finish(char* data)
+{
+    if(m_state == BODY_UNTIL_CLOSE){
+        messageComplete(data);
+        return 1;
+    }
+    if(m_state == FINISHED){
+        return 1;
+    }
+    if(m_state == ERROR){
+        return -1;
+    }
+    if(m_state == START_LINE && m_nread == m_scan){
+        // 没有收到新消息的内容(最多是几个空行)
+        return 0;
+    }
+    setError(UNEXPECTED_EOF);
+    return -1;
+}
+
+bool HttpParser::parseStartLine(const char* data, const HttpRange& line)
+{
+    const char* begin = data + line.off;
+    const char* end = begin + line.len;
+    const char* sp1 = (const char*)memchr(begin, ' ', line.len);
+    if(!sp1){
+        return setError(INVALID_START_LINE);
+    }
+    const char* sp2 = (const char*)memchr(sp1 + 1, ' ', end - sp1 - 1);
+    if(!sp2){
+        // 响应的原因短语可以省略
+        if(m_isRequest){
+            return setError(INVALID_START_LINE);
+        }
+        sp2 = end;
+    }
+
+    HttpRange a, b, c;
+    a.off = line.off;
+    a.len = sp1 - begin;
+    b.off = sp1 + 1 - data;
+    b.len = sp2 - sp1 - 1;
+    if(sp2 != end){
+        c.off = sp2 + 1 - data;
+        c.len = end - sp2 - 1;
+    }
+    else{
+        c.off = line.off + line.len;
+    }
+    if(a.len == 0 || b.len == 0){
+        return setError(INVALID_START_LINE);
+    }
+    if(!onStartLine(data, a, b, c)){
+        if(m_error == OK){
+            setError(INVALID_START_LINE);
+        }
+        return false;
+    }
+    m_state = HEADER;
+    return true;
+}
+
+bool HttpParser::parseVersion(const char* data, const HttpRange& r)
+{
+    const char* p = data + r.off;
+    if(r.len != 8 || memcmp(p, "HTTP/1.", 7) != 0
+            || p[7] < '0' || p[7] > '9'){
+        return setError(INVALID_VERSION);
+    }
+    m_version = 0x10 | (p[7] - '0');
+    return true;
+}
+
+bool HttpParser::parseHeader(const char* data, const HttpRange& line)
+{
+    const unsigned char* p = (const unsigned char*)data + line.off;
+    // 不支持obs-fold(以空白开头的续行)
+    if(IsOws(*p)){
+        return setError(INVALID_HEADER);
+    }
+
+    HttpField field;
+    field.name.off = line.off;
+    uint32_t i = 0;
+    while(i < line.len && s_token_char[p[i]]){
+        ++i;
+    }
+    // 字段名和冒号之间不能有空白
+    if(i == 0 || i == line.len || p[i] != ':'){
+        return setError(INVALID_HEADER);
+    }
+    field.name.len = i;
+    field.value.off = line.off + i + 1;
+    field.value.len = line.len - i - 1;
+    // 结束位置放在局部变量里, 否则char指针可能指向line, 每次循环都要重新读取line.len
+    uint8_t ctl = 0;
+    const unsigned char* end = p + line.len;
+    for(const unsigned char* v = p + i + 1; v < end; ++v){
+        ctl |= IsCtl(*v);
+    }
+    if(ctl){
+        return setError(INVALID_HEADER);
+    }
+    TrimOws(data, field.value);
+    m_fields.push_back(field);
+
+    StringView name = view(data, field.name);
+    StringView value = view(data, field.value);
+    switch(name.size()){
+        case 10:
+            if(name.equalsIgnoreCase("connection")){
+                ForEachToken(data, field.value, [this](const StringView& token){
+                    if(token.equalsIgnoreCase("close")){
+                        m_connClose = true;
+                    }
+                    else if(token.equalsIgnoreCase("keep-alive")){
+                        m_connKeepAlive = true;
+                    }
+                });
+            }
+            break;
+        case 14:
+            if(name.equalsIgnoreCase("content-length")){
+                if(value.empty() || value.size() > 18){
+                    return setError(INVALID_CONTENT_LENGTH);
+                }
+                uint64_t v = 0;
+                for(size_t j = 0; j < value.size(); ++j){
+                    if(value[j] < '0' || value[j] > '9'){
+                        return setError(INVALID_CONTENT_LENGTH);
+                    }
+                    v = v * 10 + (value[j] - '0');
+                }
+                // 多个Content-Length的值必须一致
+                if(m_hasContentLength && v != m_contentLength){
+                    return setError(INVALID_CONTENT_LENGTH);
+                }
+                m_hasContentLength = true;
+                m_contentLength = v;
+            }
+            break;
+        case 17:
+            if(name.equalsIgnoreCase("transfer-encoding")){
+                // 只看最后一项, 分块必须是最后一个编码
+                StringView last;
+                ForEachToken(data, field.value, [&last](const StringView& token){
+                    last = token;
+                });
+                m_chunked = last.equalsIgnoreCase("chunked");
+                m_unknownEncoding = !m_chunked;
+            }
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+bool HttpParser::headerComplete(const char* data)
+{
+    if(m_version >= 0x11){
+        m_close = m_connClose;
+    }
+    else{
+        m_close = m_connClose || !m_connKeepAlive;
+    }
+    m_body.off = m_nread;
+    m_body.len = 0;
+
+    if(m_unknownEncoding){
+        if(m_isRequest){
+            return setError(INVALID_TRANSFER_ENCODING);
+        }
+        // 响应的消息体直到连接关闭
+        m_contentLength = 0;
+        m_close = true;
+        m_state = m_noBody ? FINISHED : BODY_UNTIL_CLOSE;
+    }
+    else if(m_chunked){
+        // 同时有Content-Length时以分块为准, 这个消息之后关闭连接, 避免请求走私
+        if(m_hasContentLength){
+            m_hasContentLength = false;
+            m_contentLength = 0;
+            m_close = true;
+        }
+        m_state = m_noBody ? FINISHED : CHUNK_SIZE;
+    }
+    else if(m_hasContentLength){
+        if(m_contentLength > m_bodyLimit){
+            return setError(BODY_TOO_LARGE);
+        }
+        m_state = (m_noBody || m_contentLength == 0) ? FINISHED : BODY;
+    }
+    else if(!m_isRequest && !m_noBody){
+        m_close = true;
+        m_state = BODY_UNTIL_CLOSE;
+    }
+    else{
+        m_state = FINISHED;
+    }
+
+    if(!onHeaderComplete(data)){
+        if(m_error == OK){
+            setError(INVALID_HEADER);
+        }
+        return false;
+    }
+    if(m_state == FINISHED){
+        messageComplete(data);
+    }
+    return true;
+}
+
+bool HttpParser::parseChunkSize(const char* data, const HttpRange& line)
+{
+    const char* p = data + line.off;
+    const char* end = p + line.len;
+    uint64_t size = 0;
+    const char* begin = p;
+    while(p < end){
+        char c = *p;
+        int v;
+        if(c >= '0' && c <= '9'){
+            v = c - '0';
+        }
+        else if(c >= 'a' && c <= 'f'){
+            v = c - 'a' + 10;
+        }
+        else if(c >= 'A' && c <= 'F'){
+            v = c - 'A' + 10;
+        }
+        else{
+            break;
+        }
+        if(p - begin >= 15){
+            return setError(INVALID_CHUNK);
+        }
+        size = (size << 4) | v;
+        ++p;
+    }
+    if(p == begin){
+        return setError(INVALID_CHUNK);
+    }
+    // 块扩展忽略
+    while(p < end && IsOws(*p)){
+        ++p;
+    }
+    if(p != end && *p != ';'){
+        return setError(INVALID_CHUNK);
+    }
+
+    if(size == 0){
+        m_trailerStart = m_nread;
+        m_state = CHUNK_TRAILER;
+        return true;
+    }
+    if(m_body.len + size > m_bodyLimit){
+        return setError(BODY_TOO_LARGE);
+    }
+    m_chunkLeft = size;
+    m_state = CHUNK_DATA;
+    return true;
+}
+
+void HttpParser::messageComplete(const char* data)
+{
+    m_state = FINISHED;
+    onMessageComplete(data);
+}
+
+const char* HttpParser::ErrorToString(int error)
+{
+    switch(error){
+#define XX(name) \
+        case name: \
+            return #name;
+        XX(OK);
+        XX(INVALID_START_LINE);
+        XX(INVALID_VERSION);
+        XX(INVALID_METHOD);
+        XX(INVALID_URI);
+        XX(INVALID_HEADER);
+        XX(HEADER_TOO_LARGE);
+        XX(INVALID_CONTENT_LENGTH);
+        XX(INVALID_TRANSFER_ENCODING);
+        XX(INVALID_CHUNK);
+        XX(BODY_TOO_LARGE);
+        XX(UNEXPECTED_EOF);
+#undef XX
+        default:
+            return "UNKNOWN";
+    }
+}
+
+HttpRequestParser::HttpRequestParser()
+    :HttpParser(true, s_http_request_buffer_size, s_http_request_max_body_size)
+    ,m_data(new HttpRequest){
+}
+
+void HttpRequestParser::reset()
+{
+    HttpParser::reset();
+    m_data.reset(new HttpRequest);
+}
+
+uint64_t HttpRequestParser::GetHttpRequestBufferSize()
+{
+    return s_http_request_buffer_size;
+}
+
+uint64_t HttpRequestParser::GetHttpRequestMaxBodySize()
+{
+    return s_http_request_max_body_size;
+}
+
+bool HttpRequestParser::onStartLine(const char* data, const HttpRange& a
+                                    ,const HttpRange& b, const HttpRange& c)
+{
+    HttpMethod method = CharsToHttpMethod(data + a.off, a.len);
+    if(method == HttpMethod::INVALID_METHOD){
+        SYLAR_LOG_DEBUG(g_logger) << "invalid http request method: "
+            << view(data, a);
+        return setError(INVALID_METHOD);
+    }
+    if(!parseVersion(data, c)){
+        return false;
+    }
+    m_data->m_method = method;
+    m_data->m_version = m_version;
+    return parseUri(data, b);
+}
+
+bool HttpRequestParser::parseUri(const char* data, const HttpRange& uri)
+{
+    const char* p = data + uri.off;
+    uint8_t bad = 0;
+    const unsigned char* end = (const unsigned char*)p + uri.len;
+    for(const unsigned char* v = (const unsigned char*)p; v < end; ++v){
+        bad |= (*v <= 0x20) | (*v == 0x7F);
+    }
+    if(bad){
+        return setError(INVALID_URI);
+    }
+    m_data->m_uri = uri;
+
+    uint32_t begin = 0;
+    if(p[0] != '/' && !(uri.len == 1 && p[0] == '*')){
+        if(m_data->m_method == HttpMethod::CONNECT){
+            // authority形式
+            m_data->m_path = uri;
+            return true;
+        }
+        // 绝对形式 scheme://authority/path, 跳过scheme和authority
+        const char* scheme_end = nullptr;
+        for(uint32_t i = 0; i + 2 < uri.len; ++i){
+            if(p[i] == ':' && p[i + 1] == '/' && p[i + 2] == '/'){
+                scheme_end = p + i + 3;
+                break;
+            }
+            if(p[i] == '/' || p[i] == '?' || p[i] == '#'){
+                break;
+            }
+        }
+        if(!scheme_end || scheme_end == p + 3){
+            return setError(INVALID_URI);
+        }
+        begin = scheme_end - p;
+        while(begin < uri.len && p[begin] != '/'
+                && p[begin] != '?' && p[begin] != '#'){
+            ++begin;
+        }
+    }
+
+    uint32_t i = begin;
+    while(i < uri.len && p[i] != '?' && p[i] != '#'){
+        ++i;
+    }
+    m_data->m_path.off = uri.off + begin;
+    m_data->m_path.len = i - begin;
+    if(i < uri.len && p[i] == '?'){
+        uint32_t q = ++i;
+        while(i < uri.len && p[i] != '#'){
+            ++i;
+        }
+        m_data->m_query.off = uri.off + q;
+        m_data->m_query.len = i - q;
+    }
+    if(i < uri.len && p[i] == '#'){
+        ++i;
+        m_data->m_fragment.off = uri.off + i;
+        m_data->m_fragment.len = uri.len - i;
+    }
+    return true;
+}
+
+bool HttpRequestParser::onHeaderComplete(const char* data)
+{
+    m_data->m_base = data;
+    m_data->m_close = m_close;
+    m_data->m_chunked = m_chunked;
+    m_data->m_contentLength = m_contentLength;
+    m_data->m_headers.swap(m_fields);
+    return true;
+}
+
+void HttpRequestParser::onMessageComplete(const char* data)
+{
+    m_data->m_base = data;
+    m_data->m_body = m_body;
+}
+
+HttpResponseParser::HttpResponseParser()
+    :HttpParser(false, s_http_response_buffer_size, s_http_response_max_body_size)
+    ,m_data(new HttpResponse){
+}
+
+void HttpResponseParser::reset()
+{
+    HttpParser::reset();
+    m_data.reset(new HttpResponse);
+}
+
+uint64_t HttpResponseParser::GetHttpResponseBufferSize()
+{
+    return s_http_response_buffer_size;
+}
+
+uint64_t HttpResponseParser::GetHttpResponseMaxBodySize()
+{
+    return s_http_response_max_body_size;
+}
+
+bool HttpResponseParser::onStartLine(const char* data, const HttpRange& a
+                                     ,const HttpRange& b, const HttpRange& c)
+{
+    if(!parseVersion(data, a)){
+        return false;
+    }
+    const char* p = data + b.off;
+    if(b.len != 3 || p[0] < '1' || p[0] > '9'
+            || p[1] < '0' || p[1] > '9' || p[2] < '0' || p[2] > '9'){
+        return setError(INVALID_START_LINE);
+    }
+    uint32_t status = (p[0] - '0') * 100 + (p[1] - '0') * 10 + (p[2] - '0');
+    if(status < 200 || status == 204 || status == 304){
+        m_noBody = true;
+    }
+    m_data->setVersion(m_version);
+    m_data->setStatus((HttpStatus)status);
+    m_data->setReason(view(data, c).toString());
+    return true;
+}
+
+bool HttpResponseParser::onHeaderComplete(const char* data)
+{
+    for(auto& i : m_fields){
+        std::string name = view(data, i.name).toString();
+        std::string value = view(data, i.value).toString();
+        auto it = m_data->getHeaders().find(name);
+        if(it != m_data->getHeaders().end()){
+            // 同名字段按逗号合并
+            value = it->second + ", " + value;
+        }
+        m_data->setHeader(name, value);
+    }
+    m_data->setClose(m_close);
+    return true;
+}
+
+void HttpResponseParser::onMessageComplete(const char* data)
+{
+    m_data->setBody(view(data, m_body).toString());
+}
+
+}
+}
@@ -0,0 +1,193 @@
+#ifndef __SYLAR_HTTP_PARSER_H__
+#define __SYLAR_HTTP_PARSER_H__
+
+#include "http.h"
+
+namespace sylar{
+namespace http{
+
+// HTTP/1.1消息的增量解析器, 请求和响应共用
+// 按行推进的状态机: 起始行 -> 头部 -> 消息体(定长/分块/直到连接关闭) -> 完成
+// 每次execute从上次停下的位置继续, 已经扫描过的字节不会重新扫描
+// 解析过程不拷贝数据: 起始行和头部只记录相对于消息第一个字节的区间,
+// 分块编码的消息体在原缓冲区内就地拼接成连续的一段(覆盖掉块长度行)
+// 调用约定:
+//   data 始终指向当前消息的第一个字节, len 是从data起已经收到的全部字节数(包括之前传入过的)
+//   两次调用之间缓冲区可以搬移或扩容, 但已经传入的内容不能修改
+//   完成后 getParsedSize() 是这个消息占用的字节数, 之后的字节属于下一个消息(pipelining),
+//   reset之后从 data + getParsedSize() 开始解析下一个消息
+class HttpParser{
+public:
+    enum State{
+        START_LINE,
+        HEADER,
+        // Content-Length指定长度的消息体
+        BODY,
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        // 块数据之后的CRLF
+        CHUNK_DATA_END,
+        CHUNK_TRAILER,
+        // 没有长度的响应, 消息体直到连接关闭
+        BODY_UNTIL_CLOSE,
+        FINISHED,
+        ERROR
+    };
+
+    enum Error{
+        OK = 0,
+        INVALID_START_LINE,
+        INVALID_VERSION,
+        INVALID_METHOD,
+        INVALID_URI,
+        INVALID_HEADER,
+        HEADER_TOO_LARGE,
+        INVALID_CONTENT_LENGTH,
+        INVALID_TRANSFER_ENCODING,
+        INVALID_CHUNK,
+        BODY_TOO_LARGE,
+        // 以连接关闭结束之外的消息在完成前连接关闭
+        UNEXPECTED_EOF
+    };
+
+    // header_limit 起始行加头部的最大字节数, body_limit 消息体的最大字节数
+    HttpParser(bool is_request, uint64_t header_limit, uint64_t body_limit);
+    virtual ~HttpParser() {}
+
+    // 返回值: 1 消息完整, 0 需要更多数据, -1 出错
+    int execute(char* data, size_t len);
+    // 连接关闭时调用, 以连接关闭为结束的消息体在此完成, 返回值同execute
+    int finish(char* data);
+    // 准备解析下一个消息
+    virtual void reset();
+
+    State getState() const { return m_state;}
+    bool isFinished() const { return m_state == FINISHED;}
+    bool hasError() const { return m_state == ERROR;}
+    int getError() const { return m_error;}
+    bool isHeaderFinished() const { return m_state > HEADER && m_state != ERROR;}
+    // 当前消息已经解析的字节数
+    size_t getParsedSize() const { return m_nread;}
+
+    uint64_t getContentLength() const { return m_contentLength;}
+    bool isChunked() const { return m_chunked;}
+    bool isClose() const { return m_close;}
+    uint8_t getVersion() const { return m_version;}
+
+    uint64_t getHeaderLimit() const { return m_headerLimit;}
+    void setHeaderLimit(uint64_t v);
+    uint64_t getBodyLimit() const { return m_bodyLimit;}
+    void setBodyLimit(uint64_t v);
+
+    static const char* ErrorToString(int error);
+protected:
+    // 起始行以空格分成的三部分, 第三部分可以包含空格(响应的原因短语), 返回false表示出错(需要设置m_error)
+    virtual bool onStartLine(const char* data, const HttpRange& a
+                             ,const HttpRange& b, const HttpRange& c) = 0;
+    // 头部解析完成, 此时已经确定了消息体的类型
+    virtual bool onHeaderComplete(const char* data) = 0;
+    virtual void onMessageComplete(const char* data) = 0;
+
+    bool setError(int error);
+    // 解析 HTTP/x.y, 只接受1.x
+    bool parseVersion(const char* data, const HttpRange& r);
+    StringView view(const char* data, const HttpRange& r) const {
+        return StringView(data + r.off, r.len);
+    }
+private:
+    // 找到下一行的结尾, 没有完整的一行时返回false, line为不含CRLF的行内容
+    bool nextLine(const char* data, size_t len, HttpRange& line);
+    bool parseStartLine(const char* data, const HttpRange& line);
+    bool parseHeader(const char* data, const HttpRange& line);
+    bool headerComplete(const char* data);
+    bool parseChunkSize(const char* data, const HttpRange& line);
+    void messageComplete(const char* data);
+protected:
+    bool m_isRequest;
+    State m_state;
+    int m_error;
+    uint8_t m_version;
+    bool m_close;
+    bool m_chunked;
+    // 响应状态为1xx/204/304等没有消息体的情况
+    bool m_noBody;
+    uint64_t m_contentLength;
+    std::vector<HttpField> m_fields;
+    // 消息体的区间, 分块编码时是拼接后的结果
+    HttpRange m_body;
+private:
+    uint64_t m_headerLimit;
+    uint64_t m_bodyLimit;
+    // 已经解析的字节数, 下一次从这里继续
+    size_t m_nread;
+    // 已经扫描过但还没有找到行尾的位置
+    size_t m_scan;
+    bool m_hasContentLength;
+    bool m_connClose;
+    bool m_connKeepAlive;
+    // Transfer-Encoding的最后一项不是chunked
+    bool m_unknownEncoding;
+    // 当前块剩余的字节数
+    uint64_t m_chunkLeft;
+    // trailer开始的位置, 用于限制trailer的大小
+    size_t m_trailerStart;
+};
+
+// HTTP请求解析器, 结果的字段指向接收缓冲区
+// 配置项:
+//   http.request.buffer_size    请求行加头部的最大字节数, 超过时出错(HEADER_TOO_LARGE)
+//   http.request.max_body_size  消息体的最大字节数, 超过时出错(BODY_TOO_LARGE)
+class HttpRequestParser : public HttpParser{
+public:
+    typedef std::shared_ptr<HttpRequestParser> ptr;
+
+    HttpRequestParser();
+
+    // 头部完成后可用, 字段指向头部完成(以及消息完成)时execute传入的缓冲区
+    HttpRequest::ptr getData() const { return m_data;}
+    void reset() override;
+
+    static uint64_t GetHttpRequestBufferSize();
+    static uint64_t GetHttpRequestMaxBodySize();
+protected:
+    bool onStartLine(const char* data, const HttpRange& a
+                     ,const HttpRange& b, const HttpRange& c) override;
+    bool onHeaderComplete(const char* data) override;
+    void onMessageComplete(const char* data) override;
+private:
+    bool parseUri(const char* data, const HttpRange& uri);
+private:
+    HttpRequest::ptr m_data;
+};
+
+// HTTP响应解析器, 用于客户端, 完成时把内容拷贝到HttpResponse
+// 配置项:
+//   http.response.buffer_size    状态行加头部的最大字节数
+//   http.response.max_body_size  消息体的最大字节数
+class HttpResponseParser : public HttpParser{
+public:
+    typedef std::shared_ptr<HttpResponseParser> ptr;
+
+    HttpResponseParser();
+
+    // 消息完成后可用
+    HttpResponse::ptr getData() const { return m_data;}
+    void reset() override;
+    // 对HEAD请求的响应没有消息体, 需要在解析前告知
+    void setNoBody(bool v) { m_noBody = v;}
+
+    static uint64_t GetHttpResponseBufferSize();
+    static uint64_t GetHttpResponseMaxBodySize();
+protected:
+    bool onStartLine(const char* data, const HttpRange& a
+                     ,const HttpRange& b, const HttpRange& c) override;
+    bool onHeaderComplete(const char* data) override;
+    void onMessageComplete(const char* data) override;
+private:
+    HttpResponse::ptr m_data;
+};
+
+}
+}
+
+#endif
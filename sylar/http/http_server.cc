@@ -0,0 +1,107 @@
+#include "http_server.h"
+#include "../log.h"
+#include "../util.h"
+#include "../trace.h"
+
+namespace sylar{
+namespace http{
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+static sylar::Logger::ptr g_access = SYLAR_LOG_NAME("access");
+
+HttpServer::HttpServer(bool keepalive
+                       ,sylar::IOManager* worker
+                       ,sylar::IOManager* accept_worker)
+    :TcpServer(worker, accept_worker)
+    ,m_isKeepalive(keepalive){
+    m_dispatch.reset(new ServletDispatch);
+    m_type = "http";
+}
+
+void HttpServer::setName(const std::string& v)
+{
+    TcpServer::setName(v);
+    m_dispatch->setDefault(std::make_shared<NotFoundServlet>(v));
+}
+
+// 请求解析失败时回复的状态码
+// 连接在请求之间正常关闭或空闲超时(仍为OK), 以及请求中途关闭时不回复
+static bool ParseErrorToStatus(int error, HttpStatus& status)
+{
+    switch(error){
+        case HttpParser::OK:
+        case HttpParser::UNEXPECTED_EOF:
+            return false;
+        case HttpParser::HEADER_TOO_LARGE:
+            status = HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE;
+            break;
+        case HttpParser::BODY_TOO_LARGE:
+            status = HttpStatus::PAYLOAD_TOO_LARGE;
+            break;
+        case HttpParser::INVALID_VERSION:
+            status = HttpStatus::HTTP_VERSION_NOT_SUPPORTED;
+            break;
+        case HttpParser::INVALID_TRANSFER_ENCODING:
+            status = HttpStatus::NOT_IMPLEMENTED;
+            break;
+        default:
+            status = HttpStatus::BAD_REQUEST;
+            break;
+    }
+    return true;
+}
+
+void HttpServer::handleClient(Socket::ptr client)
+{
+    SYLAR_LOG_DEBUG(g_logger) << "handleClient " << *client;
+    HttpSession::ptr session(new HttpSession(client));
+    while(true){
+        HttpRequest::ptr req = session->recvRequest();
+        if(!req){
+            HttpStatus status;
+            if(ParseErrorToStatus(session->getError(), status)){
+                HttpResponse::ptr rsp(new HttpResponse(0x11, true));
+                rsp->setStatus(status);
+                rsp->setHeader("Server", getName());
+                session->sendResponse(rsp);
+                SYLAR_LOG_INFO(g_access) << session->getRemoteAddressString()
+                    << " \"-\" " << (uint32_t)status << " 0 0us "
+                    << HttpParser::ErrorToString(session->getError());
+            }
+            break;
+        }
+
+        // 到本次循环结束, 访问日志的 %S 是这个区间
+        SYLAR_TRACE_SCOPE("http.request");
+        uint64_t start = GetMonotonicUS();
+        HttpResponse::ptr rsp(new HttpResponse(req->getVersion()
+                    ,req->isClose() || !m_isKeepalive));
+        rsp->setHeader("Server", getName());
+        {
+            SYLAR_TRACE_SCOPE("http.dispatch");
+            m_dispatch->handle(req, rsp, session);
+        }
+        int rt = 0;
+        {
+            SYLAR_TRACE_SCOPE("http.send");
+            rt = session->sendResponse(rsp);
+        }
+
+        SYLAR_LOG_INFO(g_access) << session->getRemoteAddressString()
+            << " \"" << HttpMethodToString(req->getMethod())
+            << " " << req->getUri()
+            << " HTTP/" << (uint32_t)(req->getVersion() >> 4)
+            << "." << (uint32_t)(req->getVersion() & 0x0F)
+            << "\" " << (uint32_t)rsp->getStatus()
+            << " " << rsp->getBody().size()
+            << " " << (GetMonotonicUS() - start) << "us";
+
+        if(rt < 0 || rsp->isClose()){
+            break;
+        }
+    }
+    session->close();
+}
+
+}
+}
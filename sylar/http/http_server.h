@@ -0,0 +1,39 @@
+#ifndef __SYLAR_HTTP_SERVER_H__
+#define __SYLAR_HTTP_SERVER_H__
+
+#include "../tcp_server.h"
+#include "http_session.h"
+#include "servlet.h"
+
+namespace sylar{
+namespace http{
+
+// HTTP/1.1服务器, 连接上的请求依次解析后交给ServletDispatch处理
+// keepalive为true时处理完一个请求后继续在同一个连接上读下一个(客户端要求关闭的除外),
+// 同一个连接的接收缓冲区、解析器和响应缓冲区在请求之间复用
+// 每个请求完成后向名为"access"的日志器写一条访问日志, 可以通过日志配置单独输出到文件或关闭
+class HttpServer : public TcpServer{
+public:
+    typedef std::shared_ptr<HttpServer> ptr;
+
+    HttpServer(bool keepalive = false
+               ,sylar::IOManager* worker = sylar::IOManager::GetThis()
+               ,sylar::IOManager* accept_worker = sylar::IOManager::GetThis());
+
+    ServletDispatch::ptr getServletDispatch() const { return m_dispatch;}
+    void setServletDispatch(ServletDispatch::ptr v) { m_dispatch = v;}
+
+    bool isKeepalive() const { return m_isKeepalive;}
+
+    virtual void setName(const std::string& v) override;
+protected:
+    virtual void handleClient(Socket::ptr client) override;
+private:
+    bool m_isKeepalive;
+    ServletDispatch::ptr m_dispatch;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,87 @@
+#include "http_session.h"
+#include "../log.h"
+#include <algorithm>
+
+namespace sylar{
+namespace http{
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+HttpSession::HttpSession(Socket::ptr sock)
+    :m_socket(sock)
+    ,m_begin(0)
+    ,m_size(0)
+    ,m_parsed(0)
+    ,m_ba(new ByteArray){
+    Address::ptr addr = sock->getRemoteAddress();
+    if(addr){
+        m_remote = addr->toString();
+    }
+    // 初始大小能放下一个不带消息体的最大请求, 有消息体时按需扩容
+    m_buf.resize(std::max<uint64_t>(HttpRequestParser::GetHttpRequestBufferSize(), 256));
+}
+
+HttpRequest::ptr HttpSession::recvRequest()
+{
+    m_begin += m_parsed;
+    m_parsed = 0;
+    m_parser.reset();
+    while(true){
+        if(m_size > m_begin){
+            int rt = m_parser.execute(&m_buf[m_begin], m_size - m_begin);
+            if(rt == 1){
+                m_parsed = m_parser.getParsedSize();
+                return m_parser.getData();
+            }
+            if(rt < 0){
+                SYLAR_LOG_DEBUG(g_logger) << "http request parse error: "
+                    << HttpParser::ErrorToString(m_parser.getError())
+                    << " client=" << m_remote;
+                return nullptr;
+            }
+        }
+
+        // 需要更多数据: 当前请求移到缓冲区开头, 仍然放不下时扩容
+        // 解析器只记录相对于请求开头的偏移, 搬移后继续解析不受影响
+        if(m_begin > 0){
+            if(m_size > m_begin){
+                memmove(&m_buf[0], &m_buf[m_begin], m_size - m_begin);
+            }
+            m_size -= m_begin;
+            m_begin = 0;
+        }
+        if(m_size == m_buf.size()){
+            m_buf.resize(m_buf.size() * 2);
+        }
+
+        int n = m_socket->recv(&m_buf[m_size], m_buf.size() - m_size);
+        if(n <= 0){
+            m_parser.finish(&m_buf[0]);
+            return nullptr;
+        }
+        m_size += n;
+    }
+}
+
+int HttpSession::sendResponse(HttpResponse::ptr rsp)
+{
+    m_ba->clear();
+    rsp->dump(m_ba);
+    m_ba->setPosition(0);
+    size_t total = m_ba->getReadSize();
+    while(m_ba->getReadSize() > 0){
+        // 对端已经关闭时返回EPIPE, 不产生SIGPIPE
+        if(m_socket->send(m_ba, ~0ull, MSG_NOSIGNAL) <= 0){
+            return -1;
+        }
+    }
+    return total;
+}
+
+void HttpSession::close()
+{
+    m_socket->close();
+}
+
+}
+}
@@ -0,0 +1,49 @@
+#ifndef __SYLAR_HTTP_SESSION_H__
+#define __SYLAR_HTTP_SESSION_H__
+
+#include "http_parser.h"
+#include "../socket.h"
+#include "../bytearray.h"
+
+namespace sylar{
+namespace http{
+
+// 服务端的一个HTTP连接
+// 接收缓冲区和响应用的ByteArray在连接的整个生命周期内复用, 保持连接时后续请求不再分配
+// 一次recv读到的多个请求(pipelining)依次从缓冲区中解析, 不会丢弃多读的数据
+class HttpSession{
+public:
+    typedef std::shared_ptr<HttpSession> ptr;
+
+    HttpSession(Socket::ptr sock);
+
+    // 接收下一个请求, 连接关闭、超时或请求格式错误时返回nullptr
+    // 返回的请求指向内部的接收缓冲区, 下一次调用recvRequest后失效
+    HttpRequest::ptr recvRequest();
+    // 发送完整个响应返回发送的字节数, 出错返回-1
+    int sendResponse(HttpResponse::ptr rsp);
+
+    // recvRequest失败时解析器的错误, 连接关闭或超时为HttpParser::OK
+    int getError() const { return m_parser.getError();}
+    Socket::ptr getSocket() const { return m_socket;}
+    // 对端地址, 创建时取一次, 访问日志每个请求都要用
+    const std::string& getRemoteAddressString() const { return m_remote;}
+    void close();
+private:
+    Socket::ptr m_socket;
+    HttpRequestParser m_parser;
+    std::string m_remote;
+    std::vector<char> m_buf;
+    // 当前请求在缓冲区中的起始位置
+    size_t m_begin;
+    // 缓冲区中有效数据的长度
+    size_t m_size;
+    // 上一个请求占用的字节数, 下一次recvRequest时丢弃
+    size_t m_parsed;
+    ByteArray::ptr m_ba;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,295 @@
+#include "servlet.h"
+#include <string.h>
+
+namespace sylar{
+namespace http{
+
+FunctionServlet::FunctionServlet(callback cb)
+    :Servlet("FunctionServlet")
+    ,m_cb(cb){
+}
+
+int32_t FunctionServlet::handle(sylar::http::HttpRequest::ptr request
+                                ,sylar::http::HttpResponse::ptr response
+                                ,sylar::http::HttpSession::ptr session)
+{
+    return m_cb(request, response, session);
+}
+
+struct RouteTree::Node{
+    ~Node(){
+        for(auto& i : children){
+            delete i;
+        }
+        delete segment;
+    }
+
+    // 边上的字符串
+    std::string prefix;
+    // 每个子节点prefix的第一个字符, 和children一一对应, 子节点之间首字符互不相同
+    std::string indices;
+    std::vector<Node*> children;
+    // 段内'*'之后的部分
+    Node* segment = nullptr;
+    // 以'*'结尾的模式
+    Servlet::ptr tail;
+    // 在这个节点结束的模式
+    Servlet::ptr servlet;
+};
+
+RouteTree::RouteTree()
+    :m_root(new Node){
+}
+
+RouteTree::~RouteTree()
+{
+    delete m_root;
+}
+
+void RouteTree::clear()
+{
+    delete m_root;
+    m_root = new Node;
+}
+
+RouteTree::Node* RouteTree::InsertStatic(Node* node, const char* str, size_t len)
+{
+    while(len > 0){
+        size_t idx = node->indices.find(str[0]);
+        if(idx == std::string::npos){
+            Node* child = new Node;
+            child->prefix.assign(str, len);
+            node->indices.push_back(str[0]);
+            node->children.push_back(child);
+            return child;
+        }
+        Node* child = node->children[idx];
+        size_t max = std::min(len, child->prefix.size());
+        size_t common = 1;
+        while(common < max && child->prefix[common] == str[common]){
+            ++common;
+        }
+        // 只有一部分相同, 把边从分叉处拆成两段
+        if(common < child->prefix.size()){
+            Node* mid = new Node;
+            mid->prefix = child->prefix.substr(0, common);
+            child->prefix.erase(0, common);
+            mid->indices.push_back(child->prefix[0]);
+            mid->children.push_back(child);
+            node->children[idx] = mid;
+            child = mid;
+        }
+        node = child;
+        str += common;
+        len -= common;
+    }
+    return node;
+}
+
+void RouteTree::insert(const std::string& pattern, Servlet::ptr slt)
+{
+    Node* node = m_root;
+    size_t pos = 0;
+    while(true){
+        size_t star = pattern.find('*', pos);
+        if(star == std::string::npos){
+            node = InsertStatic(node, pattern.c_str() + pos, pattern.size() - pos);
+            node->servlet = slt;
+            return;
+        }
+        node = InsertStatic(node, pattern.c_str() + pos, star - pos);
+        // 连续的'*'等同于一个
+        pos = pattern.find_first_not_of('*', star);
+        if(pos == std::string::npos){
+            node->tail = slt;
+            return;
+        }
+        if(!node->segment){
+            node->segment = new Node;
+        }
+        node = node->segment;
+    }
+}
+
+const Servlet::ptr* RouteTree::Match(const Node* node, const char* p, const char* end)
+{
+    // 调用时node的prefix已经匹配
+    if(p == end){
+        if(node->servlet){
+            return &node->servlet;
+        }
+    }
+    else{
+        const char* idx = (const char*)memchr(node->indices.data(), *p, node->indices.size());
+        if(idx){
+            const Node* child = node->children[idx - node->indices.data()];
+            size_t n = child->prefix.size();
+            if((size_t)(end - p) >= n && memcmp(child->prefix.data(), p, n) == 0){
+                const Servlet::ptr* rt = Match(child, p + n, end);
+                if(rt){
+                    return rt;
+                }
+            }
+        }
+        if(node->segment){
+            // 段内'*'先尝试匹配到段尾, 再逐个字符缩短
+            const char* seg_end = (const char*)memchr(p, '/', end - p);
+            if(!seg_end){
+                seg_end = end;
+            }
+            for(const char* q = seg_end; q > p; --q){
+                const Servlet::ptr* rt = Match(node->segment, q, end);
+                if(rt){
+                    return rt;
+                }
+            }
+        }
+    }
+    return node->tail ? &node->tail : nullptr;
+}
+
+Servlet::ptr RouteTree::match(const StringView& path) const
+{
+    const Servlet::ptr* rt = Match(m_root, path.begin(), path.end());
+    return rt ? *rt : nullptr;
+}
+
+size_t StringViewHash::operator()(const StringView& v) const
+{
+    // FNV-1a
+    uint64_t h = 14695981039346656037ULL;
+    for(size_t i = 0; i < v.size(); ++i){
+        h ^= (unsigned char)v[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+ServletDispatch::ServletDispatch()
+    :Servlet("ServletDispatch"){
+    m_default.reset(new NotFoundServlet("sylar/1.0"));
+}
+
+int32_t ServletDispatch::handle(sylar::http::HttpRequest::ptr request
+                                ,sylar::http::HttpResponse::ptr response
+                                ,sylar::http::HttpSession::ptr session)
+{
+    auto slt = getMatchedServlet(request->getPath());
+    if(slt){
+        slt->handle(request, response, session);
+    }
+    return 0;
+}
+
+void ServletDispatch::addServlet(const std::string& uri, Servlet::ptr slt)
+{
+    RWMutexType::WriteLock lock(m_mutex);
+    auto it = m_datas.find(uri);
+    if(it == m_datas.end()){
+        it = m_datas.insert(std::make_pair(uri, slt)).first;
+    }
+    else{
+        it->second = slt;
+    }
+    m_index[StringView(it->first)] = slt;
+}
+
+void ServletDispatch::addServlet(const std::string& uri, FunctionServlet::callback cb)
+{
+    addServlet(uri, std::make_shared<FunctionServlet>(cb));
+}
+
+void ServletDispatch::addGlobServlet(const std::string& uri, Servlet::ptr slt)
+{
+    RWMutexType::WriteLock lock(m_mutex);
+    m_globs[uri] = slt;
+    rebuildTree();
+}
+
+void ServletDispatch::addGlobServlet(const std::string& uri, FunctionServlet::callback cb)
+{
+    addGlobServlet(uri, std::make_shared<FunctionServlet>(cb));
+}
+
+void ServletDispatch::delServlet(const std::string& uri)
+{
+    RWMutexType::WriteLock lock(m_mutex);
+    auto it = m_datas.find(uri);
+    if(it != m_datas.end()){
+        m_index.erase(StringView(it->first));
+        m_datas.erase(it);
+    }
+}
+
+void ServletDispatch::delGlobServlet(const std::string& uri)
+{
+    RWMutexType::WriteLock lock(m_mutex);
+    if(m_globs.erase(uri)){
+        rebuildTree();
+    }
+}
+
+Servlet::ptr ServletDispatch::getDefault() const
+{
+    RWMutexType::ReadLock lock(m_mutex);
+    return m_default;
+}
+
+void ServletDispatch::setDefault(Servlet::ptr v)
+{
+    RWMutexType::WriteLock lock(m_mutex);
+    m_default = v;
+}
+
+void ServletDispatch::rebuildTree()
+{
+    m_tree.clear();
+    for(auto& i : m_globs){
+        m_tree.insert(i.first, i.second);
+    }
+}
+
+Servlet::ptr ServletDispatch::getServlet(const std::string& uri)
+{
+    RWMutexType::ReadLock lock(m_mutex);
+    auto it = m_datas.find(uri);
+    return it == m_datas.end() ? nullptr : it->second;
+}
+
+Servlet::ptr ServletDispatch::getGlobServlet(const std::string& uri)
+{
+    RWMutexType::ReadLock lock(m_mutex);
+    auto it = m_globs.find(uri);
+    return it == m_globs.end() ? nullptr : it->second;
+}
+
+Servlet::ptr ServletDispatch::getMatchedServlet(const StringView& path)
+{
+    RWMutexType::ReadLock lock(m_mutex);
+    auto it = m_index.find(path);
+    if(it != m_index.end()){
+        return it->second;
+    }
+    Servlet::ptr slt = m_tree.match(path);
+    return slt ? slt : m_default;
+}
+
+NotFoundServlet::NotFoundServlet(const std::string& name)
+    :Servlet("NotFoundServlet"){
+    m_content = "<html><head><title>404 Not Found"
+        "</title></head><body><center><h1>404 Not Found</h1></center>"
+        "<hr><center>" + name + "</center></body></html>";
+}
+
+int32_t NotFoundServlet::handle(sylar::http::HttpRequest::ptr request
+                                ,sylar::http::HttpResponse::ptr response
+                                ,sylar::http::HttpSession::ptr session)
+{
+    response->setStatus(sylar::http::HttpStatus::NOT_FOUND);
+    response->setHeader("Content-Type", "text/html");
+    response->setBody(m_content);
+    return 0;
+}
+
+}
+}
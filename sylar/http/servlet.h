@@ -0,0 +1,138 @@
+#ifndef __SYLAR_HTTP_SERVLET_H__
+#define __SYLAR_HTTP_SERVLET_H__
+
+#include <memory>
+#include <functional>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include "http.h"
+#include "http_session.h"
+#include "../mutex.h"
+#include "../noncopyable.h"
+
+namespace sylar{
+namespace http{
+
+class Servlet{
+public:
+    typedef std::shared_ptr<Servlet> ptr;
+
+    Servlet(const std::string& name)
+        :m_name(name){
+    }
+    virtual ~Servlet() {}
+
+    virtual int32_t handle(sylar::http::HttpRequest::ptr request
+                           ,sylar::http::HttpResponse::ptr response
+                           ,sylar::http::HttpSession::ptr session) = 0;
+
+    const std::string& getName() const { return m_name;}
+protected:
+    std::string m_name;
+};
+
+class FunctionServlet : public Servlet{
+public:
+    typedef std::shared_ptr<FunctionServlet> ptr;
+    typedef std::function<int32_t (sylar::http::HttpRequest::ptr request
+                                   ,sylar::http::HttpResponse::ptr response
+                                   ,sylar::http::HttpSession::ptr session)> callback;
+
+    FunctionServlet(callback cb);
+    int32_t handle(sylar::http::HttpRequest::ptr request
+                   ,sylar::http::HttpResponse::ptr response
+                   ,sylar::http::HttpSession::ptr session) override;
+private:
+    callback m_cb;
+};
+
+// 通配路由的基数树, 公共前缀合并成一条边, 匹配时沿着路径逐段比较, 不用正则也不逐条尝试
+// 模式中的 '*':
+//   在结尾时匹配剩余的任意字符(包括'/'), 如 /static/* 匹配 /static/ 下的所有路径
+//   在其它位置时匹配同一段内的一个或多个字符(不包括'/'), 如 /user/*/info、/img/*.png
+// 同一位置有多种可能时, 优先级为 普通字符 > 段内'*' > 结尾'*', 不匹配时回溯尝试下一种
+class RouteTree : Noncopyable{
+public:
+    RouteTree();
+    ~RouteTree();
+
+    // 同一个模式重复插入时替换
+    void insert(const std::string& pattern, Servlet::ptr slt);
+    // 没有匹配返回nullptr
+    Servlet::ptr match(const StringView& path) const;
+    void clear();
+private:
+    struct Node;
+    static Node* InsertStatic(Node* node, const char* str, size_t len);
+    static const Servlet::ptr* Match(const Node* node, const char* p, const char* end);
+private:
+    Node* m_root;
+};
+
+struct StringViewHash{
+    size_t operator()(const StringView& v) const;
+};
+
+// 按请求路径分派到servlet
+// 精确路由放在哈希表中, 通配路由增删时重新编译成RouteTree, 处理请求时只做一次哈希查找和一次树上匹配
+// 优先级: 精确路由 > 通配路由 > 默认servlet(404)
+class ServletDispatch : public Servlet{
+public:
+    typedef std::shared_ptr<ServletDispatch> ptr;
+    typedef RWMutex RWMutexType;
+
+    ServletDispatch();
+    int32_t handle(sylar::http::HttpRequest::ptr request
+                   ,sylar::http::HttpResponse::ptr response
+                   ,sylar::http::HttpSession::ptr session) override;
+
+    void addServlet(const std::string& uri, Servlet::ptr slt);
+    void addServlet(const std::string& uri, FunctionServlet::callback cb);
+    void addGlobServlet(const std::string& uri, Servlet::ptr slt);
+    void addGlobServlet(const std::string& uri, FunctionServlet::callback cb);
+
+    void delServlet(const std::string& uri);
+    void delGlobServlet(const std::string& uri);
+
+    Servlet::ptr getDefault() const;
+    void setDefault(Servlet::ptr v);
+
+    Servlet::ptr getServlet(const std::string& uri);
+    Servlet::ptr getGlobServlet(const std::string& uri);
+
+    // 按优先级查找处理路径的servlet, 没有时返回默认servlet
+    Servlet::ptr getMatchedServlet(const StringView& path);
+private:
+    // 由m_globs重新生成m_tree, 调用方持有写锁
+    void rebuildTree();
+private:
+    mutable RWMutexType m_mutex;
+    // uri -> servlet, 持有键的内存
+    std::map<std::string, Servlet::ptr> m_datas;
+    // 精确路由的哈希索引, 键指向m_datas中的字符串, 查找时不需要构造std::string
+    std::unordered_map<StringView, Servlet::ptr, StringViewHash> m_index;
+    // 通配模式 -> servlet
+    std::map<std::string, Servlet::ptr> m_globs;
+    RouteTree m_tree;
+    // 默认servlet, 所有路由都没匹配到时使用
+    Servlet::ptr m_default;
+};
+
+class NotFoundServlet : public Servlet{
+public:
+    typedef std::shared_ptr<NotFoundServlet> ptr;
+
+    NotFoundServlet(const std::string& name);
+    int32_t handle(sylar::http::HttpRequest::ptr request
+                   ,sylar::http::HttpResponse::ptr response
+                   ,sylar::http::HttpSession::ptr session) override;
+private:
+    std::string m_content;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,449 @@
+#include "iomanager.h"
+#include "macro.h"
+#include "log.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+
+namespace sylar{
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+IOManager::FdContext::EventContext& IOManager::FdContext::getContext(IOManager::Event event)
+{
+    switch(event){
+        case IOManager::READ:
+            return read;
+        case IOManager::WRITE:
+            return write;
+        default:
+            SYLAR_ASSERT2(false, "getContext");
+    }
+    throw std::invalid_argument("getContext invalid event");
+}
+
+void IOManager::FdContext::resetContext(EventContext& ctx)
+{
+    ctx.scheduler = nullptr;
+    ctx.fiber.reset();
+    ctx.cb = nullptr;
+}
+
+void IOManager::FdContext::triggerEvent(IOManager::Event event)
+{
+    SYLAR_ASSERT(events & event);
+    events = (Event)(events & ~event);
+    EventContext& ctx = getContext(event);
+    if(ctx.cb){
+        ctx.scheduler->schedule(&ctx.cb);
+    }
+    else{
+        ctx.scheduler->schedule(&ctx.fiber);
+    }
+    ctx.scheduler = nullptr;
+}
+
+IOManager::IOManager(size_t threads, bool use_caller, const std::string& name)
+    :Scheduler(threads, use_caller, name){
+    m_epfd = epoll_create1(EPOLL_CLOEXEC);
+    SYLAR_ASSERT(m_epfd > 0);
+
+    // 工作线程的epoll中, tickle事件的data.fd是自己的eventfd, 否则是共享的m_epfd
+    for(size_t i = 0; i < getWorkerCount(); ++i){
+        Waiter* waiter = new Waiter;
+        waiter->epfd = epoll_create1(EPOLL_CLOEXEC);
+        SYLAR_ASSERT(waiter->epfd > 0);
+        waiter->tickleFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        SYLAR_ASSERT(waiter->tickleFd > 0);
+
+        epoll_event event;
+        memset(&event, 0, sizeof(epoll_event));
+        event.events = EPOLLIN | EPOLLET;
+        event.data.fd = waiter->tickleFd;
+        int rt = epoll_ctl(waiter->epfd, EPOLL_CTL_ADD, waiter->tickleFd, &event);
+        SYLAR_ASSERT(!rt);
+
+        // 水平触发, 没取完的事件让下一个进入等待的线程继续取
+        event.events = EPOLLIN;
+        event.data.fd = m_epfd;
+        rt = epoll_ctl(waiter->epfd, EPOLL_CTL_ADD, m_epfd, &event);
+        SYLAR_ASSERT(!rt);
+        m_waiters.push_back(waiter);
+    }
+
+    contextResize(32);
+
+    start();
+}
+
+IOManager::~IOManager()
+{
+    stop();
+    for(auto i : m_waiters){
+        close(i->epfd);
+        close(i->tickleFd);
+        delete i;
+    }
+    close(m_epfd);
+
+    for(size_t i = 0; i < m_fdContexts.size(); ++i){
+        if(m_fdContexts[i]){
+            delete m_fdContexts[i];
+        }
+    }
+}
+
+void IOManager::contextResize(size_t size)
+{
+    m_fdContexts.resize(size);
+
+    for(size_t i = 0; i < m_fdContexts.size(); ++i){
+        if(!m_fdContexts[i]){
+            m_fdContexts[i] = new FdContext;
+            m_fdContexts[i]->fd = i;
+        }
+    }
+}
+
+int IOManager::addEvent(int fd, Event event, std::function<void()> cb)
+{
+    FdContext* fd_ctx = nullptr;
+    RWMutexType::ReadLock lock(m_mutex);
+    if((int)m_fdContexts.size() > fd){
+        fd_ctx = m_fdContexts[fd];
+        lock.unlock();
+    }
+    else{
+        lock.unlock();
+        RWMutexType::WriteLock lock2(m_mutex);
+        if((int)m_fdContexts.size() <= fd){
+            contextResize(fd * 1.5);
+        }
+        fd_ctx = m_fdContexts[fd];
+    }
+
+    FdContext::MutexType::Lock lock2(fd_ctx->mutex);
+    if(SYLAR_UNLIKELY(fd_ctx->events & event)){
+        SYLAR_LOG_ERROR(g_logger) << "addEvent assert fd=" << fd
+            << " event=" << event
+            << " fd_ctx.event=" << fd_ctx->events;
+        SYLAR_ASSERT(!(fd_ctx->events & event));
+    }
+
+    int op = fd_ctx->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    epoll_event epevent;
+    epevent.events = EPOLLET | fd_ctx->events | event;
+    epevent.data.ptr = fd_ctx;
+
+    int rt = epoll_ctl(m_epfd, op, fd, &epevent);
+    if(rt){
+        SYLAR_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", "
+            << op << ", " << fd << ", " << epevent.events << "):"
+            << rt << " (" << errno << ") (" << strerror(errno) << ")";
+        return -1;
+    }
+
+    ++m_pendingEventCount;
+    fd_ctx->events = (Event)(fd_ctx->events | event);
+    FdContext::EventContext& event_ctx = fd_ctx->getContext(event);
+    SYLAR_ASSERT(!event_ctx.scheduler
+                && !event_ctx.fiber
+                && !event_ctx.cb);
+
+    // 在调度器之外注册的事件由本IOManager调度
+    event_ctx.scheduler = Scheduler::GetThis();
+    if(!event_ctx.scheduler){
+        event_ctx.scheduler = this;
+    }
+    if(cb){
+        event_ctx.cb.swap(cb);
+    }
+    else{
+        event_ctx.fiber = Fiber::GetThis();
+        SYLAR_ASSERT2(event_ctx.fiber->getState() == Fiber::EXEC
+                      ,"state=" << event_ctx.fiber->getState());
+    }
+    return 0;
+}
+
+bool IOManager::delEvent(int fd, Event event)
+{
+    RWMutexType::ReadLock lock(m_mutex);
+    if((int)m_fdContexts.size() <= fd){
+        return false;
+    }
+    FdContext* fd_ctx = m_fdContexts[fd];
+    lock.unlock();
+
+    FdContext::MutexType::Lock lock2(fd_ctx->mutex);
+    if(SYLAR_UNLIKELY(!(fd_ctx->events & event))){
+        return false;
+    }
+
+    Event new_events = (Event)(fd_ctx->events & ~event);
+    int op = new_events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+    epoll_event epevent;
+    epevent.events = EPOLLET | new_events;
+    epevent.data.ptr = fd_ctx;
+
+    int rt = epoll_ctl(m_epfd, op, fd, &epevent);
+    if(rt){
+        SYLAR_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", "
+            << op << ", " << fd << ", " << epevent.events << "):"
+            << rt << " (" << errno << ") (" << strerror(errno) << ")";
+        return false;
+    }
+
+    --m_pendingEventCount;
+    fd_ctx->events = new_events;
+    FdContext::EventContext& event_ctx = fd_ctx->getContext(event);
+    fd_ctx->resetContext(event_ctx);
+    return true;
+}
+
+bool IOManager::cancelEvent(int fd, Event event)
+{
+    RWMutexType::ReadLock lock(m_mutex);
+    if((int)m_fdContexts.size() <= fd){
+        return false;
+    }
+    FdContext* fd_ctx = m_fdContexts[fd];
+    lock.unlock();
+
+    FdContext::MutexType::Lock lock2(fd_ctx->mutex);
+    if(SYLAR_UNLIKELY(!(fd_ctx->events & event))){
+        return false;
+    }
+
+    Event new_events = (Event)(fd_ctx->events & ~event);
+    int op = new_events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+    epoll_event epevent;
+    epevent.events = EPOLLET | new_events;
+    epevent.data.ptr = fd_ctx;
+
+    int rt = epoll_ctl(m_epfd, op, fd, &epevent);
+    if(rt){
+        SYLAR_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", "
+            << op << ", " << fd << ", " << epevent.events << "):"
+            << rt << " (" << errno << ") (" << strerror(errno) << ")";
+        return false;
+    }
+
+    fd_ctx->triggerEvent(event);
+    --m_pendingEventCount;
+    return true;
+}
+
+bool IOManager::cancelAll(int fd)
+{
+    RWMutexType::ReadLock lock(m_mutex);
+    if((int)m_fdContexts.size() <= fd){
+        return false;
+    }
+    FdContext* fd_ctx = m_fdContexts[fd];
+    lock.unlock();
+
+    FdContext::MutexType::Lock lock2(fd_ctx->mutex);
+    if(!fd_ctx->events){
+        return false;
+    }
+
+    int op = EPOLL_CTL_DEL;
+    epoll_event epevent;
+    epevent.events = 0;
+    epevent.data.ptr = fd_ctx;
+
+    int rt = epoll_ctl(m_epfd, op, fd, &epevent);
+    if(rt){
+        SYLAR_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", "
+            << op << ", " << fd << ", " << epevent.events << "):"
+            << rt << " (" << errno << ") (" << strerror(errno) << ")";
+        return false;
+    }
+
+    if(fd_ctx->events & READ){
+        fd_ctx->triggerEvent(READ);
+        --m_pendingEventCount;
+    }
+    if(fd_ctx->events & WRITE){
+        fd_ctx->triggerEvent(WRITE);
+        --m_pendingEventCount;
+    }
+
+    SYLAR_ASSERT(fd_ctx->events == 0);
+    return true;
+}
+
+IOManager* IOManager::GetThis()
+{
+    return dynamic_cast<IOManager*>(Scheduler::GetThis());
+}
+
+bool IOManager::tickle(Waiter* waiter)
+{
+    bool expect = true;
+    if(!waiter->waiting.compare_exchange_strong(expect, false)){
+        return false;
+    }
+    uint64_t one = 1;
+    int rt = write(waiter->tickleFd, &one, sizeof(one));
+    SYLAR_ASSERT(rt == sizeof(one));
+    return true;
+}
+
+void IOManager::tickle()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(!hasIdleThreads()){
+        return;
+    }
+    size_t n = m_waiters.size();
+    int cur = getWorkerIndex();
+    size_t start = cur == -1 ? 0 : cur + 1;
+    for(size_t i = 0; i < n; ++i){
+        if(tickle(m_waiters[(start + i) % n])){
+            return;
+        }
+    }
+}
+
+void IOManager::tickleWorker(size_t idx)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    tickle(m_waiters[idx]);
+}
+
+bool IOManager::stopping()
+{
+    return !hasTimer()
+        && m_pendingEventCount == 0
+        && Scheduler::stopping();
+}
+
+bool IOManager::stopping(uint64_t& timeout)
+{
+    timeout = getNextTimer();
+    return timeout == ~0ull
+        && m_pendingEventCount == 0
+        && Scheduler::stopping();
+}
+
+void IOManager::onTimerInsertedAtFront()
+{
+    tickle();
+}
+
+void IOManager::idle()
+{
+    const uint64_t MAX_EVNETS = 256;
+    epoll_event* events = new epoll_event[MAX_EVNETS]();
+    std::shared_ptr<epoll_event> shared_events(events, [](epoll_event* ptr){
+        delete[] ptr;
+    });
+
+    int idx = getWorkerIndex();
+    SYLAR_ASSERT(idx >= 0);
+    Waiter* waiter = m_waiters[idx];
+    while(true){
+        // 先声明要等待再检查任务和停止条件, 和投递方的"先入队再检查等待者"配对, 不会丢失唤醒
+        waiter->waiting.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t next_timeout = 0;
+        if(stopping(next_timeout)){
+            waiter->waiting.store(false);
+            SYLAR_LOG_INFO(g_logger) << "name=" << getName()
+                                     << " idle stopping exit";
+            break;
+        }
+
+        // 只看本线程能执行的任务, 指定给其它线程的任务由目标线程自己被唤醒后执行
+        static const uint64_t MAX_TIMEOUT = 3000;
+        int timeout = 0;
+        if(!hasWorkerTask(idx)){
+            timeout = (int)std::min(next_timeout, MAX_TIMEOUT);
+        }
+        epoll_event wakes[2];
+        int rt = 0;
+        do{
+            rt = epoll_wait(waiter->epfd, wakes, 2, timeout);
+        }while(rt < 0 && errno == EINTR);
+        waiter->waiting.store(false);
+
+        bool has_events = false;
+        for(int i = 0; i < rt; ++i){
+            if(wakes[i].data.fd == waiter->tickleFd){
+                uint64_t dummy;
+                while(read(waiter->tickleFd, &dummy, sizeof(dummy)) > 0);
+            }
+            else{
+                has_events = true;
+            }
+        }
+
+        rt = 0;
+        if(has_events){
+            // 其它线程可能已经取走, 不阻塞
+            rt = epoll_wait(m_epfd, events, MAX_EVNETS, 0);
+        }
+        for(int i = 0; i < rt; ++i){
+            epoll_event& event = events[i];
+            FdContext* fd_ctx = (FdContext*)event.data.ptr;
+            FdContext::MutexType::Lock lock(fd_ctx->mutex);
+            // 出错或对端关闭时唤醒所有等待者, 由它们的读写调用拿到具体错误
+            if(event.events & (EPOLLERR | EPOLLHUP)){
+                event.events |= (EPOLLIN | EPOLLOUT) & fd_ctx->events;
+            }
+            int real_events = NONE;
+            if(event.events & EPOLLIN){
+                real_events |= READ;
+            }
+            if(event.events & EPOLLOUT){
+                real_events |= WRITE;
+            }
+
+            if((fd_ctx->events & real_events) == NONE){
+                continue;
+            }
+
+            int left_events = (fd_ctx->events & ~real_events);
+            int op = left_events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+            event.events = EPOLLET | left_events;
+
+            int rt2 = epoll_ctl(m_epfd, op, fd_ctx->fd, &event);
+            if(rt2){
+                SYLAR_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", "
+                    << op << ", " << fd_ctx->fd << ", " << event.events << "):"
+                    << rt2 << " (" << errno << ") (" << strerror(errno) << ")";
+                continue;
+            }
+
+            if(real_events & READ){
+                fd_ctx->triggerEvent(READ);
+                --m_pendingEventCount;
+            }
+            if(real_events & WRITE){
+                fd_ctx->triggerEvent(WRITE);
+                --m_pendingEventCount;
+            }
+        }
+
+        std::vector<std::function<void()> > cbs;
+        listExpiredCb(cbs);
+        if(!cbs.empty()){
+            schedule(cbs.begin(), cbs.end());
+            cbs.clear();
+        }
+
+        Fiber::ptr cur = Fiber::GetThis();
+        auto raw_ptr = cur.get();
+        cur.reset();
+
+        raw_ptr->swapOut();
+    }
+}
+
+}
@@ -0,0 +1,98 @@
+#ifndef __SYLAR_IOMANAGER_H__
+#define __SYLAR_IOMANAGER_H__
+
+#include "scheduler.h"
+#include "timer.h"
+
+namespace sylar{
+
+// 基于epoll的IO协程调度器
+// 协程在fd上注册读/写事件后挂起, 事件就绪时由空闲线程重新调度, 一个线程可以服务大量连接
+// fd上下文按fd下标存放在连续数组中, epoll_event直接携带上下文指针, 事件分发不需要查表
+// 同时是定时器管理器, epoll_wait的超时取下一个定时器的到期时间
+// 每个工作线程阻塞在自己的epoll上, 其中只有自己的eventfd和共享的fd事件epoll,
+// 唤醒只写目标线程的eventfd; 共享epoll上有事件时所有阻塞的线程都会醒来, 由先取到事件的处理
+class IOManager : public Scheduler, public TimerManager{
+public:
+    typedef std::shared_ptr<IOManager> ptr;
+    typedef RWMutex RWMutexType;
+
+    enum Event{
+        NONE    = 0x0,
+        READ    = 0x1,  // EPOLLIN
+        WRITE   = 0x4   // EPOLLOUT
+    };
+private:
+    struct FdContext{
+        typedef Mutex MutexType;
+        // 事件触发时要调度的协程或回调
+        struct EventContext{
+            Scheduler* scheduler = nullptr;
+            Fiber::ptr fiber;
+            std::function<void()> cb;
+        };
+
+        EventContext& getContext(Event event);
+        void resetContext(EventContext& ctx);
+        // 触发事件并从已注册事件中移除
+        void triggerEvent(Event event);
+
+        EventContext read;
+        EventContext write;
+        int fd = 0;
+        Event events = NONE;    // 已注册的事件
+        MutexType mutex;
+    };
+public:
+    IOManager(size_t threads = 1, bool use_caller = true, const std::string& name = "");
+    ~IOManager();
+
+    // 注册事件(边缘触发), cb为空时事件触发后恢复当前协程, 成功返回0, 失败返回-1
+    int addEvent(int fd, Event event, std::function<void()> cb = nullptr);
+    // 删除事件, 不触发
+    bool delEvent(int fd, Event event);
+    // 取消事件, 如果事件已注册则立即触发一次
+    bool cancelEvent(int fd, Event event);
+    // 取消fd上的所有事件
+    bool cancelAll(int fd);
+
+    static IOManager* GetThis();
+protected:
+    // 唤醒一个阻塞在epoll_wait上的工作线程
+    void tickle() override;
+    // 只唤醒指定的工作线程
+    void tickleWorker(size_t idx) override;
+    bool stopping() override;
+    void idle() override;
+    void onTimerInsertedAtFront() override;
+
+    // 同时给出到下一个定时器的毫秒数
+    bool stopping(uint64_t& timeout);
+
+    void contextResize(size_t size);
+private:
+    // 工作线程自己的等待点
+    struct Waiter{
+        // 只包含tickleFd和共享的m_epfd
+        int epfd = -1;
+        // eventfd, 写入时唤醒这个线程
+        int tickleFd = -1;
+        // 正在(或即将)阻塞在epoll_wait上, 唤醒方把它置为false后写tickleFd
+        std::atomic<bool> waiting {false};
+    };
+
+    // 唤醒等待中的线程, 成功返回true
+    bool tickle(Waiter* waiter);
+private:
+    // fd事件
+    int m_epfd = 0;
+    std::vector<Waiter*> m_waiters;
+
+    std::atomic<size_t> m_pendingEventCount {0};
+    RWMutexType m_mutex;
+    std::vector<FdContext*> m_fdContexts;
+};
+
+}
+
+#endif
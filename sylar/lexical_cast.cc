@@ -0,0 +1,334 @@
+#include "lexical_cast.h"
+#include <locale.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+namespace sylar{
+
+static std::string BuildMessage(const std::string& msg, const std::string& input, size_t pos){
+    std::string rt = msg + " at position " + UInt64ToString(pos) + " in '" + input + "'";
+    return rt;
+}
+
+LexicalCastError::LexicalCastError(const std::string& msg, const std::string& input, size_t pos)
+    :std::invalid_argument(BuildMessage(msg, input, pos))
+    ,m_pos(pos){
+}
+
+namespace {
+
+void Fail(const char* msg, const char* str, size_t len, size_t pos){
+    throw LexicalCastError(msg, std::string(str, len), pos);
+}
+
+// strtod_l 使用固定的C locale, 不受进程 setlocale 影响
+locale_t GetCLocale(){
+    static locale_t s_locale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+    return s_locale;
+}
+
+bool EqualsNoCase(const char* str, size_t len, const char* lit){
+    size_t n = strlen(lit);
+    if(n != len){
+        return false;
+    }
+    for(size_t i = 0; i < n; ++i){
+        char c = str[i];
+        if(c >= 'A' && c <= 'Z'){
+            c += 'a' - 'A';
+        }
+        if(c != lit[i]){
+            return false;
+        }
+    }
+    return true;
+}
+
+// 检查浮点写法 [+-]digits[.digits][(e|E)[+-]digits], 非法时pos为出错位置
+bool ScanFloat(const char* str, size_t len, size_t& pos){
+    size_t i = 0;
+    if(i < len && (str[i] == '+' || str[i] == '-')){
+        ++i;
+    }
+    size_t digits = 0;
+    while(i < len && str[i] >= '0' && str[i] <= '9'){
+        ++i;
+        ++digits;
+    }
+    if(i < len && str[i] == '.'){
+        ++i;
+        while(i < len && str[i] >= '0' && str[i] <= '9'){
+            ++i;
+            ++digits;
+        }
+    }
+    if(digits == 0){
+        pos = i;
+        return false;
+    }
+    if(i < len && (str[i] == 'e' || str[i] == 'E')){
+        ++i;
+        if(i < len && (str[i] == '+' || str[i] == '-')){
+            ++i;
+        }
+        size_t exp_digits = 0;
+        while(i < len && str[i] >= '0' && str[i] <= '9'){
+            ++i;
+            ++exp_digits;
+        }
+        if(exp_digits == 0){
+            pos = i;
+            return false;
+        }
+    }
+    pos = i;
+    return i == len;
+}
+
+// YAML的 .inf -.inf .nan, 命中返回true
+bool ParseSpecial(const char* str, size_t len, double& v){
+    size_t i = 0;
+    bool neg = false;
+    if(len > 0 && (str[0] == '+' || str[0] == '-')){
+        neg = str[0] == '-';
+        ++i;
+    }
+    if(EqualsNoCase(str + i, len - i, ".inf")){
+        v = neg ? -HUGE_VAL : HUGE_VAL;
+        return true;
+    }
+    if(i == 0 && EqualsNoCase(str, len, ".nan")){
+        v = NAN;
+        return true;
+    }
+    return false;
+}
+
+template<class T, class F>
+T ParseFloating(const char* str, size_t len, F func){
+    if(len == 0){
+        Fail("empty value", str, len, 0);
+    }
+    double special = 0;
+    if(ParseSpecial(str, len, special)){
+        return (T)special;
+    }
+    size_t pos = 0;
+    if(!ScanFloat(str, len, pos)){
+        Fail("invalid character", str, len, pos);
+    }
+    // strtod需要'\0'结尾, 短输入拷贝到栈上
+    char buf[128];
+    std::string tmp;
+    const char* p = buf;
+    if(len < sizeof(buf)){
+        memcpy(buf, str, len);
+        buf[len] = '\0';
+    }
+    else{
+        tmp.assign(str, len);
+        p = tmp.c_str();
+    }
+    errno = 0;
+    T v = func(p, nullptr, GetCLocale());
+    if(errno == ERANGE && isinf(v)){
+        Fail("out of range", str, len, 0);
+    }
+    return v;
+}
+
+// 解析无符号部分, 遇到 . e E 时设置is_float交由浮点解析
+uint64_t ParseMagnitude(const char* str, size_t len, size_t i, uint64_t limit, bool& is_float){
+    is_float = false;
+    if(i == len){
+        Fail("missing digits", str, len, i);
+    }
+    int base = 10;
+    if(str[i] == '0' && i + 1 < len){
+        char c = str[i + 1];
+        if(c == 'x' || c == 'X'){
+            base = 16;
+        }
+        else if(c == 'o' || c == 'O'){
+            base = 8;
+        }
+        else if(c == 'b' || c == 'B'){
+            base = 2;
+        }
+        if(base != 10){
+            i += 2;
+            if(i == len){
+                Fail("missing digits", str, len, i);
+            }
+        }
+    }
+
+    uint64_t v = 0;
+    for(; i < len; ++i){
+        char c = str[i];
+        int d = 0;
+        if(c >= '0' && c <= '9'){
+            d = c - '0';
+        }
+        else if(base == 16 && c >= 'a' && c <= 'f'){
+            d = c - 'a' + 10;
+        }
+        else if(base == 16 && c >= 'A' && c <= 'F'){
+            d = c - 'A' + 10;
+        }
+        else if(base == 10 && (c == '.' || c == 'e' || c == 'E')){
+            is_float = true;
+            return 0;
+        }
+        else{
+            Fail("invalid character", str, len, i);
+        }
+        if(d >= base){
+            Fail("invalid digit", str, len, i);
+        }
+        if(v > (limit - d) / base){
+            Fail("out of range", str, len, i);
+        }
+        v = v * base + d;
+    }
+    return v;
+}
+
+// 输出能精确解析回原值的文本
+template<class T>
+size_t FormatShortest(T v, char* buf, size_t size, int min_precision, int max_precision,
+        T (*parse)(const char*, size_t)){
+    if(isnan(v)){
+        return snprintf(buf, size, ".nan");
+    }
+    if(isinf(v)){
+        return snprintf(buf, size, v > 0 ? ".inf" : "-.inf");
+    }
+    // 配置中的值大多是短小数, 先用低精度尝试; 不能还原时直接使用最大精度, 最多格式化两次
+    int precision[2] = {min_precision, max_precision};
+    int n = 0;
+    for(int i = 0; i < 2; ++i){
+        n = snprintf(buf, size, "%.*g", precision[i], (double)v);
+        // printf 的小数点受 LC_NUMERIC 影响, 统一为 '.'
+        char* comma = strchr(buf, ',');
+        if(comma){
+            *comma = '.';
+        }
+        if(i == 1 || parse(buf, n) == v){
+            break;
+        }
+    }
+    return n;
+}
+
+}
+
+int64_t ParseInt64(const char* str, size_t len, int64_t min, int64_t max){
+    if(len == 0){
+        Fail("empty value", str, len, 0);
+    }
+    bool neg = str[0] == '-';
+    size_t i = (str[0] == '-' || str[0] == '+') ? 1 : 0;
+    uint64_t limit = neg ? (uint64_t)(-(min + 1)) + 1 : (uint64_t)max;
+    bool is_float = false;
+    uint64_t v = ParseMagnitude(str, len, i, limit, is_float);
+    if(is_float){
+        double d = ParseDouble(str, len);
+        if(d != floor(d)){
+            Fail("not an integer", str, len, 0);
+        }
+        if(d < (double)min || d > (double)max || d >= 9223372036854775808.0){
+            Fail("out of range", str, len, 0);
+        }
+        return (int64_t)d;
+    }
+    return neg ? (int64_t)(0 - v) : (int64_t)v;
+}
+
+uint64_t ParseUInt64(const char* str, size_t len, uint64_t max){
+    if(len == 0){
+        Fail("empty value", str, len, 0);
+    }
+    if(str[0] == '-'){
+        Fail("negative value", str, len, 0);
+    }
+    size_t i = str[0] == '+' ? 1 : 0;
+    bool is_float = false;
+    uint64_t v = ParseMagnitude(str, len, i, max, is_float);
+    if(is_float){
+        double d = ParseDouble(str, len);
+        if(d != floor(d)){
+            Fail("not an integer", str, len, 0);
+        }
+        if(d < 0 || d > (double)max || d >= 18446744073709551616.0){
+            Fail("out of range", str, len, 0);
+        }
+        return (uint64_t)d;
+    }
+    return v;
+}
+
+double ParseDouble(const char* str, size_t len){
+    return ParseFloating<double>(str, len, strtod_l);
+}
+
+float ParseFloat(const char* str, size_t len){
+    return ParseFloating<float>(str, len, strtof_l);
+}
+
+bool ParseBool(const char* str, size_t len){
+    static const char* s_true[] = {"true", "yes", "on", "y", "1"};
+    static const char* s_false[] = {"false", "no", "off", "n", "0"};
+    for(size_t i = 0; i < sizeof(s_true) / sizeof(s_true[0]); ++i){
+        if(EqualsNoCase(str, len, s_true[i])){
+            return true;
+        }
+        if(EqualsNoCase(str, len, s_false[i])){
+            return false;
+        }
+    }
+    Fail("invalid bool", str, len, 0);
+    return false;
+}
+
+std::string Int64ToString(int64_t v){
+    if(v < 0){
+        char buf[24];
+        char* p = buf + sizeof(buf);
+        uint64_t u = 0 - (uint64_t)v;
+        do{
+            *--p = '0' + u % 10;
+            u /= 10;
+        }while(u);
+        *--p = '-';
+        return std::string(p, buf + sizeof(buf) - p);
+    }
+    return UInt64ToString(v);
+}
+
+std::string UInt64ToString(uint64_t v){
+    char buf[24];
+    char* p = buf + sizeof(buf);
+    do{
+        *--p = '0' + v % 10;
+        v /= 10;
+    }while(v);
+    return std::string(p, buf + sizeof(buf) - p);
+}
+
+std::string DoubleToString(double v){
+    char buf[64];
+    size_t n = FormatShortest<double>(v, buf, sizeof(buf), 15, 17, ParseDouble);
+    return std::string(buf, n);
+}
+
+std::string FloatToString(float v){
+    char buf[64];
+    size_t n = FormatShortest<float>(v, buf, sizeof(buf), 6, 9, ParseFloat);
+    return std::string(buf, n);
+}
+
+}
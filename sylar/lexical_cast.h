@@ -0,0 +1,49 @@
+#ifndef __SYLAR_LEXICAL_CAST_H__
+#define __SYLAR_LEXICAL_CAST_H__
+
+#include <string>
+#include <stdexcept>
+#include <limits>
+#include <stdint.h>
+
+namespace sylar{
+
+// 标量转换失败, 携带出错字符在输入中的位置
+class LexicalCastError : public std::invalid_argument{
+public:
+    LexicalCastError(const std::string& msg, const std::string& input, size_t pos);
+    size_t getPos() const { return m_pos;}
+private:
+    size_t m_pos;
+};
+
+// 不依赖locale、不分配内存的标量解析, 失败抛出 LexicalCastError
+// 整数支持 [+-] 十进制 / 0x十六进制 / 0o八进制 / 0b二进制, 以及1e3这类值为整数的浮点写法
+// 浮点支持常规写法和YAML的 .inf -.inf .nan
+// bool支持 true/false yes/no on/off y/n 1/0 (不区分大小写)
+int64_t ParseInt64(const char* str, size_t len, int64_t min, int64_t max);
+uint64_t ParseUInt64(const char* str, size_t len, uint64_t max);
+double ParseDouble(const char* str, size_t len);
+float ParseFloat(const char* str, size_t len);
+bool ParseBool(const char* str, size_t len);
+
+// 整数按十进制输出, 浮点输出能精确还原的文本(短小数保持原样, 如10.2)
+std::string Int64ToString(int64_t v);
+std::string UInt64ToString(uint64_t v);
+std::string DoubleToString(double v);
+std::string FloatToString(float v);
+
+template<class T>
+T ParseSigned(const std::string& str){
+    return (T)ParseInt64(str.c_str(), str.size(),
+            std::numeric_limits<T>::min(), std::numeric_limits<T>::max());
+}
+
+template<class T>
+T ParseUnsigned(const std::string& str){
+    return (T)ParseUInt64(str.c_str(), str.size(), std::numeric_limits<T>::max());
+}
+
+}
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef __SYLAR_LOCKFREE_MPMC_QUEUE_H__
+#define __SYLAR_LOCKFREE_MPMC_QUEUE_H__
+
+#include <atomic>
+#include <utility>
+#include <stdint.h>
+#include <stddef.h>
+#include "../noncopyable.h"
+
+namespace sylar{
+
+// 有界多生产者多消费者环形队列, Dmitry Vyukov 的算法
+// 每个槽有一个序号: 等于入队位置时可写, 等于入队位置+1时可读, 读完后加上容量留给下一圈
+// 生产者和消费者只在各自的位置计数器上CAS一次, 不同槽之间互不干扰
+// 某个生产者已经占了槽但还没写完时, 排在它后面的消费者会看到队列为空(返回false), 不会阻塞
+// T 需要可默认构造和移动赋值
+template<class T>
+class MPMCQueue : Noncopyable{
+private:
+    struct Cell{
+        std::atomic<size_t> sequence;
+        T data;
+    };
+public:
+    // 容量向上取整到2的幂
+    MPMCQueue(size_t capacity = 1024){
+        size_t c = 2;
+        while(c < capacity){
+            c <<= 1;
+        }
+        m_buffer = new Cell[c];
+        m_mask = c - 1;
+        for(size_t i = 0; i < c; ++i){
+            m_buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        m_enqueuePos.store(0, std::memory_order_relaxed);
+        m_dequeuePos.store(0, std::memory_order_relaxed);
+    }
+
+    ~MPMCQueue(){
+        delete[] m_buffer;
+    }
+
+    // 队列满时返回false
+    bool push(const T& v){
+        return emplace(v);
+    }
+
+    bool push(T&& v){
+        return emplace(std::move(v));
+    }
+
+    // 队列空时返回false
+    bool pop(T& v){
+        Cell* cell = nullptr;
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        while(true){
+            cell = &m_buffer[pos & m_mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+            if(dif == 0){
+                if(m_dequeuePos.compare_exchange_weak(pos, pos + 1,
+                            std::memory_order_relaxed)){
+                    break;
+                }
+            }
+            else if(dif < 0){
+                return false;
+            }
+            else{
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        v = std::move(cell->data);
+        cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return m_mask + 1;}
+
+    // 近似大小
+    size_t size() const{
+        size_t e = m_enqueuePos.load(std::memory_order_relaxed);
+        size_t d = m_dequeuePos.load(std::memory_order_relaxed);
+        return e > d ? e - d : 0;
+    }
+
+    bool empty() const { return size() == 0;}
+private:
+    template<class U>
+    bool emplace(U&& v){
+        Cell* cell = nullptr;
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        while(true){
+            cell = &m_buffer[pos & m_mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if(dif == 0){
+                if(m_enqueuePos.compare_exchange_weak(pos, pos + 1,
+                            std::memory_order_relaxed)){
+                    break;
+                }
+            }
+            else if(dif < 0){
+                return false;
+            }
+            else{
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::forward<U>(v);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+private:
+    // 只读字段, 入队位置, 出队位置分别放在不同的缓存行
+    // (C++11的new不保证alignas超过16字节的对齐, 用填充)
+    char m_pad0[64];
+    Cell* m_buffer;
+    size_t m_mask;
+    char m_pad1[64 - sizeof(Cell*) - sizeof(size_t)];
+    std::atomic<size_t> m_enqueuePos;
+    char m_pad2[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> m_dequeuePos;
+    char m_pad3[64 - sizeof(std::atomic<size_t>)];
+};
+
+}
+
+#endif
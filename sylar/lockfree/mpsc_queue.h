@@ -0,0 +1,86 @@
+#ifndef __SYLAR_LOCKFREE_MPSC_QUEUE_H__
+#define __SYLAR_LOCKFREE_MPSC_QUEUE_H__
+
+#include <atomic>
+#include <utility>
+#include "../noncopyable.h"
+#include "object_pool.h"
+
+namespace sylar{
+
+// 无界多生产者单消费者链表队列, Dmitry Vyukov 的算法
+// 生产者只做一次exchange把节点挂到尾部, 不会失败重试; 消费者独占头部, 没有原子读改写
+// 生产者exchange之后, 链接前一个节点之前被打断时, 消费者暂时看不到它之后的元素(pop返回false)
+// 节点从对象池分配, 消费者释放的节点回到生产者线程的缓存
+template<class T>
+class MPSCQueue : Noncopyable{
+private:
+    struct Node{
+        std::atomic<Node*> next;
+        T value;
+
+        Node()
+            :next(nullptr){
+        }
+
+        template<class U>
+        Node(U&& v)
+            :next(nullptr)
+            ,value(std::forward<U>(v)){
+        }
+    };
+    typedef ObjectPool<Node> NodePool;
+public:
+    MPSCQueue(){
+        Node* stub = NodePool::New();
+        m_head.store(stub, std::memory_order_relaxed);
+        m_tail = stub;
+    }
+
+    ~MPSCQueue(){
+        T v;
+        while(pop(v));
+        NodePool::Delete(m_tail);
+    }
+
+    // 任意线程调用
+    void push(const T& v){
+        pushNode(NodePool::New(v));
+    }
+
+    void push(T&& v){
+        pushNode(NodePool::New(std::move(v)));
+    }
+
+    // 只能由消费者线程调用, 空时返回false
+    bool pop(T& v){
+        Node* tail = m_tail;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if(!next){
+            return false;
+        }
+        v = std::move(next->value);
+        m_tail = next;
+        NodePool::Delete(tail);
+        return true;
+    }
+
+    // 只能由消费者线程调用
+    bool empty() const{
+        return m_tail->next.load(std::memory_order_acquire) == nullptr;
+    }
+private:
+    void pushNode(Node* n){
+        Node* prev = m_head.exchange(n, std::memory_order_acq_rel);
+        prev->next.store(n, std::memory_order_release);
+    }
+private:
+    // 生产者写m_head, 消费者写m_tail, 分开放在不同的缓存行
+    std::atomic<Node*> m_head;
+    char m_pad[64 - sizeof(std::atomic<Node*>)];
+    Node* m_tail;
+};
+
+}
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef __SYLAR_LOCKFREE_OBJECT_POOL_H__
+#define __SYLAR_LOCKFREE_OBJECT_POOL_H__
+
+#include <atomic>
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <stddef.h>
+#include "../mutex.h"
+
+namespace sylar{
+
+// 按类型的对象池, 每个线程缓存自己的空闲块
+// 每个块记录分配它的线程缓存(owner):
+//   owner线程释放: 压入本地空闲链表, 没有原子操作
+//   其它线程释放: 用CAS压入owner的远程栈, owner本地链表用完时一次性exchange取回
+// 生产者分配/消费者释放的场景下内存回到生产者, 不会在消费者一侧越积越多
+// 线程退出时释放本地空闲块, 缓存对象交给之后创建的线程接管(还有块在外面, 不能删除)
+// MaxCached 为每个线程本地最多缓存的空闲块数, 超出的直接归还给系统
+template<class T, size_t MaxCached = 1024>
+class ObjectPool{
+private:
+    struct Cache;
+    struct Block{
+        Cache* owner;
+        Block* next;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    struct Cache{
+        Block* local = nullptr;
+        size_t localCount = 0;
+        // 其它线程释放的块, 多生产者压入, owner整体取走, 不存在ABA
+        std::atomic<Block*> remote {nullptr};
+    };
+
+    // 无人使用的缓存, 故意不释放, 避免和静态析构顺序纠缠
+    struct Orphans{
+        Mutex mutex;
+        std::vector<Cache*> caches;
+    };
+
+    struct CacheHolder{
+        Cache* cache;
+        CacheHolder(){
+            cache = Adopt();
+        }
+        ~CacheHolder(){
+            Release(cache);
+            Dead() = true;
+        }
+    };
+public:
+    template<class... Args>
+    static T* New(Args&&... args){
+        Block* b = AllocBlock();
+        try{
+            return new (&b->storage) T(std::forward<Args>(args)...);
+        }
+        catch(...){
+            FreeBlock(b);
+            throw;
+        }
+    }
+
+    static void Delete(T* p){
+        if(!p){
+            return;
+        }
+        p->~T();
+        FreeBlock(reinterpret_cast<Block*>(
+                    reinterpret_cast<char*>(p) - offsetof(Block, storage)));
+    }
+
+    // 用于std::shared_ptr/std::unique_ptr
+    struct Deleter{
+        void operator()(T* p) const{
+            Delete(p);
+        }
+    };
+
+    // 当前线程本地缓存的空闲块数
+    static size_t LocalCached(){
+        if(Dead()){
+            return 0;
+        }
+        return GetCache()->localCount;
+    }
+private:
+    static bool& Dead(){
+        static thread_local bool t_dead = false;
+        return t_dead;
+    }
+
+    static Cache* GetCache(){
+        static thread_local CacheHolder t_holder;
+        return t_holder.cache;
+    }
+
+    static Orphans* GetOrphans(){
+        static Orphans* s_orphans = new Orphans;
+        return s_orphans;
+    }
+
+    static Cache* Adopt(){
+        Orphans* o = GetOrphans();
+        Mutex::Lock lock(o->mutex);
+        if(o->caches.empty()){
+            return new Cache;
+        }
+        Cache* c = o->caches.back();
+        o->caches.pop_back();
+        return c;
+    }
+
+    static void Release(Cache* c){
+        while(c->local){
+            Block* b = c->local;
+            c->local = b->next;
+            ::operator delete(b);
+        }
+        c->localCount = 0;
+        Orphans* o = GetOrphans();
+        Mutex::Lock lock(o->mutex);
+        o->caches.push_back(c);
+    }
+
+    static Block* AllocBlock(){
+        if(Dead()){
+            Block* b = static_cast<Block*>(::operator new(sizeof(Block)));
+            b->owner = nullptr;
+            return b;
+        }
+        Cache* c = GetCache();
+        Block* b = c->local;
+        if(!b){
+            b = c->remote.exchange(nullptr, std::memory_order_acquire);
+            if(!b){
+                b = static_cast<Block*>(::operator new(sizeof(Block)));
+                b->owner = c;
+                return b;
+            }
+            size_t n = 0;
+            for(Block* i = b; i; i = i->next){
+                ++n;
+            }
+            c->localCount = n;
+        }
+        c->local = b->next;
+        --c->localCount;
+        return b;
+    }
+
+    static void FreeBlock(Block* b){
+        Cache* owner = b->owner;
+        if(!owner){
+            ::operator delete(b);
+            return;
+        }
+        if(!Dead() && owner == GetCache()){
+            if(owner->localCount >= MaxCached){
+                ::operator delete(b);
+                return;
+            }
+            b->next = owner->local;
+            owner->local = b;
+            ++owner->localCount;
+            return;
+        }
+        Block* head = owner->remote.load(std::memory_order_relaxed);
+        do{
+            b->next = head;
+        }while(!owner->remote.compare_exchange_weak(head, b,
+                    std::memory_order_release, std::memory_order_relaxed));
+    }
+};
+
+}
+
+#endif
@@ -5,6 +5,10 @@
 #include <time.h>
 #include <string.h>
 #include "config.h"
+#include "trace.h"
+#include "macro.h"
+#include <atomic>
+#include <algorithm>
 
 namespace sylar{
 
@@ -68,6 +72,7 @@ std::stringstream &LogEventWrap::getSS()
 
 void LogAppender::setFormatter(LogFormatter::ptr val)
 {  
+    MutexType::Lock lock(m_mutex);
     m_formatter = val;
     if(m_formatter){
         m_hasFormatter = true;
@@ -77,6 +82,12 @@ void LogAppender::setFormatter(LogFormatter::ptr val)
     }
 }
 
+LogFormatter::ptr LogAppender::getFormatter()
+{
+    MutexType::Lock lock(m_mutex);
+    return m_formatter;
+}
+
 class MessageFormatItem : public LogFormatter::FormatItem{
 public: 
     MessageFormatItem(const std::string& str = "") {}
@@ -117,6 +128,14 @@ public:
     }
 };
 
+class ThreadNameFormatItem : public LogFormatter::FormatItem{
+public:
+    ThreadNameFormatItem(const std::string& str = "") {}
+    void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override{
+        os << event->getThreadName();
+    }
+};
+
 class FiberIdFormatItem : public LogFormatter::FormatItem{
 public:
     FiberIdFormatItem(const std::string& str = "") {}
@@ -125,6 +144,37 @@ public:
     }
 };
 
+class SpanIdFormatItem : public LogFormatter::FormatItem{
+public:
+    SpanIdFormatItem(const std::string& str = "") {}
+    void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override{
+        // 和导出的trace中args.span的格式一致
+        os << std::hex << event->getSpanId() << std::dec;
+    }
+};
+
+class BacktraceFormatItem : public LogFormatter::FormatItem{
+public:
+    // %B{n} 最多输出n层
+    BacktraceFormatItem(const std::string& str = "")
+        :m_maxFrames(Backtrace::MAX_FRAMES){
+        if(!str.empty()){
+            m_maxFrames = std::max(atoi(str.c_str()), 1);
+        }
+    }
+    void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override{
+        Backtrace::ptr bt = event->getBacktrace();
+        if(bt && bt->size()){
+            // 没有调用栈时什么都不输出, 可以放在默认格式中
+            os << "\n";
+            bt->dump(os, "    ", m_maxFrames);
+        }
+    }
+private:
+    size_t m_maxFrames;
+};
+
+// %d{...} 按strftime格式输出, 另外 %f 输出3位毫秒, 如 %d{%Y-%m-%d %H:%M:%S.%f}
 class DateTimeFormatItem : public LogFormatter::FormatItem{
 public: 
     DateTimeFormatItem(const std::string& format = "%Y:%m:%d %H:%M:%S")
@@ -132,18 +182,39 @@ public:
             if(m_format.empty()){
                 m_format = "%Y-%m-%d %H:%M:%S";
             }
+            // 按 %f 切成几段, 段与段之间输出毫秒
+            size_t begin = 0;
+            for(size_t i = 0; i + 1 < m_format.size(); ++i){
+                if(m_format[i] != '%'){
+                    continue;
+                }
+                if(m_format[i + 1] == 'f'){
+                    m_parts.push_back(m_format.substr(begin, i - begin));
+                    begin = i + 2;
+                }
+                ++i;
+            }
+            m_parts.push_back(m_format.substr(begin));
         }
     void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override{
         struct tm tm;
-        time_t time = event->getTime();
+        uint64_t ms = event->getTime();
+        time_t time = ms / 1000;
         localtime_r(&time, &tm);        // 转换为本地时间。是线程安全的函数，它将 time_t 类型的时间戳（&time）转换为 struct tm 结构，表示本地时间。它将结果存储在 tm 变量中。
         char buf[64];
-        strftime(buf, sizeof(buf), m_format.c_str(), &tm);      // 格式化时间为字符串。用于将 struct tm 中的时间按照指定的格式（由 m_format 定义）转换为字符串，并将结果存储在 buf 数组中。
-        
-        os << buf;
+        for(size_t i = 0; i < m_parts.size(); ++i){
+            if(i > 0){
+                snprintf(buf, sizeof(buf), "%03u", (uint32_t)(ms % 1000));
+                os << buf;
+            }
+            if(!m_parts[i].empty() && strftime(buf, sizeof(buf), m_parts[i].c_str(), &tm)){      // 格式化时间为字符串。用于将 struct tm 中的时间按照指定的格式转换为字符串，并将结果存储在 buf 数组中。
+                os << buf;
+            }
+        }
     }
 private:
     std::string m_format;
+    std::vector<std::string> m_parts;
 };
 
 class FilenameFormatItem : public LogFormatter::FormatItem{
@@ -192,8 +263,18 @@ private:
     std::string m_string;
 };
 
+// 自动附带调用栈的最低级别, 由配置 log.backtrace_level 同步, 关闭时大于所有级别
+static const int s_backtrace_off = LogLevel::FATAL + 1;
+static std::atomic<int> s_backtrace_level {LogLevel::FATAL};
+
 LogEvent::LogEvent(std::shared_ptr<Logger> logger, LogLevel::Level level ,const char *file, int32_t line, uint32_t elapse, uint32_t thread_id, uint32_t fiber_id, uint64_t time)
-    :m_file(file), m_line(line), m_elapse(elapse), m_threadID(thread_id), m_fiberID(fiber_id), m_time(time), m_logger(logger), m_level(level){ }
+    :m_file(file), m_line(line), m_elapse(elapse), m_threadID(thread_id), m_fiberID(fiber_id)
+    ,m_spanID(Tracer::GetCurrentSpanId()), m_time(time), m_threadName(Thread::GetName()), m_logger(logger), m_level(level){
+    if(SYLAR_UNLIKELY(level >= s_backtrace_level.load(std::memory_order_relaxed))){
+        // 跳过构造函数本身, 从打日志的函数开始
+        m_backtrace = Backtrace::Capture(1);
+    }
+}
 
 void LogEvent::format(const char *fmt, ...)
 {
@@ -216,14 +297,16 @@ void LogEvent::format(const char *fmt, va_list al)
 
 Logger::Logger(const std::string& name)
     :m_name(name), m_level(LogLevel::DEBUG){
-        m_formatter.reset(new LogFormatter("%d{%Y-%m-%d %H:%M:%S}%T%t%T%F%T[%p]%T[%c]%T%f:%l%T%m%n"));
+        m_formatter.reset(new LogFormatter("%d{%Y-%m-%d %H:%M:%S}%T%t%T%F%T[%p]%T[%c]%T%f:%l%T%m%B%n"));
 }
 
 void Logger::setFormatter(LogFormatter::ptr val)
 {
+    MutexType::Lock lock(m_mutex);
     m_formatter = val;
 
     for(auto& i : m_appenders){
+        MutexType::Lock ll(i->m_mutex);
         if(!i->m_hasFormatter){
             i->m_formatter = m_formatter;
         }
@@ -244,11 +327,13 @@ void Logger::setFormatter(const std::string &val)
 
 LogFormatter::ptr Logger::getFormatter()
 {
+    MutexType::Lock lock(m_mutex);
     return m_formatter;
 }
 
 std::string Logger::toYamlString()
 {
+    MutexType::Lock lock(m_mutex);
     YAML::Node node;
     node["name"] = m_name;
     if(m_level != LogLevel::UNKNOW){
@@ -266,13 +351,16 @@ std::string Logger::toYamlString()
 }
 
 void Logger::addAppender(LogAppender::ptr appender){
+    MutexType::Lock lock(m_mutex);
     if(!appender->getFormatter()){
+        MutexType::Lock ll(appender->m_mutex);
         appender->m_formatter = m_formatter;
     }
     m_appenders.push_back(appender);
 }
 
 void Logger::delAppender(LogAppender::ptr appender){
+    MutexType::Lock lock(m_mutex);
     for(auto it = m_appenders.begin();
             it != m_appenders.end(); ++it)
         if(*it == appender){
@@ -283,12 +371,14 @@ void Logger::delAppender(LogAppender::ptr appender){
 
 void Logger::clearAppenders()
 {
+    MutexType::Lock lock(m_mutex);
     m_appenders.clear();
 }
 
 void Logger::log(LogLevel::Level level, LogEvent::ptr event){
     if(level >= m_level){
         auto self = shared_from_this();
+        MutexType::Lock lock(m_mutex);
         if(!m_appenders.empty()){
             for(auto& i : m_appenders){
                 i->log(self, level, event);
@@ -323,12 +413,14 @@ void Logger::fatal(LogEvent::ptr event){
 void StdoutLogAppender::log(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event)
 {
     if(level >= m_level){
+        MutexType::Lock lock(m_mutex);
         std::cout << m_formatter->format(logger, level, event);
     }
 }
 
 std::string StdoutLogAppender::toYamlString()
 {
+    MutexType::Lock lock(m_mutex);
     YAML::Node node;
     node["type"] = "StdoutLogAppender";
     if(m_level != LogLevel::UNKNOW) {
@@ -351,6 +443,7 @@ FileLogAppender::FileLogAppender(const std::string &filename)
 void FileLogAppender::log(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event)
 { 
     if(level >= m_level){
+        MutexType::Lock lock(m_mutex);
         m_filestream << m_formatter->format(logger, level, event);
         // std::cout << m_level << std::endl;
     }
@@ -358,6 +451,7 @@ void FileLogAppender::log(std::shared_ptr<Logger> logger, LogLevel::Level level,
 
 std::string FileLogAppender::toYamlString()
 {
+    MutexType::Lock lock(m_mutex);
     YAML::Node node;
     node["type"] = "FileLogAppender";
     node["file"] = m_filename;
@@ -374,6 +468,7 @@ std::string FileLogAppender::toYamlString()
 
 bool FileLogAppender::reopen()
 {
+    MutexType::Lock lock(m_mutex);
     if(m_filestream){
         m_filestream.close();
     }
@@ -484,6 +579,9 @@ void LogFormatter::init()
             XX(f, FilenameFormatItem),    // %f -- 文件名
             XX(l, LineFormatItem),        // %l -- 行号
             XX(T, TabFormatItem),         // %T -- Tab
+            XX(N, ThreadNameFormatItem),  // %N -- 线程名称
+            XX(S, SpanIdFormatItem),      // %S -- 追踪区间id
+            XX(B, BacktraceFormatItem),   // %B -- 调用栈
 #undef XX
     };
 
@@ -517,6 +615,7 @@ LoggerManager::LoggerManager()
 
 std::string LoggerManager::toYamlString()
 {
+    MutexType::Lock lock(m_mutex);
     YAML::Node node;
     for(auto& i : m_loggers){
         node.push_back(YAML::Load(i.second->toYamlString()));
@@ -528,6 +627,7 @@ std::string LoggerManager::toYamlString()
 
 Logger::ptr LoggerManager::getLogger(const std::string &name)
 {
+    MutexType::Lock lock(m_mutex);
     auto it = m_loggers.find(name);
     if(it != m_loggers.end()){
         return it->second;
@@ -660,8 +760,21 @@ public:
 sylar::ConfigVar<std::set<LogDefine>>::ptr g_log_defines =  
     sylar::Config::Lookup("logs", std::set<LogDefine>(), "logs config");
 
+static sylar::ConfigVar<std::string>::ptr g_log_backtrace_level =
+    sylar::Config::Lookup<std::string>("log.backtrace_level", "FATAL", "attach a backtrace to log events at or above this level, NONE disables");
+
+static int BacktraceLevelFromString(const std::string& str)
+{
+    LogLevel::Level level = LogLevel::FromString(str);
+    return level == LogLevel::UNKNOW ? s_backtrace_off : level;
+}
+
 struct LogIniter{
     LogIniter(){
+        s_backtrace_level = BacktraceLevelFromString(g_log_backtrace_level->getValue());
+        g_log_backtrace_level->addListener(0xF1E232, [](const std::string& old_value, const std::string& new_value){
+            s_backtrace_level = BacktraceLevelFromString(new_value);
+        });
         g_log_defines->addListener(0xF1E231, [](const std::set<LogDefine>& old_value, 
                 const std::set<LogDefine>& new_value){
             SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "on_logger_conf_changed";
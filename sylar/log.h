@@ -11,12 +11,15 @@
 #include <stdarg.h>
 #include <map>
 #include "util.h"
+#include "backtrace.h"
 #include "singleton.h"
+#include "thread.h"
+#include "mutex.h"
 
 #define SYLAR_LOG_LEVEL(logger, level) \
     if(logger->getLevel() <= level) \
         sylar::LogEventWrap(sylar::LogEvent::ptr(new sylar::LogEvent(logger, level, __FILE__, __LINE__, \
-        0, sylar::GetThreadID(), sylar::GetFiberID(), time(0)))).getSS()
+        sylar::GetElapsedMS(), sylar::GetThreadID(), sylar::GetFiberID(), sylar::GetCurrentMS()))).getSS()
 
 #define SYLAR_LOG_DEBUG(logger) SYLAR_LOG_LEVEL(logger, sylar::LogLevel::DEBUG)
 #define SYLAR_LOG_INFO(logger) SYLAR_LOG_LEVEL(logger, sylar::LogLevel::INFO)
@@ -27,7 +30,7 @@
 #define SYLAR_LOG_FMT_LEVEL(logger, level, fmt, ...) \
     if(logger->getLevel() <= level) \
         sylar::LogEventWrap(sylar::LogEvent::ptr(new sylar::LogEvent(logger, level, __FILE__, __LINE__, \
-        0, sylar::GetThreadID(), sylar::GetFiberID(), time(0)))).getEvent()->format(fmt, __VA_ARGS__)
+        sylar::GetElapsedMS(), sylar::GetThreadID(), sylar::GetFiberID(), sylar::GetCurrentMS()))).getEvent()->format(fmt, __VA_ARGS__)
 
 #define SYLAR_LOG_FMT_DEBUG(logger, fmt, ...) SYLAR_LOG_FMT_LEVEL(logger, sylar::LogLevel::DEBUG, fmt, __VA_ARGS__)
 #define SYLAR_LOG_FMT_INFO(logger, fmt, ...) SYLAR_LOG_FMT_LEVEL(logger, sylar::LogLevel::INFO, fmt, __VA_ARGS__)
@@ -63,6 +66,7 @@ public:
 class LogEvent{
 public:
     typedef std::shared_ptr<LogEvent> ptr;
+    // time 为墙上时钟的毫秒时间戳(GetCurrentMS)
     LogEvent(std::shared_ptr<Logger>, LogLevel::Level level, const char* file, int32_t line, 
             uint32_t elapse, uint32_t thread_id, uint32_t fiber_id, uint64_t time);
 
@@ -71,7 +75,12 @@ public:
     uint32_t getElapse() const { return m_elapse;}
     uint32_t getThreadId() const { return m_threadID;}
     uint32_t getFiberId() const { return m_fiberID;}
+    uint64_t getSpanId() const { return m_spanID;}
+    // 级别不低于配置 log.backtrace_level 时构造时自动捕获, 由 %B 输出
+    Backtrace::ptr getBacktrace() const { return m_backtrace;}
+    void setBacktrace(Backtrace::ptr v) { m_backtrace = v;}
     uint64_t getTime() const { return m_time;}
+    const std::string& getThreadName() const { return m_threadName;}
     std::string getContent() const { return m_ss.str();}
     std::shared_ptr<Logger> getLogger() const { return m_logger;}
     LogLevel::Level getLevel() const { return m_level;}
@@ -85,8 +94,11 @@ private:
     uint32_t m_elapse = 0;          //程序启动开始到现在的毫秒数
     uint32_t m_threadID = 0;        //线程id
     uint32_t m_fiberID = 0;         //协程id
-    uint64_t m_time = 0;            //时间戳
+    uint64_t m_spanID = 0;          //所在的追踪区间id
+    uint64_t m_time = 0;            //时间戳, 毫秒
+    std::string m_threadName;       //线程名称, 取自创建事件的线程
     std::stringstream m_ss;         //消息体的流
+    Backtrace::ptr m_backtrace;     //调用栈, 只有地址, 输出时才符号化
     
     std::shared_ptr<Logger> m_logger;
     LogLevel::Level m_level;
@@ -135,19 +147,22 @@ class LogAppender{
 friend class Logger;
 public:
     typedef std::shared_ptr<LogAppender> ptr;
+    // 持锁期间做格式化和I/O(%B还要符号化), 竞争时不能自旋
+    typedef Mutex MutexType;
     virtual ~LogAppender() {};
 
     virtual void log(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) = 0;
     virtual std::string toYamlString() = 0;
 
     void setFormatter(LogFormatter::ptr val);
-    LogFormatter::ptr getFormatter() const { return m_formatter;}
+    LogFormatter::ptr getFormatter();
 
     LogLevel::Level getLevel() const { return m_level;}
     void setLevel(LogLevel::Level level) {m_level = level;}
 protected:
     LogLevel::Level m_level = LogLevel::DEBUG;
     bool m_hasFormatter = false;
+    MutexType m_mutex;
     LogFormatter::ptr m_formatter;
 };
 
@@ -157,6 +172,8 @@ class Logger: public std::enable_shared_from_this<Logger>{
 friend class LoggerManager;
 public:
     typedef std::shared_ptr<Logger> ptr;
+    // log() 持锁调用所有输出地
+    typedef Mutex MutexType;
     Logger(const std::string& name = "root");
 
     void log(LogLevel::Level level,  LogEvent::ptr event);
@@ -186,6 +203,7 @@ private:
     std::string m_name;                         //日志名称
     LogLevel::Level m_level = LogLevel::DEBUG;  //日志级别
     std::list<LogAppender::ptr> m_appenders;    //Appender集合
+    MutexType m_mutex;
     LogFormatter::ptr m_formatter;
     Logger::ptr m_root;
 };
@@ -215,6 +233,7 @@ private:
 
 class LoggerManager{
 public:
+    typedef Spinlock MutexType;
     LoggerManager();
     Logger::ptr getLogger(const std::string& name);
 
@@ -224,6 +243,7 @@ public:
     std::string toYamlString();
 
 private:
+    MutexType m_mutex;
     std::map<std::string, Logger::ptr> m_loggers;
     Logger::ptr m_root;
 };
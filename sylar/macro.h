@@ -0,0 +1,42 @@
+#ifndef __SYLAR_MACRO_H__
+#define __SYLAR_MACRO_H__
+
+#include <string.h>
+#include <assert.h>
+#include "log.h"
+#include "backtrace.h"
+
+#if defined __GNUC__ || defined __llvm__
+#   define SYLAR_LIKELY(x)       __builtin_expect(!!(x), 1)
+#   define SYLAR_UNLIKELY(x)     __builtin_expect(!!(x), 0)
+#else
+#   define SYLAR_LIKELY(x)      (x)
+#   define SYLAR_UNLIKELY(x)      (x)
+#endif
+
+// 自旋等待时提示CPU, 降低功耗并让出超线程的执行资源
+#if defined(__x86_64__) || defined(__i386__)
+#   define SYLAR_CPU_RELAX()    __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#   define SYLAR_CPU_RELAX()    __asm__ __volatile__("yield" ::: "memory")
+#else
+#   define SYLAR_CPU_RELAX()    do {} while(0)
+#endif
+
+// 断言失败时先输出到root日志再abort, 调用栈直接写在消息里, 不依赖输出格式中的 %B
+#define SYLAR_ASSERT(x) \
+    if(SYLAR_UNLIKELY(!(x))){ \
+        SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "ASSERTION: " #x \
+            << "\nbacktrace:\n" << sylar::Backtrace::Capture()->toString(); \
+        assert(x); \
+    }
+
+#define SYLAR_ASSERT2(x, w) \
+    if(SYLAR_UNLIKELY(!(x))){ \
+        SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "ASSERTION: " #x \
+            << "\n" << w \
+            << "\nbacktrace:\n" << sylar::Backtrace::Capture()->toString(); \
+        assert(x); \
+    }
+
+#endif
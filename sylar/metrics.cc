@@ -0,0 +1,493 @@
+#include "metrics.h"
+#include "log.h"
+#include <algorithm>
+#include <sstream>
+#include <thread>
+#include <stdexcept>
+#include <new>
+#include <stdlib.h>
+#include <yaml-cpp/yaml.h>
+
+namespace sylar{
+
+static Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+thread_local uint32_t Metric::t_shard = (uint32_t)-1;
+
+Metric::Metric(const std::string& name, const std::string& description, Type type)
+    :m_name(name)
+    ,m_description(description)
+    ,m_type(type){
+}
+
+const char* Metric::TypeToString(Type type)
+{
+    switch(type){
+#define XX(name) \
+        case name: \
+            return #name;
+        XX(COUNTER);
+        XX(GAUGE);
+        XX(HISTOGRAM);
+#undef XX
+        default:
+            return "UNKNOWN";
+    }
+}
+
+uint32_t Metric::GetShardCount()
+{
+    static uint32_t s_count = [](){
+        uint32_t cpus = std::max(1u, std::thread::hardware_concurrency());
+        uint32_t n = 1;
+        while(n < cpus && n < 256){
+            n <<= 1;
+        }
+        return n;
+    }();
+    return s_count;
+}
+
+uint32_t Metric::AssignShard()
+{
+    // 依次分配, 同时存在的线程尽量落在不同的分片
+    static std::atomic<uint32_t> s_next{0};
+    t_shard = s_next.fetch_add(1, std::memory_order_relaxed);
+    return t_shard;
+}
+
+static MetricCell* NewCells(uint32_t n)
+{
+    MetricCell* cells = new MetricCell[n];
+    for(uint32_t i = 0; i < n; ++i){
+        cells[i].value.store(0, std::memory_order_relaxed);
+    }
+    return cells;
+}
+
+static int64_t SumCells(const MetricCell* cells, uint32_t n)
+{
+    int64_t v = 0;
+    for(uint32_t i = 0; i < n; ++i){
+        v += cells[i].value.load(std::memory_order_relaxed);
+    }
+    return v;
+}
+
+Counter::Counter(const std::string& name, const std::string& description)
+    :Metric(name, description, COUNTER)
+    ,m_cells(NewCells(GetShardCount()))
+    ,m_mask(GetShardCount() - 1){
+}
+
+Counter::~Counter()
+{
+    delete[] m_cells;
+}
+
+uint64_t Counter::getValue() const
+{
+    return SumCells(m_cells, m_mask + 1);
+}
+
+void Counter::reset()
+{
+    for(uint32_t i = 0; i <= m_mask; ++i){
+        m_cells[i].value.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::ostream& Counter::dump(std::ostream& os) const
+{
+    os << m_name << " " << getValue() << "\n";
+    return os;
+}
+
+Gauge::Gauge(const std::string& name, const std::string& description)
+    :Metric(name, description, GAUGE)
+    ,m_cells(NewCells(GetShardCount()))
+    ,m_mask(GetShardCount() - 1)
+    ,m_base(0){
+}
+
+Gauge::~Gauge()
+{
+    delete[] m_cells;
+}
+
+int64_t Gauge::sum() const
+{
+    return SumCells(m_cells, m_mask + 1);
+}
+
+void Gauge::set(int64_t v)
+{
+    m_base.store(v - sum(), std::memory_order_relaxed);
+}
+
+int64_t Gauge::getValue() const
+{
+    return m_base.load(std::memory_order_relaxed) + sum();
+}
+
+void Gauge::reset()
+{
+    set(0);
+}
+
+std::ostream& Gauge::dump(std::ostream& os) const
+{
+    os << m_name << " " << getValue() << "\n";
+    return os;
+}
+
+// 按缓存行对齐分配, 长度补齐到整行, 不与其他分配共用缓存行
+static void* CacheLineAlloc(size_t size)
+{
+    void* p = nullptr;
+    if(posix_memalign(&p, 64, (size + 63) & ~(size_t)63) != 0){
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+// 每个分片(头和桶数组)各自独占缓存行, 不同线程记录时互不干扰
+struct Histogram::Shard{
+    Shard(uint32_t n)
+        :buckets((std::atomic<uint64_t>*)CacheLineAlloc(sizeof(std::atomic<uint64_t>) * n)){
+        for(uint32_t i = 0; i < n; ++i){
+            new (&buckets[i]) std::atomic<uint64_t>(0);
+        }
+        sum = 0;
+        min = (uint64_t)-1;
+        max = 0;
+    }
+    ~Shard(){
+        free(buckets);
+    }
+
+    static void* operator new(size_t size){
+        return CacheLineAlloc(size);
+    }
+    static void operator delete(void* p){
+        free(p);
+    }
+
+    // 总数由各桶相加得到, 记录时少一次原子操作
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> min;
+    std::atomic<uint64_t> max;
+    std::atomic<uint64_t>* buckets;
+    char pad[64 - 3 * sizeof(std::atomic<uint64_t>) - sizeof(std::atomic<uint64_t>*)];
+};
+
+Histogram::Histogram(const std::string& name, const std::string& description
+                     ,uint32_t precision, uint32_t max_bits)
+    :Metric(name, description, HISTOGRAM)
+    ,m_precision(std::min(std::max(precision, 1u), 10u))
+    ,m_maxBits(std::min(std::max(max_bits, m_precision + 1), 64u))
+    ,m_bucketCount((m_maxBits - m_precision + 1) << m_precision)
+    ,m_mask(GetShardCount() - 1)
+    ,m_shards(new std::atomic<Shard*>[GetShardCount()]){
+    for(uint32_t i = 0; i <= m_mask; ++i){
+        m_shards[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+Histogram::~Histogram()
+{
+    for(uint32_t i = 0; i <= m_mask; ++i){
+        delete m_shards[i].load(std::memory_order_relaxed);
+    }
+    delete[] m_shards;
+}
+
+Histogram::Shard* Histogram::getShard()
+{
+    std::atomic<Shard*>& slot = m_shards[GetShard() & m_mask];
+    Shard* shard = slot.load(std::memory_order_acquire);
+    if(SYLAR_LIKELY(shard != nullptr)){
+        return shard;
+    }
+    // 共用分片的线程可能同时分配, 只保留一个
+    Shard* tmp = new Shard(m_bucketCount);
+    if(slot.compare_exchange_strong(shard, tmp, std::memory_order_acq_rel)){
+        return tmp;
+    }
+    delete tmp;
+    return shard;
+}
+
+void Histogram::record(uint64_t v)
+{
+    Shard* shard = getShard();
+    uint32_t idx = std::min(BucketIndex(v, m_precision), m_bucketCount - 1);
+    shard->buckets[idx].fetch_add(1, std::memory_order_relaxed);
+    shard->sum.fetch_add(v, std::memory_order_relaxed);
+    // 大多数记录不改变最小最大值, 先读一次避免无谓的写
+    uint64_t old = shard->min.load(std::memory_order_relaxed);
+    while(v < old && !shard->min.compare_exchange_weak(old, v, std::memory_order_relaxed));
+    old = shard->max.load(std::memory_order_relaxed);
+    while(v > old && !shard->max.compare_exchange_weak(old, v, std::memory_order_relaxed));
+}
+
+Histogram::Snapshot Histogram::snapshot() const
+{
+    Snapshot snap;
+    snap.precision = m_precision;
+    snap.buckets.resize(m_bucketCount);
+    uint64_t min = (uint64_t)-1;
+    for(uint32_t i = 0; i <= m_mask; ++i){
+        Shard* shard = m_shards[i].load(std::memory_order_acquire);
+        if(!shard){
+            continue;
+        }
+        for(uint32_t j = 0; j < m_bucketCount; ++j){
+            uint64_t n = shard->buckets[j].load(std::memory_order_relaxed);
+            snap.buckets[j] += n;
+            snap.count += n;
+        }
+        snap.sum += shard->sum.load(std::memory_order_relaxed);
+        min = std::min(min, shard->min.load(std::memory_order_relaxed));
+        snap.max = std::max(snap.max, shard->max.load(std::memory_order_relaxed));
+    }
+    snap.min = snap.count ? min : 0;
+    return snap;
+}
+
+uint64_t Histogram::getCount() const
+{
+    uint64_t count = 0;
+    for(uint32_t i = 0; i <= m_mask; ++i){
+        Shard* shard = m_shards[i].load(std::memory_order_acquire);
+        if(!shard){
+            continue;
+        }
+        for(uint32_t j = 0; j < m_bucketCount; ++j){
+            count += shard->buckets[j].load(std::memory_order_relaxed);
+        }
+    }
+    return count;
+}
+
+uint64_t Histogram::BucketLower(uint32_t idx, uint32_t precision)
+{
+    if(idx < (2u << precision)){
+        return idx;
+    }
+    uint32_t shift = (idx >> precision) - 1;
+    return (uint64_t)(idx - (shift << precision)) << shift;
+}
+
+uint64_t Histogram::BucketWidth(uint32_t idx, uint32_t precision)
+{
+    if(idx < (2u << precision)){
+        return 1;
+    }
+    return 1ull << ((idx >> precision) - 1);
+}
+
+uint64_t Histogram::Snapshot::percentile(double q) const
+{
+    if(count == 0){
+        return 0;
+    }
+    q = std::min(std::max(q, 0.0), 1.0);
+    uint64_t rank = std::max<uint64_t>(1, (uint64_t)(q * count + 0.5));
+    // 两端直接用精确的最小最大值
+    if(rank == 1){
+        return min;
+    }
+    if(rank >= count){
+        return max;
+    }
+    uint64_t seen = 0;
+    for(uint32_t i = 0; i < buckets.size(); ++i){
+        seen += buckets[i];
+        if(seen >= rank){
+            // 桶的中点, 并限制在实际的最小最大值之间
+            uint64_t v = BucketLower(i, precision) + (BucketWidth(i, precision) - 1) / 2;
+            return std::min(std::max(v, min), max);
+        }
+    }
+    return max;
+}
+
+void Histogram::reset()
+{
+    for(uint32_t i = 0; i <= m_mask; ++i){
+        Shard* shard = m_shards[i].load(std::memory_order_acquire);
+        if(!shard){
+            continue;
+        }
+        for(uint32_t j = 0; j < m_bucketCount; ++j){
+            shard->buckets[j].store(0, std::memory_order_relaxed);
+        }
+        shard->sum = 0;
+        shard->min = (uint64_t)-1;
+        shard->max = 0;
+    }
+}
+
+std::ostream& Histogram::dump(std::ostream& os) const
+{
+    Snapshot snap = snapshot();
+    os << m_name << ".count " << snap.count << "\n"
+       << m_name << ".sum " << snap.sum << "\n"
+       << m_name << ".min " << snap.min << "\n"
+       << m_name << ".max " << snap.max << "\n"
+       << m_name << ".mean " << snap.mean() << "\n"
+       << m_name << ".p50 " << snap.percentile(0.5) << "\n"
+       << m_name << ".p90 " << snap.percentile(0.9) << "\n"
+       << m_name << ".p99 " << snap.percentile(0.99) << "\n"
+       << m_name << ".p999 " << snap.percentile(0.999) << "\n";
+    return os;
+}
+
+void MetricsRegistry::CheckName(const std::string& name)
+{
+    if(name.empty() || name.find_first_not_of("abcdefghijklmnopqrstuvwxyz._0123456789")
+            != std::string::npos){
+        SYLAR_LOG_ERROR(g_logger) << "metric name invalid " << name;
+        throw std::invalid_argument(name);
+    }
+}
+
+Metric::ptr MetricsRegistry::Register(Metric::ptr m)
+{
+    RWMutexType::WriteLock lock(GetMutex());
+    // 并发注册同名指标时以先注册的为准
+    auto it = GetDatas().insert(std::make_pair(m->getName(), m)).first;
+    return it->second;
+}
+
+Metric::ptr MetricsRegistry::Lookup(const std::string& name)
+{
+    RWMutexType::ReadLock lock(GetMutex());
+    auto it = GetDatas().find(name);
+    return it == GetDatas().end() ? nullptr : it->second;
+}
+
+template<class T, class... Args>
+std::shared_ptr<T> MetricsRegistry::GetOrCreate(Metric::Type type, const std::string& name, Args&&... args)
+{
+    Metric::ptr base = Lookup(name);
+    if(!base){
+        CheckName(name);
+        base = Register(std::make_shared<T>(name, std::forward<Args>(args)...));
+    }
+    if(base->getType() != type){
+        SYLAR_LOG_ERROR(g_logger) << "metric " << name << " exists but type is "
+            << Metric::TypeToString(base->getType()) << " not "
+            << Metric::TypeToString(type);
+        return nullptr;
+    }
+    return std::static_pointer_cast<T>(base);
+}
+
+Counter::ptr MetricsRegistry::GetCounter(const std::string& name, const std::string& description)
+{
+    return GetOrCreate<Counter>(Metric::COUNTER, name, description);
+}
+
+Gauge::ptr MetricsRegistry::GetGauge(const std::string& name, const std::string& description)
+{
+    return GetOrCreate<Gauge>(Metric::GAUGE, name, description);
+}
+
+Histogram::ptr MetricsRegistry::GetHistogram(const std::string& name, const std::string& description
+                                             ,uint32_t precision, uint32_t max_bits)
+{
+    return GetOrCreate<Histogram>(Metric::HISTOGRAM, name, description, precision, max_bits);
+}
+
+std::vector<Metric::ptr> MetricsRegistry::List()
+{
+    std::vector<Metric::ptr> rt;
+    RWMutexType::ReadLock lock(GetMutex());
+    for(auto& i : GetDatas()){
+        rt.push_back(i.second);
+    }
+    return rt;
+}
+
+void MetricsRegistry::ResetAll()
+{
+    for(auto& i : List()){
+        i->reset();
+    }
+}
+
+static YAML::Node MetricToYaml(Metric::ptr m)
+{
+    YAML::Node node;
+    switch(m->getType()){
+        case Metric::COUNTER:
+            node = std::static_pointer_cast<Counter>(m)->getValue();
+            break;
+        case Metric::GAUGE:
+            node = std::static_pointer_cast<Gauge>(m)->getValue();
+            break;
+        case Metric::HISTOGRAM:{
+            Histogram::Snapshot snap = std::static_pointer_cast<Histogram>(m)->snapshot();
+            node["count"] = snap.count;
+            node["sum"] = snap.sum;
+            node["min"] = snap.min;
+            node["max"] = snap.max;
+            node["mean"] = snap.mean();
+            node["p50"] = snap.percentile(0.5);
+            node["p90"] = snap.percentile(0.9);
+            node["p99"] = snap.percentile(0.99);
+            node["p999"] = snap.percentile(0.999);
+            break;
+        }
+    }
+    return node;
+}
+
+std::string MetricsRegistry::ToYamlString()
+{
+    YAML::Node root(YAML::NodeType::Map);
+    for(auto& m : List()){
+        const std::string& name = m->getName();
+        YAML::Node value = MetricToYaml(m);
+        // 逐层进入子节点; 某一层已经是标量(如同时有 a.b 和 a.b.c)时退回用完整名称作为键
+        YAML::Node cur = root;
+        size_t begin = 0;
+        bool conflict = false;
+        while(true){
+            size_t dot = name.find('.', begin);
+            if(dot == std::string::npos){
+                break;
+            }
+            YAML::Node next = cur[name.substr(begin, dot - begin)];
+            if(next.IsDefined() && !next.IsMap()){
+                conflict = true;
+                break;
+            }
+            // yaml-cpp的Node赋值会修改被引用的节点, 换引用要用reset
+            cur.reset(next);
+            begin = dot + 1;
+        }
+        if(conflict){
+            root[name] = value;
+        }
+        else{
+            cur[name.substr(begin)] = value;
+        }
+    }
+    YAML::Emitter emitter;
+    emitter << root;
+    return emitter.c_str();
+}
+
+std::string MetricsRegistry::ToText()
+{
+    std::stringstream ss;
+    for(auto& m : List()){
+        m->dump(ss);
+    }
+    return ss.str();
+}
+
+}
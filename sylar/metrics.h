@@ -0,0 +1,220 @@
+#ifndef __SYLAR_METRICS_H__
+#define __SYLAR_METRICS_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <ostream>
+#include <stdint.h>
+#include "mutex.h"
+#include "macro.h"
+
+namespace sylar{
+
+// 服务内部的计数器、瞬时值和延迟分布
+// 写入按线程分片: 每个线程第一次写入时分到一个分片号, 之后只修改自己分片上的原子变量(relaxed),
+// 各分片在不同的缓存行, 多核同时写入时不会争抢同一个缓存行; 读取时把所有分片加起来
+// 分片数是不小于CPU数的2的幂(最多256), 线程数超过分片数时多个线程共用一个分片, 结果仍然正确
+// 不按CPU分片: 协程和线程都可能在CPU之间迁移, 每次写入取CPU号(sched_getcpu)比读线程局部变量慢
+class Metric{
+public:
+    typedef std::shared_ptr<Metric> ptr;
+    enum Type{
+        COUNTER,
+        GAUGE,
+        HISTOGRAM
+    };
+
+    Metric(const std::string& name, const std::string& description, Type type);
+    virtual ~Metric() {}
+
+    const std::string& getName() const { return m_name;}
+    const std::string& getDescription() const { return m_description;}
+    Type getType() const { return m_type;}
+
+    virtual void reset() = 0;
+    // 文本格式, 每个值一行 "名称 值"
+    virtual std::ostream& dump(std::ostream& os) const = 0;
+
+    static const char* TypeToString(Type type);
+    // 分片数, 进程内固定
+    static uint32_t GetShardCount();
+protected:
+    // 当前线程的分片号, 没有按分片数取模
+    static uint32_t GetShard(){
+        uint32_t s = t_shard;
+        if(SYLAR_UNLIKELY(s == (uint32_t)-1)){
+            s = AssignShard();
+        }
+        return s;
+    }
+private:
+    static uint32_t AssignShard();
+protected:
+    std::string m_name;
+    std::string m_description;
+    Type m_type;
+private:
+    static thread_local uint32_t t_shard;
+};
+
+// 一个缓存行一个值, 用填充而不是alignas(C++11的new不保证超过16字节的对齐),
+// 值都在各自分片的开头, 分片间隔64字节, 无论数组起始地址如何对齐, 两个值都不会落在同一个缓存行
+struct MetricCell{
+    std::atomic<int64_t> value;
+    char pad[64 - sizeof(std::atomic<int64_t>)];
+};
+
+// 单调递增的计数
+class Counter : public Metric{
+public:
+    typedef std::shared_ptr<Counter> ptr;
+
+    Counter(const std::string& name, const std::string& description = "");
+    ~Counter();
+
+    void inc(uint64_t v = 1){
+        m_cells[GetShard() & m_mask].value.fetch_add(v, std::memory_order_relaxed);
+    }
+    uint64_t getValue() const;
+
+    void reset() override;
+    std::ostream& dump(std::ostream& os) const override;
+private:
+    MetricCell* m_cells;
+    uint32_t m_mask;
+};
+
+// 可增可减的瞬时值, 如当前连接数
+class Gauge : public Metric{
+public:
+    typedef std::shared_ptr<Gauge> ptr;
+
+    Gauge(const std::string& name, const std::string& description = "");
+    ~Gauge();
+
+    void add(int64_t v){
+        m_cells[GetShard() & m_mask].value.fetch_add(v, std::memory_order_relaxed);
+    }
+    void sub(int64_t v) { add(-v);}
+    void inc() { add(1);}
+    void dec() { add(-1);}
+    // 和add同时进行时, 结果取决于两者的先后
+    void set(int64_t v);
+    int64_t getValue() const;
+
+    void reset() override;
+    std::ostream& dump(std::ostream& os) const override;
+private:
+    int64_t sum() const;
+private:
+    MetricCell* m_cells;
+    uint32_t m_mask;
+    std::atomic<int64_t> m_base;
+};
+
+// 对数线性分桶的直方图(类似HdrHistogram), 用于延迟等跨越多个数量级的值
+// 每个2的幂区间 [2^k, 2^(k+1)) 均分成 2^precision 个桶, 小于 2^(precision+1) 的值每个值一个桶,
+// 所以桶宽度和桶下界之比不超过 2^-precision, 分位数的相对误差不超过 2^-(precision+1)(取桶中点)
+// 不小于 2^max_bits 的值计入最后一个桶, min/max/sum仍然精确
+// 每个分片的桶数组在这个分片第一次写入时才分配, 线程少时不占用所有分片的内存
+class Histogram : public Metric{
+public:
+    typedef std::shared_ptr<Histogram> ptr;
+
+    // 汇总所有分片得到的结果
+    struct Snapshot{
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t min = 0;
+        uint64_t max = 0;
+        uint32_t precision = 0;
+        std::vector<uint64_t> buckets;
+
+        double mean() const { return count ? (double)sum / count : 0;}
+        // q取[0, 1], 没有数据时返回0
+        uint64_t percentile(double q) const;
+    };
+
+    // precision 取[1, 10], max_bits 取[precision + 1, 64]
+    Histogram(const std::string& name, const std::string& description = ""
+              ,uint32_t precision = 5, uint32_t max_bits = 40);
+    ~Histogram();
+
+    void record(uint64_t v);
+
+    Snapshot snapshot() const;
+    uint64_t getCount() const;
+
+    uint32_t getPrecision() const { return m_precision;}
+    uint32_t getMaxBits() const { return m_maxBits;}
+    size_t getBucketCount() const { return m_bucketCount;}
+
+    void reset() override;
+    std::ostream& dump(std::ostream& os) const override;
+
+    static uint32_t BucketIndex(uint64_t v, uint32_t precision){
+        if(v < (2ull << precision)){
+            return v;
+        }
+        uint32_t shift = 63 - __builtin_clzll(v) - precision;
+        return (shift << precision) + (uint32_t)(v >> shift);
+    }
+    // 桶的最小值和宽度
+    static uint64_t BucketLower(uint32_t idx, uint32_t precision);
+    static uint64_t BucketWidth(uint32_t idx, uint32_t precision);
+private:
+    struct Shard;
+    Shard* getShard();
+private:
+    uint32_t m_precision;
+    uint32_t m_maxBits;
+    uint32_t m_bucketCount;
+    uint32_t m_mask;
+    std::atomic<Shard*>* m_shards;
+};
+
+// 指标注册表, 名称规则和Config相同: 小写字母、数字、'.'和'_', 用'.'分层, 如 http.server.requests
+// 同名指标只创建一次, 之后返回已有的; 类型不同时返回nullptr
+class MetricsRegistry{
+public:
+    typedef std::map<std::string, Metric::ptr> MetricMap;
+    typedef RWMutex RWMutexType;
+
+    // 名称不合法时抛出 std::invalid_argument
+    static Counter::ptr GetCounter(const std::string& name, const std::string& description = "");
+    static Gauge::ptr GetGauge(const std::string& name, const std::string& description = "");
+    static Histogram::ptr GetHistogram(const std::string& name, const std::string& description = ""
+                                       ,uint32_t precision = 5, uint32_t max_bits = 40);
+
+    static Metric::ptr Lookup(const std::string& name);
+    // 按名称排序
+    static std::vector<Metric::ptr> List();
+    static void ResetAll();
+
+    // 按'.'分层的YAML, 和配置文件的结构一致; 直方图输出 count/sum/min/max/mean/p50/p90/p99/p999
+    static std::string ToYamlString();
+    // 每个值一行 "名称 值"
+    static std::string ToText();
+private:
+    static Metric::ptr Register(Metric::ptr m);
+    static void CheckName(const std::string& name);
+    template<class T, class... Args>
+    static std::shared_ptr<T> GetOrCreate(Metric::Type type, const std::string& name, Args&&... args);
+
+    static MetricMap& GetDatas(){
+        static MetricMap s_datas;
+        return s_datas;
+    }
+
+    static RWMutexType& GetMutex(){
+        static RWMutexType s_mutex;
+        return s_mutex;
+    }
+};
+
+}
+
+#endif
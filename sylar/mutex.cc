@@ -0,0 +1,46 @@
+#include "mutex.h"
+#include <stdexcept>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace sylar{
+
+void LockFail(const char* func, int rt)
+{
+    // 不经过日志模块, 日志器本身也用这些锁
+    fprintf(stderr, "%s fail rt=%d %s\n", func, rt, strerror(rt));
+    abort();
+}
+
+Semaphore::Semaphore(uint32_t count)
+{
+    if(sem_init(&m_semaphore, 0, count)){
+        throw std::logic_error("sem_init error");
+    }
+}
+
+Semaphore::~Semaphore()
+{
+    sem_destroy(&m_semaphore);
+}
+
+void Semaphore::wait()
+{
+    // 被信号中断时继续等待
+    while(sem_wait(&m_semaphore)){
+        if(errno != EINTR){
+            throw std::logic_error("sem_wait error");
+        }
+    }
+}
+
+void Semaphore::notify()
+{
+    if(sem_post(&m_semaphore)){
+        throw std::logic_error("sem_post error");
+    }
+}
+
+}
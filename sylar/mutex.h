@@ -0,0 +1,247 @@
+#ifndef __SYLAR_MUTEX_H__
+#define __SYLAR_MUTEX_H__
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
+#include <atomic>
+#include "noncopyable.h"
+
+namespace sylar{
+
+// pthread锁函数返回错误(如持有写锁的线程再加读锁得到EDEADLK)时锁的状态已不可信, 输出错误后abort
+[[noreturn]] void LockFail(const char* func, int rt);
+
+static inline void CheckLock(const char* func, int rt){
+    if(__builtin_expect(rt != 0, 0)){
+        LockFail(func, rt);
+    }
+}
+
+// 信号量
+class Semaphore : Noncopyable{
+public:
+    Semaphore(uint32_t count = 0);
+    ~Semaphore();
+
+    void wait();
+    void notify();
+private:
+    sem_t m_semaphore;
+};
+
+// 互斥锁的RAII封装, 构造时加锁, 析构时解锁
+template<class T>
+struct ScopedLockImpl{
+public:
+    ScopedLockImpl(T& mutex)
+        :m_mutex(mutex){
+        m_mutex.lock();
+        m_locked = true;
+    }
+
+    ~ScopedLockImpl(){
+        unlock();
+    }
+
+    void lock(){
+        if(!m_locked){
+            m_mutex.lock();
+            m_locked = true;
+        }
+    }
+
+    void unlock(){
+        if(m_locked){
+            m_mutex.unlock();
+            m_locked = false;
+        }
+    }
+private:
+    T& m_mutex;
+    bool m_locked;
+};
+
+// 读锁的RAII封装, 构造时加锁, 析构时解锁
+template<class T>
+struct ReadScopedLockImpl{
+public:
+    ReadScopedLockImpl(T& mutex)
+        :m_mutex(mutex){
+        m_mutex.rdlock();
+        m_locked = true;
+    }
+
+    ~ReadScopedLockImpl(){
+        unlock();
+    }
+
+    void lock(){
+        if(!m_locked){
+            m_mutex.rdlock();
+            m_locked = true;
+        }
+    }
+
+    void unlock(){
+        if(m_locked){
+            m_mutex.unlock();
+            m_locked = false;
+        }
+    }
+private:
+    T& m_mutex;
+    bool m_locked;
+};
+
+// 写锁的RAII封装
+template<class T>
+struct WriteScopedLockImpl{
+public:
+    WriteScopedLockImpl(T& mutex)
+        :m_mutex(mutex){
+        m_mutex.wrlock();
+        m_locked = true;
+    }
+
+    ~WriteScopedLockImpl(){
+        unlock();
+    }
+
+    void lock(){
+        if(!m_locked){
+            m_mutex.wrlock();
+            m_locked = true;
+        }
+    }
+
+    void unlock(){
+        if(m_locked){
+            m_mutex.unlock();
+            m_locked = false;
+        }
+    }
+private:
+    T& m_mutex;
+    bool m_locked;
+};
+
+// 互斥锁
+class Mutex : Noncopyable{
+public:
+    typedef ScopedLockImpl<Mutex> Lock;
+
+    Mutex(){
+        CheckLock("pthread_mutex_init", pthread_mutex_init(&m_mutex, nullptr));
+    }
+
+    ~Mutex(){
+        pthread_mutex_destroy(&m_mutex);
+    }
+
+    void lock(){
+        CheckLock("pthread_mutex_lock", pthread_mutex_lock(&m_mutex));
+    }
+
+    void unlock(){
+        CheckLock("pthread_mutex_unlock", pthread_mutex_unlock(&m_mutex));
+    }
+private:
+    pthread_mutex_t m_mutex;
+};
+
+// 空锁, 用于不需要加锁的场景, 和Mutex接口一致, 可作为模板参数替换
+class NullMutex : Noncopyable{
+public:
+    typedef ScopedLockImpl<NullMutex> Lock;
+    void lock() {}
+    void unlock() {}
+};
+
+// 读写锁
+class RWMutex : Noncopyable{
+public:
+    typedef ReadScopedLockImpl<RWMutex> ReadLock;
+    typedef WriteScopedLockImpl<RWMutex> WriteLock;
+
+    RWMutex(){
+        CheckLock("pthread_rwlock_init", pthread_rwlock_init(&m_lock, nullptr));
+    }
+
+    ~RWMutex(){
+        pthread_rwlock_destroy(&m_lock);
+    }
+
+    void rdlock(){
+        CheckLock("pthread_rwlock_rdlock", pthread_rwlock_rdlock(&m_lock));
+    }
+
+    void wrlock(){
+        CheckLock("pthread_rwlock_wrlock", pthread_rwlock_wrlock(&m_lock));
+    }
+
+    void unlock(){
+        CheckLock("pthread_rwlock_unlock", pthread_rwlock_unlock(&m_lock));
+    }
+private:
+    pthread_rwlock_t m_lock;
+};
+
+// 空读写锁
+class NullRWMutex : Noncopyable{
+public:
+    typedef ReadScopedLockImpl<NullRWMutex> ReadLock;
+    typedef WriteScopedLockImpl<NullRWMutex> WriteLock;
+    void rdlock() {}
+    void wrlock() {}
+    void unlock() {}
+};
+
+// 自旋锁, 临界区很短时代替Mutex, 避免线程切换
+class Spinlock : Noncopyable{
+public:
+    typedef ScopedLockImpl<Spinlock> Lock;
+
+    Spinlock(){
+        CheckLock("pthread_spin_init", pthread_spin_init(&m_mutex, 0));
+    }
+
+    ~Spinlock(){
+        pthread_spin_destroy(&m_mutex);
+    }
+
+    void lock(){
+        CheckLock("pthread_spin_lock", pthread_spin_lock(&m_mutex));
+    }
+
+    void unlock(){
+        CheckLock("pthread_spin_unlock", pthread_spin_unlock(&m_mutex));
+    }
+private:
+    pthread_spinlock_t m_mutex;
+};
+
+// 原子操作实现的锁
+class CASLock : Noncopyable{
+public:
+    typedef ScopedLockImpl<CASLock> Lock;
+
+    CASLock(){
+        m_mutex.clear();
+    }
+
+    void lock(){
+        while(std::atomic_flag_test_and_set_explicit(&m_mutex, std::memory_order_acquire)){
+        }
+    }
+
+    void unlock(){
+        std::atomic_flag_clear_explicit(&m_mutex, std::memory_order_release);
+    }
+private:
+    volatile std::atomic_flag m_mutex;
+};
+
+}
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef __SYLAR_NONCOPYABLE_H__
+#define __SYLAR_NONCOPYABLE_H__
+
+namespace sylar{
+
+// 继承该类的对象禁止拷贝和赋值
+class Noncopyable{
+public:
+    Noncopyable() = default;
+    ~Noncopyable() = default;
+    Noncopyable(const Noncopyable&) = delete;
+    Noncopyable& operator=(const Noncopyable&) = delete;
+};
+
+}
+
+#endif
@@ -0,0 +1,304 @@
+#include "profiler.h"
+#include "backtrace.h"
+#include "config.h"
+#include "thread.h"
+#include "mutex.h"
+#include "util.h"
+#include "log.h"
+#include <atomic>
+#include <algorithm>
+#include <map>
+#include <exception>
+#include <vector>
+#include <execinfo.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace sylar{
+
+static Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+static Logger::ptr g_profiler_logger = SYLAR_LOG_NAME("profiler");
+
+static ConfigVar<bool>::ptr g_profiler_enabled =
+    Config::Lookup<bool>("profiler.enabled", false, "sample call stacks on SIGPROF");
+static ConfigVar<uint32_t>::ptr g_profiler_hz =
+    Config::Lookup<uint32_t>("profiler.hz", 100, "samples per cpu second of the whole process, 1-4000");
+static ConfigVar<uint32_t>::ptr g_profiler_flush_interval =
+    Config::Lookup<uint32_t>("profiler.flush_interval", 10000, "ms between folded stack outputs");
+
+// 缓冲区的样本数, 需要是2的幂; 后台线程每100ms取一次, 1000hz下可容纳上百个满载的CPU
+static const uint32_t RING_SIZE = 1024;
+static const uint32_t DRAIN_INTERVAL_MS = 100;
+
+enum SampleState{
+    SAMPLE_FREE = 0,
+    SAMPLE_WRITING = 1,
+    SAMPLE_READY = 2
+};
+
+struct ProfileSample{
+    std::atomic<uint32_t> state;
+    uint32_t depth;
+    void* frames[Backtrace::MAX_FRAMES];     // [0]是被打断的指令, 之后是各层返回地址
+};
+
+// 第一次开启时分配, 之后不释放, 停止后可能还有在途的信号
+static ProfileSample* s_ring = nullptr;
+static std::atomic<uint32_t> s_write {0};
+static std::atomic<bool> s_sampling {false};
+static std::atomic<uint64_t> s_samples {0};
+static std::atomic<uint64_t> s_dropped {0};
+static std::atomic<uint32_t> s_hz {100};
+static std::atomic<uint32_t> s_flush_interval {10000};
+
+// 已取出未输出的样本, 按调用栈计数
+typedef std::map<std::vector<void*>, uint64_t> StackCounts;
+static Mutex s_stacks_mutex;
+static StackCounts s_stacks;
+
+// 开关和后台线程
+static Mutex s_control_mutex;
+static Thread::ptr s_thread;
+static std::atomic<bool> s_stopping {false};
+
+static void* GetSignalPc(void* ctx)
+{
+    ucontext_t* uc = (ucontext_t*)ctx;
+#if defined(__x86_64__)
+    return (void*)uc->uc_mcontext.gregs[REG_RIP];
+#elif defined(__aarch64__)
+    return (void*)uc->uc_mcontext.pc;
+#else
+    return nullptr;
+#endif
+}
+
+// 只做异步信号安全的操作: 原子变量, 栈上缓冲区, backtrace(已由Backtrace预加载libgcc_s)
+static void OnSigprof(int sig, siginfo_t* info, void* ctx)
+{
+    if(!s_sampling.load(std::memory_order_acquire)){
+        return;
+    }
+    // 线程正在抛出异常或获取调用栈时, 被打断的libgcc展开代码可能持有其内部的锁(object_mutex),
+    // 在信号处理函数里再展开会自锁, 放弃这次采样
+    if(std::uncaught_exception() || Backtrace::IsCapturing()){
+        s_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    int saved_errno = errno;
+    ProfileSample& sample = s_ring[s_write.fetch_add(1, std::memory_order_relaxed) & (RING_SIZE - 1)];
+    uint32_t expected = SAMPLE_FREE;
+    if(!sample.state.compare_exchange_strong(expected, SAMPLE_WRITING, std::memory_order_acquire)){
+        s_dropped.fetch_add(1, std::memory_order_relaxed);
+        errno = saved_errno;
+        return;
+    }
+    // 最前面是本函数和内核插入的信号返回帧, 从被打断的指令开始保存
+    void* buf[Backtrace::MAX_FRAMES + 4];
+    int n = ::backtrace(buf, Backtrace::MAX_FRAMES + 4);
+    void* pc = GetSignalPc(ctx);
+    int begin = std::min(n, 2);
+    for(int i = 0; i < std::min(n, 4); ++i){
+        if(buf[i] == pc){
+            begin = i;
+            break;
+        }
+    }
+    sample.depth = std::min(n - begin, (int)Backtrace::MAX_FRAMES);
+    memcpy(sample.frames, buf + begin, sample.depth * sizeof(void*));
+    sample.state.store(SAMPLE_READY, std::memory_order_release);
+    s_samples.fetch_add(1, std::memory_order_relaxed);
+    errno = saved_errno;
+}
+
+// 调用时持有s_stacks_mutex
+static void Drain()
+{
+    if(!s_ring){
+        return;
+    }
+    for(uint32_t i = 0; i < RING_SIZE; ++i){
+        ProfileSample& sample = s_ring[i];
+        if(sample.state.load(std::memory_order_acquire) != SAMPLE_READY){
+            continue;
+        }
+        std::vector<void*> frames(sample.frames, sample.frames + sample.depth);
+        sample.state.store(SAMPLE_FREE, std::memory_order_release);
+        ++s_stacks[frames];
+    }
+}
+
+static void SetTimer(uint32_t hz)
+{
+    struct itimerval tv;
+    memset(&tv, 0, sizeof(tv));
+    if(hz){
+        uint64_t us = 1000000 / hz;
+        tv.it_interval.tv_sec = us / 1000000;
+        tv.it_interval.tv_usec = us % 1000000;
+        tv.it_value = tv.it_interval;
+    }
+    if(setitimer(ITIMER_PROF, &tv, nullptr)){
+        SYLAR_LOG_ERROR(g_logger) << "setitimer(ITIMER_PROF, " << hz << "hz) fail errno="
+            << errno << " errstr=" << strerror(errno);
+    }
+}
+
+static void Run()
+{
+    uint64_t last = GetMonotonicMS();
+    while(!s_stopping.load(std::memory_order_relaxed)){
+        usleep(DRAIN_INTERVAL_MS * 1000);
+        {
+            Mutex::Lock lock(s_stacks_mutex);
+            Drain();
+        }
+        uint64_t now = GetMonotonicMS();
+        if(now - last >= s_flush_interval){
+            Profiler::Flush();
+            last = now;
+        }
+    }
+}
+
+static void Start()
+{
+    Mutex::Lock lock(s_control_mutex);
+    if(s_thread){
+        return;
+    }
+    if(!s_ring){
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = &OnSigprof;
+        sa.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        if(sigaction(SIGPROF, &sa, nullptr)){
+            SYLAR_LOG_ERROR(g_logger) << "sigaction(SIGPROF) fail errno=" << errno
+                << " errstr=" << strerror(errno);
+            return;
+        }
+        // 处理函数先检查s_sampling, 缓冲区在开始采样前分配即可
+        s_ring = new ProfileSample[RING_SIZE]();
+    }
+    s_stopping = false;
+    s_thread.reset(new Thread(&Run, "profiler"));
+    s_sampling.store(true, std::memory_order_release);
+    SetTimer(s_hz);
+    SYLAR_LOG_INFO(g_logger) << "profiler start hz=" << s_hz;
+}
+
+static void Stop()
+{
+    Mutex::Lock lock(s_control_mutex);
+    if(!s_thread){
+        return;
+    }
+    SetTimer(0);
+    s_sampling = false;
+    s_stopping = true;
+    s_thread->join();
+    s_thread.reset();
+    // 输出剩余的样本
+    Profiler::Flush();
+    SYLAR_LOG_INFO(g_logger) << "profiler stop samples=" << s_samples
+        << " dropped=" << s_dropped;
+}
+
+static uint32_t ClampHz(uint32_t hz)
+{
+    return std::max(1u, std::min(hz, 4000u));
+}
+
+struct ProfilerIniter{
+    ProfilerIniter(){
+        s_hz = ClampHz(g_profiler_hz->getValue());
+        s_flush_interval = g_profiler_flush_interval->getValue();
+        g_profiler_enabled->addListener(0x9F0001, [](const bool& old_value, const bool& new_value){
+            if(new_value){
+                Start();
+            }
+            else{
+                Stop();
+            }
+        });
+        g_profiler_hz->addListener(0x9F0002, [](const uint32_t& old_value, const uint32_t& new_value){
+            Mutex::Lock lock(s_control_mutex);
+            s_hz = ClampHz(new_value);
+            if(s_sampling){
+                SetTimer(s_hz);
+            }
+        });
+        g_profiler_flush_interval->addListener(0x9F0003, [](const uint32_t& old_value, const uint32_t& new_value){
+            s_flush_interval = new_value;
+        });
+        if(g_profiler_enabled->getValue()){
+            Start();
+        }
+    }
+
+    // 退出时停止采样并输出最后一段
+    ~ProfilerIniter(){
+        Stop();
+    }
+};
+
+bool Profiler::IsEnabled()
+{
+    return s_sampling.load(std::memory_order_relaxed);
+}
+
+void Profiler::SetEnabled(bool v)
+{
+    // 由监听器启动或停止
+    g_profiler_enabled->setValue(v);
+}
+
+size_t Profiler::Flush()
+{
+    StackCounts stacks;
+    {
+        Mutex::Lock lock(s_stacks_mutex);
+        Drain();
+        stacks.swap(s_stacks);
+    }
+    // 同一函数内不同位置的样本合并为一行
+    std::map<std::string, uint64_t> folded;
+    size_t total = 0;
+    for(auto& i : stacks){
+        const std::vector<void*>& frames = i.first;
+        std::string line;
+        for(size_t j = frames.size(); j > 0; --j){
+            // 除被打断的指令外都是返回地址, 减1落回call指令, 避免函数末尾的调用算到下一个函数
+            void* addr = j == 1 ? frames[0] : (void*)((char*)frames[j - 1] - 1);
+            if(!line.empty()){
+                line += ';';
+            }
+            line += Backtrace::SymbolName(addr);
+        }
+        folded[line.empty() ? "[unknown]" : line] += i.second;
+        total += i.second;
+    }
+    for(auto& i : folded){
+        SYLAR_LOG_INFO(g_profiler_logger) << i.first << " " << i.second;
+    }
+    return total;
+}
+
+uint64_t Profiler::GetSampleCount()
+{
+    return s_samples.load(std::memory_order_relaxed);
+}
+
+uint64_t Profiler::GetDroppedCount()
+{
+    return s_dropped.load(std::memory_order_relaxed);
+}
+
+static ProfilerIniter __profiler_init;
+
+}
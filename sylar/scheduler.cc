@@ -0,0 +1,555 @@
+#include "scheduler.h"
+#include "work_stealing_queue.h"
+#include "config.h"
+#include "macro.h"
+#include "log.h"
+#include "hook.h"
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace sylar{
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+static ConfigVar<uint32_t>::ptr g_scheduler_threads =
+    Config::Lookup<uint32_t>("scheduler.threads", 0, "scheduler worker threads, 0 means cpu cores");
+static ConfigVar<uint32_t>::ptr g_scheduler_idle_spin =
+    Config::Lookup<uint32_t>("scheduler.idle_spin", 100, "idle spins before a worker sleeps on futex");
+
+static thread_local Scheduler* t_scheduler = nullptr;
+static thread_local Fiber* t_scheduler_fiber = nullptr;
+
+// switchTo要求协程切出之后才能提交到目标线程, 由调度循环在swapIn返回后处理
+static thread_local Scheduler* t_switch_to = nullptr;
+static thread_local int t_switch_thread = -1;
+
+static void FutexWait(std::atomic<uint32_t>* addr, uint32_t val){
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT_PRIVATE, val, nullptr, nullptr, 0);
+}
+
+static void FutexWake(std::atomic<uint32_t>* addr, int n){
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+}
+
+struct Scheduler::Worker{
+    Worker(size_t i)
+        :idx(i)
+        ,seed(i * 2654435761u + 1){
+    }
+
+    size_t idx;
+    // 线程id, start()和线程自己都会写入, 其它线程投递任务时读取
+    std::atomic<int> thread {-1};
+    uint32_t seed;
+    // 只有本线程push/pop, 其它线程steal
+    WorkStealingQueue<Task*> queue;
+    // 指定到本线程的任务, 其它线程也会写入, 用锁保护
+    MutexType mutex;
+    std::list<Task*> pinned;
+    std::atomic<size_t> pinnedCount {0};
+    // 1 表示正在(或即将)futex睡眠, 唤醒方把它置0后调用FUTEX_WAKE
+    std::atomic<uint32_t> sleeping {0};
+};
+
+static thread_local Scheduler::Worker* t_worker = nullptr;
+
+Scheduler::Scheduler(size_t threads, bool use_caller, const std::string& name)
+    :m_name(name){
+    if(threads == 0){
+        threads = g_scheduler_threads->getValue();
+    }
+    if(threads == 0){
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    SYLAR_ASSERT(threads > 0);
+    m_spinCount = g_scheduler_idle_spin->getValue();
+
+    for(size_t i = 0; i < threads; ++i){
+        m_workers.push_back(new Worker(i));
+    }
+
+    if(use_caller){
+        sylar::Fiber::GetThis();
+        --threads;
+
+        SYLAR_ASSERT(GetThis() == nullptr);
+        t_scheduler = this;
+
+        m_rootFiber.reset(new Fiber(std::bind(&Scheduler::run, this, 0), 0, true));
+        sylar::Thread::SetName(m_name);
+
+        t_scheduler_fiber = m_rootFiber.get();
+        m_rootThread = sylar::GetThreadID();
+        m_workers[0]->thread.store(m_rootThread, std::memory_order_relaxed);
+        m_threadIds.push_back(m_rootThread);
+    }
+    else{
+        m_rootThread = -1;
+    }
+    m_threadCount = threads;
+}
+
+Scheduler::~Scheduler()
+{
+    SYLAR_ASSERT(m_stopping);
+    if(GetThis() == this){
+        t_scheduler = nullptr;
+    }
+    for(auto w : m_workers){
+        Task* task = nullptr;
+        while(w->queue.pop(task)){
+            delete task;
+        }
+        for(auto i : w->pinned){
+            delete i;
+        }
+        delete w;
+    }
+    for(auto i : m_tasks){
+        delete i;
+    }
+}
+
+Scheduler* Scheduler::GetThis()
+{
+    return t_scheduler;
+}
+
+Fiber* Scheduler::GetMainFiber()
+{
+    return t_scheduler_fiber;
+}
+
+std::vector<int> Scheduler::getWorkerThreadIds() const
+{
+    size_t first = m_rootThread == -1 ? 0 : 1;
+    return std::vector<int>(m_threadIds.begin() + first, m_threadIds.end());
+}
+
+void Scheduler::start()
+{
+    MutexType::Lock lock(m_mutex);
+    if(!m_stopping){
+        return;
+    }
+    m_stopping = false;
+    SYLAR_ASSERT(m_threads.empty());
+
+    size_t first = m_rootThread == -1 ? 0 : 1;
+    m_threads.resize(m_threadCount);
+    for(size_t i = 0; i < m_threadCount; ++i){
+        m_threads[i].reset(new Thread(std::bind(&Scheduler::run, this, first + i)
+                            , m_name + "_" + std::to_string(i)));
+        m_workers[first + i]->thread.store(m_threads[i]->getId(), std::memory_order_relaxed);
+        m_threadIds.push_back(m_threads[i]->getId());
+    }
+}
+
+void Scheduler::stop()
+{
+    m_autoStop = true;
+    if(m_rootFiber
+            && m_threadCount == 0
+            && (m_rootFiber->getState() == Fiber::TERM
+                || m_rootFiber->getState() == Fiber::INIT)){
+        SYLAR_LOG_INFO(g_logger) << this << " stopped";
+        m_stopping = true;
+
+        if(stopping()){
+            return;
+        }
+    }
+
+    if(m_rootThread != -1){
+        SYLAR_ASSERT(GetThis() == this);
+    }
+    else{
+        SYLAR_ASSERT(GetThis() != this);
+    }
+
+    m_stopping = true;
+    wakeAll();
+
+    if(m_rootFiber){
+        if(!stopping()){
+            m_rootFiber->call();
+        }
+    }
+
+    std::vector<Thread::ptr> thrs;
+    {
+        MutexType::Lock lock(m_mutex);
+        thrs.swap(m_threads);
+    }
+
+    for(auto& i : thrs){
+        i->join();
+    }
+}
+
+void Scheduler::setThis()
+{
+    t_scheduler = this;
+}
+
+Scheduler::Worker* Scheduler::findWorker(int thread)
+{
+    for(auto w : m_workers){
+        if(w->thread.load(std::memory_order_relaxed) == thread){
+            return w;
+        }
+    }
+    return nullptr;
+}
+
+void Scheduler::submit(Task* task)
+{
+    ++m_pendingCount;
+    if(task->thread != -1){
+        Worker* w = findWorker(task->thread);
+        if(w){
+            {
+                MutexType::Lock lock(w->mutex);
+                w->pinned.push_back(task);
+                ++w->pinnedCount;
+            }
+            tickleWorker(w->idx);
+            return;
+        }
+        // 目标线程还没有启动, 先放入全局队列, 被取出时再转交
+    }
+    else if(t_worker && t_scheduler == this){
+        // 工作线程内提交的任务压入自己的队列, 空闲线程会来窃取
+        t_worker->queue.push(task);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        tickle();
+        return;
+    }
+
+    {
+        MutexType::Lock lock(m_mutex);
+        m_tasks.push_back(task);
+        ++m_taskCount;
+    }
+    tickle();
+}
+
+Scheduler::Task* Scheduler::nextTask(Worker* w)
+{
+    Task* task = nullptr;
+    if(w->pinnedCount.load(std::memory_order_relaxed) > 0){
+        MutexType::Lock lock(w->mutex);
+        if(!w->pinned.empty()){
+            task = w->pinned.front();
+            w->pinned.pop_front();
+            --w->pinnedCount;
+            return task;
+        }
+    }
+
+    if(w->queue.pop(task)){
+        return task;
+    }
+
+    if(m_taskCount.load(std::memory_order_relaxed) > 0){
+        std::vector<Task*> redirect;
+        {
+            MutexType::Lock lock(m_mutex);
+            // 一次搬一批到自己的队列, 减少全局锁的争用, 搬走的任务可以被其它线程窃取
+            size_t batch = std::min<size_t>(m_tasks.size() / m_workers.size() + 1, 32);
+            auto it = m_tasks.begin();
+            while(it != m_tasks.end() && batch > 0){
+                Task* t = *it;
+                if(t->thread != -1 && t->thread != w->thread.load(std::memory_order_relaxed)){
+                    it = m_tasks.erase(it);
+                    --m_taskCount;
+                    if(findWorker(t->thread)){
+                        redirect.push_back(t);
+                        continue;
+                    }
+                    SYLAR_LOG_WARN(g_logger) << "schedule to unknown thread=" << t->thread
+                        << " run on any thread";
+                    t->thread = -1;
+                }
+                else{
+                    it = m_tasks.erase(it);
+                    --m_taskCount;
+                }
+                --batch;
+                if(!task){
+                    task = t;
+                }
+                else{
+                    w->queue.push(t);
+                }
+            }
+        }
+        for(auto t : redirect){
+            --m_pendingCount;
+            submit(t);
+        }
+        if(task){
+            return task;
+        }
+    }
+
+    size_t n = m_workers.size();
+    if(n > 1){
+        w->seed = w->seed * 1103515245 + 12345;
+        size_t start = (w->seed >> 16) % n;
+        for(size_t i = 0; i < n; ++i){
+            Worker* victim = m_workers[(start + i) % n];
+            if(victim != w && victim->queue.steal(task)){
+                return task;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void Scheduler::runTask(Task* task, Fiber::ptr& cb_fiber)
+{
+    Fiber::ptr fiber;
+    if(task->fiber){
+        fiber.swap(task->fiber);
+        delete task;
+        if(fiber->getState() == Fiber::TERM
+                || fiber->getState() == Fiber::EXCEPT){
+            return;
+        }
+    }
+    else if(task->cb){
+        if(cb_fiber){
+            cb_fiber->reset(task->cb);
+        }
+        else{
+            cb_fiber.reset(new Fiber(task->cb));
+        }
+        delete task;
+        fiber = cb_fiber;
+    }
+    else{
+        delete task;
+        return;
+    }
+
+    // 等待协程在其它线程上完成切出
+    while(fiber->m_running.exchange(true, std::memory_order_acquire)){
+        SYLAR_CPU_RELAX();
+    }
+    fiber->swapIn();
+    // 释放m_running之后协程可能立即被其它线程唤醒执行, 状态必须在此之前读取和修改
+    Fiber::State state = fiber->getState();
+    if(state != Fiber::READY && state != Fiber::TERM && state != Fiber::EXCEPT){
+        fiber->m_state = Fiber::HOLD;
+    }
+    fiber->m_running.store(false, std::memory_order_release);
+
+    if(state == Fiber::READY){
+        schedule(fiber);
+    }
+
+    if(fiber == cb_fiber){
+        if(state == Fiber::TERM || state == Fiber::EXCEPT){
+            // 留着复用栈, 释放回调持有的资源
+            cb_fiber->m_cb = nullptr;
+        }
+        else{
+            // 协程被挂起或重新调度, 不能再复用
+            cb_fiber.reset();
+        }
+    }
+
+    if(t_switch_to){
+        Scheduler* target = t_switch_to;
+        t_switch_to = nullptr;
+        target->schedule(fiber, t_switch_thread);
+    }
+}
+
+void Scheduler::run(size_t idx)
+{
+    SYLAR_LOG_DEBUG(g_logger) << m_name << " run worker=" << idx;
+    Worker* w = m_workers[idx];
+    // start()在Thread构造返回后才写入线程id, 调度循环开始前先自己写入
+    w->thread.store(sylar::GetThreadID(), std::memory_order_relaxed);
+    setThis();
+    t_worker = w;
+    // 工作线程上的阻塞调用转成协程切换, 退出时恢复(use_caller的线程还要继续执行原来的代码)
+    bool hook_enable = sylar::is_hook_enable();
+    sylar::set_hook_enable(true);
+    if(sylar::GetThreadID() != m_rootThread){
+        t_scheduler_fiber = Fiber::GetThis().get();
+    }
+
+    Fiber::ptr idle_fiber(new Fiber(std::bind(&Scheduler::idle, this)));
+    Fiber::ptr cb_fiber;
+
+    while(true){
+        Task* task = nextTask(w);
+        if(task){
+            // 先增加活跃数再减少待执行数, stopping()不会看到两者同时为0的中间状态
+            ++m_activeThreadCount;
+            --m_pendingCount;
+            runTask(task, cb_fiber);
+            --m_activeThreadCount;
+            if(SYLAR_UNLIKELY(m_stopping) && stopping()){
+                wakeAll();
+            }
+            continue;
+        }
+
+        if(idle_fiber->getState() == Fiber::TERM){
+            SYLAR_LOG_DEBUG(g_logger) << "idle fiber term";
+            break;
+        }
+
+        ++m_idleThreadCount;
+        idle_fiber->swapIn();
+        --m_idleThreadCount;
+        if(idle_fiber->getState() != Fiber::TERM
+                && idle_fiber->getState() != Fiber::EXCEPT){
+            idle_fiber->m_state = Fiber::HOLD;
+        }
+    }
+    t_worker = nullptr;
+    sylar::set_hook_enable(hook_enable);
+}
+
+bool Scheduler::hasTask(Worker* w)
+{
+    if(w->pinnedCount.load(std::memory_order_relaxed) > 0
+            || m_taskCount.load(std::memory_order_relaxed) > 0){
+        return true;
+    }
+    for(auto i : m_workers){
+        if(!i->queue.empty()){
+            return true;
+        }
+    }
+    return false;
+}
+
+int Scheduler::getWorkerIndex() const
+{
+    if(t_scheduler != this || !t_worker){
+        return -1;
+    }
+    return t_worker->idx;
+}
+
+bool Scheduler::hasWorkerTask(size_t idx)
+{
+    return hasTask(m_workers[idx]);
+}
+
+void Scheduler::park(Worker* w)
+{
+    for(uint32_t i = 0; i < m_spinCount; ++i){
+        if(hasTask(w) || stopping()){
+            return;
+        }
+        SYLAR_CPU_RELAX();
+    }
+
+    // 先声明要睡眠再检查任务, 和提交方的"先入队再检查睡眠者"配对, 不会丢失唤醒
+    w->sleeping.store(1);
+    ++m_sleepingCount;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(!hasTask(w) && !stopping()){
+        FutexWait(&w->sleeping, 1);
+    }
+
+    // 被唤醒时唤醒方已经撤销了睡眠标记, 否则(检查到任务或伪唤醒)由自己撤销
+    uint32_t expect = 1;
+    if(w->sleeping.compare_exchange_strong(expect, 0)){
+        --m_sleepingCount;
+    }
+}
+
+void Scheduler::tickle()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(m_sleepingCount.load(std::memory_order_relaxed) == 0){
+        return;
+    }
+    size_t n = m_workers.size();
+    size_t start = t_worker ? t_worker->idx + 1 : 0;
+    for(size_t i = 0; i < n; ++i){
+        Worker* w = m_workers[(start + i) % n];
+        uint32_t expect = 1;
+        if(w->sleeping.compare_exchange_strong(expect, 0)){
+            --m_sleepingCount;
+            FutexWake(&w->sleeping, 1);
+            return;
+        }
+    }
+}
+
+void Scheduler::tickleWorker(size_t idx)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    Worker* w = m_workers[idx];
+    uint32_t expect = 1;
+    if(w->sleeping.compare_exchange_strong(expect, 0)){
+        --m_sleepingCount;
+        FutexWake(&w->sleeping, 1);
+    }
+}
+
+void Scheduler::wakeAll()
+{
+    for(size_t i = 0; i < m_workers.size(); ++i){
+        tickleWorker(i);
+    }
+}
+
+bool Scheduler::stopping()
+{
+    return m_autoStop && m_stopping
+        && m_pendingCount == 0 && m_activeThreadCount == 0;
+}
+
+void Scheduler::idle()
+{
+    while(!stopping()){
+        park(t_worker);
+        sylar::Fiber::YieldToHold();
+    }
+}
+
+void Scheduler::switchTo(int thread)
+{
+    SYLAR_ASSERT(Scheduler::GetThis() != nullptr);
+    if(Scheduler::GetThis() == this){
+        if(thread == -1 || thread == sylar::GetThreadID()){
+            return;
+        }
+    }
+    t_switch_to = this;
+    t_switch_thread = thread;
+    Fiber::YieldToHold();
+}
+
+std::ostream& Scheduler::dump(std::ostream& os)
+{
+    os << "[Scheduler name=" << m_name
+       << " size=" << m_threadCount
+       << " workers=" << m_workers.size()
+       << " active_count=" << m_activeThreadCount
+       << " idle_count=" << m_idleThreadCount
+       << " sleeping_count=" << m_sleepingCount
+       << " pending=" << m_pendingCount
+       << " stopping=" << m_stopping
+       << " ]" << std::endl << "    ";
+    for(size_t i = 0; i < m_threadIds.size(); ++i){
+        if(i){
+            os << ", ";
+        }
+        os << m_threadIds[i];
+    }
+    return os;
+}
+
+}
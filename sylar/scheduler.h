@@ -0,0 +1,137 @@
+#ifndef __SYLAR_SCHEDULER_H__
+#define __SYLAR_SCHEDULER_H__
+
+#include <memory>
+#include <vector>
+#include <list>
+#include <atomic>
+#include <functional>
+#include <ostream>
+#include "fiber.h"
+#include "thread.h"
+#include "mutex.h"
+
+namespace sylar{
+
+// M:N 协程调度器
+// 每个工作线程有一个Chase-Lev工作窃取队列, 线程内提交的任务压入自己的队列, 空闲时从其它线程窃取
+// 外部线程提交的任务进入全局注入队列, 指定线程的任务进入目标线程的私有队列
+// 没有任务时先自旋一小段时间, 再用futex睡眠
+class Scheduler{
+public:
+    typedef std::shared_ptr<Scheduler> ptr;
+    typedef Mutex MutexType;
+    // 工作线程的私有状态, 定义在scheduler.cc
+    struct Worker;
+
+    // threads 线程数, 为0时使用配置 scheduler.threads, 配置也为0时使用CPU核数
+    // use_caller 为true时创建调度器的线程也作为工作线程之一(在stop时参与调度)
+    Scheduler(size_t threads = 1, bool use_caller = true, const std::string& name = "");
+    virtual ~Scheduler();
+
+    const std::string& getName() const { return m_name;}
+    // 工作线程数, 包含use_caller时的调用线程
+    size_t getWorkerCount() const { return m_workers.size();}
+    // 独立工作线程的id, 不含use_caller时的调用线程(它只在stop时参与调度), start之后有效
+    std::vector<int> getWorkerThreadIds() const;
+
+    // 当前线程所属的调度器
+    static Scheduler* GetThis();
+    // 当前线程的调度协程
+    static Fiber* GetMainFiber();
+
+    void start();
+    void stop();
+
+    // 调度协程或函数, thread 为目标线程id(GetThreadID()), -1表示任意线程
+    template<class FiberOrCb>
+    void schedule(FiberOrCb fc, int thread = -1){
+        submit(new Task(fc, thread));
+    }
+
+    template<class InputIterator>
+    void schedule(InputIterator begin, InputIterator end){
+        while(begin != end){
+            submit(new Task(&*begin, -1));
+            ++begin;
+        }
+    }
+
+    // 把当前协程切换到本调度器的thread线程上执行
+    void switchTo(int thread = -1);
+    std::ostream& dump(std::ostream& os);
+protected:
+    // 唤醒一个空闲线程
+    virtual void tickle();
+    // 唤醒指定的工作线程, 用于指定线程的任务和停止
+    virtual void tickleWorker(size_t idx);
+    // 工作线程的调度循环, idx为工作线程下标
+    void run(size_t idx);
+    virtual bool stopping();
+    // 没有任务时执行的协程
+    virtual void idle();
+
+    void setThis();
+
+    bool hasIdleThreads() { return m_idleThreadCount > 0;}
+    // 当前线程在本调度器中的工作线程下标, 不是本调度器的工作线程时返回-1
+    int getWorkerIndex() const;
+    // 下标为idx的工作线程是否有可以执行的任务: 指定给它的、全局队列中的和可以窃取的
+    bool hasWorkerTask(size_t idx);
+private:
+    // 待执行的任务, 协程或函数二选一
+    struct Task{
+        Fiber::ptr fiber;
+        std::function<void()> cb;
+        int thread;
+
+        Task(Fiber::ptr f, int thr)
+            :fiber(f), thread(thr){
+        }
+        Task(Fiber::ptr* f, int thr)
+            :thread(thr){
+            fiber.swap(*f);
+        }
+        Task(std::function<void()> f, int thr)
+            :cb(f), thread(thr){
+        }
+        Task(std::function<void()>* f, int thr)
+            :thread(thr){
+            cb.swap(*f);
+        }
+    };
+
+    void submit(Task* task);
+    Task* nextTask(Worker* w);
+    void runTask(Task* task, Fiber::ptr& cb_fiber);
+    Worker* findWorker(int thread);
+    bool hasTask(Worker* w);
+    // 自旋等待任务, 仍然没有则在futex上睡眠
+    void park(Worker* w);
+    void wakeAll();
+private:
+    MutexType m_mutex;
+    std::vector<Thread::ptr> m_threads;
+    std::vector<Worker*> m_workers;
+    // 全局注入队列
+    std::list<Task*> m_tasks;
+    std::atomic<size_t> m_taskCount {0};
+    Fiber::ptr m_rootFiber;
+    std::string m_name;
+    uint32_t m_spinCount = 0;
+protected:
+    std::vector<int> m_threadIds;
+    size_t m_threadCount = 0;
+    // 已提交但还没有被取走的任务数
+    std::atomic<size_t> m_pendingCount {0};
+    std::atomic<size_t> m_activeThreadCount {0};
+    std::atomic<size_t> m_idleThreadCount {0};
+    std::atomic<size_t> m_sleepingCount {0};
+    std::atomic<bool> m_stopping {true};
+    bool m_autoStop = false;
+    int m_rootThread = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,820 @@
+#include "socket.h"
+#include "fd_manager.h"
+#include "iomanager.h"
+#include "config.h"
+#include "hook.h"
+#include "macro.h"
+#include "log.h"
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <sstream>
+#include <string.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/sendfile.h>
+#include <linux/errqueue.h>
+
+namespace sylar{
+
+static Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+static ConfigVar<bool>::ptr g_tcp_nodelay =
+    Config::Lookup<bool>("tcp.socket.nodelay", true, "set TCP_NODELAY on new tcp sockets");
+static ConfigVar<int>::ptr g_tcp_send_buffer =
+    Config::Lookup<int>("tcp.socket.send_buffer", 0, "SO_SNDBUF of new sockets, 0 keeps the system default");
+static ConfigVar<int>::ptr g_tcp_recv_buffer =
+    Config::Lookup<int>("tcp.socket.recv_buffer", 0, "SO_RCVBUF of new sockets, 0 keeps the system default");
+static ConfigVar<int>::ptr g_tcp_send_timeout =
+    Config::Lookup<int>("tcp.socket.send_timeout", -1, "send timeout(ms) of new sockets, -1 never times out");
+static ConfigVar<int>::ptr g_tcp_recv_timeout =
+    Config::Lookup<int>("tcp.socket.recv_timeout", -1, "recv timeout(ms) of new sockets, -1 never times out");
+static ConfigVar<uint64_t>::ptr g_tcp_zerocopy_min_size =
+    Config::Lookup<uint64_t>("tcp.zerocopy.min_size", 16384, "smallest send that uses MSG_ZEROCOPY, pinning pages costs more than copying small buffers");
+
+// 每个新socket都要读取, 由监听器同步到原子变量
+static std::atomic<bool> s_nodelay {true};
+static std::atomic<int> s_send_buffer {0};
+static std::atomic<int> s_recv_buffer {0};
+static std::atomic<int> s_send_timeout {-1};
+static std::atomic<int> s_recv_timeout {-1};
+static std::atomic<uint64_t> s_zerocopy_min_size {16384};
+
+struct SocketIniter{
+    SocketIniter(){
+        s_nodelay = g_tcp_nodelay->getValue();
+        s_send_buffer = g_tcp_send_buffer->getValue();
+        s_recv_buffer = g_tcp_recv_buffer->getValue();
+        s_send_timeout = g_tcp_send_timeout->getValue();
+        s_recv_timeout = g_tcp_recv_timeout->getValue();
+        s_zerocopy_min_size = g_tcp_zerocopy_min_size->getValue();
+        g_tcp_nodelay->addListener(0x50C001, [](const bool& old_value, const bool& new_value){
+            s_nodelay = new_value;
+        });
+        g_tcp_send_buffer->addListener(0x50C002, [](const int& old_value, const int& new_value){
+            s_send_buffer = new_value;
+        });
+        g_tcp_recv_buffer->addListener(0x50C003, [](const int& old_value, const int& new_value){
+            s_recv_buffer = new_value;
+        });
+        g_tcp_send_timeout->addListener(0x50C004, [](const int& old_value, const int& new_value){
+            s_send_timeout = new_value;
+        });
+        g_tcp_recv_timeout->addListener(0x50C005, [](const int& old_value, const int& new_value){
+            s_recv_timeout = new_value;
+        });
+        g_tcp_zerocopy_min_size->addListener(0x50C006, [](const uint64_t& old_value, const uint64_t& new_value){
+            s_zerocopy_min_size = new_value;
+        });
+    }
+};
+
+static SocketIniter __socket_init;
+
+Socket::ptr Socket::CreateTCP(sylar::Address::ptr address)
+{
+    Socket::ptr sock(new Socket(address->getFamily(), TCP, 0));
+    return sock;
+}
+
+Socket::ptr Socket::CreateUDP(sylar::Address::ptr address)
+{
+    Socket::ptr sock(new Socket(address->getFamily(), UDP, 0));
+    sock->newSock();
+    sock->m_isConnected = true;
+    return sock;
+}
+
+Socket::ptr Socket::CreateTCPSocket()
+{
+    Socket::ptr sock(new Socket(IPv4, TCP, 0));
+    return sock;
+}
+
+Socket::ptr Socket::CreateUDPSocket()
+{
+    Socket::ptr sock(new Socket(IPv4, UDP, 0));
+    sock->newSock();
+    sock->m_isConnected = true;
+    return sock;
+}
+
+Socket::ptr Socket::CreateTCPSocket6()
+{
+    Socket::ptr sock(new Socket(IPv6, TCP, 0));
+    return sock;
+}
+
+Socket::ptr Socket::CreateUDPSocket6()
+{
+    Socket::ptr sock(new Socket(IPv6, UDP, 0));
+    sock->newSock();
+    sock->m_isConnected = true;
+    return sock;
+}
+
+Socket::ptr Socket::CreateUnixTCPSocket()
+{
+    Socket::ptr sock(new Socket(UNIX, TCP, 0));
+    return sock;
+}
+
+Socket::ptr Socket::CreateUnixUDPSocket()
+{
+    Socket::ptr sock(new Socket(UNIX, UDP, 0));
+    return sock;
+}
+
+Socket::Socket(int family, int type, int protocol)
+    :m_sock(-1)
+    ,m_family(family)
+    ,m_type(type)
+    ,m_protocol(protocol)
+    ,m_isConnected(false)
+    ,m_zeroCopy(false)
+    ,m_zcSent(0)
+    ,m_zcDone(0)
+    ,m_zcCopied(0){
+}
+
+Socket::~Socket()
+{
+    close();
+}
+
+int64_t Socket::getSendTimeout()
+{
+    FdCtx::ptr ctx = FdMgr::GetInstance()->get(m_sock);
+    if(ctx){
+        return ctx->getTimeout(SO_SNDTIMEO);
+    }
+    return -1;
+}
+
+void Socket::setSendTimeout(int64_t v)
+{
+    // 0表示不超时
+    struct timeval tv{};
+    if(v > 0){
+        tv.tv_sec = v / 1000;
+        tv.tv_usec = v % 1000 * 1000;
+    }
+    setOption(SOL_SOCKET, SO_SNDTIMEO, tv);
+}
+
+int64_t Socket::getRecvTimeout()
+{
+    FdCtx::ptr ctx = FdMgr::GetInstance()->get(m_sock);
+    if(ctx){
+        return ctx->getTimeout(SO_RCVTIMEO);
+    }
+    return -1;
+}
+
+void Socket::setRecvTimeout(int64_t v)
+{
+    struct timeval tv{};
+    if(v > 0){
+        tv.tv_sec = v / 1000;
+        tv.tv_usec = v % 1000 * 1000;
+    }
+    setOption(SOL_SOCKET, SO_RCVTIMEO, tv);
+}
+
+bool Socket::getOption(int level, int option, void* result, socklen_t* len)
+{
+    int rt = getsockopt(m_sock, level, option, result, (socklen_t*)len);
+    if(rt){
+        SYLAR_LOG_DEBUG(g_logger) << "getOption sock=" << m_sock
+            << " level=" << level << " option=" << option
+            << " errno=" << errno << " errstr=" << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool Socket::setOption(int level, int option, const void* result, socklen_t len)
+{
+    if(setsockopt(m_sock, level, option, result, (socklen_t)len)){
+        SYLAR_LOG_DEBUG(g_logger) << "setOption sock=" << m_sock
+            << " level=" << level << " option=" << option
+            << " errno=" << errno << " errstr=" << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool Socket::open()
+{
+    if(!isValid()){
+        newSock();
+    }
+    return isValid();
+}
+
+Socket::ptr Socket::accept()
+{
+    Socket::ptr sock(new Socket(m_family, m_type, m_protocol));
+    int newsock = ::accept(m_sock, nullptr, nullptr);
+    if(newsock == -1){
+        // 由调用者根据errno决定是否重试和输出错误日志
+        int err = errno;
+        SYLAR_LOG_DEBUG(g_logger) << "accept(" << m_sock << ") errno="
+            << err << " errstr=" << strerror(err);
+        errno = err;
+        return nullptr;
+    }
+    if(sock->init(newsock)){
+        return sock;
+    }
+    return nullptr;
+}
+
+bool Socket::init(int sock)
+{
+    FdCtx::ptr ctx = FdMgr::GetInstance()->get(sock);
+    if(ctx && (!ctx->isSocket() || ctx->isClose())){
+        return false;
+    }
+    m_sock = sock;
+    m_isConnected = true;
+    initSock();
+    getLocalAddress();
+    getRemoteAddress();
+    return true;
+}
+
+bool Socket::bind(const Address::ptr addr)
+{
+    if(!isValid()){
+        newSock();
+        if(SYLAR_UNLIKELY(!isValid())){
+            return false;
+        }
+    }
+
+    if(SYLAR_UNLIKELY(addr->getFamily() != m_family)){
+        SYLAR_LOG_ERROR(g_logger) << "bind sock.family("
+            << m_family << ") addr.family(" << addr->getFamily()
+            << ") not equal, addr=" << addr->toString();
+        return false;
+    }
+
+    if(::bind(m_sock, addr->getAddr(), addr->getAddrLen())){
+        SYLAR_LOG_ERROR(g_logger) << "bind error errno=" << errno
+            << " errstr=" << strerror(errno) << " addr=" << addr->toString();
+        return false;
+    }
+    getLocalAddress();
+    return true;
+}
+
+bool Socket::connect(const Address::ptr addr, uint64_t timeout_ms)
+{
+    m_remoteAddress = addr;
+    if(!isValid()){
+        newSock();
+        if(SYLAR_UNLIKELY(!isValid())){
+            return false;
+        }
+    }
+
+    if(SYLAR_UNLIKELY(addr->getFamily() != m_family)){
+        SYLAR_LOG_ERROR(g_logger) << "connect sock.family("
+            << m_family << ") addr.family(" << addr->getFamily()
+            << ") not equal, addr=" << addr->toString();
+        return false;
+    }
+
+    int rt = timeout_ms == (uint64_t)-1
+           ? ::connect(m_sock, addr->getAddr(), addr->getAddrLen())
+           : ::connect_with_timeout(m_sock, addr->getAddr(), addr->getAddrLen(), timeout_ms);
+    if(rt){
+        SYLAR_LOG_ERROR(g_logger) << "sock=" << m_sock << " connect(" << addr->toString()
+            << ") timeout=" << (int64_t)timeout_ms << " error errno="
+            << errno << " errstr=" << strerror(errno);
+        close();
+        return false;
+    }
+    m_isConnected = true;
+    getRemoteAddress();
+    getLocalAddress();
+    return true;
+}
+
+bool Socket::reconnect(uint64_t timeout_ms)
+{
+    if(!m_remoteAddress){
+        SYLAR_LOG_ERROR(g_logger) << "reconnect m_remoteAddress is null";
+        return false;
+    }
+    m_localAddress.reset();
+    return connect(m_remoteAddress, timeout_ms);
+}
+
+bool Socket::listen(int backlog)
+{
+    if(!isValid()){
+        SYLAR_LOG_ERROR(g_logger) << "listen error sock=-1";
+        return false;
+    }
+    if(::listen(m_sock, backlog)){
+        SYLAR_LOG_ERROR(g_logger) << "listen error errno=" << errno
+            << " errstr=" << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool Socket::close()
+{
+    if(!m_isConnected && m_sock == -1){
+        return true;
+    }
+    m_isConnected = false;
+    if(m_sock != -1){
+        ::close(m_sock);
+        m_sock = -1;
+    }
+    return true;
+}
+
+int Socket::send(const void* buffer, size_t length, int flags)
+{
+    if(isConnected()){
+        return ::send(m_sock, buffer, length, flags);
+    }
+    return -1;
+}
+
+int Socket::send(const iovec* buffers, size_t length, int flags)
+{
+    if(isConnected()){
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = (iovec*)buffers;
+        msg.msg_iovlen = length;
+        return ::sendmsg(m_sock, &msg, flags);
+    }
+    return -1;
+}
+
+int Socket::sendTo(const void* buffer, size_t length, const Address::ptr to, int flags)
+{
+    if(isConnected()){
+        return ::sendto(m_sock, buffer, length, flags, to->getAddr(), to->getAddrLen());
+    }
+    return -1;
+}
+
+int Socket::sendTo(const iovec* buffers, size_t length, const Address::ptr to, int flags)
+{
+    if(isConnected()){
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = (iovec*)buffers;
+        msg.msg_iovlen = length;
+        msg.msg_name = (void*)to->getAddr();
+        msg.msg_namelen = to->getAddrLen();
+        return ::sendmsg(m_sock, &msg, flags);
+    }
+    return -1;
+}
+
+int Socket::recv(void* buffer, size_t length, int flags)
+{
+    if(isConnected()){
+        return ::recv(m_sock, buffer, length, flags);
+    }
+    return -1;
+}
+
+int Socket::recv(iovec* buffers, size_t length, int flags)
+{
+    if(isConnected()){
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = (iovec*)buffers;
+        msg.msg_iovlen = length;
+        return ::recvmsg(m_sock, &msg, flags);
+    }
+    return -1;
+}
+
+int Socket::recvFrom(void* buffer, size_t length, Address::ptr from, int flags)
+{
+    if(isConnected()){
+        socklen_t len = from->getAddrLen();
+        return ::recvfrom(m_sock, buffer, length, flags, from->getAddr(), &len);
+    }
+    return -1;
+}
+
+int Socket::recvFrom(iovec* buffers, size_t length, Address::ptr from, int flags)
+{
+    if(isConnected()){
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = (iovec*)buffers;
+        msg.msg_iovlen = length;
+        msg.msg_name = from->getAddr();
+        msg.msg_namelen = from->getAddrLen();
+        return ::recvmsg(m_sock, &msg, flags);
+    }
+    return -1;
+}
+
+int Socket::send(ByteArray::ptr ba, size_t length, int flags)
+{
+    if(!isConnected()){
+        return -1;
+    }
+    std::vector<iovec> iovs;
+    if(ba->getReadBuffers(iovs, length) == 0){
+        return 0;
+    }
+    // 超过IOV_MAX的部分留给下一次发送
+    if(iovs.size() > IOV_MAX){
+        iovs.resize(IOV_MAX);
+    }
+    int rt = send(&iovs[0], iovs.size(), flags);
+    if(rt > 0){
+        ba->setPosition(ba->getPosition() + rt);
+    }
+    return rt;
+}
+
+int Socket::recv(ByteArray::ptr ba, size_t length, int flags)
+{
+    if(!isConnected()){
+        return -1;
+    }
+    std::vector<iovec> iovs;
+    if(ba->getWriteBuffers(iovs, length) == 0){
+        return 0;
+    }
+    if(iovs.size() > IOV_MAX){
+        iovs.resize(IOV_MAX);
+    }
+    int rt = recv(&iovs[0], iovs.size(), flags);
+    if(rt > 0){
+        ba->setPosition(ba->getPosition() + rt);
+    }
+    return rt;
+}
+
+int64_t Socket::sendFile(int fd, off_t offset, size_t count)
+{
+    if(!isConnected()){
+        return -1;
+    }
+    off_t off = offset;
+    int64_t total = 0;
+    while(count > 0){
+        // 单次sendfile最多传输0x7ffff000字节
+        ssize_t n = ::sendfile(m_sock, fd, &off, std::min<size_t>(count, 0x7ffff000));
+        if(n < 0){
+            SYLAR_LOG_DEBUG(g_logger) << "sendfile sock=" << m_sock << " fd=" << fd
+                << " errno=" << errno << " errstr=" << strerror(errno);
+            return total ? total : -1;
+        }
+        // 文件比count短
+        if(n == 0){
+            break;
+        }
+        count -= n;
+        total += n;
+    }
+    return total;
+}
+
+int64_t Socket::spliceFile(int fd, off_t offset, size_t count)
+{
+    if(!isConnected()){
+        return -1;
+    }
+    int pipefd[2];
+    if(pipe2(pipefd, O_CLOEXEC)){
+        SYLAR_LOG_ERROR(g_logger) << "spliceFile pipe2 errno=" << errno
+            << " errstr=" << strerror(errno);
+        return -1;
+    }
+    // 管道越大往返次数越少, 受 /proc/sys/fs/pipe-max-size 限制, 失败时保持默认
+    fcntl(pipefd[1], F_SETPIPE_SZ, 1 << 20);
+    int pipe_size = fcntl(pipefd[1], F_GETPIPE_SZ);
+    size_t chunk = pipe_size > 0 ? pipe_size : 65536;
+
+    loff_t off = offset;
+    int64_t total = 0;
+    bool error = false;
+    while(count > 0 && !error){
+        ssize_t n = ::splice(fd, &off, pipefd[1], nullptr, std::min(count, chunk),
+                             SPLICE_F_MOVE);
+        if(n <= 0){
+            error = n < 0;
+            break;
+        }
+        // 管道里的数据全部送到socket之后再读下一段
+        while(n > 0){
+            // 与MSG_MORE相同, 只在后面还有数据时设置, 否则最后不满一个报文段的数据会被压住
+            unsigned int flags = SPLICE_F_MOVE | ((size_t)n < count ? SPLICE_F_MORE : 0);
+            ssize_t m = ::splice(pipefd[0], nullptr, m_sock, nullptr, n, flags);
+            if(m <= 0){
+                error = true;
+                break;
+            }
+            n -= m;
+            count -= m;
+            total += m;
+        }
+    }
+    if(error){
+        SYLAR_LOG_DEBUG(g_logger) << "splice sock=" << m_sock << " fd=" << fd
+            << " errno=" << errno << " errstr=" << strerror(errno);
+    }
+    ::close(pipefd[0]);
+    ::close(pipefd[1]);
+    return (error && total == 0) ? -1 : total;
+}
+
+bool Socket::setZeroCopy(bool v)
+{
+#ifdef SO_ZEROCOPY
+    if(!isValid()){
+        newSock();
+    }
+    int val = v ? 1 : 0;
+    if(!setOption(SOL_SOCKET, SO_ZEROCOPY, val)){
+        m_zeroCopy = false;
+        return false;
+    }
+    m_zeroCopy = v;
+    return true;
+#else
+    m_zeroCopy = false;
+    return !v;
+#endif
+}
+
+int Socket::sendZeroCopy(const void* buffer, size_t length, int flags)
+{
+#ifdef MSG_ZEROCOPY
+    if(m_zeroCopy && length >= s_zerocopy_min_size){
+        if(!isConnected()){
+            return -1;
+        }
+        int rt = ::send(m_sock, buffer, length, flags | MSG_ZEROCOPY);
+        if(rt > 0){
+            ++m_zcSent;
+            return rt;
+        }
+        // ENOBUFS: 锁定的页超过了optmem限制, 退化为普通发送
+        if(rt == 0 || errno != ENOBUFS){
+            return rt;
+        }
+    }
+#endif
+    return send(buffer, length, flags);
+}
+
+int Socket::waitZeroCopy()
+{
+#ifdef SO_EE_ORIGIN_ZEROCOPY
+    int64_t timeout = getRecvTimeout();
+    uint64_t deadline = timeout > 0 ? GetMonotonicMS() + timeout : ~0ull;
+    while(m_zcDone != m_zcSent){
+        char control[128];
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        // 不经过hook, hook的recvmsg在EAGAIN时会注册fd的读事件, 与阻塞在recv上的协程冲突
+        int rt = recvmsg_f(m_sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+        if(rt == -1){
+            if(errno == EINTR){
+                continue;
+            }
+            if(errno != EAGAIN){
+                return -1;
+            }
+            uint64_t now = GetMonotonicMS();
+            if(now >= deadline){
+                errno = ETIMEDOUT;
+                return -1;
+            }
+            if(is_hook_enable() && IOManager::GetThis()){
+                // 协程中每1ms重试一次, 只挂起当前协程
+                usleep(1000);
+                continue;
+            }
+            // 错误队列非空时poll返回POLLERR
+            pollfd pfd;
+            pfd.fd = m_sock;
+            pfd.events = 0;
+            pfd.revents = 0;
+            int prt = ::poll(&pfd, 1, deadline == ~0ull ? -1 : (int)(deadline - now));
+            if(prt < 0 && errno != EINTR){
+                return -1;
+            }
+            continue;
+        }
+
+        for(cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)){
+            if(!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+                    && !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)){
+                continue;
+            }
+            const sock_extended_err* serr = (const sock_extended_err*)CMSG_DATA(cm);
+            if(serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY){
+                continue;
+            }
+            // 序号区间[ee_info, ee_data]内的发送都已完成
+            uint32_t n = serr->ee_data - serr->ee_info + 1;
+            m_zcDone += n;
+            if(serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED){
+                m_zcCopied += n;
+            }
+        }
+    }
+#endif
+    return 0;
+}
+
+Address::ptr Socket::getRemoteAddress()
+{
+    if(m_remoteAddress){
+        return m_remoteAddress;
+    }
+
+    Address::ptr result;
+    switch(m_family){
+        case AF_INET:
+            result.reset(new IPv4Address());
+            break;
+        case AF_INET6:
+            result.reset(new IPv6Address());
+            break;
+        case AF_UNIX:
+            result.reset(new UnixAddress());
+            break;
+        default:
+            result.reset(new UnknownAddress(m_family));
+            break;
+    }
+    socklen_t addrlen = result->getAddrLen();
+    if(getpeername(m_sock, result->getAddr(), &addrlen)){
+        return Address::ptr(new UnknownAddress(m_family));
+    }
+    if(m_family == AF_UNIX){
+        UnixAddress::ptr addr = std::dynamic_pointer_cast<UnixAddress>(result);
+        addr->setAddrLen(addrlen);
+    }
+    m_remoteAddress = result;
+    return m_remoteAddress;
+}
+
+Address::ptr Socket::getLocalAddress()
+{
+    if(m_localAddress){
+        return m_localAddress;
+    }
+
+    Address::ptr result;
+    switch(m_family){
+        case AF_INET:
+            result.reset(new IPv4Address());
+            break;
+        case AF_INET6:
+            result.reset(new IPv6Address());
+            break;
+        case AF_UNIX:
+            result.reset(new UnixAddress());
+            break;
+        default:
+            result.reset(new UnknownAddress(m_family));
+            break;
+    }
+    socklen_t addrlen = result->getAddrLen();
+    if(getsockname(m_sock, result->getAddr(), &addrlen)){
+        SYLAR_LOG_ERROR(g_logger) << "getsockname error sock=" << m_sock
+            << " errno=" << errno << " errstr=" << strerror(errno);
+        return Address::ptr(new UnknownAddress(m_family));
+    }
+    if(m_family == AF_UNIX){
+        UnixAddress::ptr addr = std::dynamic_pointer_cast<UnixAddress>(result);
+        addr->setAddrLen(addrlen);
+    }
+    m_localAddress = result;
+    return m_localAddress;
+}
+
+bool Socket::isValid() const
+{
+    return m_sock != -1;
+}
+
+int Socket::getError()
+{
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if(!getOption(SOL_SOCKET, SO_ERROR, &error, &len)){
+        error = errno;
+    }
+    return error;
+}
+
+std::ostream& Socket::dump(std::ostream& os) const
+{
+    os << "[Socket sock=" << m_sock
+       << " is_connected=" << m_isConnected
+       << " family=" << m_family
+       << " type=" << m_type
+       << " protocol=" << m_protocol;
+    if(m_localAddress){
+        os << " local_address=" << *m_localAddress;
+    }
+    if(m_remoteAddress){
+        os << " remote_address=" << *m_remoteAddress;
+    }
+    os << "]";
+    return os;
+}
+
+std::string Socket::toString() const
+{
+    std::stringstream ss;
+    dump(ss);
+    return ss.str();
+}
+
+bool Socket::cancelRead()
+{
+    IOManager* iom = IOManager::GetThis();
+    return iom && iom->cancelEvent(m_sock, sylar::IOManager::READ);
+}
+
+bool Socket::cancelWrite()
+{
+    IOManager* iom = IOManager::GetThis();
+    return iom && iom->cancelEvent(m_sock, sylar::IOManager::WRITE);
+}
+
+bool Socket::cancelAccept()
+{
+    IOManager* iom = IOManager::GetThis();
+    return iom && iom->cancelEvent(m_sock, sylar::IOManager::READ);
+}
+
+bool Socket::cancelAll()
+{
+    IOManager* iom = IOManager::GetThis();
+    return iom && iom->cancelAll(m_sock);
+}
+
+void Socket::initSock()
+{
+    int val = 1;
+    setOption(SOL_SOCKET, SO_REUSEADDR, val);
+    if(m_type == SOCK_STREAM && m_family != AF_UNIX && s_nodelay){
+        setOption(IPPROTO_TCP, TCP_NODELAY, val);
+    }
+    int send_buffer = s_send_buffer;
+    if(send_buffer > 0){
+        setOption(SOL_SOCKET, SO_SNDBUF, send_buffer);
+    }
+    int recv_buffer = s_recv_buffer;
+    if(recv_buffer > 0){
+        setOption(SOL_SOCKET, SO_RCVBUF, recv_buffer);
+    }
+    int send_timeout = s_send_timeout;
+    if(send_timeout > 0){
+        setSendTimeout(send_timeout);
+    }
+    int recv_timeout = s_recv_timeout;
+    if(recv_timeout > 0){
+        setRecvTimeout(recv_timeout);
+    }
+}
+
+void Socket::newSock()
+{
+    m_sock = socket(m_family, m_type, m_protocol);
+    if(SYLAR_LIKELY(m_sock != -1)){
+        initSock();
+    }
+    else{
+        SYLAR_LOG_ERROR(g_logger) << "socket(" << m_family
+            << ", " << m_type << ", " << m_protocol << ") errno="
+            << errno << " errstr=" << strerror(errno);
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const Socket& sock)
+{
+    return sock.dump(os);
+}
+
+}
@@ -0,0 +1,175 @@
+#ifndef __SYLAR_SOCKET_H__
+#define __SYLAR_SOCKET_H__
+
+#include <memory>
+#include <ostream>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "address.h"
+#include "bytearray.h"
+#include "noncopyable.h"
+
+namespace sylar{
+
+// socket封装
+// 在IOManager的协程中使用时, 读写经过hook层, 阻塞操作变成挂起协程
+// 新建的socket按配置项初始化:
+//   tcp.socket.nodelay           TCP_NODELAY
+//   tcp.socket.send_buffer       SO_SNDBUF, 0使用系统默认值
+//   tcp.socket.recv_buffer       SO_RCVBUF, 0使用系统默认值
+//   tcp.socket.send_timeout      发送超时(ms), -1不超时
+//   tcp.socket.recv_timeout      接收超时(ms), -1不超时
+// 大块数据提供几种避免用户态拷贝的发送方式:
+//   send(ByteArray)      直接用ByteArray的内存块做iovec, 一次sendmsg发出
+//   sendFile/spliceFile  文件内容在内核里直接送到socket
+//   sendZeroCopy         MSG_ZEROCOPY, 内核直接引用用户内存, 完成后通过错误队列通知
+class Socket : public std::enable_shared_from_this<Socket>, Noncopyable{
+public:
+    typedef std::shared_ptr<Socket> ptr;
+    typedef std::weak_ptr<Socket> weak_ptr;
+
+    enum Type{
+        TCP = SOCK_STREAM,
+        UDP = SOCK_DGRAM
+    };
+
+    enum Family{
+        IPv4 = AF_INET,
+        IPv6 = AF_INET6,
+        UNIX = AF_UNIX
+    };
+
+    // 按地址的地址族创建
+    static Socket::ptr CreateTCP(sylar::Address::ptr address);
+    static Socket::ptr CreateUDP(sylar::Address::ptr address);
+
+    static Socket::ptr CreateTCPSocket();
+    static Socket::ptr CreateUDPSocket();
+    static Socket::ptr CreateTCPSocket6();
+    static Socket::ptr CreateUDPSocket6();
+    static Socket::ptr CreateUnixTCPSocket();
+    static Socket::ptr CreateUnixUDPSocket();
+
+    // 不立即创建句柄, 在bind/connect时创建
+    Socket(int family, int type, int protocol = 0);
+    virtual ~Socket();
+
+    // 超时(ms), -1不超时
+    int64_t getSendTimeout();
+    void setSendTimeout(int64_t v);
+    int64_t getRecvTimeout();
+    void setRecvTimeout(int64_t v);
+
+    bool getOption(int level, int option, void* result, socklen_t* len);
+
+    template<class T>
+    bool getOption(int level, int option, T& result){
+        socklen_t length = sizeof(T);
+        return getOption(level, option, &result, &length);
+    }
+
+    bool setOption(int level, int option, const void* result, socklen_t len);
+
+    template<class T>
+    bool setOption(int level, int option, const T& value){
+        return setOption(level, option, &value, sizeof(T));
+    }
+
+    // 提前创建句柄, 用于在bind/connect之前设置选项(如SO_REUSEPORT)
+    bool open();
+
+    // 失败返回nullptr
+    virtual Socket::ptr accept();
+    virtual bool bind(const Address::ptr addr);
+    // timeout_ms为-1时使用配置 tcp.connect.timeout
+    virtual bool connect(const Address::ptr addr, uint64_t timeout_ms = -1);
+    virtual bool reconnect(uint64_t timeout_ms = -1);
+    virtual bool listen(int backlog = SOMAXCONN);
+    virtual bool close();
+
+    // 返回值和对应的系统调用一致: >0 字节数, =0 对端关闭, <0 出错
+    virtual int send(const void* buffer, size_t length, int flags = 0);
+    // length 为iovec的个数
+    virtual int send(const iovec* buffers, size_t length, int flags = 0);
+    virtual int sendTo(const void* buffer, size_t length, const Address::ptr to, int flags = 0);
+    virtual int sendTo(const iovec* buffers, size_t length, const Address::ptr to, int flags = 0);
+
+    virtual int recv(void* buffer, size_t length, int flags = 0);
+    virtual int recv(iovec* buffers, size_t length, int flags = 0);
+    virtual int recvFrom(void* buffer, size_t length, Address::ptr from, int flags = 0);
+    virtual int recvFrom(iovec* buffers, size_t length, Address::ptr from, int flags = 0);
+
+    // 从ba的当前位置起发送最多length字节, 成功后ba的位置前进实际发送的字节数
+    int send(ByteArray::ptr ba, size_t length = ~0ull, int flags = 0);
+    // 在ba的当前位置接收最多length字节, 成功后ba的位置前进实际接收的字节数
+    int recv(ByteArray::ptr ba, size_t length, int flags = 0);
+
+    // 用sendfile把文件fd从offset起的count字节发完, 返回发送的字节数
+    // 中途出错时返回已发送的字节数, 一个字节都没发出返回-1
+    int64_t sendFile(int fd, off_t offset, size_t count);
+    // 同sendFile, 经管道用splice传输, 适用于sendfile不支持的输入(如管道和其它socket)
+    int64_t spliceFile(int fd, off_t offset, size_t count);
+
+    // 开启MSG_ZEROCOPY, 内核或协议不支持时返回false
+    bool setZeroCopy(bool v);
+    bool isZeroCopy() const { return m_zeroCopy;}
+    // 不小于 tcp.zerocopy.min_size 的数据用MSG_ZEROCOPY发送, 其余普通发送
+    // 以零拷贝方式发出的buffer在waitZeroCopy返回之前不能修改或释放
+    int sendZeroCopy(const void* buffer, size_t length, int flags = 0);
+    // 等待所有零拷贝发送的完成通知, 成功返回0, 出错或超时返回-1
+    int waitZeroCopy();
+    // 尚未收到完成通知的零拷贝发送次数
+    uint32_t getZeroCopyPending() const { return m_zcSent - m_zcDone;}
+    // 内核实际退化为拷贝的次数(如回环地址), 这类情况继续用零拷贝没有收益
+    uint32_t getZeroCopyCopied() const { return m_zcCopied;}
+
+    Address::ptr getRemoteAddress();
+    Address::ptr getLocalAddress();
+
+    int getFamily() const { return m_family;}
+    int getType() const { return m_type;}
+    int getProtocol() const { return m_protocol;}
+    bool isConnected() const { return m_isConnected;}
+    bool isValid() const;
+    // SO_ERROR
+    int getError();
+
+    virtual std::ostream& dump(std::ostream& os) const;
+    virtual std::string toString() const;
+
+    int getSocket() const { return m_sock;}
+
+    // 唤醒等在这个socket上的协程
+    bool cancelRead();
+    bool cancelWrite();
+    bool cancelAccept();
+    bool cancelAll();
+protected:
+    // 按配置项设置socket选项
+    void initSock();
+    void newSock();
+    // 初始化accept得到的句柄
+    virtual bool init(int sock);
+protected:
+    int m_sock;
+    int m_family;
+    int m_type;
+    int m_protocol;
+    bool m_isConnected;
+    bool m_zeroCopy;
+    // 零拷贝发送的序号, 内核按发送次数从0开始编号
+    uint32_t m_zcSent;
+    uint32_t m_zcDone;
+    uint32_t m_zcCopied;
+
+    Address::ptr m_localAddress;
+    Address::ptr m_remoteAddress;
+};
+
+std::ostream& operator<<(std::ostream& os, const Socket& sock);
+
+}
+
+#endif
@@ -0,0 +1,294 @@
+#include "tcp_server.h"
+#include "config.h"
+#include "hook.h"
+#include "fd_manager.h"
+#include "util.h"
+#include "log.h"
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#include <sstream>
+
+namespace sylar{
+
+static Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+static ConfigVar<std::vector<std::string> >::ptr g_tcp_server_addresses =
+    Config::Lookup("tcp_server.addresses", std::vector<std::string>{"0.0.0.0:8020"}, "tcp server listen addresses");
+static ConfigVar<int>::ptr g_tcp_server_backlog =
+    Config::Lookup<int>("tcp_server.backlog", SOMAXCONN, "tcp server listen backlog");
+static ConfigVar<uint32_t>::ptr g_tcp_server_workers =
+    Config::Lookup<uint32_t>("tcp_server.workers", 0, "SO_REUSEPORT listeners per address, 0 means one per accept thread");
+static ConfigVar<uint64_t>::ptr g_tcp_server_read_timeout =
+    Config::Lookup<uint64_t>("tcp_server.read_timeout", (uint64_t)(60 * 1000 * 2), "tcp server read timeout(ms)");
+static ConfigVar<uint64_t>::ptr g_tcp_server_drain_timeout =
+    Config::Lookup<uint64_t>("tcp_server.drain_timeout", 5000, "time(ms) stop waits for open connections before shutting them down");
+
+TcpServer::TcpServer(sylar::IOManager* worker, sylar::IOManager* accept_worker)
+    :m_worker(worker)
+    ,m_acceptWorker(accept_worker)
+    ,m_recvTimeout(g_tcp_server_read_timeout->getValue())
+    ,m_name("sylar/1.0.0")
+    ,m_isStop(true){
+}
+
+TcpServer::~TcpServer()
+{
+    for(auto& i : m_socks){
+        i->close();
+    }
+    m_socks.clear();
+}
+
+bool TcpServer::bind(sylar::Address::ptr addr)
+{
+    std::vector<Address::ptr> addrs;
+    std::vector<Address::ptr> fails;
+    addrs.push_back(addr);
+    return bind(addrs, fails);
+}
+
+bool TcpServer::bind(const std::vector<Address::ptr>& addrs
+                     ,std::vector<Address::ptr>& fails)
+{
+    size_t listeners = g_tcp_server_workers->getValue();
+    if(listeners == 0){
+        listeners = m_acceptWorker->getWorkerThreadIds().size();
+    }
+    if(listeners == 0){
+        listeners = 1;
+    }
+    int backlog = g_tcp_server_backlog->getValue();
+    // 之前bind成功的socket, 本次失败时保留
+    size_t old_size = m_socks.size();
+
+    for(auto& addr : addrs){
+        // unix域socket不能多个socket绑定同一路径
+        size_t n = addr->getFamily() == AF_UNIX ? 1 : listeners;
+        Address::ptr bind_addr = addr;
+        std::vector<Socket::ptr> socks;
+        for(size_t i = 0; i < n; ++i){
+            Socket::ptr sock = Socket::CreateTCP(bind_addr);
+            int val = 1;
+            if(!sock->open()
+                    || (n > 1 && !sock->setOption(SOL_SOCKET, SO_REUSEPORT, val))
+                    || !sock->bind(bind_addr)
+                    || !sock->listen(backlog)){
+                SYLAR_LOG_ERROR(g_logger) << "bind fail errno="
+                    << errno << " errstr=" << strerror(errno)
+                    << " addr=[" << addr->toString() << "]";
+                socks.clear();
+                break;
+            }
+            // 在没有开启hook的线程中创建的socket不在FdManager中(或残留着同号旧fd的上下文),
+            // 重新注册后accept才会挂起协程而不是阻塞线程
+            if(!is_hook_enable()){
+                FdMgr::GetInstance()->del(sock->getSocket());
+                FdMgr::GetInstance()->get(sock->getSocket(), true);
+            }
+            // 端口为0时由第一个socket分配端口, 其余socket绑定同一个端口
+            if(i == 0){
+                bind_addr = sock->getLocalAddress();
+            }
+            socks.push_back(sock);
+        }
+        if(socks.empty()){
+            fails.push_back(addr);
+        }
+        else{
+            m_socks.insert(m_socks.end(), socks.begin(), socks.end());
+        }
+    }
+
+    if(!fails.empty()){
+        m_socks.resize(old_size);
+        return false;
+    }
+
+    for(size_t i = old_size; i < m_socks.size(); ++i){
+        SYLAR_LOG_INFO(g_logger) << "type=" << m_type
+            << " name=" << m_name
+            << " server bind success: " << *m_socks[i];
+    }
+    return true;
+}
+
+bool TcpServer::bindConfig(std::vector<Address::ptr>& fails)
+{
+    std::vector<Address::ptr> addrs;
+    for(auto& i : g_tcp_server_addresses->getValue()){
+        Address::ptr addr;
+        if(!i.empty() && i[0] == '/'){
+            addr.reset(new UnixAddress(i));
+        }
+        else{
+            addr = Address::LookupAny(i, AF_UNSPEC, SOCK_STREAM);
+        }
+        if(!addr){
+            SYLAR_LOG_ERROR(g_logger) << "invalid address: " << i;
+            return false;
+        }
+        addrs.push_back(addr);
+    }
+    return bind(addrs, fails);
+}
+
+bool TcpServer::start()
+{
+    if(!m_isStop){
+        return true;
+    }
+    m_isStop = false;
+
+    // 每个监听socket的accept循环固定在一个线程上, SO_REUSEPORT的内核负载均衡对应到线程
+    std::vector<int> threads = m_acceptWorker->getWorkerThreadIds();
+    for(size_t i = 0; i < m_socks.size(); ++i){
+        ++m_accepting;
+        m_acceptWorker->schedule(std::bind(&TcpServer::startAccept,
+                    shared_from_this(), m_socks[i])
+                , threads.empty() ? -1 : threads[i % threads.size()]);
+    }
+    return true;
+}
+
+// 单个连接出错, 可以立即接受下一个
+static bool IsTransientAcceptError(int err)
+{
+    switch(err){
+        case EINTR:
+        case EAGAIN:
+        case ECONNABORTED:
+        case EPROTO:
+        case ENETDOWN:
+        case ENOPROTOOPT:
+        case EHOSTDOWN:
+        case ENONET:
+        case EHOSTUNREACH:
+        case ENETUNREACH:
+        case EOPNOTSUPP:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void TcpServer::startAccept(Socket::ptr sock)
+{
+    // 被调度到的线程, accept等待后协程可能在其它线程上被唤醒, 再切回来
+    int thread = GetThreadID();
+    std::vector<int> threads = m_acceptWorker->getWorkerThreadIds();
+    if(std::find(threads.begin(), threads.end(), thread) == threads.end()){
+        thread = -1;
+    }
+    uint64_t backoff_ms = 0;
+    while(!m_isStop){
+        Socket::ptr client = sock->accept();
+        int err = errno;
+        if(thread != -1 && GetThreadID() != thread){
+            m_acceptWorker->switchTo(thread);
+        }
+        if(client){
+            backoff_ms = 0;
+            client->setRecvTimeout(m_recvTimeout);
+            {
+                MutexType::Lock lock(m_mutex);
+                m_clients.insert(client);
+            }
+            m_worker->schedule(std::bind(&TcpServer::onClient,
+                        shared_from_this(), client));
+            continue;
+        }
+        if(m_isStop || IsTransientAcceptError(err)){
+            continue;
+        }
+        // EMFILE/ENFILE/ENOBUFS等持续性错误, 立即重试只会空转占满CPU, 退避后再试
+        backoff_ms = backoff_ms ? std::min<uint64_t>(backoff_ms * 2, 1000) : 10;
+        SYLAR_LOG_ERROR(g_logger) << "name=" << m_name << " accept on " << *sock
+            << " fail errno=" << err << " errstr=" << strerror(err)
+            << ", retry in " << backoff_ms << "ms";
+        // 在协程中只挂起当前协程
+        usleep(backoff_ms * 1000);
+    }
+    --m_accepting;
+}
+
+void TcpServer::onClient(Socket::ptr client)
+{
+    handleClient(client);
+    MutexType::Lock lock(m_mutex);
+    m_clients.erase(client);
+}
+
+void TcpServer::handleClient(Socket::ptr client)
+{
+    SYLAR_LOG_INFO(g_logger) << "handleClient: " << *client;
+}
+
+size_t TcpServer::getConnectionCount()
+{
+    MutexType::Lock lock(m_mutex);
+    return m_clients.size();
+}
+
+void TcpServer::stop()
+{
+    bool expected = false;
+    if(!m_isStop.compare_exchange_strong(expected, true)){
+        return;
+    }
+    uint64_t deadline = GetMonotonicMS() + g_tcp_server_drain_timeout->getValue();
+
+    // 监听socket先shutdown, 阻塞在accept上的协程被唤醒后accept失败退出, 之后再关闭句柄
+    for(auto& sock : m_socks){
+        ::shutdown(sock->getSocket(), SHUT_RDWR);
+        m_acceptWorker->cancelAll(sock->getSocket());
+    }
+    // 在协程中调用时usleep只挂起当前协程
+    while(m_accepting > 0 && GetMonotonicMS() < deadline){
+        usleep(1000);
+    }
+    for(auto& sock : m_socks){
+        sock->close();
+    }
+    m_socks.clear();
+
+    while(getConnectionCount() > 0 && GetMonotonicMS() < deadline){
+        usleep(10 * 1000);
+    }
+
+    // 超时后shutdown剩余的连接, 阻塞在读写上的处理协程随之返回
+    size_t left = 0;
+    {
+        MutexType::Lock lock(m_mutex);
+        left = m_clients.size();
+        for(auto& i : m_clients){
+            ::shutdown(i->getSocket(), SHUT_RDWR);
+        }
+    }
+    if(left){
+        SYLAR_LOG_INFO(g_logger) << "type=" << m_type << " name=" << m_name
+            << " shutdown " << left << " connections after drain timeout";
+        deadline = GetMonotonicMS() + 1000;
+        while(getConnectionCount() > 0 && GetMonotonicMS() < deadline){
+            usleep(10 * 1000);
+        }
+    }
+}
+
+std::string TcpServer::toString(const std::string& prefix)
+{
+    std::stringstream ss;
+    ss << prefix << "[type=" << m_type
+       << " name=" << m_name
+       << " worker=" << (m_worker ? m_worker->getName() : "")
+       << " accept=" << (m_acceptWorker ? m_acceptWorker->getName() : "")
+       << " recv_timeout=" << m_recvTimeout
+       << " connections=" << getConnectionCount() << "]" << std::endl;
+    std::string pfx = prefix.empty() ? "    " : prefix;
+    for(auto& i : m_socks){
+        ss << pfx << pfx << *i << std::endl;
+    }
+    return ss.str();
+}
+
+}
@@ -0,0 +1,83 @@
+#ifndef __SYLAR_TCP_SERVER_H__
+#define __SYLAR_TCP_SERVER_H__
+
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <unordered_set>
+#include "address.h"
+#include "iomanager.h"
+#include "socket.h"
+#include "noncopyable.h"
+
+namespace sylar{
+
+// TCP服务器基类, 子类重写handleClient处理连接
+// 每个监听地址按accept_worker的工作线程数创建多个SO_REUSEPORT监听socket, 每个socket有自己的accept协程,
+// 由内核把新连接分散到各个socket的accept队列, 多个线程同时accept, 代替所有线程争抢同一个accept队列
+// 每个连接在worker中用一个协程处理
+// 配置项:
+//   tcp_server.addresses      bindConfig使用的监听地址
+//   tcp_server.backlog        listen的backlog
+//   tcp_server.workers        每个地址的监听socket数, 0表示accept_worker的工作线程数
+//   tcp_server.read_timeout   连接的接收超时(ms)
+//   tcp_server.drain_timeout  stop时等待已有连接结束的时间(ms), 超时后shutdown剩余连接
+class TcpServer : public std::enable_shared_from_this<TcpServer>, Noncopyable{
+public:
+    typedef std::shared_ptr<TcpServer> ptr;
+    typedef Mutex MutexType;
+
+    // worker 处理连接的调度器, accept_worker 执行accept循环的调度器
+    TcpServer(sylar::IOManager* worker = sylar::IOManager::GetThis()
+              ,sylar::IOManager* accept_worker = sylar::IOManager::GetThis());
+    virtual ~TcpServer();
+
+    virtual bool bind(sylar::Address::ptr addr);
+    // 绑定失败的地址放入fails, 有任何失败都返回false
+    virtual bool bind(const std::vector<Address::ptr>& addrs
+                      ,std::vector<Address::ptr>& fails);
+    // 绑定配置项 tcp_server.addresses 中的地址
+    bool bindConfig(std::vector<Address::ptr>& fails);
+
+    virtual bool start();
+    // 停止接受新连接, 等待已有连接在drain超时内结束, 可以在任意线程或协程中调用
+    virtual void stop();
+
+    uint64_t getRecvTimeout() const { return m_recvTimeout;}
+    void setRecvTimeout(uint64_t v) { m_recvTimeout = v;}
+
+    std::string getName() const { return m_name;}
+    virtual void setName(const std::string& v) { m_name = v;}
+
+    bool isStop() const { return m_isStop;}
+    // 正在处理的连接数
+    size_t getConnectionCount();
+    // 所有的监听socket
+    std::vector<Socket::ptr> getSocks() const { return m_socks;}
+
+    virtual std::string toString(const std::string& prefix = "");
+protected:
+    // 处理一个连接, 返回后连接被关闭
+    virtual void handleClient(Socket::ptr client);
+    // 监听socket上的accept循环
+    virtual void startAccept(Socket::ptr sock);
+private:
+    void onClient(Socket::ptr client);
+protected:
+    std::vector<Socket::ptr> m_socks;
+    sylar::IOManager* m_worker;
+    sylar::IOManager* m_acceptWorker;
+    uint64_t m_recvTimeout;
+    std::string m_name;
+    std::string m_type = "tcp";
+    std::atomic<bool> m_isStop;
+private:
+    MutexType m_mutex;
+    std::unordered_set<Socket::ptr> m_clients;
+    // 还在运行的accept循环数
+    std::atomic<size_t> m_accepting {0};
+};
+
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef __SYLAR_THREAD_H__
+#define __SYLAR_THREAD_H__
+
+#include <thread>
+#include <functional>
+#include <memory>
+#include <string>
+#include <pthread.h>
+#include "mutex.h"
+
+namespace sylar{
+
+// 基于pthread的线程封装
+// 线程id和名称缓存在thread_local中, 日志等热路径不再需要系统调用
+class Thread{
+public:
+    typedef std::shared_ptr<Thread> ptr;
+    // 创建并启动线程, 构造函数返回时线程已经开始运行
+    // name 同时设置为内核线程名(截断到15个字符), 可在top/perf中看到
+    Thread(std::function<void()> cb, const std::string& name);
+    ~Thread();
+
+    pid_t getId() const { return m_id;}
+    const std::string& getName() const { return m_name;}
+
+    void join();
+
+    // 当前线程对象, 非sylar::Thread创建的线程返回nullptr
+    static Thread* GetThis();
+    // 当前线程名称
+    static const std::string& GetName();
+    // 设置当前线程名称, 同时设置内核线程名
+    static void SetName(const std::string& name);
+private:
+    Thread(const Thread&) = delete;
+    Thread(const Thread&&) = delete;
+    Thread& operator=(const Thread&) = delete;
+
+    static void* run(void* arg);
+private:
+    pid_t m_id = -1;
+    pthread_t m_thread = 0;
+    std::function<void()> m_cb;
+    std::string m_name;
+    Semaphore m_semaphore;
+};
+
+}
+
+#endif
@@ -0,0 +1,366 @@
+#include "timer.h"
+#include "util.h"
+#include "macro.h"
+#include <string.h>
+
+namespace sylar{
+
+// 第level层每个槽覆盖的时间跨度为 1 << shift
+static inline int LevelShift(int level)
+{
+    return level == 0 ? 0 : 8 + 6 * (level - 1);
+}
+
+// 从idx开始(含)环形查找下一个置位, 返回相对idx的距离, 没有置位返回-1
+static int FindNext(const uint64_t* bitmap, int words, int idx)
+{
+    int n = words * 64;
+    for(int i = 0; i <= words; ++i){
+        int w = ((idx >> 6) + i) % words;
+        uint64_t bits = bitmap[w];
+        if(i == 0){
+            bits &= ~0ull << (idx & 63);
+        }
+        else if(i == words){
+            bits &= (1ull << (idx & 63)) - 1;
+        }
+        if(bits){
+            int pos = w * 64 + __builtin_ctzll(bits);
+            return (pos - idx + n) % n;
+        }
+    }
+    return -1;
+}
+
+Timer::Timer(uint64_t ms, std::function<void()> cb,
+             bool recurring, TimerManager* manager)
+    :m_recurring(recurring)
+    ,m_ms(ms)
+    ,m_cb(cb)
+    ,m_manager(manager){
+    m_next = sylar::GetMonotonicMS() + m_ms;
+}
+
+bool Timer::cancel()
+{
+    // 自引用在解锁后才释放
+    Timer::ptr self;
+    TimerManager::RWMutexType::WriteLock lock(m_manager->m_mutex);
+    if(m_cb){
+        m_cb = nullptr;
+        if(m_level >= 0){
+            m_manager->remove(this);
+        }
+        self.swap(m_self);
+        return true;
+    }
+    return false;
+}
+
+bool Timer::refresh()
+{
+    TimerManager::RWMutexType::WriteLock lock(m_manager->m_mutex);
+    if(!m_cb || m_level < 0){
+        return false;
+    }
+    // 只会往后推迟, 不需要通知
+    m_manager->remove(this);
+    m_next = sylar::GetMonotonicMS() + m_ms;
+    m_manager->insert(this);
+    return true;
+}
+
+bool Timer::reset(uint64_t ms, bool from_now)
+{
+    if(ms == m_ms && !from_now){
+        return true;
+    }
+    TimerManager::RWMutexType::WriteLock lock(m_manager->m_mutex);
+    if(!m_cb || m_level < 0){
+        return false;
+    }
+    m_manager->remove(this);
+    Timer::ptr self;
+    self.swap(m_self);
+    uint64_t start = 0;
+    if(from_now){
+        start = sylar::GetMonotonicMS();
+    }
+    else{
+        start = m_next - m_ms;
+    }
+    m_ms = ms;
+    m_next = start + m_ms;
+    m_manager->addTimer(self, lock);
+    return true;
+}
+
+TimerManager::TimerManager()
+{
+    memset(m_slots, 0, sizeof(m_slots));
+    memset(m_bitmap, 0, sizeof(m_bitmap));
+    m_current = sylar::GetMonotonicMS();
+}
+
+TimerManager::~TimerManager()
+{
+    std::vector<Timer::ptr> timers;
+    RWMutexType::WriteLock lock(m_mutex);
+    takeAll(timers);
+}
+
+Timer::ptr TimerManager::addTimer(uint64_t ms, std::function<void()> cb
+                                  ,bool recurring)
+{
+    Timer::ptr timer(new Timer(ms, cb, recurring, this));
+    RWMutexType::WriteLock lock(m_mutex);
+    addTimer(timer, lock);
+    return timer;
+}
+
+static void OnTimer(std::weak_ptr<void> weak_cond, std::function<void()> cb)
+{
+    std::shared_ptr<void> tmp = weak_cond.lock();
+    if(tmp){
+        cb();
+    }
+}
+
+Timer::ptr TimerManager::addConditionTimer(uint64_t ms, std::function<void()> cb
+                                    ,std::weak_ptr<void> weak_cond
+                                    ,bool recurring)
+{
+    return addTimer(ms, std::bind(&OnTimer, weak_cond, cb), recurring);
+}
+
+void TimerManager::addTimer(Timer::ptr val, RWMutexType::WriteLock& lock)
+{
+    val->m_self = val;
+    bool at_front = insert(val.get());
+    lock.unlock();
+
+    if(at_front){
+        onTimerInsertedAtFront();
+    }
+}
+
+uint64_t TimerManager::getNextTimer()
+{
+    RWMutexType::WriteLock lock(m_mutex);
+    if(m_count == 0){
+        m_notified = ~0ull;
+        return ~0ull;
+    }
+    uint64_t next = nextEventTime();
+    m_notified = next;
+    lock.unlock();
+
+    uint64_t now_ms = sylar::GetMonotonicMS();
+    return now_ms >= next ? 0 : next - now_ms;
+}
+
+void TimerManager::listExpiredCb(std::vector<std::function<void()> >& cbs)
+{
+    uint64_t now_ms = sylar::GetMonotonicMS();
+    std::vector<Timer::ptr> expired;
+    {
+        RWMutexType::ReadLock lock(m_mutex);
+        if(m_count == 0){
+            return;
+        }
+    }
+    RWMutexType::WriteLock lock(m_mutex);
+    if(m_count == 0){
+        return;
+    }
+
+    advance(now_ms, expired);
+
+    cbs.reserve(cbs.size() + expired.size());
+    for(auto& timer : expired){
+        if(timer->m_recurring){
+            cbs.push_back(timer->m_cb);
+            timer->m_next = now_ms + timer->m_ms;
+            timer->m_self = timer;
+            insert(timer.get());
+        }
+        else{
+            cbs.push_back(std::move(timer->m_cb));
+            timer->m_cb = nullptr;
+        }
+    }
+}
+
+bool TimerManager::hasTimer()
+{
+    RWMutexType::ReadLock lock(m_mutex);
+    return m_count != 0;
+}
+
+bool TimerManager::insert(Timer* timer)
+{
+    uint64_t t = timer->m_next;
+    // 已经过期的放到当前槽, 下次推进时立即触发
+    if(t < m_current){
+        t = m_current;
+    }
+    uint64_t delta = t - m_current;
+    int level = 0;
+    int slot = 0;
+    if(delta < (uint64_t)s_slots0){
+        slot = t & (s_slots0 - 1);
+    }
+    else{
+        for(level = 1; level < s_levels; ++level){
+            if(delta < (1ull << (LevelShift(level) + 6))){
+                break;
+            }
+        }
+        if(level == s_levels){
+            // 超出时间轮跨度, 先放到最高层最远的槽, 下放时再按真实时间重新定位
+            level = s_levels - 1;
+            t = m_current + (1ull << (LevelShift(level) + 6)) - 1;
+        }
+        slot = (t >> LevelShift(level)) & (s_slots - 1);
+    }
+
+    Timer*& head = m_slots[level][slot];
+    timer->m_prev = nullptr;
+    timer->m_succ = head;
+    if(head){
+        head->m_prev = timer;
+    }
+    head = timer;
+    m_bitmap[level][slot >> 6] |= 1ull << (slot & 63);
+    timer->m_level = level;
+    timer->m_slot = slot;
+    ++m_count;
+
+    if(timer->m_next < m_notified){
+        m_notified = timer->m_next;
+        return true;
+    }
+    return false;
+}
+
+void TimerManager::remove(Timer* timer)
+{
+    SYLAR_ASSERT(timer->m_level >= 0);
+    int level = timer->m_level;
+    int slot = timer->m_slot;
+    if(timer->m_prev){
+        timer->m_prev->m_succ = timer->m_succ;
+    }
+    else{
+        m_slots[level][slot] = timer->m_succ;
+        if(!timer->m_succ){
+            m_bitmap[level][slot >> 6] &= ~(1ull << (slot & 63));
+        }
+    }
+    if(timer->m_succ){
+        timer->m_succ->m_prev = timer->m_prev;
+    }
+    timer->m_prev = timer->m_succ = nullptr;
+    timer->m_level = timer->m_slot = -1;
+    --m_count;
+}
+
+Timer* TimerManager::takeSlot(int level, int idx)
+{
+    Timer* head = m_slots[level][idx];
+    m_slots[level][idx] = nullptr;
+    m_bitmap[level][idx >> 6] &= ~(1ull << (idx & 63));
+    return head;
+}
+
+void TimerManager::cascade(int level, int idx)
+{
+    Timer* timer = takeSlot(level, idx);
+    while(timer){
+        Timer* next = timer->m_succ;
+        timer->m_level = timer->m_slot = -1;
+        --m_count;
+        insert(timer);
+        timer = next;
+    }
+}
+
+void TimerManager::takeAll(std::vector<Timer::ptr>& expired)
+{
+    for(int level = 0; level < s_levels; ++level){
+        int slots = level == 0 ? s_slots0 : s_slots;
+        for(int idx = 0; idx < slots; ++idx){
+            Timer* timer = takeSlot(level, idx);
+            while(timer){
+                Timer* next = timer->m_succ;
+                timer->m_prev = timer->m_succ = nullptr;
+                timer->m_level = timer->m_slot = -1;
+                expired.push_back(std::move(timer->m_self));
+                timer = next;
+            }
+        }
+    }
+    m_count = 0;
+}
+
+uint64_t TimerManager::nextEventTime() const
+{
+    uint64_t best = ~0ull;
+    int d = FindNext(m_bitmap[0], s_slots0 / 64, m_current & (s_slots0 - 1));
+    if(d >= 0){
+        best = m_current + d;
+    }
+    for(int level = 1; level < s_levels; ++level){
+        int shift = LevelShift(level);
+        uint64_t cur = m_current >> shift;
+        d = FindNext(m_bitmap[level], 1, cur & (s_slots - 1));
+        if(d < 0){
+            continue;
+        }
+        // 当前槽只有在m_current恰好落在边界(还没下放)时才属于本圈, 否则是下一圈
+        if(d == 0 && (m_current & ((1ull << shift) - 1))){
+            d = s_slots;
+        }
+        uint64_t t = (cur + d) << shift;
+        if(t < best){
+            best = t;
+        }
+    }
+    return best;
+}
+
+void TimerManager::advance(uint64_t now_ms, std::vector<Timer::ptr>& expired)
+{
+    // 直接跳到下一个有定时器的时间点, 空闲的时间段不逐毫秒推进
+    while(m_count && m_current <= now_ms){
+        uint64_t t = nextEventTime();
+        if(t > now_ms){
+            break;
+        }
+        m_current = t;
+        // 从高层往低层下放, 高层下放的定时器可能落到低层当前的槽
+        for(int level = s_levels - 1; level > 0; --level){
+            int shift = LevelShift(level);
+            if(t & ((1ull << shift) - 1)){
+                continue;
+            }
+            cascade(level, (t >> shift) & (s_slots - 1));
+        }
+
+        Timer* timer = takeSlot(0, t & (s_slots0 - 1));
+        while(timer){
+            Timer* next = timer->m_succ;
+            timer->m_prev = timer->m_succ = nullptr;
+            timer->m_level = timer->m_slot = -1;
+            --m_count;
+            expired.push_back(std::move(timer->m_self));
+            timer = next;
+        }
+        m_current = t + 1;
+    }
+    if(m_current <= now_ms){
+        m_current = now_ms + 1;
+    }
+}
+
+}
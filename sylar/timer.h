@@ -0,0 +1,111 @@
+#ifndef __SYLAR_TIMER_H__
+#define __SYLAR_TIMER_H__
+
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+#include "mutex.h"
+
+namespace sylar{
+
+class TimerManager;
+
+// 定时器, 由TimerManager创建
+class Timer : public std::enable_shared_from_this<Timer>{
+friend class TimerManager;
+public:
+    typedef std::shared_ptr<Timer> ptr;
+
+    // 取消定时器, 已经触发(非循环)或已取消时返回false
+    bool cancel();
+    // 从现在起重新计时
+    bool refresh();
+    // 修改周期, from_now为true时从现在起计时, 否则从上次的起点计时
+    bool reset(uint64_t ms, bool from_now);
+private:
+    Timer(uint64_t ms, std::function<void()> cb,
+          bool recurring, TimerManager* manager);
+private:
+    bool m_recurring = false;
+    // 周期(ms)
+    uint64_t m_ms = 0;
+    // 到期时间, 单调时钟(GetMonotonicMS)的毫秒数
+    uint64_t m_next = 0;
+    std::function<void()> m_cb;
+    TimerManager* m_manager = nullptr;
+
+    // 时间轮槽位中的侵入式双向链表, m_level < 0 表示不在时间轮中
+    Timer* m_prev = nullptr;
+    Timer* m_succ = nullptr;
+    int m_level = -1;
+    int m_slot = -1;
+    // 在时间轮中时持有自身, 保证用户丢掉Timer::ptr后仍能触发
+    Timer::ptr m_self;
+};
+
+// 定时器管理器, 基于分层时间轮, 精度1ms, 使用单调时钟, 不受系统时间调整影响
+// 第0层256个槽, 每槽1ms; 第1~4层各64个槽, 每槽覆盖下一层一圈, 总跨度2^32ms(约49天)
+// 添加和取消都是O(1)的链表操作, 推进时间时高层的槽整体下放到低层
+// 每层一个位图记录非空槽, 查找下一个到期时间和跳过空闲时间段不需要逐槽扫描
+class TimerManager{
+friend class Timer;
+public:
+    typedef RWMutex RWMutexType;
+
+    TimerManager();
+    virtual ~TimerManager();
+
+    // 添加定时器, ms毫秒后触发, recurring为true时周期触发
+    Timer::ptr addTimer(uint64_t ms, std::function<void()> cb
+                        ,bool recurring = false);
+    // 添加条件定时器, 触发时weak_cond指向的对象已经释放则不执行cb
+    Timer::ptr addConditionTimer(uint64_t ms, std::function<void()> cb
+                        ,std::weak_ptr<void> weak_cond
+                        ,bool recurring = false);
+    // 到下一个定时器到期的毫秒数, 没有定时器时返回~0ull
+    // 高层的槽只能给出下界, 返回值可能早于实际到期时间(到时会下放后重新计算)
+    uint64_t getNextTimer();
+    // 取出所有已到期定时器的回调, 循环定时器重新加入
+    void listExpiredCb(std::vector<std::function<void()> >& cbs);
+    bool hasTimer();
+protected:
+    // 新加入的定时器早于上次getNextTimer给出的时间, 需要唤醒等待者重新计算超时
+    virtual void onTimerInsertedAtFront() = 0;
+    // 把定时器加入时间轮, 解锁后按需通知
+    void addTimer(Timer::ptr val, RWMutexType::WriteLock& lock);
+private:
+    static const int s_levels = 5;
+    static const int s_slots0 = 256;
+    static const int s_slots = 64;
+
+    // 以下都需要持有写锁
+    // 加入时间轮, 返回是否早于上次给出的下一个到期时间
+    bool insert(Timer* timer);
+    void remove(Timer* timer);
+    // 把level层idx槽的定时器重新放入时间轮
+    void cascade(int level, int idx);
+    // 取出level层idx槽的全部定时器
+    Timer* takeSlot(int level, int idx);
+    // 取出全部定时器(析构时)
+    void takeAll(std::vector<Timer::ptr>& expired);
+    // 推进到now_ms, 取出到期的定时器
+    void advance(uint64_t now_ms, std::vector<Timer::ptr>& expired);
+    // 时间轮中下一个需要处理的时间点: 第0层的到期槽或高层槽的下放时刻
+    uint64_t nextEventTime() const;
+
+private:
+    RWMutexType m_mutex;
+    // 时间轮的当前时间, 早于它的时间点都已经处理过
+    uint64_t m_current = 0;
+    size_t m_count = 0;
+    // 上次getNextTimer给出的到期时间, 新定时器早于它时才通知
+    uint64_t m_notified = ~0ull;
+    Timer* m_slots[s_levels][s_slots0];
+    uint64_t m_bitmap[s_levels][s_slots0 / 64];
+};
+
+}
+
+#endif
@@ -0,0 +1,296 @@
+#include "trace.h"
+#include "config.h"
+#include "fiber.h"
+#include "thread.h"
+#include "util.h"
+#include "log.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+namespace sylar{
+
+static Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+static ConfigVar<bool>::ptr g_trace_enabled =
+    Config::Lookup<bool>("trace.enabled", false, "record SYLAR_TRACE_SCOPE spans");
+static ConfigVar<uint32_t>::ptr g_trace_buffer_size =
+    Config::Lookup<uint32_t>("trace.buffer_size", 65536, "spans kept per thread, rounded up to a power of two, the oldest are overwritten");
+
+std::atomic<bool> Tracer::s_enabled {false};
+// 新线程创建缓冲区时读取, 已有的缓冲区大小不变
+static std::atomic<uint32_t> s_buffer_size {65536};
+
+struct TracerIniter{
+    TracerIniter(){
+        if(g_trace_enabled->getValue()){
+            TscClock::IsAvailable();
+        }
+        Tracer::s_enabled = g_trace_enabled->getValue();
+        s_buffer_size = g_trace_buffer_size->getValue();
+        g_trace_enabled->addListener(0x7A0001, [](const bool& old_value, const bool& new_value){
+            if(new_value){
+                // 开启时先完成时钟校准, 不让第一个区间等待
+                TscClock::IsAvailable();
+            }
+            Tracer::s_enabled = new_value;
+        });
+        g_trace_buffer_size->addListener(0x7A0002, [](const uint32_t& old_value, const uint32_t& new_value){
+            s_buffer_size = new_value;
+        });
+    }
+};
+
+// 单写者环形缓冲区, 只有所属线程写入, 导出时其它线程读取
+// m_tail 是写入的总数, 写完一条再release发布; 读者拷贝后再读一次m_tail,
+// 丢弃拷贝期间可能被覆盖的记录
+class TraceBuffer{
+public:
+    typedef std::shared_ptr<TraceBuffer> ptr;
+
+    TraceBuffer(uint32_t capacity)
+        :m_threadId(GetThreadID())
+        ,m_threadName(Thread::GetName()){
+        uint32_t n = 64;
+        while(n < capacity && n < (1u << 24)){
+            n <<= 1;
+        }
+        m_events.resize(n);
+        m_mask = n - 1;
+        // 高位是缓冲区序号, 区间id在进程内唯一且不需要共享计数
+        static std::atomic<uint64_t> s_index {0};
+        m_nextId = (++s_index) << 40;
+    }
+
+    uint64_t nextId() { return ++m_nextId;}
+
+    void push(const TraceEvent& e){
+        uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        m_events[tail & m_mask] = e;
+        m_tail.store(tail + 1, std::memory_order_release);
+    }
+
+    void collect(std::vector<TraceEvent>& out) const{
+        uint64_t size = m_mask + 1;
+        uint64_t tail = m_tail.load(std::memory_order_acquire);
+        uint64_t begin = std::max(tail > size ? tail - size : 0
+                                  ,m_cleared.load(std::memory_order_relaxed));
+        out.clear();
+        for(uint64_t i = begin; i < tail; ++i){
+            out.push_back(m_events[i & m_mask]);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // 写者正在写第tail2条, 会覆盖第tail2 - size条
+        uint64_t tail2 = m_tail.load(std::memory_order_relaxed);
+        if(tail2 >= size && tail2 - size + 1 > begin){
+            size_t drop = std::min<uint64_t>(tail2 - size + 1 - begin, out.size());
+            out.erase(out.begin(), out.begin() + drop);
+        }
+    }
+
+    void clear() { m_cleared.store(m_tail.load(std::memory_order_acquire), std::memory_order_relaxed);}
+
+    uint32_t getThreadId() const { return m_threadId;}
+    const std::string& getThreadName() const { return m_threadName;}
+    bool isExited() const { return m_exited;}
+    void setExited() { m_exited = true;}
+private:
+    uint32_t m_threadId;
+    std::string m_threadName;
+    std::vector<TraceEvent> m_events;
+    uint64_t m_mask = 0;
+    uint64_t m_nextId = 0;
+    std::atomic<uint64_t> m_tail {0};
+    std::atomic<uint64_t> m_cleared {0};
+    std::atomic<bool> m_exited {false};
+};
+
+static Mutex& GetBuffersMutex()
+{
+    static Mutex s_mutex;
+    return s_mutex;
+}
+
+static std::vector<TraceBuffer::ptr>& GetBuffers()
+{
+    static std::vector<TraceBuffer::ptr> s_buffers;
+    return s_buffers;
+}
+
+// 线程退出时标记缓冲区, 记录保留到下一次Clear
+struct TraceBufferHolder{
+    TraceBuffer::ptr buffer;
+    ~TraceBufferHolder(){
+        if(buffer){
+            buffer->setExited();
+        }
+    }
+};
+
+static thread_local TraceBufferHolder t_holder;
+static thread_local TraceBuffer* t_buffer = nullptr;
+
+static TraceBuffer* GetThreadBuffer()
+{
+    if(SYLAR_LIKELY(t_buffer != nullptr)){
+        return t_buffer;
+    }
+    TraceBuffer::ptr buffer(new TraceBuffer(s_buffer_size));
+    {
+        Mutex::Lock lock(GetBuffersMutex());
+        GetBuffers().push_back(buffer);
+    }
+    t_holder.buffer = buffer;
+    t_buffer = buffer.get();
+    return t_buffer;
+}
+
+void TraceScope::begin(const char* name)
+{
+    TraceBuffer* buffer = GetThreadBuffer();
+    m_name = name;
+    m_id = buffer->nextId();
+    m_parent = Fiber::GetTraceSpan();
+    Fiber::SetTraceSpan(m_id);
+    m_begin = TscClock::Now();
+}
+
+void TraceScope::end()
+{
+    TraceEvent e;
+    e.end = TscClock::Now();
+    e.name = m_name;
+    e.begin = m_begin;
+    e.id = m_id;
+    e.parent = m_parent;
+    e.fiberId = Fiber::GetFiberId();
+    // 协程可能在区间内切换到其它线程, 写入结束时所在线程的缓冲区
+    GetThreadBuffer()->push(e);
+    Fiber::SetTraceSpan(m_parent);
+}
+
+void Tracer::SetEnabled(bool v)
+{
+    // 由监听器更新s_enabled
+    g_trace_enabled->setValue(v);
+}
+
+uint64_t Tracer::GetCurrentSpanId()
+{
+    return Fiber::GetTraceSpan();
+}
+
+std::vector<TraceThread> Tracer::Collect()
+{
+    std::vector<TraceBuffer::ptr> buffers;
+    {
+        Mutex::Lock lock(GetBuffersMutex());
+        buffers = GetBuffers();
+    }
+    std::vector<TraceThread> rt(buffers.size());
+    for(size_t i = 0; i < buffers.size(); ++i){
+        rt[i].threadId = buffers[i]->getThreadId();
+        rt[i].threadName = buffers[i]->getThreadName();
+        buffers[i]->collect(rt[i].events);
+    }
+    return rt;
+}
+
+void Tracer::Clear()
+{
+    Mutex::Lock lock(GetBuffersMutex());
+    auto& buffers = GetBuffers();
+    for(auto& i : buffers){
+        i->clear();
+    }
+    buffers.erase(std::remove_if(buffers.begin(), buffers.end()
+                ,[](const TraceBuffer::ptr& b){ return b->isExited();}), buffers.end());
+}
+
+static void JsonEscape(std::ostream& os, const std::string& str)
+{
+    static const char* s_hex = "0123456789abcdef";
+    for(unsigned char c : str){
+        switch(c){
+            case '"':
+                os << "\\\"";
+                break;
+            case '\\':
+                os << "\\\\";
+                break;
+            case '\n':
+                os << "\\n";
+                break;
+            case '\t':
+                os << "\\t";
+                break;
+            default:
+                if(c < 0x20){
+                    os << "\\u00" << s_hex[c >> 4] << s_hex[c & 0xF];
+                }
+                else{
+                    os << c;
+                }
+        }
+    }
+}
+
+// 微秒, 保留纳秒精度
+static void WriteUs(std::ostream& os, uint64_t ns)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%lu.%03lu", (unsigned long)(ns / 1000), (unsigned long)(ns % 1000));
+    os << buf;
+}
+
+std::string Tracer::ToChromeJson()
+{
+    std::vector<TraceThread> threads = Collect();
+    uint64_t base = ~0ull;
+    for(auto& t : threads){
+        for(auto& e : t.events){
+            base = std::min(base, e.begin);
+        }
+    }
+    pid_t pid = getpid();
+    std::stringstream ss;
+    ss << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for(auto& t : threads){
+        ss << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":"
+           << std::dec << pid << ",\"tid\":" << t.threadId << ",\"args\":{\"name\":\"";
+        JsonEscape(ss, t.threadName);
+        ss << "\"}}";
+        first = false;
+        for(auto& e : t.events){
+            ss << ",\n{\"name\":\"";
+            JsonEscape(ss, e.name);
+            ss << "\",\"cat\":\"sylar\",\"ph\":\"X\",\"ts\":";
+            WriteUs(ss, e.begin - base);
+            ss << ",\"dur\":";
+            WriteUs(ss, e.end - e.begin);
+            ss << ",\"pid\":" << pid << ",\"tid\":" << t.threadId
+               << ",\"args\":{\"span\":\"" << std::hex << e.id
+               << "\",\"parent\":\"" << e.parent
+               << "\",\"fiber\":" << std::dec << e.fiberId << "}}";
+        }
+    }
+    ss << "\n]}\n";
+    return ss.str();
+}
+
+bool Tracer::DumpChromeJson(const std::string& path)
+{
+    std::ofstream ofs(path, std::ios::trunc);
+    if(!ofs){
+        SYLAR_LOG_ERROR(g_logger) << "open trace file " << path << " fail";
+        return false;
+    }
+    ofs << ToChromeJson();
+    return (bool)ofs;
+}
+
+static TracerIniter __tracer_init;
+
+}
@@ -0,0 +1,91 @@
+#ifndef __SYLAR_TRACE_H__
+#define __SYLAR_TRACE_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+#include "noncopyable.h"
+#include "macro.h"
+
+namespace sylar{
+
+// 进程内的区间追踪, 用于排查延迟
+// SYLAR_TRACE_SCOPE("name") 记录所在作用域的开始结束时间、线程和协程, 区间可以嵌套, 内层记录外层的id
+// 每个线程写自己的环形缓冲区(只有一个写者, 没有锁), 写满后覆盖最旧的记录, 导出时最多保留 trace.buffer_size - 1 条
+// 由配置 trace.enabled 控制, 关闭时每个区间只有一次原子读
+// 导出为Chrome trace JSON, 可以在 chrome://tracing 或 ui.perfetto.dev 中打开
+
+// 一个结束的区间
+struct TraceEvent{
+    const char* name;   // 需要是字符串常量, 只保存指针
+    uint64_t begin;     // TscClock, 纳秒
+    uint64_t end;
+    uint64_t id;
+    uint64_t parent;    // 外层区间的id, 没有时为0
+    uint64_t fiberId;
+};
+
+// 一个线程的记录
+struct TraceThread{
+    uint32_t threadId;
+    std::string threadName;
+    std::vector<TraceEvent> events;     // 按结束时间排序
+};
+
+class Tracer{
+public:
+    static bool IsEnabled() { return s_enabled.load(std::memory_order_relaxed);}
+    // 修改配置 trace.enabled
+    static void SetEnabled(bool v);
+
+    // 当前协程(不在协程中时为当前线程)所在区间的id, 不在区间中返回0
+    // 日志格式 %S 输出这个值, 与导出的 args.span 相同
+    static uint64_t GetCurrentSpanId();
+
+    // 所有线程缓冲区中的记录, 包括已经退出的线程
+    static std::vector<TraceThread> Collect();
+    // 丢弃已有的记录, 并释放已退出线程的缓冲区
+    static void Clear();
+
+    static std::string ToChromeJson();
+    static bool DumpChromeJson(const std::string& path);
+private:
+    friend struct TracerIniter;
+    static std::atomic<bool> s_enabled;
+};
+
+// 作用域内的区间, 析构时写入当前线程的缓冲区
+class TraceScope : Noncopyable{
+public:
+    TraceScope(const char* name){
+        if(SYLAR_UNLIKELY(Tracer::IsEnabled())){
+            begin(name);
+        }
+    }
+    ~TraceScope(){
+        if(SYLAR_UNLIKELY(m_name != nullptr)){
+            end();
+        }
+    }
+
+    uint64_t getId() const { return m_id;}
+private:
+    void begin(const char* name);
+    void end();
+private:
+    const char* m_name = nullptr;
+    uint64_t m_begin = 0;
+    uint64_t m_id = 0;
+    uint64_t m_parent = 0;
+};
+
+}
+
+#define SYLAR_TRACE_CONCAT_IMPL(a, b) a##b
+#define SYLAR_TRACE_CONCAT(a, b) SYLAR_TRACE_CONCAT_IMPL(a, b)
+#define SYLAR_TRACE_SCOPE(name) \
+    sylar::TraceScope SYLAR_TRACE_CONCAT(sylar_trace_scope_, __LINE__)(name)
+
+#endif
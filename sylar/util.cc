@@ -1,13 +1,162 @@
 #include "util.h"
+#include "fiber.h"
+#include <dirent.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
 
 namespace sylar{
 
 pid_t GetThreadID(){
-    return syscall(SYS_gettid);
+    // 线程id在线程生命周期内不变, 只在第一次调用时走系统调用
+    static thread_local pid_t t_tid = 0;
+    if(!t_tid){
+        t_tid = syscall(SYS_gettid);
+    }
+    return t_tid;
 }
 
 uint32_t GetFiberID()
 {
-    return 0;
+    return sylar::Fiber::GetFiberId();
+}
+
+uint64_t GetCurrentMS()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000ul + tv.tv_usec / 1000;
+}
+
+uint64_t GetCurrentUS()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000 * 1000ul + tv.tv_usec;
+}
+
+uint64_t GetMonotonicNS()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ul + ts.tv_nsec;
+}
+
+uint64_t GetMonotonicUS()
+{
+    return GetMonotonicNS() / 1000;
+}
+
+uint64_t GetMonotonicMS()
+{
+    return GetMonotonicNS() / 1000000;
+}
+
+static uint64_t GetStartMS()
+{
+    static uint64_t s_start = GetMonotonicMS();
+    return s_start;
+}
+
+// 库加载时记下起点, 不等到第一次输出日志
+static uint64_t s_start_anchor = GetStartMS();
+
+uint64_t GetElapsedMS()
+{
+    return GetMonotonicMS() - GetStartMS();
+}
+
+// 计数器频率恒定且各核同步
+static bool HasInvariantCounter()
+{
+#if defined(__x86_64__)
+    uint32_t eax, ebx, ecx, edx;
+    __asm__ __volatile__("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0x80000000), "c"(0));
+    if(eax < 0x80000007){
+        return false;
+    }
+    __asm__ __volatile__("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0x80000007), "c"(0));
+    return edx & (1u << 8);
+#elif defined(__aarch64__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+TscClock::Param TscClock::Calibrate()
+{
+    Param p = {false, 0, 0, 0, 0};
+    if(!HasInvariantCounter()){
+        return p;
+    }
+    // 忙等约10ms, 两端各取一次两个时钟
+    uint64_t ns0 = GetMonotonicNS();
+    uint64_t c0 = ReadCycles();
+    uint64_t ns1 = ns0;
+    while(ns1 - ns0 < 10000000){
+        ns1 = GetMonotonicNS();
+    }
+    uint64_t c1 = ReadCycles();
+    if(c1 <= c0){
+        return p;
+    }
+    double ns_per_cycle = (double)(ns1 - ns0) / (c1 - c0);
+    p.available = true;
+    p.baseCycles = c1;
+    p.baseNs = ns1;
+    p.mult = (uint64_t)(ns_per_cycle * 4294967296.0);
+    p.cyclesPerNs = 1 / ns_per_cycle;
+    return p;
+}
+
+void FSUtil::ListAllFile(std::vector<std::string>& files, const std::string& path, 
+                        const std::string& subfix)
+{
+    if(access(path.c_str(), 0) != 0){
+        return;
+    }
+    DIR* dir = opendir(path.c_str());
+    if(dir == nullptr){
+        return;
+    }
+    struct dirent* dp = nullptr;
+    while((dp = readdir(dir)) != nullptr){
+        unsigned char type = dp->d_type;
+        if(type == DT_LNK || type == DT_UNKNOWN){
+            // 符号链接和不填d_type的文件系统用stat判断, 只跟随指向文件的链接, 不进入链接的目录以免循环
+            struct stat st;
+            std::string full = path + "/" + dp->d_name;
+            if(lstat(full.c_str(), &st) == 0 && S_ISDIR(st.st_mode)){
+                type = DT_DIR;
+            }
+            else if(stat(full.c_str(), &st) == 0 && S_ISREG(st.st_mode)){
+                type = DT_REG;
+            }
+        }
+        if(type == DT_DIR){
+            if(!strcmp(dp->d_name, ".") || !strcmp(dp->d_name, "..")){
+                continue;
+            }
+            ListAllFile(files, path + "/" + dp->d_name, subfix);
+        }
+        else if(type == DT_REG){
+            std::string filename(dp->d_name);
+            if(subfix.empty()){
+                files.push_back(path + "/" + filename);
+            }
+            else{
+                if(filename.size() < subfix.size()){
+                    continue;
+                }
+                if(filename.substr(filename.length() - subfix.size()) == subfix){
+                    files.push_back(path + "/" + filename);
+                }
+            }
+        }
+    }
+    closedir(dir);
+}
+
 }
-}
\ No newline at end of file
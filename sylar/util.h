@@ -7,12 +7,83 @@
 #include <sys/syscall.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string>
+#include <vector>
 
 namespace sylar {
 
 pid_t GetThreadID();
 uint32_t GetFiberID();
 
+// 墙上时间, 毫秒/微秒
+uint64_t GetCurrentMS();
+uint64_t GetCurrentUS();
+
+// 单调时钟, 不受系统时间调整影响, 计算时间间隔和超时用这一组
+// clock_gettime(CLOCK_MONOTONIC) 由vDSO在用户态完成, 不进入内核
+uint64_t GetMonotonicNS();
+uint64_t GetMonotonicUS();
+uint64_t GetMonotonicMS();
+
+// 进程启动(库初始化)以来的毫秒数, 日志的 %r
+uint64_t GetElapsedMS();
+
+// 读CPU时间戳计数器的单调时钟, 返回值和GetMonotonicNS在同一时间轴上(纳秒), 比它便宜一半以上
+// 只在计数器频率恒定且各核同步时启用(x86_64的不变TSC, aarch64的cntvct), 否则以及其它平台退回GetMonotonicNS
+// 第一次使用时阻塞约10ms校准频率, 误差约1e-5, 适合测量短间隔, 长时间累计会和单调时钟有偏差
+class TscClock{
+public:
+    static bool IsAvailable() { return GetParam().available;}
+    static uint64_t Now(){
+#if defined(__x86_64__) || defined(__aarch64__)
+        const Param& p = GetParam();
+        if(__builtin_expect(!p.available, 0)){
+            return GetMonotonicNS();
+        }
+        // 各核的计数器之间有少量偏差, 刚校准完在别的核上可能读到比基准小的值, 按0算, 避免回绕成很大的时间
+        uint64_t cycles = ReadCycles();
+        uint64_t delta = cycles > p.baseCycles ? cycles - p.baseCycles : 0;
+        return p.baseNs + (uint64_t)(((unsigned __int128)delta * p.mult) >> 32);
+#else
+        return GetMonotonicNS();
+#endif
+    }
+    // 计数器的原始值, 不可用时返回0
+    static uint64_t ReadCycles(){
+#if defined(__x86_64__)
+        return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+        uint64_t v;
+        __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(v));
+        return v;
+#else
+        return 0;
+#endif
+    }
+    // 每纳秒的计数, 不可用时返回0
+    static double GetFrequency() { return GetParam().cyclesPerNs;}
+private:
+    struct Param{
+        bool available;
+        uint64_t baseCycles;
+        uint64_t baseNs;
+        uint64_t mult;          // 每个计数的纳秒数 * 2^32
+        double cyclesPerNs;
+    };
+    static Param Calibrate();
+    static const Param& GetParam(){
+        static Param s_param = Calibrate();
+        return s_param;
+    }
+};
+
+class FSUtil{
+public:
+    // 递归列出path下所有以subfix结尾的文件
+    static void ListAllFile(std::vector<std::string>& files, const std::string& path, 
+                            const std::string& subfix);
+};
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,143 @@
+#ifndef __SYLAR_WORK_STEALING_QUEUE_H__
+#define __SYLAR_WORK_STEALING_QUEUE_H__
+
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+#include "noncopyable.h"
+
+namespace sylar{
+
+// Chase-Lev 工作窃取双端队列
+// 只有所属线程可以push/pop(底部, LIFO), 其它线程通过steal从顶部取(FIFO)
+// 内存序参考 Lê et al. "Correct and Efficient Work-Stealing for Weak Memory Models"
+// T 必须是可以放进std::atomic的平凡类型, 一般是指针
+template<class T>
+class WorkStealingQueue : Noncopyable{
+private:
+    // 环形数组, 容量为2的幂, 扩容时整体复制
+    struct Array{
+        Array(size_t c)
+            :capacity(c)
+            ,mask(c - 1)
+            ,data(new std::atomic<T>[c]){
+        }
+
+        ~Array(){
+            delete[] data;
+        }
+
+        void put(int64_t i, T v){
+            data[i & mask].store(v, std::memory_order_relaxed);
+        }
+
+        T get(int64_t i) const{
+            return data[i & mask].load(std::memory_order_relaxed);
+        }
+
+        Array* grow(int64_t bottom, int64_t top) const{
+            Array* rt = new Array(capacity * 2);
+            for(int64_t i = top; i < bottom; ++i){
+                rt->put(i, get(i));
+            }
+            return rt;
+        }
+
+        size_t capacity;
+        size_t mask;
+        std::atomic<T>* data;
+    };
+public:
+    WorkStealingQueue(size_t capacity = 256)
+        :m_top(0)
+        ,m_bottom(0){
+        size_t c = 1;
+        while(c < capacity){
+            c <<= 1;
+        }
+        m_array.store(new Array(c), std::memory_order_relaxed);
+    }
+
+    ~WorkStealingQueue(){
+        for(auto i : m_garbage){
+            delete i;
+        }
+        delete m_array.load(std::memory_order_relaxed);
+    }
+
+    // 所属线程从底部压入
+    void push(T v){
+        int64_t b = m_bottom.load(std::memory_order_relaxed);
+        int64_t t = m_top.load(std::memory_order_acquire);
+        Array* a = m_array.load(std::memory_order_relaxed);
+        if(b - t > (int64_t)a->capacity - 1){
+            // 窃取者可能还在读旧数组, 旧数组留到队列析构时再释放
+            Array* n = a->grow(b, t);
+            m_garbage.push_back(a);
+            a = n;
+            m_array.store(a, std::memory_order_release);
+        }
+        a->put(b, v);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // 所属线程从底部弹出, 队列为空或最后一个元素被窃取时返回false
+    bool pop(T& v){
+        int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+        Array* a = m_array.load(std::memory_order_relaxed);
+        m_bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = m_top.load(std::memory_order_relaxed);
+        if(t > b){
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        v = a->get(b);
+        if(t == b){
+            // 只剩一个元素, 和窃取者竞争
+            bool ok = m_top.compare_exchange_strong(t, t + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed);
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+            return ok;
+        }
+        return true;
+    }
+
+    // 其它线程从顶部窃取, 队列为空或竞争失败时返回false
+    bool steal(T& v){
+        int64_t t = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = m_bottom.load(std::memory_order_acquire);
+        if(t >= b){
+            return false;
+        }
+        Array* a = m_array.load(std::memory_order_acquire);
+        v = a->get(t);
+        return m_top.compare_exchange_strong(t, t + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    // 近似大小, 只用于判断是否有任务
+    size_t size() const{
+        int64_t b = m_bottom.load(std::memory_order_relaxed);
+        int64_t t = m_top.load(std::memory_order_relaxed);
+        return b > t ? b - t : 0;
+    }
+
+    bool empty() const { return size() == 0;}
+private:
+    // top和bottom分别被窃取者和所属线程频繁修改, 用填充隔开到不同的缓存行
+    // (C++11的new不保证alignas超过16字节的对齐)
+    std::atomic<int64_t> m_top;
+    char m_pad1[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<int64_t> m_bottom;
+    char m_pad2[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<Array*> m_array;
+    std::vector<Array*> m_garbage;
+};
+
+}
+
+#endif
@@ -0,0 +1,71 @@
+#include "../sylar/backtrace.h"
+#include "../sylar/util.h"
+#include <execinfo.h>
+#include <stdlib.h>
+#include <iostream>
+
+// 调用栈的各部分开销, 栈深度约为 depth + 3
+// capture          Backtrace::Capture, 只取地址
+// glibc_symbols    backtrace + backtrace_symbols, 对照组: 每次都符号化
+// to_string_cold   第一次输出(查符号, 反修饰, 写缓存)
+// to_string_warm   再次输出, 全部命中缓存
+// 每项输出一行JSON
+// 用法: bench_backtrace [iterations] [depth]
+
+static void Report(const char* mode, uint64_t ops, uint64_t ns, size_t frames){
+    std::cout << "{\"bench\":\"backtrace\",\"mode\":\"" << mode << "\""
+              << ",\"ops\":" << ops
+              << ",\"frames\":" << frames
+              << ",\"ns_per_op\":" << (double)ns / ops
+              << "}" << std::endl;
+}
+
+template<class Func>
+__attribute__((noinline)) void Recurse(int depth, Func& func){
+    if(depth > 0){
+        Recurse(depth - 1, func);
+        __asm__ __volatile__("" ::: "memory");
+        return;
+    }
+    func();
+}
+
+int main(int argc, char** argv){
+    uint64_t iterations = argc > 1 ? atoll(argv[1]) : 100000;
+    int depth = argc > 2 ? atoi(argv[2]) : 10;
+
+    sylar::Backtrace::ptr bt;
+    auto capture = [&bt, iterations](){
+        uint64_t begin = sylar::GetMonotonicNS();
+        for(uint64_t i = 0; i < iterations; ++i){
+            bt = sylar::Backtrace::Capture();
+        }
+        Report("capture", iterations, sylar::GetMonotonicNS() - begin, bt->size());
+    };
+    Recurse(depth, capture);
+
+    uint64_t glibc_iterations = std::max<uint64_t>(iterations / 10, 1);
+    auto glibc = [glibc_iterations](){
+        void* buf[sylar::Backtrace::MAX_FRAMES];
+        int n = 0;
+        uint64_t begin = sylar::GetMonotonicNS();
+        for(uint64_t i = 0; i < glibc_iterations; ++i){
+            n = ::backtrace(buf, sylar::Backtrace::MAX_FRAMES);
+            char** symbols = backtrace_symbols(buf, n);
+            free(symbols);
+        }
+        Report("glibc_symbols", glibc_iterations, sylar::GetMonotonicNS() - begin, n);
+    };
+    Recurse(depth, glibc);
+
+    uint64_t begin = sylar::GetMonotonicNS();
+    std::string str = bt->toString();
+    Report("to_string_cold", 1, sylar::GetMonotonicNS() - begin, bt->size());
+
+    begin = sylar::GetMonotonicNS();
+    for(uint64_t i = 0; i < glibc_iterations; ++i){
+        str = bt->toString();
+    }
+    Report("to_string_warm", glibc_iterations, sylar::GetMonotonicNS() - begin, bt->size());
+    return 0;
+}
@@ -0,0 +1,192 @@
+#include "../sylar/bytearray.h"
+#include "../sylar/endian.h"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+#include <vector>
+
+// ByteArray 与 std::stringstream 的编解码吞吐对比
+// stringstream一侧同样写二进制(定长用write, varint逐字节put), 只比较缓冲区本身的开销
+//   fixed32: 定长网络字节序uint32
+//   varint64: zigzag+varint int64, 取值按指数分布, 覆盖1~10字节的编码
+//   string: varint长度前缀的字符串, 长度0~63
+// 每项输出一行JSON, 用法: bench_bytearray [count] [base_size]
+
+static uint64_t NowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void Report(const char* name, const char* impl, uint64_t ops
+                   ,uint64_t bytes, uint64_t ns){
+    std::cout << "{\"bench\":\"" << name << "\",\"impl\":\"" << impl
+        << "\",\"ops\":" << ops << ",\"ns_per_op\":" << (double)ns / ops
+        << ",\"mb_per_sec\":" << (bytes * 1e3 / ns) << "}" << std::endl;
+}
+
+static void SsWriteVarint(std::stringstream& ss, uint64_t v){
+    while(v >= 0x80){
+        ss.put((char)((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    ss.put((char)v);
+}
+
+static uint64_t SsReadVarint(std::stringstream& ss){
+    uint64_t result = 0;
+    for(int i = 0; i < 64; i += 7){
+        uint8_t b = (uint8_t)ss.get();
+        result |= ((uint64_t)(b & 0x7F)) << i;
+        if(b < 0x80){
+            break;
+        }
+    }
+    return result;
+}
+
+// 防止结果被优化掉
+static volatile uint64_t s_sink = 0;
+
+static void BenchFixed32(const std::vector<uint32_t>& vals, size_t base_size){
+    {
+        uint64_t begin = NowNs();
+        sylar::ByteArray ba(base_size);
+        for(auto v : vals){
+            ba.writeFuint32(v);
+        }
+        uint64_t mid = NowNs();
+        ba.setPosition(0);
+        uint64_t sum = 0;
+        for(size_t i = 0; i < vals.size(); ++i){
+            sum += ba.readFuint32();
+        }
+        uint64_t end = NowNs();
+        s_sink += sum;
+        Report("fixed32_encode", "bytearray", vals.size(), ba.getSize(), mid - begin);
+        Report("fixed32_decode", "bytearray", vals.size(), ba.getSize(), end - mid);
+    }
+    {
+        uint64_t begin = NowNs();
+        std::stringstream ss;
+        for(auto v : vals){
+            uint32_t n = sylar::byteswapOnLittleEndian(v);
+            ss.write((const char*)&n, sizeof(n));
+        }
+        uint64_t mid = NowNs();
+        uint64_t sum = 0;
+        for(size_t i = 0; i < vals.size(); ++i){
+            uint32_t n;
+            ss.read((char*)&n, sizeof(n));
+            sum += sylar::byteswapOnLittleEndian(n);
+        }
+        uint64_t end = NowNs();
+        s_sink += sum;
+        Report("fixed32_encode", "stringstream", vals.size(), vals.size() * 4, mid - begin);
+        Report("fixed32_decode", "stringstream", vals.size(), vals.size() * 4, end - mid);
+    }
+}
+
+static void BenchVarint64(const std::vector<int64_t>& vals, size_t base_size){
+    uint64_t bytes = 0;
+    {
+        uint64_t begin = NowNs();
+        sylar::ByteArray ba(base_size);
+        for(auto v : vals){
+            ba.writeInt64(v);
+        }
+        uint64_t mid = NowNs();
+        ba.setPosition(0);
+        uint64_t sum = 0;
+        for(size_t i = 0; i < vals.size(); ++i){
+            sum += ba.readInt64();
+        }
+        uint64_t end = NowNs();
+        s_sink += sum;
+        bytes = ba.getSize();
+        Report("varint64_encode", "bytearray", vals.size(), bytes, mid - begin);
+        Report("varint64_decode", "bytearray", vals.size(), bytes, end - mid);
+    }
+    {
+        uint64_t begin = NowNs();
+        std::stringstream ss;
+        for(auto v : vals){
+            SsWriteVarint(ss, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+        }
+        uint64_t mid = NowNs();
+        uint64_t sum = 0;
+        for(size_t i = 0; i < vals.size(); ++i){
+            uint64_t z = SsReadVarint(ss);
+            sum += (int64_t)((z >> 1) ^ -(z & 1));
+        }
+        uint64_t end = NowNs();
+        s_sink += sum;
+        Report("varint64_encode", "stringstream", vals.size(), bytes, mid - begin);
+        Report("varint64_decode", "stringstream", vals.size(), bytes, end - mid);
+    }
+}
+
+static void BenchString(const std::vector<std::string>& vals, size_t base_size){
+    uint64_t bytes = 0;
+    {
+        uint64_t begin = NowNs();
+        sylar::ByteArray ba(base_size);
+        for(auto& v : vals){
+            ba.writeStringVint(v);
+        }
+        uint64_t mid = NowNs();
+        ba.setPosition(0);
+        uint64_t sum = 0;
+        for(size_t i = 0; i < vals.size(); ++i){
+            sum += ba.readStringVint().size();
+        }
+        uint64_t end = NowNs();
+        s_sink += sum;
+        bytes = ba.getSize();
+        Report("string_encode", "bytearray", vals.size(), bytes, mid - begin);
+        Report("string_decode", "bytearray", vals.size(), bytes, end - mid);
+    }
+    {
+        uint64_t begin = NowNs();
+        std::stringstream ss;
+        for(auto& v : vals){
+            SsWriteVarint(ss, v.size());
+            ss.write(v.c_str(), v.size());
+        }
+        uint64_t mid = NowNs();
+        uint64_t sum = 0;
+        for(size_t i = 0; i < vals.size(); ++i){
+            std::string s;
+            s.resize(SsReadVarint(ss));
+            if(!s.empty()){
+                ss.read(&s[0], s.size());
+            }
+            sum += s.size();
+        }
+        uint64_t end = NowNs();
+        s_sink += sum;
+        Report("string_encode", "stringstream", vals.size(), bytes, mid - begin);
+        Report("string_decode", "stringstream", vals.size(), bytes, end - mid);
+    }
+}
+
+int main(int argc, char** argv){
+    size_t count = argc > 1 ? atoll(argv[1]) : 1000000;
+    size_t base_size = argc > 2 ? atoll(argv[2]) : 4096;
+    srand(12345);
+
+    std::vector<uint32_t> u32s;
+    std::vector<int64_t> i64s;
+    std::vector<std::string> strs;
+    for(size_t i = 0; i < count; ++i){
+        u32s.push_back(rand());
+        int64_t v = (int64_t)((((uint64_t)rand() << 32) | rand()) >> (rand() % 64));
+        i64s.push_back(rand() % 2 ? v : -v);
+        strs.push_back(std::string(rand() % 64, 'a' + i % 26));
+    }
+
+    BenchFixed32(u32s, base_size);
+    BenchVarint64(i64s, base_size);
+    BenchString(strs, base_size);
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include "../sylar/util.h"
+#include <chrono>
+#include <iostream>
+#include <time.h>
+
+// 各时钟的单次调用开销, 以及TSC时钟长时间运行后与单调时钟的偏差
+// 每项输出一行JSON
+// 用法: bench_clock [calls]
+
+template<class Func>
+static void Bench(const char* clock, uint64_t calls, Func func){
+    uint64_t sum = 0;
+    uint64_t begin = sylar::GetMonotonicNS();
+    for(uint64_t i = 0; i < calls; ++i){
+        sum += func();
+    }
+    uint64_t ns = sylar::GetMonotonicNS() - begin;
+    std::cout << "{\"bench\":\"clock\",\"clock\":\"" << clock << "\""
+              << ",\"calls\":" << calls
+              << ",\"ns_per_call\":" << (double)ns / calls
+              << ",\"checksum\":" << (sum & 1)
+              << "}" << std::endl;
+}
+
+int main(int argc, char** argv){
+    uint64_t calls = argc > 1 ? atoll(argv[1]) : 2000000;
+
+    // 先完成校准
+    std::cout << "{\"bench\":\"clock\",\"tsc_available\":" << sylar::TscClock::IsAvailable()
+              << ",\"cycles_per_ns\":" << sylar::TscClock::GetFrequency() << "}" << std::endl;
+
+    Bench("time", calls, [](){ return (uint64_t)time(0);});
+    Bench("GetCurrentMS", calls, [](){ return sylar::GetCurrentMS();});
+    Bench("GetCurrentUS", calls, [](){ return sylar::GetCurrentUS();});
+    Bench("GetMonotonicNS", calls, [](){ return sylar::GetMonotonicNS();});
+    Bench("GetElapsedMS", calls, [](){ return sylar::GetElapsedMS();});
+    Bench("steady_clock", calls, [](){
+        return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+    });
+    Bench("CLOCK_MONOTONIC_COARSE", calls, [](){
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return (uint64_t)ts.tv_nsec;
+    });
+    Bench("TscClock::ReadCycles", calls, [](){ return sylar::TscClock::ReadCycles();});
+    Bench("TscClock::Now", calls, [](){ return sylar::TscClock::Now();});
+
+    uint64_t tsc = sylar::TscClock::Now();
+    uint64_t mono = sylar::GetMonotonicNS();
+    std::cout << "{\"bench\":\"clock\",\"drift_ns\":" << (int64_t)(tsc - mono)
+              << ",\"since_calibration_ms\":" << sylar::GetElapsedMS() << "}" << std::endl;
+    return 0;
+}
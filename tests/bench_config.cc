@@ -0,0 +1,278 @@
+#include "../sylar/config.h"
+#include "../sylar/log.h"
+#include "person.h"
+#include <yaml-cpp/yaml.h>
+#include <chrono>
+#include <iostream>
+#include <new>
+#include <stdlib.h>
+
+// 配置子系统基准
+// 生成指定规模和深度的YAML(标量/LexicalCast支持的容器/Person结构体),
+// 测量 LoadFromYaml / Lookup / getValue / toString / 监听器回调
+// 每项输出一行JSON: {"bench":..., "ops":..., "ns_per_op":..., "allocs_per_op":...}
+// 用法: bench_config [keys] [depth] [iterations]
+
+// 替换全局 operator new 统计分配次数(对 libsylar/yaml-cpp 同样生效)
+// gcc 会把内联后的 malloc/free 配对误报为 new/delete 不匹配
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+static uint64_t s_alloc_count = 0;
+
+void* operator new(size_t size){
+    ++s_alloc_count;
+    void* p = malloc(size ? size : 1);
+    if(!p){
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept{
+    free(p);
+}
+
+static uint64_t NowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 计时并统计区间内的内存分配次数
+class BenchScope{
+public:
+    BenchScope(const std::string& name, uint64_t ops)
+        :m_name(name), m_ops(ops), m_allocs(s_alloc_count), m_begin(NowNs()){
+    }
+
+    ~BenchScope(){
+        uint64_t ns = NowNs() - m_begin;
+        uint64_t allocs = s_alloc_count - m_allocs;
+        std::cout << "{\"bench\":\"" << m_name << "\",\"ops\":" << m_ops
+            << ",\"ns_per_op\":" << (m_ops ? (double)ns / m_ops : 0)
+            << ",\"allocs_per_op\":" << (m_ops ? (double)allocs / m_ops : 0)
+            << "}" << std::endl;
+    }
+private:
+    std::string m_name;
+    uint64_t m_ops;
+    uint64_t m_allocs;
+    uint64_t m_begin;
+};
+
+enum KeyType{
+    INT = 0,
+    FLOAT,
+    BOOL,
+    STRING,
+    VEC,
+    LIST,
+    SET,
+    USET,
+    MAP,
+    UMAP,
+    PERSON,
+    TYPE_COUNT
+};
+
+// 第i个key的YAML值, seed不同时生成不同的值, 用于触发真实的setValue
+static YAML::Node MakeValue(size_t i, int seed){
+    YAML::Node n;
+    int v = i + seed;
+    switch(i % TYPE_COUNT){
+        case INT: n = v; break;
+        case FLOAT: n = v + 0.5; break;
+        case BOOL: n = (v % 2 == 0); break;
+        case STRING: n = "str_" + std::to_string(v); break;
+        case VEC:
+        case LIST:
+        case SET:
+        case USET:
+            for(int j = 0; j < 4; ++j){
+                n.push_back(v + j);
+            }
+            break;
+        case MAP:
+        case UMAP:
+            for(int j = 0; j < 4; ++j){
+                n["k" + std::to_string(j)] = v + j;
+            }
+            break;
+        case PERSON:
+            n["name"] = "p" + std::to_string(v);
+            n["age"] = v % 100;
+            n["sex"] = (v % 2 == 0);
+            break;
+    }
+    return n;
+}
+
+// key形如 bench.g3.g1.k42, 前 depth-1 级为分组
+static std::vector<std::string> MakePath(size_t i, size_t depth){
+    std::vector<std::string> path;
+    path.push_back("bench");
+    for(size_t d = 1; d < depth; ++d){
+        path.push_back("g" + std::to_string((i >> (2 * d)) % 4));
+    }
+    path.push_back("k" + std::to_string(i));
+    return path;
+}
+
+static YAML::Node MakeTree(size_t keys, size_t depth, int seed){
+    // 根节点必须先确定为Map, 否则拷贝出的Node不共享数据
+    YAML::Node root(YAML::NodeType::Map);
+    for(size_t i = 0; i < keys; ++i){
+        auto path = MakePath(i, depth);
+        std::vector<YAML::Node> nodes;
+        nodes.push_back(root);
+        for(size_t j = 0; j + 1 < path.size(); ++j){
+            nodes.push_back(nodes.back()[path[j]]);
+        }
+        nodes.back()[path.back()] = MakeValue(i, seed);
+    }
+    return root;
+}
+
+static std::string MakeName(size_t i, size_t depth){
+    auto path = MakePath(i, depth);
+    std::string name;
+    for(auto& p : path){
+        name += name.empty() ? p : "." + p;
+    }
+    return name;
+}
+
+typedef std::map<std::string, int> StrIntMap;
+typedef std::unordered_map<std::string, int> StrIntUMap;
+
+static void Register(const std::string& name, size_t i){
+    switch(i % TYPE_COUNT){
+#define XX(type, T, v) \
+        case type: sylar::Config::Lookup(name, T(v), "bench"); break;
+        XX(INT, int, 0)
+        XX(FLOAT, double, 0)
+        XX(BOOL, bool, false)
+        XX(STRING, std::string, "")
+        XX(VEC, std::vector<int>, )
+        XX(LIST, std::list<int>, )
+        XX(SET, std::set<int>, )
+        XX(USET, std::unordered_set<int>, )
+        XX(MAP, StrIntMap, )
+        XX(UMAP, StrIntUMap, )
+        XX(PERSON, Person, )
+#undef XX
+    }
+}
+
+int main(int argc, char** argv){
+    size_t keys = argc > 1 ? atoi(argv[1]) : 11000;
+    size_t depth = argc > 2 ? atoi(argv[2]) : 3;
+    size_t iterations = argc > 3 ? atoi(argv[3]) : 4;
+    if(depth < 1){
+        depth = 1;
+    }
+
+    // 基准期间不输出日志
+    SYLAR_LOG_ROOT()->setLevel(sylar::LogLevel::FATAL);
+    SYLAR_LOG_NAME("system")->setLevel(sylar::LogLevel::FATAL);
+
+    std::vector<std::string> names;
+    for(size_t i = 0; i < keys; ++i){
+        names.push_back(MakeName(i, depth));
+    }
+
+    {
+        BenchScope s("register", keys);
+        for(size_t i = 0; i < keys; ++i){
+            Register(names[i], i);
+        }
+    }
+
+    YAML::Node trees[2] = {MakeTree(keys, depth, 0), MakeTree(keys, depth, 1)};
+    {
+        // 两棵值不同的树交替加载, 每次都会真实更新配置
+        BenchScope s("load_from_yaml", keys * iterations);
+        for(size_t i = 0; i < iterations; ++i){
+            sylar::Config::LoadFromYaml(trees[i % 2]);
+        }
+    }
+
+    {
+        BenchScope s("lookup", keys * iterations);
+        for(size_t n = 0; n < iterations; ++n){
+            for(size_t i = 0; i < keys; ++i){
+                sylar::Config::LookupBase(names[i]);
+            }
+        }
+    }
+
+    std::vector<sylar::ConfigVar<int>::ptr> ints;
+    std::vector<sylar::ConfigVar<std::vector<int> >::ptr> vecs;
+    std::vector<sylar::ConfigVar<Person>::ptr> persons;
+    for(size_t i = 0; i < keys; ++i){
+        switch(i % TYPE_COUNT){
+            case INT: ints.push_back(sylar::Config::Lookup<int>(names[i])); break;
+            case VEC: vecs.push_back(sylar::Config::Lookup<std::vector<int> >(names[i])); break;
+            case PERSON: persons.push_back(sylar::Config::Lookup<Person>(names[i])); break;
+        }
+    }
+
+    int64_t sum = 0;
+    {
+        BenchScope s("get_value_int", ints.size() * iterations);
+        for(size_t n = 0; n < iterations; ++n){
+            for(auto& i : ints){
+                sum += i->getValue();
+            }
+        }
+    }
+    {
+        BenchScope s("get_value_vector", vecs.size() * iterations);
+        for(size_t n = 0; n < iterations; ++n){
+            for(auto& i : vecs){
+                sum += i->getValue().size();
+            }
+        }
+    }
+    {
+        BenchScope s("get_value_person", persons.size() * iterations);
+        for(size_t n = 0; n < iterations; ++n){
+            for(auto& i : persons){
+                sum += i->getValue().m_age;
+            }
+        }
+    }
+
+    std::vector<sylar::ConfigVarBase::ptr> vars;
+    for(auto& i : names){
+        vars.push_back(sylar::Config::LookupBase(i));
+    }
+    {
+        BenchScope s("to_string", keys);
+        for(auto& i : vars){
+            sum += i->toString().size();
+        }
+    }
+
+    for(auto& i : ints){
+        for(uint64_t k = 0; k < 4; ++k){
+            i->addListener(k, [&sum](const int& old_value, const int& new_value){
+                sum += new_value - old_value;
+            });
+        }
+    }
+    {
+        BenchScope s("listener_dispatch", ints.size() * iterations);
+        for(size_t n = 0; n < iterations; ++n){
+            for(auto& i : ints){
+                i->setValue(i->getValue() + 1);
+            }
+        }
+    }
+
+    std::cerr << "checksum=" << sum << std::endl;
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "../sylar/config.h"
+#include "../sylar/macro.h"
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+// 配置注册表基准: 注册/按名称查找/按驻留key查找/句柄访问, 以及多线程并发查找
+// 用法: bench_config_registry [keys] [threads]
+
+static uint64_t NowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void Report(const std::string& name, uint64_t ops, uint64_t ns){
+    std::cout << name << " ops=" << ops << " total_ms=" << ns / 1000000
+        << " ns_per_op=" << (ops ? (double)ns / ops : 0) << std::endl;
+}
+
+int main(int argc, char** argv){
+    size_t keys = argc > 1 ? atoi(argv[1]) : 100000;
+    size_t threads = argc > 2 ? atoi(argv[2]) : 4;
+
+    std::vector<std::string> names;
+    names.reserve(keys);
+    for(size_t i = 0; i < keys; ++i){
+        names.push_back("bench.key_" + std::to_string(i));
+    }
+
+    uint64_t begin = NowNs();
+    for(size_t i = 0; i < keys; ++i){
+        sylar::Config::Lookup(names[i], (int)i, "bench");
+    }
+    Report("register", keys, NowNs() - begin);
+
+    // 重复Lookup(带默认值): 字符串查找 + 类型检查
+    begin = NowNs();
+    for(size_t i = 0; i < keys; ++i){
+        sylar::Config::Lookup(names[i], (int)0, "bench");
+    }
+    Report("lookup_existing", keys, NowNs() - begin);
+
+    begin = NowNs();
+    for(size_t i = 0; i < keys; ++i){
+        sylar::Config::Lookup<int>(names[i]);
+    }
+    Report("lookup_by_name", keys, NowNs() - begin);
+
+    std::vector<sylar::ConfigKey> ckeys;
+    ckeys.reserve(keys);
+    begin = NowNs();
+    for(size_t i = 0; i < keys; ++i){
+        ckeys.push_back(sylar::ConfigKey(names[i]));
+    }
+    Report("intern", keys, NowNs() - begin);
+
+    begin = NowNs();
+    for(size_t i = 0; i < keys; ++i){
+        sylar::Config::Lookup<int>(ckeys[i]);
+    }
+    Report("lookup_by_key", keys, NowNs() - begin);
+    SYLAR_ASSERT(sylar::Config::Lookup<int>(ckeys[keys - 1])->getValue() == (int)keys - 1);
+    SYLAR_ASSERT(!sylar::Config::Lookup<float>(ckeys[0]));
+    // 只驻留未注册的名称
+    sylar::ConfigKey unknown("bench.unknown");
+    SYLAR_ASSERT(!sylar::Config::Lookup<int>(unknown));
+    SYLAR_ASSERT(sylar::Config::Lookup(unknown, 7)->getValue() == 7);
+    SYLAR_ASSERT(sylar::Config::Lookup<int>(unknown)->getValue() == 7);
+
+    std::vector<sylar::ConfigHandle<int> > handles;
+    handles.reserve(keys);
+    for(size_t i = 0; i < keys; ++i){
+        handles.push_back(sylar::Config::GetHandle<int>(names[i]));
+    }
+
+    int64_t sum = 0;
+    begin = NowNs();
+    for(size_t i = 0; i < keys; ++i){
+        sum += handles[i].getValue();
+    }
+    Report("handle_get", keys, NowNs() - begin);
+
+    // 多线程并发: 一半线程按名称查找, 一半线程注册新key
+    std::vector<std::thread> thrs;
+    begin = NowNs();
+    for(size_t t = 0; t < threads; ++t){
+        thrs.push_back(std::thread([t, keys, &names](){
+            if(t % 2 == 0){
+                for(size_t i = 0; i < keys; ++i){
+                    sylar::Config::Lookup<int>(names[i]);
+                }
+            }
+            else{
+                std::string prefix = "bench.thread_" + std::to_string(t) + "_";
+                for(size_t i = 0; i < keys / 10; ++i){
+                    sylar::Config::Lookup(prefix + std::to_string(i), (int)i);
+                }
+            }
+        }));
+    }
+    for(auto& i : thrs){
+        i.join();
+    }
+    Report("concurrent_mixed", keys * ((threads + 1) / 2) + keys / 10 * (threads / 2), NowNs() - begin);
+
+    std::cout << "checksum=" << sum << std::endl;
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "../sylar/fiber.h"
+#include "../sylar/fiber_stack.h"
+#include "../sylar/log.h"
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <unistd.h>
+
+// 协程基准: 切换耗时(一次swapIn + 一次YieldToHold算两次切换)、创建销毁耗时,
+// 以及大量协程同时挂起时的RSS和栈分配器统计
+// 用法: bench_fiber [switches] [creates] [alive]
+
+static uint64_t NowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void Report(const std::string& name, uint64_t ops, uint64_t ns){
+    std::cout << "{\"bench\":\"" << name << "\",\"impl\":\""
+        << (SYLAR_FIBER_USE_UCONTEXT ? "ucontext" : "asm") << "\",\"ops\":" << ops
+        << ",\"ns_per_op\":" << (double)ns / ops << "}" << std::endl;
+}
+
+static uint64_t RssBytes(){
+    long pages = 0, rss = 0;
+    FILE* fp = fopen("/proc/self/statm", "r");
+    if(fp){
+        if(fscanf(fp, "%ld %ld", &pages, &rss) != 2){
+            rss = 0;
+        }
+        fclose(fp);
+    }
+    return rss * sysconf(_SC_PAGESIZE);
+}
+
+// alive个协程同时挂起, 每个只用了很浅的栈, RSS应远小于 alive * stack_size
+static void BenchAlive(uint64_t alive){
+    uint64_t rss_begin = RssBytes();
+    std::vector<sylar::Fiber::ptr> fibers;
+    fibers.reserve(alive);
+    uint64_t begin = NowNs();
+    for(uint64_t i = 0; i < alive; ++i){
+        fibers.push_back(sylar::Fiber::ptr(new sylar::Fiber([](){
+            sylar::Fiber::YieldToHold();
+        })));
+        fibers.back()->swapIn();
+    }
+    uint64_t ns = NowNs() - begin;
+    uint64_t rss = RssBytes() - rss_begin;
+    for(auto& i : fibers){
+        i->swapIn();
+    }
+    fibers.clear();
+    auto stats = sylar::FiberStackPool::GetStats();
+    std::cout << "{\"bench\":\"fiber_alive\",\"fibers\":" << alive
+        << ",\"ns_per_fiber\":" << (double)ns / alive
+        << ",\"rss_bytes\":" << rss << ",\"rss_per_fiber\":" << rss / alive
+        << ",\"stacks_peak\":" << stats.stacks_peak
+        << ",\"mapped_peak\":" << stats.mapped_peak
+        << ",\"cache_hits\":" << stats.cache_hits
+        << ",\"mmaps\":" << stats.mmaps
+        << ",\"trims\":" << stats.trims
+        << ",\"cached\":" << stats.cached << "}" << std::endl;
+}
+
+int main(int argc, char** argv){
+    uint64_t switches = argc > 1 ? atoll(argv[1]) : 10000000;
+    uint64_t creates = argc > 2 ? atoll(argv[2]) : 100000;
+    // 开启保护页时每个栈占两段映射, 默认值低于vm.max_map_count(65530)的一半
+    uint64_t alive = argc > 3 ? atoll(argv[3]) : 30000;
+    SYLAR_LOG_NAME("system")->setLevel(sylar::LogLevel::INFO);
+
+    sylar::Fiber::GetThis();
+    bool stop = false;
+    sylar::Fiber::ptr fiber(new sylar::Fiber([&stop](){
+        while(!stop){
+            sylar::Fiber::YieldToHold();
+        }
+    }));
+
+    uint64_t begin = NowNs();
+    for(uint64_t i = 0; i < switches; ++i){
+        fiber->swapIn();
+    }
+    Report("fiber_switch", switches * 2, NowNs() - begin);
+    stop = true;
+    fiber->swapIn();
+
+    begin = NowNs();
+    for(uint64_t i = 0; i < creates; ++i){
+        sylar::Fiber::ptr f(new sylar::Fiber([](){}));
+        f->swapIn();
+    }
+    Report("fiber_create_run_destroy", creates, NowNs() - begin);
+
+    sylar::Fiber::ptr reuse(new sylar::Fiber([](){}));
+    begin = NowNs();
+    for(uint64_t i = 0; i < creates; ++i){
+        reuse->swapIn();
+        reuse->reset([](){});
+    }
+    Report("fiber_reset_run", creates, NowNs() - begin);
+
+    BenchAlive(alive);
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include "../sylar/fiber_sync.h"
+#include "../sylar/channel.h"
+#include "../sylar/scheduler.h"
+#include "../sylar/log.h"
+#include <chrono>
+#include <iostream>
+
+// 协程同步原语基准
+//   pingpong_channel:   两个协程通过两个容量为1的通道来回传递, 每次往返包含两次挂起和唤醒
+//   pingpong_semaphore: 同上, 用两个信号量
+//   channel_throughput: threads*2个生产者和消费者协程通过容量1024的通道传递
+//   mutex_contention:   threads*4个协程竞争同一把FiberMutex
+// 每项输出一行JSON
+// 用法: bench_fiber_sync [threads] [rounds]
+
+static uint64_t NowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void Report(const char* name, size_t threads, uint64_t ops, uint64_t ns){
+    std::cout << "{\"bench\":\"" << name << "\",\"threads\":" << threads
+        << ",\"ops\":" << ops << ",\"ns_per_op\":" << (double)ns / ops
+        << ",\"ops_per_sec\":" << (uint64_t)(ops * 1e9 / ns) << "}" << std::endl;
+}
+
+static void BenchPingPongChannel(size_t threads, uint64_t rounds){
+    sylar::Channel<uint64_t> ping(1);
+    sylar::Channel<uint64_t> pong(1);
+    sylar::Scheduler sc(threads, false, "bench");
+    sc.start();
+    uint64_t begin = NowNs();
+    sc.schedule([&ping, &pong, rounds](){
+        uint64_t v = 0;
+        for(uint64_t i = 0; i < rounds; ++i){
+            ping.push(i);
+            pong.pop(v);
+        }
+    });
+    sc.schedule([&ping, &pong, rounds](){
+        uint64_t v = 0;
+        for(uint64_t i = 0; i < rounds; ++i){
+            ping.pop(v);
+            pong.push(v);
+        }
+    });
+    sc.stop();
+    Report("pingpong_channel", threads, rounds, NowNs() - begin);
+}
+
+static void BenchPingPongSemaphore(size_t threads, uint64_t rounds){
+    sylar::FiberSemaphore ping;
+    sylar::FiberSemaphore pong;
+    sylar::Scheduler sc(threads, false, "bench");
+    sc.start();
+    uint64_t begin = NowNs();
+    sc.schedule([&ping, &pong, rounds](){
+        for(uint64_t i = 0; i < rounds; ++i){
+            ping.notify();
+            pong.wait();
+        }
+    });
+    sc.schedule([&ping, &pong, rounds](){
+        for(uint64_t i = 0; i < rounds; ++i){
+            ping.wait();
+            pong.notify();
+        }
+    });
+    sc.stop();
+    Report("pingpong_semaphore", threads, rounds, NowNs() - begin);
+}
+
+static void BenchChannelThroughput(size_t threads, uint64_t items){
+    size_t producers = threads * 2;
+    uint64_t per_producer = items / producers;
+    std::atomic<size_t> left {producers};
+    std::atomic<uint64_t> received {0};
+    sylar::Channel<uint64_t> chan(1024);
+    sylar::Scheduler sc(threads, false, "bench");
+    sc.start();
+    uint64_t begin = NowNs();
+    for(size_t p = 0; p < producers; ++p){
+        sc.schedule([&chan, &left, per_producer](){
+            for(uint64_t i = 0; i < per_producer; ++i){
+                chan.push(i);
+            }
+            if(--left == 0){
+                chan.close();
+            }
+        });
+        sc.schedule([&chan, &received](){
+            uint64_t v = 0;
+            uint64_t n = 0;
+            while(chan.pop(v)){
+                ++n;
+            }
+            received += n;
+        });
+    }
+    sc.stop();
+    Report("channel_throughput", threads, received, NowNs() - begin);
+}
+
+static void BenchMutex(size_t threads, uint64_t ops){
+    size_t fibers = threads * 4;
+    uint64_t per_fiber = ops / fibers;
+    sylar::FiberMutex mutex;
+    uint64_t count = 0;
+    sylar::Scheduler sc(threads, false, "bench");
+    sc.start();
+    uint64_t begin = NowNs();
+    for(size_t f = 0; f < fibers; ++f){
+        sc.schedule([&mutex, &count, per_fiber](){
+            for(uint64_t i = 0; i < per_fiber; ++i){
+                sylar::FiberMutex::Lock lock(mutex);
+                ++count;
+            }
+        });
+    }
+    sc.stop();
+    Report("mutex_contention", threads, count, NowNs() - begin);
+}
+
+int main(int argc, char** argv){
+    size_t threads = argc > 1 ? atoi(argv[1]) : 2;
+    uint64_t rounds = argc > 2 ? atoll(argv[2]) : 200000;
+    SYLAR_LOG_NAME("system")->setLevel(sylar::LogLevel::INFO);
+
+    BenchPingPongChannel(1, rounds);
+    BenchPingPongChannel(threads, rounds);
+    BenchPingPongSemaphore(1, rounds);
+    BenchPingPongSemaphore(threads, rounds);
+    BenchChannelThroughput(threads, rounds * 10);
+    BenchMutex(threads, rounds * 10);
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include "../sylar/http/http_parser.h"
+#include "../sylar/log.h"
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <stdlib.h>
+
+// HTTP请求解析吞吐基准, 语料是几种常见的真实请求
+// 对比三种方式:
+//   whole      整个请求一次传入HttpRequestParser
+//   fragment   每次多收到frag个字节就调用一次execute, 模拟小包到达
+//   copy       朴素的拷贝实现: 逐行取出std::string, 头部放入std::map
+// 每种语料/方式输出一行JSON
+// 用法: bench_http_parser [iterations] [frag]
+
+static uint64_t NowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Corpus{
+    const char* name;
+    std::string data;
+};
+
+static std::vector<Corpus> MakeCorpus(){
+    std::vector<Corpus> c;
+    c.push_back({"browser_get",
+        "GET /wp-content/uploads/2010/03/hello-kitty-darth-vader-pink.jpg HTTP/1.1\r\n"
+        "Host: www.kittyhell.com\r\n"
+        "User-Agent: Mozilla/5.0 (Macintosh; U; Intel Mac OS X 10_6_3; ja-JP-mac; rv:1.9.2.3) "
+        "Gecko/20100401 Firefox/3.6.3 Pathtraq/0.9\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+        "Accept-Language: ja,en-us;q=0.7,en;q=0.3\r\n"
+        "Accept-Encoding: gzip,deflate\r\n"
+        "Accept-Charset: Shift_JIS,utf-8;q=0.7,*;q=0.7\r\n"
+        "Keep-Alive: 115\r\n"
+        "Connection: keep-alive\r\n"
+        "Cookie: wp_ozh_wsa_visits=2; wp_ozh_wsa_visit_lasttime=xxxxxxxxxx; "
+        "__utma=xxxxxxxxx.xxxxxxxxxx.xxxxxxxxxx.xxxxxxxxxx.xxxxxxxxxx.x; "
+        "__utmz=xxxxxxxxx.xxxxxxxxxx.x.x.utmccn=(referral)|utmcsr=reader.livedoor.com|utmcct=/reader/|utmcmd=referral\r\n"
+        "\r\n"});
+    c.push_back({"curl_get",
+        "GET /api/v1/status?verbose=1 HTTP/1.1\r\n"
+        "Host: 127.0.0.1:8020\r\n"
+        "User-Agent: curl/7.81.0\r\n"
+        "Accept: */*\r\n"
+        "\r\n"});
+    std::string json = "{\"user\":\"sylar\",\"id\":10086,\"tags\":[\"a\",\"b\",\"c\"],\"score\":99.5}";
+    c.push_back({"post_json",
+        "POST /api/v1/user HTTP/1.1\r\n"
+        "Host: 127.0.0.1:8020\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: " + std::to_string(json.size()) + "\r\n"
+        "\r\n" + json});
+    c.push_back({"chunked_post",
+        "POST /upload HTTP/1.1\r\n"
+        "Host: 127.0.0.1:8020\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "10\r\n0123456789abcdef\r\n"
+        "10\r\n0123456789abcdef\r\n"
+        "8\r\n01234567\r\n"
+        "0\r\n\r\n"});
+    return c;
+}
+
+// 朴素实现, 只处理Content-Length, 用作拷贝开销的参照
+struct CopyRequest{
+    std::string method;
+    std::string uri;
+    std::string version;
+    std::map<std::string, std::string> headers;
+    std::string body;
+};
+
+static bool CopyParse(const std::string& data, CopyRequest& req){
+    size_t pos = data.find("\r\n");
+    if(pos == std::string::npos){
+        return false;
+    }
+    std::string line = data.substr(0, pos);
+    size_t sp1 = line.find(' ');
+    size_t sp2 = line.rfind(' ');
+    req.method = line.substr(0, sp1);
+    req.uri = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    req.version = line.substr(sp2 + 1);
+    size_t start = pos + 2;
+    while(true){
+        pos = data.find("\r\n", start);
+        if(pos == std::string::npos){
+            return false;
+        }
+        if(pos == start){
+            start += 2;
+            break;
+        }
+        line = data.substr(start, pos - start);
+        size_t colon = line.find(':');
+        size_t v = line.find_first_not_of(' ', colon + 1);
+        req.headers[line.substr(0, colon)] = v == std::string::npos ? "" : line.substr(v);
+        start = pos + 2;
+    }
+    auto it = req.headers.find("Content-Length");
+    if(it != req.headers.end()){
+        req.body = data.substr(start, atoi(it->second.c_str()));
+    }
+    return true;
+}
+
+static void Report(const char* corpus, const char* mode, size_t size
+                   ,uint64_t iterations, uint64_t ns){
+    double sec = ns / 1e9;
+    std::cout << "{\"bench\":\"http_parser\",\"corpus\":\"" << corpus
+              << "\",\"mode\":\"" << mode
+              << "\",\"bytes\":" << size
+              << ",\"iterations\":" << iterations
+              << ",\"ns_per_req\":" << (double)ns / iterations
+              << ",\"req_per_sec\":" << (uint64_t)(iterations / sec)
+              << ",\"mb_per_sec\":" << (size * iterations / sec / 1024 / 1024)
+              << "}" << std::endl;
+}
+
+int main(int argc, char** argv){
+    uint64_t iterations = argc > 1 ? atoll(argv[1]) : 200000;
+    size_t frag = argc > 2 ? atoi(argv[2]) : 16;
+    SYLAR_LOG_NAME("system")->setLevel(sylar::LogLevel::ERROR);
+
+    std::vector<Corpus> corpus = MakeCorpus();
+    uint64_t sink = 0;
+    for(auto& c : corpus){
+        // 分块的消息体会就地改写缓冲区, 每次都从原始数据拷贝一份, 三种方式都计入这次拷贝
+        std::string buf;
+        sylar::http::HttpRequestParser parser;
+
+        uint64_t start = NowNs();
+        for(uint64_t i = 0; i < iterations; ++i){
+            buf.assign(c.data);
+            parser.reset();
+            if(parser.execute(&buf[0], buf.size()) != 1){
+                std::cerr << c.name << " parse error: "
+                          << sylar::http::HttpParser::ErrorToString(parser.getError()) << std::endl;
+                return 1;
+            }
+            sink += parser.getData()->getBody().size();
+        }
+        Report(c.name, "whole", c.data.size(), iterations, NowNs() - start);
+
+        start = NowNs();
+        for(uint64_t i = 0; i < iterations; ++i){
+            buf.assign(c.data);
+            parser.reset();
+            int rt = 0;
+            for(size_t n = frag; rt == 0; n += frag){
+                rt = parser.execute(&buf[0], std::min(n, buf.size()));
+            }
+            sink += parser.getData()->getBody().size();
+        }
+        Report(c.name, "fragment", c.data.size(), iterations, NowNs() - start);
+
+        // 朴素实现不支持分块编码
+        if(c.data.find("chunked") == std::string::npos){
+            start = NowNs();
+            for(uint64_t i = 0; i < iterations; ++i){
+                buf.assign(c.data);
+                CopyRequest req;
+                CopyParse(buf, req);
+                sink += req.body.size();
+            }
+            Report(c.name, "copy", c.data.size(), iterations, NowNs() - start);
+        }
+    }
+    return sink == 0 ? 1 : 0;
+}
@@ -0,0 +1,155 @@
+#include "../sylar/http/http_server.h"
+#include "../sylar/iomanager.h"
+#include "../sylar/log.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+// 回环HTTP压测: 服务端只有一个返回固定内容的servlet, 客户端协程循环 发请求 -> 收完整响应
+// 两种方式:
+//   keepalive  每个客户端协程一个连接, 所有请求都在这个连接上发送
+//   close      每个请求新建连接, 请求带 Connection: close
+// 每种方式输出一行JSON, 包括每秒请求数和延迟分位数(us)
+// 用法: bench_http_server [threads] [concurrency] [requests_per_client] [access_log]
+//   access_log 为1时访问日志照常输出(重定向到/dev/null来测量日志的开销)
+
+static uint64_t NowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const std::string s_request = "GET /hello HTTP/1.1\r\n"
+                                     "Host: 127.0.0.1\r\n"
+                                     "User-Agent: bench_http_server\r\n"
+                                     "Accept: */*\r\n"
+                                     "\r\n";
+static const std::string s_close_request = "GET /hello HTTP/1.1\r\n"
+                                           "Host: 127.0.0.1\r\n"
+                                           "User-Agent: bench_http_server\r\n"
+                                           "Connection: close\r\n"
+                                           "\r\n";
+
+// 收一个完整的响应, 连接上没有多余的数据(每次只有一个请求在途)
+static bool RecvResponse(sylar::Socket::ptr sock, std::string& buf){
+    sylar::http::HttpResponseParser parser;
+    buf.clear();
+    char tmp[4096];
+    while(true){
+        int n = sock->recv(tmp, sizeof(tmp));
+        if(n <= 0){
+            return false;
+        }
+        buf.append(tmp, n);
+        int rt = parser.execute(&buf[0], buf.size());
+        if(rt != 0){
+            return rt == 1 && parser.getData()->getStatus() == sylar::http::HttpStatus::OK;
+        }
+    }
+}
+
+// 返回每个请求的延迟(ns), 失败的请求不计入
+static std::vector<uint64_t> RunClients(sylar::Address::ptr addr, bool keepalive
+                                        ,int concurrency, uint64_t requests){
+    std::vector<std::vector<uint64_t> > lats(concurrency);
+    {
+        sylar::IOManager iom(2, false, "client");
+        for(int i = 0; i < concurrency; ++i){
+            std::vector<uint64_t>* lat = &lats[i];
+            iom.schedule([addr, keepalive, requests, lat](){
+                lat->reserve(requests);
+                std::string buf;
+                sylar::Socket::ptr sock;
+                for(uint64_t j = 0; j < requests; ++j){
+                    uint64_t start = NowNs();
+                    if(!sock){
+                        sock = sylar::Socket::CreateTCP(addr);
+                        if(!sock->connect(addr, 1000)){
+                            sock.reset();
+                            continue;
+                        }
+                    }
+                    const std::string& req = keepalive ? s_request : s_close_request;
+                    if(sock->send(req.c_str(), req.size()) != (int)req.size()
+                            || !RecvResponse(sock, buf)){
+                        sock.reset();
+                        continue;
+                    }
+                    lat->push_back(NowNs() - start);
+                    if(!keepalive){
+                        // 服务端先关闭, 客户端以RST关闭, 避免耗尽本地端口
+                        linger l = {1, 0};
+                        sock->setOption(SOL_SOCKET, SO_LINGER, l);
+                        sock->close();
+                        sock.reset();
+                    }
+                }
+            });
+        }
+    }
+    std::vector<uint64_t> all;
+    for(auto& i : lats){
+        all.insert(all.end(), i.begin(), i.end());
+    }
+    return all;
+}
+
+static void Run(const char* mode, int threads, int concurrency, uint64_t requests){
+    sylar::IOManager server_iom(threads, false, "server");
+    sylar::http::HttpServer::ptr server(new sylar::http::HttpServer(true, &server_iom, &server_iom));
+    server->getServletDispatch()->addServlet("/hello", [](sylar::http::HttpRequest::ptr req
+                ,sylar::http::HttpResponse::ptr rsp, sylar::http::HttpSession::ptr session){
+        rsp->setHeader("Content-Type", "text/plain");
+        rsp->setBody("hello, world");
+        return 0;
+    });
+    if(!server->bind(sylar::IPv4Address::Create("127.0.0.1", 0))){
+        std::cerr << "bind fail" << std::endl;
+        return;
+    }
+    sylar::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+    server->start();
+
+    bool keepalive = strcmp(mode, "keepalive") == 0;
+    uint64_t start = NowNs();
+    std::vector<uint64_t> lats = RunClients(addr, keepalive, concurrency, requests);
+    uint64_t used = NowNs() - start;
+    server->stop();
+
+    if(lats.empty()){
+        std::cerr << mode << " no request succeeded" << std::endl;
+        return;
+    }
+    std::sort(lats.begin(), lats.end());
+    auto pct = [&lats](double p){
+        return lats[std::min(lats.size() - 1, (size_t)(lats.size() * p))] / 1000.0;
+    };
+    std::cout << "{\"bench\":\"http_server\",\"mode\":\"" << mode << "\""
+              << ",\"threads\":" << threads
+              << ",\"concurrency\":" << concurrency
+              << ",\"requests\":" << lats.size()
+              << ",\"ns\":" << used
+              << ",\"req_per_sec\":" << (uint64_t)(lats.size() * 1e9 / used)
+              << ",\"p50_us\":" << pct(0.5)
+              << ",\"p90_us\":" << pct(0.9)
+              << ",\"p99_us\":" << pct(0.99)
+              << ",\"p999_us\":" << pct(0.999)
+              << ",\"max_us\":" << lats.back() / 1000.0
+              << "}" << std::endl;
+}
+
+int main(int argc, char** argv){
+    int threads = argc > 1 ? atoi(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+    int concurrency = argc > 2 ? atoi(argv[2]) : 32;
+    uint64_t requests = argc > 3 ? atoll(argv[3]) : 500;
+    bool access_log = argc > 4 && atoi(argv[4]);
+
+    // stop时accept失败的错误日志不计入
+    SYLAR_LOG_NAME("system")->setLevel(sylar::LogLevel::FATAL);
+    if(!access_log){
+        SYLAR_LOG_NAME("access")->setLevel(sylar::LogLevel::FATAL);
+    }
+    Run("keepalive", threads, concurrency, requests);
+    Run("close", threads, concurrency, requests);
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "../sylar/iomanager.h"
+#include "../sylar/log.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <string.h>
+#include <chrono>
+#include <iostream>
+
+// 回环echo基准: 同一个IOManager里跑服务端和客户端, 每个连接一个协程
+// 客户端发送msg_size字节后等待回显, 重复rounds次
+// 输出一行JSON: 往返次数/秒和吞吐
+// 用法: bench_iomanager [threads] [connections] [rounds] [msg_size]
+
+static uint64_t NowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void SetNonblock(int fd){
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+// 非阻塞IO, 返回EAGAIN时注册事件并挂起当前协程
+template<class Fun>
+static ssize_t DoIO(int fd, sylar::IOManager::Event event, Fun fun){
+    while(true){
+        ssize_t n = fun();
+        if(n >= 0 || errno != EAGAIN){
+            return n;
+        }
+        if(sylar::IOManager::GetThis()->addEvent(fd, event)){
+            return -1;
+        }
+        sylar::Fiber::YieldToHold();
+    }
+}
+
+static bool ReadFull(int fd, char* buf, size_t len){
+    size_t off = 0;
+    while(off < len){
+        ssize_t n = DoIO(fd, sylar::IOManager::READ, [&](){
+            return read(fd, buf + off, len - off);
+        });
+        if(n <= 0){
+            return false;
+        }
+        off += n;
+    }
+    return true;
+}
+
+static bool WriteFull(int fd, const char* buf, size_t len){
+    size_t off = 0;
+    while(off < len){
+        ssize_t n = DoIO(fd, sylar::IOManager::WRITE, [&](){
+            return write(fd, buf + off, len - off);
+        });
+        if(n <= 0){
+            return false;
+        }
+        off += n;
+    }
+    return true;
+}
+
+static void Echo(int fd, size_t msg_size){
+    std::string buf(msg_size, 0);
+    while(ReadFull(fd, &buf[0], msg_size)){
+        if(!WriteFull(fd, &buf[0], msg_size)){
+            break;
+        }
+    }
+    close(fd);
+}
+
+static void Accept(int lfd, size_t conns, size_t msg_size){
+    for(size_t i = 0; i < conns; ++i){
+        int fd = DoIO(lfd, sylar::IOManager::READ, [lfd](){
+            return (ssize_t)accept4(lfd, nullptr, nullptr, SOCK_NONBLOCK);
+        });
+        if(fd < 0){
+            SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "accept errno=" << errno << " " << strerror(errno);
+            break;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        sylar::IOManager::GetThis()->schedule(std::bind(&Echo, fd, msg_size));
+    }
+    close(lfd);
+}
+
+static std::atomic<uint64_t> s_rounds {0};
+
+static void Client(const sockaddr_in& addr, size_t rounds, size_t msg_size){
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    int rt = connect(fd, (const sockaddr*)&addr, sizeof(addr));
+    if(rt && errno == EINPROGRESS){
+        sylar::IOManager::GetThis()->addEvent(fd, sylar::IOManager::WRITE);
+        sylar::Fiber::YieldToHold();
+    }
+    else if(rt){
+        SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "connect errno=" << errno << " " << strerror(errno);
+        close(fd);
+        return;
+    }
+    std::string msg(msg_size, 'x');
+    std::string buf(msg_size, 0);
+    for(size_t i = 0; i < rounds; ++i){
+        if(!WriteFull(fd, msg.data(), msg_size)
+                || !ReadFull(fd, &buf[0], msg_size)){
+            break;
+        }
+        ++s_rounds;
+    }
+    close(fd);
+}
+
+int main(int argc, char** argv){
+    size_t threads = argc > 1 ? atoi(argv[1]) : 0;
+    size_t conns = argc > 2 ? atoi(argv[2]) : 100;
+    size_t rounds = argc > 3 ? atoi(argv[3]) : 2000;
+    size_t msg_size = argc > 4 ? atoi(argv[4]) : 64;
+    SYLAR_LOG_NAME("system")->setLevel(sylar::LogLevel::WARN);
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int lfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if(bind(lfd, (sockaddr*)&addr, sizeof(addr)) || listen(lfd, 4096)){
+        std::cerr << "listen failed errno=" << errno << std::endl;
+        return 1;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(lfd, (sockaddr*)&addr, &len);
+
+    uint64_t begin = NowNs();
+    size_t workers = 0;
+    {
+        sylar::IOManager iom(threads, false, "echo");
+        workers = iom.getWorkerCount();
+        iom.schedule(std::bind(&Accept, lfd, conns, msg_size));
+        for(size_t i = 0; i < conns; ++i){
+            iom.schedule(std::bind(&Client, addr, rounds, msg_size));
+        }
+    }
+    uint64_t ns = NowNs() - begin;
+    uint64_t total = s_rounds;
+    std::cout << "{\"bench\":\"iomanager_echo\",\"threads\":" << workers
+        << ",\"connections\":" << conns << ",\"msg_size\":" << msg_size
+        << ",\"round_trips\":" << total
+        << ",\"round_trips_per_sec\":" << (uint64_t)(total * 1e9 / ns)
+        << ",\"mb_per_sec\":" << total * msg_size * 2 * 1e3 / ns
+        << ",\"us_per_round_trip\":" << ns / 1e3 / total << "}" << std::endl;
+    return 0;
+}
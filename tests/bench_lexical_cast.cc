@@ -0,0 +1,86 @@
+#include "../sylar/config.h"
+#include <boost/lexical_cast.hpp>
+#include <chrono>
+#include <iostream>
+
+// 标量转换基准: sylar::LexicalCast 与 boost::lexical_cast 对比
+// 输入为一百万个标量(int/double/bool 各占三分之一)
+// 用法: bench_lexical_cast [count]
+
+static uint64_t NowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void Report(const std::string& name, uint64_t ops, uint64_t ns){
+    std::cout << name << " ops=" << ops << " total_ms=" << ns / 1000000
+        << " ns_per_op=" << (ops ? (double)ns / ops : 0) << std::endl;
+}
+
+int main(int argc, char** argv){
+    size_t count = argc > 1 ? atoi(argv[1]) : 1000000;
+    std::vector<std::string> ints, doubles, bools;
+    for(size_t i = 0; i < count / 3; ++i){
+        ints.push_back(std::to_string(rand() - RAND_MAX / 2));
+        doubles.push_back(sylar::DoubleToString(rand() * 1e-3 / (rand() + 1)));
+        bools.push_back(i % 2 ? "1" : "0");   // boost 只认识 1/0
+    }
+    size_t n = ints.size() * 3;
+
+    int64_t isum = 0;
+    double dsum = 0;
+    uint64_t begin = NowNs();
+    for(size_t i = 0; i < ints.size(); ++i){
+        isum += boost::lexical_cast<int>(ints[i]);
+        dsum += boost::lexical_cast<double>(doubles[i]);
+        isum += boost::lexical_cast<bool>(bools[i]);
+    }
+    Report("parse_boost", n, NowNs() - begin);
+
+    begin = NowNs();
+    for(size_t i = 0; i < ints.size(); ++i){
+        isum += sylar::LexicalCast<std::string, int>()(ints[i]);
+        dsum += sylar::LexicalCast<std::string, double>()(doubles[i]);
+        isum += sylar::LexicalCast<std::string, bool>()(bools[i]);
+    }
+    Report("parse_sylar", n, NowNs() - begin);
+
+    // 两种实现的解析结果必须一致
+    size_t mismatch = 0;
+    std::vector<int> ivals;
+    std::vector<double> dvals;
+    for(size_t i = 0; i < ints.size(); ++i){
+        ivals.push_back(sylar::LexicalCast<std::string, int>()(ints[i]));
+        dvals.push_back(sylar::LexicalCast<std::string, double>()(doubles[i]));
+        mismatch += ivals.back() != boost::lexical_cast<int>(ints[i]);
+        mismatch += dvals.back() != boost::lexical_cast<double>(doubles[i]);
+    }
+
+    size_t len = 0;
+    begin = NowNs();
+    for(size_t i = 0; i < ivals.size(); ++i){
+        len += boost::lexical_cast<std::string>(ivals[i]).size();
+    }
+    Report("format_int_boost", ivals.size(), NowNs() - begin);
+
+    begin = NowNs();
+    for(size_t i = 0; i < ivals.size(); ++i){
+        len += sylar::LexicalCast<int, std::string>()(ivals[i]).size();
+    }
+    Report("format_int_sylar", ivals.size(), NowNs() - begin);
+
+    begin = NowNs();
+    for(size_t i = 0; i < dvals.size(); ++i){
+        len += boost::lexical_cast<std::string>(dvals[i]).size();
+    }
+    Report("format_double_boost", dvals.size(), NowNs() - begin);
+
+    begin = NowNs();
+    for(size_t i = 0; i < dvals.size(); ++i){
+        len += sylar::LexicalCast<double, std::string>()(dvals[i]).size();
+    }
+    Report("format_double_sylar", dvals.size(), NowNs() - begin);
+
+    std::cout << "mismatch=" << mismatch << " checksum=" << isum << " " << dsum << " " << len << std::endl;
+    return 0;
+}
@@ -0,0 +1,227 @@
+#include "../sylar/lockfree/mpmc_queue.h"
+#include "../sylar/lockfree/mpsc_queue.h"
+#include "../sylar/lockfree/object_pool.h"
+#include "../sylar/thread.h"
+#include "../sylar/mutex.h"
+#include <deque>
+#include <chrono>
+#include <iostream>
+#include <sched.h>
+#include <stdlib.h>
+
+// 无锁原语基准, 对照组为 Mutex + std::deque
+// mpmc     P个生产者, C个消费者
+// mpsc     P个生产者, 1个消费者
+// pool     单线程分配释放; 生产者分配, 消费者释放(跨线程释放)
+// 每项输出一行JSON
+// 用法: bench_lockfree [producers] [consumers] [items]
+
+static uint64_t NowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 对照组
+template<class T>
+class MutexQueue{
+public:
+    bool push(const T& v){
+        sylar::Mutex::Lock lock(m_mutex);
+        m_queue.push_back(v);
+        return true;
+    }
+
+    bool pop(T& v){
+        sylar::Mutex::Lock lock(m_mutex);
+        if(m_queue.empty()){
+            return false;
+        }
+        v = m_queue.front();
+        m_queue.pop_front();
+        return true;
+    }
+private:
+    sylar::Mutex m_mutex;
+    std::deque<T> m_queue;
+};
+
+static void Report(const char* bench, const char* impl, size_t producers,
+                   size_t consumers, size_t items, uint64_t ns){
+    std::cout << "{\"bench\":\"" << bench << "\",\"impl\":\"" << impl
+        << "\",\"producers\":" << producers << ",\"consumers\":" << consumers
+        << ",\"items\":" << items
+        << ",\"ns_per_item\":" << (double)ns / items
+        << ",\"items_per_sec\":" << (uint64_t)(items * 1e9 / ns) << "}" << std::endl;
+}
+
+template<class Queue>
+static void BenchQueue(const char* bench, const char* impl, Queue& queue,
+                       size_t producers, size_t consumers, size_t items){
+    size_t per_producer = items / producers;
+    size_t total = per_producer * producers;
+    std::atomic<size_t> consumed {0};
+    std::vector<sylar::Thread::ptr> threads;
+    uint64_t begin = NowNs();
+    for(size_t i = 0; i < producers; ++i){
+        threads.push_back(sylar::Thread::ptr(new sylar::Thread([&queue, per_producer](){
+            for(size_t s = 0; s < per_producer; ++s){
+                while(!queue.push(s)){
+                    sched_yield();
+                }
+            }
+        }, "prod_" + std::to_string(i))));
+    }
+    for(size_t i = 0; i < consumers; ++i){
+        threads.push_back(sylar::Thread::ptr(new sylar::Thread([&queue, &consumed, total](){
+            uint64_t v = 0;
+            size_t empty = 0;
+            while(consumed.load(std::memory_order_relaxed) < total){
+                if(queue.pop(v)){
+                    consumed.fetch_add(1, std::memory_order_relaxed);
+                    empty = 0;
+                }
+                else if(++empty > 16){
+                    sched_yield();
+                }
+            }
+        }, "cons_" + std::to_string(i))));
+    }
+    for(auto& t : threads){
+        t->join();
+    }
+    Report(bench, impl, producers, consumers, total, NowNs() - begin);
+}
+
+// MPSCQueue的push没有失败, 包装成和其它队列一致的接口
+template<class T>
+class MPSCAdapter{
+public:
+    bool push(const T& v){
+        m_queue.push(v);
+        return true;
+    }
+    bool pop(T& v){
+        return m_queue.pop(v);
+    }
+private:
+    sylar::MPSCQueue<T> m_queue;
+};
+
+struct Item{
+    char data[64];
+};
+
+typedef sylar::ObjectPool<Item> ItemPool;
+
+// 对照组: 全局互斥锁保护的空闲链表
+class MutexPool{
+public:
+    Item* New(){
+        {
+            sylar::Mutex::Lock lock(m_mutex);
+            if(!m_free.empty()){
+                Item* i = m_free.back();
+                m_free.pop_back();
+                return i;
+            }
+        }
+        return new Item;
+    }
+    void Delete(Item* i){
+        sylar::Mutex::Lock lock(m_mutex);
+        m_free.push_back(i);
+    }
+    ~MutexPool(){
+        for(auto i : m_free){
+            delete i;
+        }
+    }
+private:
+    sylar::Mutex m_mutex;
+    std::deque<Item*> m_free;
+};
+
+// 单线程: 每轮分配batch个再全部释放
+template<class NewFun, class DeleteFun>
+static void BenchPoolLocal(const char* impl, size_t items, NewFun new_fun, DeleteFun delete_fun){
+    const size_t batch = 64;
+    std::vector<Item*> live(batch);
+    uint64_t begin = NowNs();
+    for(size_t i = 0; i < items; i += batch){
+        for(size_t j = 0; j < batch; ++j){
+            live[j] = new_fun();
+        }
+        for(size_t j = 0; j < batch; ++j){
+            delete_fun(live[j]);
+        }
+    }
+    Report("pool_local", impl, 1, 1, items / batch * batch, NowNs() - begin);
+}
+
+// 跨线程: 生产者分配后通过队列交给消费者释放
+template<class NewFun, class DeleteFun>
+static void BenchPoolRemote(const char* impl, size_t items, NewFun new_fun, DeleteFun delete_fun){
+    sylar::MPMCQueue<Item*> queue(1024);
+    uint64_t begin = NowNs();
+    sylar::Thread producer([&](){
+        for(size_t i = 0; i < items; ++i){
+            Item* item = new_fun();
+            while(!queue.push(item)){
+                sched_yield();
+            }
+        }
+    }, "pool_prod");
+    sylar::Thread consumer([&](){
+        Item* item = nullptr;
+        for(size_t i = 0; i < items; ){
+            if(queue.pop(item)){
+                delete_fun(item);
+                ++i;
+            }
+            else{
+                sched_yield();
+            }
+        }
+    }, "pool_cons");
+    producer.join();
+    consumer.join();
+    Report("pool_remote", impl, 1, 1, items, NowNs() - begin);
+}
+
+int main(int argc, char** argv){
+    size_t producers = argc > 1 ? atoi(argv[1]) : 2;
+    size_t consumers = argc > 2 ? atoi(argv[2]) : 2;
+    size_t items = argc > 3 ? atoi(argv[3]) : 2000000;
+
+    {
+        sylar::MPMCQueue<uint64_t> q(4096);
+        BenchQueue("mpmc", "lockfree", q, producers, consumers, items);
+    }
+    {
+        MutexQueue<uint64_t> q;
+        BenchQueue("mpmc", "mutex_deque", q, producers, consumers, items);
+    }
+    {
+        MPSCAdapter<uint64_t> q;
+        BenchQueue("mpsc", "lockfree", q, producers, 1, items);
+    }
+    {
+        MutexQueue<uint64_t> q;
+        BenchQueue("mpsc", "mutex_deque", q, producers, 1, items);
+    }
+
+    MutexPool mutex_pool;
+    BenchPoolLocal("object_pool", items, [](){ return ItemPool::New(); },
+                   [](Item* i){ ItemPool::Delete(i); });
+    BenchPoolLocal("new_delete", items, [](){ return new Item; },
+                   [](Item* i){ delete i; });
+    BenchPoolLocal("mutex_deque", items, [&](){ return mutex_pool.New(); },
+                   [&](Item* i){ mutex_pool.Delete(i); });
+    BenchPoolRemote("object_pool", items, [](){ return ItemPool::New(); },
+                    [](Item* i){ ItemPool::Delete(i); });
+    BenchPoolRemote("new_delete", items, [](){ return new Item; },
+                    [](Item* i){ delete i; });
+    BenchPoolRemote("mutex_deque", items, [&](){ return mutex_pool.New(); },
+                    [&](Item* i){ mutex_pool.Delete(i); });
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "../sylar/metrics.h"
+#include "../sylar/thread.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+// 多线程同时写同一个指标的开销
+// atomic     所有线程对同一个 std::atomic<uint64_t> fetch_add(relaxed), 对照组
+// counter    Counter::inc
+// histogram  Histogram::record
+// 线程数取 1, 2, 4 ... 直到 max(CPU数, 8), 每项输出一行JSON
+// 用法: bench_metrics [ops_per_thread]
+
+static uint64_t NowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 返回所有线程完成的总耗时
+template<class Func>
+static uint64_t RunThreads(int threads, Func func){
+    std::vector<sylar::Thread::ptr> thrs;
+    uint64_t begin = NowNs();
+    for(int i = 0; i < threads; ++i){
+        thrs.push_back(sylar::Thread::ptr(new sylar::Thread(func, "bench_" + std::to_string(i))));
+    }
+    for(auto& t : thrs){
+        t->join();
+    }
+    return NowNs() - begin;
+}
+
+static void Report(const char* impl, int threads, uint64_t ops, uint64_t ns){
+    uint64_t total = ops * threads;
+    std::cout << "{\"bench\":\"metrics\",\"impl\":\"" << impl << "\""
+              << ",\"threads\":" << threads
+              << ",\"ops\":" << total
+              << ",\"ns_per_op\":" << (double)ns / total
+              << ",\"ops_per_sec\":" << (uint64_t)(total * 1e9 / ns)
+              << "}" << std::endl;
+}
+
+int main(int argc, char** argv){
+    uint64_t ops = argc > 1 ? atoll(argv[1]) : 5000000;
+    int max_threads = std::max(std::thread::hardware_concurrency(), 8u);
+
+    for(int threads = 1; threads <= max_threads; threads *= 2){
+        std::atomic<uint64_t> shared{0};
+        uint64_t ns = RunThreads(threads, [&shared, ops](){
+            for(uint64_t i = 0; i < ops; ++i){
+                shared.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+        Report("atomic", threads, ops, ns);
+
+        sylar::Counter counter("bench.counter");
+        ns = RunThreads(threads, [&counter, ops](){
+            for(uint64_t i = 0; i < ops; ++i){
+                counter.inc();
+            }
+        });
+        if(counter.getValue() != ops * threads || shared != ops * threads){
+            std::cerr << "counter mismatch" << std::endl;
+            return 1;
+        }
+        Report("counter", threads, ops, ns);
+
+        // 值落在不同的桶, 模拟 1us ~ 1ms 的延迟
+        sylar::Histogram hist("bench.histogram");
+        ns = RunThreads(threads, [&hist, ops](){
+            uint64_t seed = (uint64_t)&seed;
+            for(uint64_t i = 0; i < ops; ++i){
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                hist.record(1000 + (seed >> 44));
+            }
+        });
+        Report("histogram", threads, ops, ns);
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "../sylar/mutex.h"
+#include "../sylar/thread.h"
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// 锁竞争基准: 读多写少(90%读) / 写多读少(10%读) 两种负载, 线程数从1递增到N
+// 每项输出一行JSON
+// 用法: bench_mutex [max_threads] [ops_per_thread]
+
+static uint64_t NowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 用信号量模拟的互斥锁, 作为对比
+class SemaphoreLock{
+public:
+    typedef sylar::ScopedLockImpl<SemaphoreLock> Lock;
+    SemaphoreLock()
+        :m_sem(1){
+    }
+    void lock() { m_sem.wait();}
+    void unlock() { m_sem.notify();}
+private:
+    sylar::Semaphore m_sem;
+};
+
+// 共享数据, 临界区内读或写其中一个槽位
+struct SharedData{
+    uint64_t slots[16] = {0};
+};
+
+template<class M, class ReadLock, class WriteLock>
+void Run(const std::string& name, size_t threads, int read_pct, uint64_t ops){
+    M mutex;
+    SharedData data;
+    std::vector<sylar::Thread::ptr> thrs;
+    std::vector<uint64_t> sums(threads, 0);
+
+    uint64_t begin = NowNs();
+    for(size_t t = 0; t < threads; ++t){
+        thrs.push_back(sylar::Thread::ptr(new sylar::Thread([&, t](){
+            uint32_t seed = t * 2654435761u + 1;
+            uint64_t sum = 0;
+            for(uint64_t i = 0; i < ops; ++i){
+                seed = seed * 1103515245 + 12345;
+                size_t slot = (seed >> 8) % 16;
+                if((int)((seed >> 16) % 100) < read_pct){
+                    ReadLock lock(mutex);
+                    sum += data.slots[slot];
+                }
+                else{
+                    WriteLock lock(mutex);
+                    ++data.slots[slot];
+                }
+            }
+            sums[t] = sum;
+        }, "bench_" + std::to_string(t))));
+    }
+    for(auto& i : thrs){
+        i->join();
+    }
+    uint64_t ns = NowNs() - begin;
+    uint64_t total = ops * threads;
+    std::cout << "{\"bench\":\"mutex\",\"lock\":\"" << name << "\",\"threads\":" << threads
+        << ",\"read_pct\":" << read_pct << ",\"ops\":" << total
+        << ",\"ns_per_op\":" << (double)ns / total
+        << ",\"ops_per_sec\":" << (uint64_t)(total * 1e9 / ns) << "}" << std::endl;
+}
+
+template<class M>
+void RunMutex(const std::string& name, size_t threads, int read_pct, uint64_t ops){
+    Run<M, typename M::Lock, typename M::Lock>(name, threads, read_pct, ops);
+}
+
+template<class M>
+void RunRWMutex(const std::string& name, size_t threads, int read_pct, uint64_t ops){
+    Run<M, typename M::ReadLock, typename M::WriteLock>(name, threads, read_pct, ops);
+}
+
+int main(int argc, char** argv){
+    size_t max_threads = argc > 1 ? atoi(argv[1]) : std::max(4u, std::thread::hardware_concurrency());
+    uint64_t ops = argc > 2 ? atoll(argv[2]) : 1000000;
+
+    int loads[] = {90, 10};
+    for(int read_pct : loads){
+        // 空锁只在单线程下有意义, 作为无锁开销的基线
+        RunMutex<sylar::NullMutex>("NullMutex", 1, read_pct, ops);
+        for(size_t threads = 1; threads <= max_threads; threads *= 2){
+            RunMutex<sylar::Mutex>("Mutex", threads, read_pct, ops);
+            RunRWMutex<sylar::RWMutex>("RWMutex", threads, read_pct, ops);
+            RunMutex<sylar::Spinlock>("Spinlock", threads, read_pct, ops);
+            RunMutex<sylar::CASLock>("CASLock", threads, read_pct, ops);
+            RunMutex<SemaphoreLock>("Semaphore", threads, read_pct, ops / 10);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "../sylar/profiler.h"
+#include "../sylar/config.h"
+#include "../sylar/util.h"
+#include "../sylar/log.h"
+#include <signal.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <iostream>
+
+// 采样分析器的开销
+// off/100hz/1000hz  同一段纯计算在不同采样频率下的耗时, overhead_pct 相对off
+// sample            用raise(SIGPROF)直接触发, 单次采样(信号投递+取调用栈+写缓冲区)的开销,
+//                   乘以hz即为每秒CPU时间中分析器所占的比例
+// 每项输出一行JSON
+// 用法: bench_profiler [rounds] [depth]
+
+static volatile uint64_t s_sink = 0;
+
+__attribute__((noinline)) static uint64_t Work(int depth){
+    if(depth > 0){
+        uint64_t rt = Work(depth - 1);
+        __asm__ __volatile__("" ::: "memory");
+        return rt;
+    }
+    uint64_t x = s_sink + 1;
+    for(int i = 0; i < 100000; ++i){
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    s_sink = x;
+    return x;
+}
+
+static double Run(const char* mode, uint32_t hz, uint64_t rounds, int depth, double base){
+    auto hz_var = sylar::Config::Lookup<uint32_t>("profiler.hz");
+    if(hz){
+        hz_var->setValue(hz);
+        sylar::Profiler::SetEnabled(true);
+    }
+    uint64_t samples = sylar::Profiler::GetSampleCount();
+    uint64_t begin = sylar::GetMonotonicNS();
+    for(uint64_t i = 0; i < rounds; ++i){
+        Work(depth);
+    }
+    double ns = (double)(sylar::GetMonotonicNS() - begin) / rounds;
+    samples = sylar::Profiler::GetSampleCount() - samples;
+    sylar::Profiler::SetEnabled(false);
+    std::cout << "{\"bench\":\"profiler\",\"mode\":\"" << mode << "\""
+              << ",\"hz\":" << hz
+              << ",\"ops\":" << rounds
+              << ",\"ns_per_op\":" << ns
+              << ",\"samples\":" << samples
+              << ",\"overhead_pct\":" << (base > 0 ? (ns - base) * 100 / base : 0)
+              << "}" << std::endl;
+    return ns;
+}
+
+__attribute__((noinline)) static void RaiseAt(int depth, uint64_t count){
+    if(depth > 0){
+        RaiseAt(depth - 1, count);
+        __asm__ __volatile__("" ::: "memory");
+        return;
+    }
+    for(uint64_t i = 0; i < count; ++i){
+        raise(SIGPROF);
+    }
+}
+
+static void BenchSample(uint64_t count, int depth){
+    // 很低的频率, 基本只有raise触发的采样
+    sylar::Config::Lookup<uint32_t>("profiler.hz")->setValue(1);
+    sylar::Profiler::SetEnabled(true);
+    uint64_t ns = 0;
+    uint64_t done = 0;
+    uint64_t dropped = sylar::Profiler::GetDroppedCount();
+    while(done < count){
+        // 每批不超过缓冲区的一半, 批之间取走样本
+        uint64_t batch = std::min<uint64_t>(count - done, 512);
+        uint64_t begin = sylar::GetMonotonicNS();
+        RaiseAt(depth, batch);
+        ns += sylar::GetMonotonicNS() - begin;
+        done += batch;
+        sylar::Profiler::Flush();
+    }
+    dropped = sylar::Profiler::GetDroppedCount() - dropped;
+    sylar::Profiler::SetEnabled(false);
+    double per = (double)ns / count;
+    std::cout << "{\"bench\":\"profiler\",\"mode\":\"sample\""
+              << ",\"ops\":" << count
+              << ",\"ns_per_op\":" << per
+              << ",\"dropped\":" << dropped
+              << ",\"pct_at_100hz\":" << per * 100 / 1e9 * 100
+              << ",\"pct_at_1000hz\":" << per * 1000 / 1e9 * 100
+              << "}" << std::endl;
+}
+
+int main(int argc, char** argv){
+    uint64_t rounds = argc > 1 ? atoll(argv[1]) : 20000;
+    int depth = argc > 2 ? atoi(argv[2]) : 10;
+    // 只测采集, 不输出
+    SYLAR_LOG_NAME("profiler")->setLevel(sylar::LogLevel::ERROR);
+    SYLAR_LOG_NAME("system")->setLevel(sylar::LogLevel::ERROR);
+    sylar::Config::Lookup<uint32_t>("profiler.flush_interval")->setValue(3600 * 1000);
+
+    Work(depth);
+    double base = Run("off", 0, rounds, depth, 0);
+    Run("100hz", 100, rounds, depth, base);
+    Run("1000hz", 1000, rounds, depth, base);
+    BenchSample(rounds, depth);
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "../sylar/scheduler.h"
+#include "../sylar/log.h"
+#include <chrono>
+#include <iostream>
+#include <atomic>
+
+// 调度器扩展性基准, 线程数从1递增到CPU核数
+//   external: 外部线程提交任务, 走全局注入队列
+//   fanout:   少量根任务在工作线程内派生子任务, 走本地队列和工作窃取
+//   yield:    协程反复YieldToReady, 测试协程切换和重新入队
+// 每项输出一行JSON
+// 用法: bench_scheduler [max_threads] [tasks]
+
+static uint64_t NowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::atomic<uint64_t> s_done {0};
+
+// 每个任务做一点计算, 避免只测到队列本身
+static void Work(){
+    volatile uint64_t x = 0;
+    for(int i = 0; i < 100; ++i){
+        x = x + i;
+    }
+    ++s_done;
+}
+
+static void Report(const std::string& name, size_t threads, uint64_t tasks, uint64_t ns){
+    std::cout << "{\"bench\":\"scheduler_" << name << "\",\"threads\":" << threads
+        << ",\"tasks\":" << tasks << ",\"ns_per_task\":" << (double)ns / tasks
+        << ",\"tasks_per_sec\":" << (uint64_t)(tasks * 1e9 / ns) << "}" << std::endl;
+}
+
+static void BenchExternal(size_t threads, uint64_t tasks){
+    s_done = 0;
+    sylar::Scheduler sc(threads, false, "bench");
+    sc.start();
+    uint64_t begin = NowNs();
+    for(uint64_t i = 0; i < tasks; ++i){
+        sc.schedule(&Work);
+    }
+    sc.stop();
+    Report("external", threads, s_done, NowNs() - begin);
+}
+
+static void BenchFanout(size_t threads, uint64_t tasks){
+    s_done = 0;
+    sylar::Scheduler sc(threads, false, "bench");
+    sc.start();
+    uint64_t roots = 16;
+    uint64_t children = tasks / roots;
+    uint64_t begin = NowNs();
+    for(uint64_t i = 0; i < roots; ++i){
+        sc.schedule([children](){
+            sylar::Scheduler* s = sylar::Scheduler::GetThis();
+            for(uint64_t j = 0; j < children; ++j){
+                s->schedule(&Work);
+            }
+        });
+    }
+    sc.stop();
+    Report("fanout", threads, s_done, NowNs() - begin);
+}
+
+static void BenchYield(size_t threads, uint64_t tasks){
+    s_done = 0;
+    sylar::Scheduler sc(threads, false, "bench");
+    sc.start();
+    uint64_t fibers = threads * 4;
+    uint64_t yields = tasks / fibers;
+    uint64_t begin = NowNs();
+    for(uint64_t i = 0; i < fibers; ++i){
+        sc.schedule([yields](){
+            for(uint64_t j = 0; j < yields; ++j){
+                ++s_done;
+                sylar::Fiber::YieldToReady();
+            }
+        });
+    }
+    sc.stop();
+    Report("yield", threads, s_done, NowNs() - begin);
+}
+
+int main(int argc, char** argv){
+    size_t max_threads = argc > 1 ? atoi(argv[1]) : sysconf(_SC_NPROCESSORS_ONLN);
+    uint64_t tasks = argc > 2 ? atoll(argv[2]) : 1000000;
+    SYLAR_LOG_NAME("system")->setLevel(sylar::LogLevel::INFO);
+
+    for(size_t threads = 1; ; threads *= 2){
+        if(threads > max_threads){
+            threads = max_threads;
+        }
+        BenchExternal(threads, tasks);
+        BenchFanout(threads, tasks);
+        BenchYield(threads, tasks);
+        if(threads == max_threads){
+            break;
+        }
+    }
+    return 0;
+}
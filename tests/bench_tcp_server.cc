@@ -0,0 +1,105 @@
+#include "../sylar/tcp_server.h"
+#include "../sylar/config.h"
+#include "../sylar/iomanager.h"
+#include "../sylar/log.h"
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+// 回环建连速率基准: 服务端accept后立即关闭连接, 客户端协程循环 connect -> 等待对端关闭 -> RST关闭
+// 对比两种方式在不同服务端线程数下的每秒连接数:
+//   single     一个监听socket, 所有线程的accept协程共用
+//   reuseport  每个线程一个SO_REUSEPORT监听socket
+// 每种组合输出一行JSON
+// 用法: bench_tcp_server [max_threads] [connections] [concurrency]
+
+static uint64_t NowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class CloseServer : public sylar::TcpServer{
+public:
+    using TcpServer::TcpServer;
+protected:
+    void handleClient(sylar::Socket::ptr client) override{
+        client->close();
+    }
+};
+
+// 返回成功建立的连接数
+static uint64_t RunClients(sylar::Address::ptr addr, uint64_t connections, int concurrency){
+    std::atomic<uint64_t> ok{0};
+    std::atomic<uint64_t> left{connections};
+    // iom析构时等待所有客户端协程结束
+    {
+        sylar::IOManager iom(2, false, "client");
+        for(int i = 0; i < concurrency; ++i){
+            iom.schedule([addr, &ok, &left](){
+                while(true){
+                    uint64_t n = left.load();
+                    if(n == 0){
+                        break;
+                    }
+                    if(!left.compare_exchange_weak(n, n - 1)){
+                        continue;
+                    }
+                    sylar::Socket::ptr sock = sylar::Socket::CreateTCP(addr);
+                    if(!sock->connect(addr, 1000)){
+                        continue;
+                    }
+                    char c;
+                    if(sock->recv(&c, 1) == 0){
+                        ++ok;
+                    }
+                    // 收到FIN后以RST关闭, 两端都不进入TIME_WAIT, 避免耗尽本地端口
+                    linger l = {1, 0};
+                    sock->setOption(SOL_SOCKET, SO_LINGER, l);
+                    sock->close();
+                }
+            });
+        }
+    }
+    return ok;
+}
+
+static void Run(const char* mode, uint32_t workers, int threads
+                ,uint64_t connections, int concurrency){
+    sylar::Config::Lookup<uint32_t>("tcp_server.workers")->setValue(workers);
+    sylar::IOManager server_iom(threads, false, "server");
+    sylar::TcpServer::ptr server(new CloseServer(&server_iom, &server_iom));
+    if(!server->bind(sylar::IPv4Address::Create("127.0.0.1", 0))){
+        std::cerr << "bind fail" << std::endl;
+        return;
+    }
+    sylar::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+    size_t listeners = server->getSocks().size();
+    server->start();
+
+    uint64_t start = NowNs();
+    uint64_t ok = RunClients(addr, connections, concurrency);
+    uint64_t used = NowNs() - start;
+    server->stop();
+
+    std::cout << "{\"bench\":\"tcp_server_accept\",\"mode\":\"" << mode << "\""
+              << ",\"threads\":" << threads
+              << ",\"listeners\":" << listeners
+              << ",\"connections\":" << ok
+              << ",\"ns\":" << used
+              << ",\"conns_per_sec\":" << (uint64_t)(ok * 1e9 / used)
+              << "}" << std::endl;
+}
+
+int main(int argc, char** argv){
+    int max_threads = argc > 1 ? atoi(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+    uint64_t connections = argc > 2 ? atoll(argv[2]) : 20000;
+    int concurrency = argc > 3 ? atoi(argv[3]) : 64;
+
+    // stop时accept失败的错误日志不计入
+    SYLAR_LOG_NAME("system")->setLevel(sylar::LogLevel::FATAL);
+    for(int threads = 1; threads <= max_threads; threads *= 2){
+        Run("single", 1, threads, connections, concurrency);
+        Run("reuseport", 0, threads, connections, concurrency);
+    }
+    return 0;
+}
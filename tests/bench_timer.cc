@@ -0,0 +1,160 @@
+#include "../sylar/timer.h"
+#include "../sylar/util.h"
+#include "../sylar/log.h"
+#include <set>
+#include <chrono>
+#include <iostream>
+#include <stdlib.h>
+
+// 定时器基准: 分层时间轮(sylar::TimerManager) 对比 std::set 有序集合(原sylar的实现)
+// add      连续添加N个随机延迟(1ms~10min)的定时器
+// cancel   逐个取消上面的定时器
+// churn    保持N个存活定时器, 反复添加并立即取消(请求超时在响应到达后被取消的典型场景)
+// expire   添加N个200ms内到期的定时器, 只统计listExpiredCb的耗时
+// 每项输出一行JSON
+// 用法: bench_timer [timers]
+
+static uint64_t NowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 时间轮, 不需要唤醒
+class WheelTimerManager : public sylar::TimerManager{
+protected:
+    void onTimerInsertedAtFront() override {}
+};
+
+// 基于std::set的对照实现, 按到期时间排序, 添加/取消O(logN)
+class SetTimerManager{
+public:
+    struct Timer : public std::enable_shared_from_this<Timer>{
+        typedef std::shared_ptr<Timer> ptr;
+        uint64_t next;
+        std::function<void()> cb;
+        SetTimerManager* manager;
+
+        bool cancel(){
+            sylar::RWMutex::WriteLock lock(manager->m_mutex);
+            if(!cb){
+                return false;
+            }
+            cb = nullptr;
+            manager->m_timers.erase(shared_from_this());
+            return true;
+        }
+    };
+
+    struct Comparator{
+        bool operator()(const Timer::ptr& lhs, const Timer::ptr& rhs) const{
+            if(lhs->next != rhs->next){
+                return lhs->next < rhs->next;
+            }
+            return lhs.get() < rhs.get();
+        }
+    };
+
+    Timer::ptr addTimer(uint64_t ms, std::function<void()> cb){
+        Timer::ptr timer(new Timer);
+        timer->next = sylar::GetMonotonicMS() + ms;
+        timer->cb = cb;
+        timer->manager = this;
+        sylar::RWMutex::WriteLock lock(m_mutex);
+        m_timers.insert(timer);
+        return timer;
+    }
+
+    void listExpiredCb(std::vector<std::function<void()> >& cbs){
+        uint64_t now_ms = sylar::GetMonotonicMS();
+        sylar::RWMutex::WriteLock lock(m_mutex);
+        while(!m_timers.empty() && (*m_timers.begin())->next <= now_ms){
+            Timer::ptr timer = *m_timers.begin();
+            m_timers.erase(m_timers.begin());
+            cbs.push_back(timer->cb);
+            timer->cb = nullptr;
+        }
+    }
+
+    bool hasTimer(){
+        sylar::RWMutex::ReadLock lock(m_mutex);
+        return !m_timers.empty();
+    }
+private:
+    sylar::RWMutex m_mutex;
+    std::set<Timer::ptr, Comparator> m_timers;
+};
+
+static void Report(const char* impl, const char* op, size_t n, uint64_t ns){
+    std::cout << "{\"bench\":\"timer_" << op << "\",\"impl\":\"" << impl
+        << "\",\"timers\":" << n
+        << ",\"ns_per_op\":" << (double)ns / n
+        << ",\"ops_per_sec\":" << (uint64_t)(n * 1e9 / ns) << "}" << std::endl;
+}
+
+template<class Manager>
+static void Bench(const char* impl, size_t n){
+    std::vector<uint64_t> delays(n);
+    for(size_t i = 0; i < n; ++i){
+        delays[i] = 1 + rand() % (600 * 1000);
+    }
+    auto cb = [](){};
+
+    {
+        Manager mgr;
+        std::vector<decltype(mgr.addTimer(0, cb))> timers;
+        timers.reserve(n);
+        uint64_t begin = NowNs();
+        for(size_t i = 0; i < n; ++i){
+            timers.push_back(mgr.addTimer(delays[i], cb));
+        }
+        Report(impl, "add", n, NowNs() - begin);
+
+        begin = NowNs();
+        for(size_t i = 0; i < n; ++i){
+            timers[i]->cancel();
+        }
+        Report(impl, "cancel", n, NowNs() - begin);
+    }
+
+    {
+        Manager mgr;
+        std::vector<decltype(mgr.addTimer(0, cb))> timers;
+        for(size_t i = 0; i < n; ++i){
+            timers.push_back(mgr.addTimer(delays[i], cb));
+        }
+        uint64_t begin = NowNs();
+        for(size_t i = 0; i < n; ++i){
+            mgr.addTimer(delays[i] % 5000 + 1, cb)->cancel();
+        }
+        Report(impl, "churn", n, NowNs() - begin);
+        for(auto& t : timers){
+            t->cancel();
+        }
+    }
+
+    {
+        Manager mgr;
+        for(size_t i = 0; i < n; ++i){
+            mgr.addTimer(delays[i] % 200, cb);
+        }
+        size_t fired = 0;
+        uint64_t ns = 0;
+        std::vector<std::function<void()> > cbs;
+        while(mgr.hasTimer()){
+            usleep(1000);
+            cbs.clear();
+            uint64_t begin = NowNs();
+            mgr.listExpiredCb(cbs);
+            ns += NowNs() - begin;
+            fired += cbs.size();
+        }
+        Report(impl, "expire", fired, ns);
+    }
+}
+
+int main(int argc, char** argv){
+    size_t n = argc > 1 ? atoi(argv[1]) : 1000000;
+    Bench<WheelTimerManager>("wheel", n);
+    Bench<SetTimerManager>("set", n);
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include "../sylar/trace.h"
+#include <chrono>
+#include <iostream>
+
+// 每个区间的开销
+// disabled   trace.enabled 为false, 只有一次原子读
+// enabled    记录开始结束时间并写入线程缓冲区
+// nested     两层嵌套, 每次循环两个区间
+// 每项输出一行JSON
+// 用法: bench_trace [spans]
+
+static uint64_t NowNs(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void Report(const char* mode, uint64_t spans, uint64_t ns){
+    std::cout << "{\"bench\":\"trace\",\"mode\":\"" << mode << "\""
+              << ",\"spans\":" << spans
+              << ",\"ns_per_span\":" << (double)ns / spans
+              << "}" << std::endl;
+}
+
+int main(int argc, char** argv){
+    uint64_t spans = argc > 1 ? atoll(argv[1]) : 5000000;
+
+    sylar::Tracer::SetEnabled(false);
+    uint64_t begin = NowNs();
+    for(uint64_t i = 0; i < spans; ++i){
+        SYLAR_TRACE_SCOPE("disabled");
+        __asm__ __volatile__("" ::: "memory");
+    }
+    Report("disabled", spans, NowNs() - begin);
+
+    sylar::Tracer::SetEnabled(true);
+    begin = NowNs();
+    for(uint64_t i = 0; i < spans; ++i){
+        SYLAR_TRACE_SCOPE("enabled");
+    }
+    Report("enabled", spans, NowNs() - begin);
+
+    begin = NowNs();
+    for(uint64_t i = 0; i < spans / 2; ++i){
+        SYLAR_TRACE_SCOPE("outer");
+        SYLAR_TRACE_SCOPE("inner");
+    }
+    Report("nested", spans / 2 * 2, NowNs() - begin);
+
+    begin = NowNs();
+    std::string json = sylar::Tracer::ToChromeJson();
+    std::cout << "{\"bench\":\"trace\",\"mode\":\"export\",\"bytes\":" << json.size()
+              << ",\"ns\":" << NowNs() - begin << "}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,59 @@
+#ifndef __SYLAR_TESTS_PERSON_H__
+#define __SYLAR_TESTS_PERSON_H__
+
+#include "../sylar/config.h"
+#include <yaml-cpp/yaml.h>
+#include <sstream>
+#include <string>
+
+// test_config 和 bench_config 共用的自定义配置类型
+
+class Person {
+public:
+    Person() {}
+    std::string m_name;
+    int m_age = 0;
+    bool m_sex = 0;
+
+    std::string toString() const{
+        std::stringstream ss;
+        ss << "[Person name=" << m_name << " age=" << m_age << " sex=" << m_sex << "]";
+        return ss.str();
+    }
+
+    bool operator== (const Person& oth) const{
+        return m_name == oth.m_name && m_age ==oth.m_age && m_sex == oth.m_sex;
+    }
+};
+
+namespace sylar{
+// 这里的 <> 表示这是对 LexicalCast 模板类的特化
+template<>
+class LexicalCast<std::string, Person>{
+public:
+    Person operator()(const std::string& v){
+        YAML::Node node = YAML::Load(v);
+        Person p;
+        p.m_name = node["name"].as<std::string>();
+        p.m_age = node["age"].as<int>();
+        p.m_sex = node["sex"].as<bool>();
+        return p;
+    }
+};
+
+template<>
+class LexicalCast<Person, std::string>{
+public:
+    std::string operator()(const Person& p){
+        YAML::Node node;
+        node["name"] = p.m_name;
+        node["age"] = p.m_age;
+        node["sex"] = p.m_sex;
+        std::stringstream ss;
+        ss << node;
+        return ss.str();
+    }
+};
+}
+
+#endif
@@ -0,0 +1,101 @@
+#include "../sylar/backtrace.h"
+#include "../sylar/config.h"
+#include "../sylar/macro.h"
+#include "../sylar/log.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+// 不内联, 并且有外部链接, 以 -rdynamic 导出后能查到符号
+namespace test_bt{
+__attribute__((noinline)) sylar::Backtrace::ptr Inner(int skip){
+    sylar::Backtrace::ptr bt = sylar::Backtrace::Capture(skip);
+    __asm__ __volatile__("" ::: "memory");
+    return bt;
+}
+
+__attribute__((noinline)) sylar::Backtrace::ptr Outer(int skip){
+    sylar::Backtrace::ptr bt = Inner(skip);
+    __asm__ __volatile__("" ::: "memory");
+    return bt;
+}
+}
+
+void test_capture(){
+    sylar::Backtrace::ptr bt = test_bt::Outer(0);
+    std::string str = bt->toString();
+    SYLAR_LOG_INFO(g_logger) << "\n" << str;
+    SYLAR_ASSERT(bt->size() >= 3);
+    // 第一层是调用Capture的函数, 已反修饰
+    SYLAR_ASSERT(sylar::Backtrace::Symbolize(bt->getFrames()[0]).find("test_bt::Inner(int)") == 0);
+    SYLAR_ASSERT(sylar::Backtrace::Symbolize(bt->getFrames()[1]).find("test_bt::Outer(int)") == 0);
+    SYLAR_ASSERT(str.find("#0 ") != std::string::npos && str.find("test_backtrace") != std::string::npos);
+
+    // 第一层之外按call指令(返回地址-1)解析
+    SYLAR_ASSERT(str.find(sylar::Backtrace::Symbolize(bt->getFrames()[0])) != std::string::npos);
+    SYLAR_ASSERT(str.find(sylar::Backtrace::Symbolize((char*)bt->getFrames()[1] - 1)) != std::string::npos);
+    SYLAR_ASSERT(str.find(sylar::Backtrace::Symbolize(bt->getFrames()[1])) == std::string::npos);
+
+    // 跳过一层
+    sylar::Backtrace::ptr skipped = test_bt::Outer(1);
+    SYLAR_ASSERT(sylar::Backtrace::Symbolize(skipped->getFrames()[0]).find("test_bt::Outer(int)") == 0);
+
+    // 层数限制
+    SYLAR_ASSERT(sylar::Backtrace::Capture(0, 2)->size() == 2);
+    SYLAR_ASSERT(bt->toString("", 1).find('\n') == std::string::npos);
+
+    // 缓存的结果和第一次一致
+    SYLAR_ASSERT(bt->toString() == str);
+
+    SYLAR_ASSERT(sylar::Backtrace::Demangle("_ZN5sylar9Backtrace7CaptureEii") == "sylar::Backtrace::Capture(int, int)");
+    SYLAR_ASSERT(sylar::Backtrace::Demangle("main") == "main");
+}
+
+static std::string Format(const std::string& pattern, sylar::LogEvent::ptr event){
+    sylar::LogFormatter fmt(pattern);
+    SYLAR_ASSERT(!fmt.isError());
+    return fmt.format(g_logger, event->getLevel(), event);
+}
+
+// 导出符号, 便于检查调用栈的第一层
+__attribute__((noinline)) sylar::LogEvent::ptr MakeEvent(sylar::LogLevel::Level level){
+    return sylar::LogEvent::ptr(new sylar::LogEvent(g_logger, level, __FILE__, __LINE__
+                ,0, 0, 0, 0));
+}
+
+void test_log(){
+    auto level = sylar::Config::Lookup<std::string>("log.backtrace_level");
+    SYLAR_ASSERT(level->getValue() == "FATAL");
+    SYLAR_ASSERT(!MakeEvent(sylar::LogLevel::ERROR)->getBacktrace());
+    SYLAR_ASSERT(MakeEvent(sylar::LogLevel::FATAL)->getBacktrace());
+
+    level->setValue("ERROR");
+    sylar::LogEvent::ptr event = MakeEvent(sylar::LogLevel::ERROR);
+    SYLAR_ASSERT(event->getBacktrace() && event->getBacktrace()->size() > 0);
+    SYLAR_ASSERT(!MakeEvent(sylar::LogLevel::WARN)->getBacktrace());
+    // 捕获从打日志的函数开始
+    SYLAR_ASSERT(sylar::Backtrace::Symbolize(event->getBacktrace()->getFrames()[0]).find("MakeEvent") != std::string::npos);
+
+    std::string out = Format("%m%B|", event);
+    SYLAR_LOG_INFO(g_logger) << out;
+    SYLAR_ASSERT(out.find("\n    #0 ") == 0);
+    SYLAR_ASSERT(Format("%B{1}|", event).find('\n', 1) == std::string::npos);
+    // 没有调用栈时不输出
+    SYLAR_ASSERT(Format("%m%B|", MakeEvent(sylar::LogLevel::INFO)) == "|");
+
+    level->setValue("NONE");
+    SYLAR_ASSERT(!MakeEvent(sylar::LogLevel::FATAL)->getBacktrace());
+    level->setValue("FATAL");
+
+    // 默认格式带 %B
+    sylar::Logger::ptr logger(new sylar::Logger("bt"));
+    logger->addAppender(sylar::LogAppender::ptr(new sylar::StdoutLogAppender));
+    SYLAR_LOG_FATAL(logger) << "fatal with backtrace";
+}
+
+int main(int argc, char** argv){
+    test_capture();
+    SYLAR_LOG_INFO(g_logger) << "test_capture ok";
+    test_log();
+    SYLAR_LOG_INFO(g_logger) << "test_log ok";
+    return 0;
+}
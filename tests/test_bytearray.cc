@@ -0,0 +1,265 @@
+#include "../sylar/bytearray.h"
+#include "../sylar/endian.h"
+#include "../sylar/macro.h"
+#include "../sylar/log.h"
+#include <stdlib.h>
+#include <unistd.h>
+#include <limits>
+#include <stdexcept>
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+// 随机值写入再读出, 块大小取1/3/100/4096以覆盖跨块的各种情况
+// 写完后从头读一遍, 再用setPosition跳回去读一遍
+#define XX(type, len, write_fun, read_fun, base_len) { \
+    std::vector<type> vec; \
+    for(int i = 0; i < len; ++i){ \
+        vec.push_back((type)((((uint64_t)rand() << 32) | rand()) >> (rand() % 64))); \
+    } \
+    vec.push_back(std::numeric_limits<type>::min()); \
+    vec.push_back(std::numeric_limits<type>::max()); \
+    sylar::ByteArray::ptr ba(new sylar::ByteArray(base_len)); \
+    for(auto& i : vec){ \
+        ba->write_fun(i); \
+    } \
+    ba->setPosition(0); \
+    for(size_t i = 0; i < vec.size(); ++i){ \
+        type v = ba->read_fun(); \
+        SYLAR_ASSERT(v == vec[i]); \
+    } \
+    SYLAR_ASSERT(ba->getReadSize() == 0); \
+    size_t size = ba->getSize(); \
+    ba->setPosition(0); \
+    SYLAR_ASSERT(ba->getSize() == size); \
+    for(size_t i = 0; i < vec.size(); ++i){ \
+        SYLAR_ASSERT(ba->read_fun() == vec[i]); \
+    } \
+}
+
+void test_integers(){
+    size_t bases[] = {1, 3, 100, 4096};
+    for(size_t base : bases){
+        XX(int8_t,  100, writeFint8, readFint8, base);
+        XX(uint8_t, 100, writeFuint8, readFuint8, base);
+        XX(int16_t,  100, writeFint16, readFint16, base);
+        XX(uint16_t, 100, writeFuint16, readFuint16, base);
+        XX(int32_t,  100, writeFint32, readFint32, base);
+        XX(uint32_t, 100, writeFuint32, readFuint32, base);
+        XX(int64_t,  100, writeFint64, readFint64, base);
+        XX(uint64_t, 100, writeFuint64, readFuint64, base);
+
+        XX(int32_t,  100, writeInt32, readInt32, base);
+        XX(uint32_t, 100, writeUint32, readUint32, base);
+        XX(int64_t,  100, writeInt64, readInt64, base);
+        XX(uint64_t, 100, writeUint64, readUint64, base);
+    }
+    SYLAR_LOG_INFO(g_logger) << "test_integers ok";
+}
+
+#undef XX
+
+// varint编码长度和zigzag, 小的负数只占一个字节
+void test_varint(){
+    sylar::ByteArray ba;
+    ba.writeInt32(-1);
+    SYLAR_ASSERT(ba.getSize() == 1);
+    ba.writeInt32(63);
+    SYLAR_ASSERT(ba.getSize() == 2);
+    ba.writeInt32(-65);
+    SYLAR_ASSERT(ba.getSize() == 4);
+    ba.writeUint32(127);
+    SYLAR_ASSERT(ba.getSize() == 5);
+    ba.writeUint32(128);
+    SYLAR_ASSERT(ba.getSize() == 7);
+    ba.writeUint64(~0ull);
+    SYLAR_ASSERT(ba.getSize() == 17);
+    ba.setPosition(0);
+    SYLAR_ASSERT(ba.readInt32() == -1);
+    SYLAR_ASSERT(ba.readInt32() == 63);
+    SYLAR_ASSERT(ba.readInt32() == -65);
+    SYLAR_ASSERT(ba.readUint32() == 127);
+    SYLAR_ASSERT(ba.readUint32() == 128);
+    SYLAR_ASSERT(ba.readUint64() == ~0ull);
+
+    // 截断的varint读到末尾抛异常
+    sylar::ByteArray bad;
+    bad.writeFuint8(0x80);
+    bad.setPosition(0);
+    bool thrown = false;
+    try{
+        bad.readUint32();
+    } catch(std::out_of_range&){
+        thrown = true;
+    }
+    SYLAR_ASSERT(thrown);
+    SYLAR_LOG_INFO(g_logger) << "test_varint ok";
+}
+
+// 字节序
+void test_endian(){
+    sylar::ByteArray ba;
+    ba.writeFuint32(0x01020304);
+    SYLAR_ASSERT(ba.toHexString() == "");
+    ba.setPosition(0);
+    SYLAR_ASSERT(ba.toHexString() == "01 02 03 04 ");
+
+    sylar::ByteArray le;
+    le.setIsLittleEndian(true);
+    SYLAR_ASSERT(le.isLittleEndian());
+    le.writeFuint32(0x01020304);
+    le.setPosition(0);
+    SYLAR_ASSERT(le.toHexString() == "04 03 02 01 ");
+    SYLAR_ASSERT(le.readFuint32() == 0x01020304);
+    SYLAR_LOG_INFO(g_logger) << "test_endian ok";
+}
+
+void test_float_string(){
+    size_t bases[] = {1, 7, 4096};
+    for(size_t base : bases){
+        sylar::ByteArray ba(base);
+        std::string big(10000, 'x');
+        for(size_t i = 0; i < big.size(); ++i){
+            big[i] = 'a' + i % 26;
+        }
+        ba.writeFloat(3.25f);
+        ba.writeDouble(-1e300);
+        ba.writeStringF16("hello");
+        ba.writeStringF32("");
+        ba.writeStringF64(big);
+        ba.writeStringVint(big);
+        ba.writeStringWithoutLength("tail");
+        ba.setPosition(0);
+        SYLAR_ASSERT(ba.readFloat() == 3.25f);
+        SYLAR_ASSERT(ba.readDouble() == -1e300);
+        SYLAR_ASSERT(ba.readStringF16() == "hello");
+        SYLAR_ASSERT(ba.readStringF32() == "");
+        SYLAR_ASSERT(ba.readStringF64() == big);
+        SYLAR_ASSERT(ba.readStringVint() == big);
+        SYLAR_ASSERT(ba.toString() == "tail");
+
+        // 长度前缀超过剩余数据
+        sylar::ByteArray bad(base);
+        bad.writeFuint16(100);
+        bad.writeStringWithoutLength("short");
+        bad.setPosition(0);
+        bool thrown = false;
+        try{
+            bad.readStringF16();
+        } catch(std::out_of_range&){
+            thrown = true;
+        }
+        SYLAR_ASSERT(thrown);
+
+        // 长度超过前缀范围
+        sylar::ByteArray over(base);
+        over.writeStringF16(std::string(65535, 'x'));
+        size_t size = over.getSize();
+        thrown = false;
+        try{
+            over.writeStringF16(std::string(65536, 'x'));
+        } catch(std::length_error&){
+            thrown = true;
+        }
+        SYLAR_ASSERT(thrown);
+        SYLAR_ASSERT(over.getSize() == size);
+    }
+    SYLAR_LOG_INFO(g_logger) << "test_float_string ok";
+}
+
+void test_file(){
+    sylar::ByteArray ba(5);
+    for(int i = 0; i < 1000; ++i){
+        ba.writeInt64(i * 1000003ll - 500000000);
+    }
+    ba.setPosition(0);
+    std::string path = "/tmp/test_bytearray.dat";
+    SYLAR_ASSERT(ba.writeToFile(path));
+
+    sylar::ByteArray other(4096);
+    SYLAR_ASSERT(other.readFromFile(path));
+    other.setPosition(0);
+    SYLAR_ASSERT(other.getSize() == ba.getSize());
+    SYLAR_ASSERT(other.toString() == ba.toString());
+    for(int i = 0; i < 1000; ++i){
+        SYLAR_ASSERT(other.readInt64() == i * 1000003ll - 500000000);
+    }
+    unlink(path.c_str());
+    SYLAR_LOG_INFO(g_logger) << "test_file ok";
+}
+
+// 通过管道用writev/readv直接收发块内存
+void test_iovec(){
+    sylar::ByteArray src(64);
+    for(int i = 0; i < 1000; ++i){
+        src.writeUint32(i * 7919);
+    }
+    src.setPosition(0);
+
+    std::vector<iovec> rbufs;
+    uint64_t len = src.getReadBuffers(rbufs);
+    SYLAR_ASSERT(len == src.getSize());
+    SYLAR_ASSERT(rbufs.size() == (len + 63) / 64);
+    SYLAR_ASSERT(src.getPosition() == 0);
+
+    int fds[2];
+    SYLAR_ASSERT(pipe(fds) == 0);
+    ssize_t rt = writev(fds[1], &rbufs[0], rbufs.size());
+    SYLAR_ASSERT(rt == (ssize_t)len);
+
+    // 先写入3个字节, 让接收区从块中间开始
+    sylar::ByteArray dst(50);
+    dst.writeFuint8(1);
+    dst.writeFuint8(2);
+    dst.writeFuint8(3);
+    std::vector<iovec> wbufs;
+    SYLAR_ASSERT(dst.getWriteBuffers(wbufs, len) == len);
+    SYLAR_ASSERT(wbufs[0].iov_len == 47);
+    rt = readv(fds[0], &wbufs[0], wbufs.size());
+    SYLAR_ASSERT(rt == (ssize_t)len);
+    dst.setPosition(dst.getPosition() + len);
+    close(fds[0]);
+    close(fds[1]);
+
+    dst.setPosition(0);
+    SYLAR_ASSERT(dst.readFuint8() == 1 && dst.readFuint8() == 2 && dst.readFuint8() == 3);
+    for(int i = 0; i < 1000; ++i){
+        SYLAR_ASSERT(dst.readUint32() == (uint32_t)(i * 7919));
+    }
+    SYLAR_ASSERT(dst.getReadSize() == 0);
+
+    // 指定位置和长度
+    rbufs.clear();
+    SYLAR_ASSERT(dst.getReadBuffers(rbufs, 10, 45) == 10);
+    SYLAR_ASSERT(rbufs.size() == 2 && rbufs[0].iov_len == 5 && rbufs[1].iov_len == 5);
+    rbufs.clear();
+    SYLAR_ASSERT(dst.getReadBuffers(rbufs, 100, dst.getSize()) == 0);
+    SYLAR_LOG_INFO(g_logger) << "test_iovec ok";
+}
+
+void test_clear(){
+    sylar::ByteArray ba(16);
+    for(int round = 0; round < 3; ++round){
+        for(int i = 0; i < 100; ++i){
+            ba.writeFuint64(i);
+        }
+        ba.setPosition(8 * 50);
+        SYLAR_ASSERT(ba.readFuint64() == 50);
+        uint64_t v = 0;
+        ba.read(&v, sizeof(v), 8 * 99);
+        SYLAR_ASSERT(sylar::byteswapOnLittleEndian(v) == 99);
+        ba.clear();
+        SYLAR_ASSERT(ba.getSize() == 0 && ba.getPosition() == 0 && ba.getReadSize() == 0);
+    }
+    SYLAR_LOG_INFO(g_logger) << "test_clear ok";
+}
+
+int main(int argc, char** argv){
+    test_integers();
+    test_varint();
+    test_endian();
+    test_float_string();
+    test_file();
+    test_iovec();
+    test_clear();
+    return 0;
+}
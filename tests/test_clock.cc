@@ -0,0 +1,111 @@
+#include "../sylar/util.h"
+#include "../sylar/macro.h"
+#include "../sylar/log.h"
+#include <stdlib.h>
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static uint64_t Diff(uint64_t a, uint64_t b){
+    return a > b ? a - b : b - a;
+}
+
+void test_monotonic(){
+    uint64_t last = sylar::GetMonotonicNS();
+    for(int i = 0; i < 100000; ++i){
+        uint64_t now = sylar::GetMonotonicNS();
+        SYLAR_ASSERT(now >= last);
+        last = now;
+    }
+    uint64_t ns = sylar::GetMonotonicNS();
+    uint64_t us = sylar::GetMonotonicUS();
+    uint64_t ms = sylar::GetMonotonicMS();
+    SYLAR_ASSERT(Diff(ns / 1000, us) < 1000);
+    SYLAR_ASSERT(Diff(us / 1000, ms) < 10);
+
+    // 墙上时间和单调时钟的间隔一致
+    uint64_t wall = sylar::GetCurrentUS();
+    ms = sylar::GetMonotonicMS();
+    usleep(20 * 1000);
+    SYLAR_ASSERT(Diff(sylar::GetCurrentUS() - wall, (sylar::GetMonotonicMS() - ms) * 1000) < 5000);
+}
+
+void test_tsc(){
+    SYLAR_LOG_INFO(g_logger) << "tsc available=" << sylar::TscClock::IsAvailable()
+        << " cycles_per_ns=" << sylar::TscClock::GetFrequency();
+    // 与单调时钟在同一时间轴上
+    SYLAR_ASSERT(Diff(sylar::TscClock::Now(), sylar::GetMonotonicNS()) < 1000000);
+    uint64_t last = sylar::TscClock::Now();
+    for(int i = 0; i < 100000; ++i){
+        uint64_t now = sylar::TscClock::Now();
+        SYLAR_ASSERT(now >= last);
+        last = now;
+    }
+    uint64_t t0 = sylar::TscClock::Now();
+    uint64_t m0 = sylar::GetMonotonicNS();
+    usleep(50 * 1000);
+    uint64_t t1 = sylar::TscClock::Now();
+    uint64_t m1 = sylar::GetMonotonicNS();
+    // 50ms的间隔误差在1%以内
+    SYLAR_ASSERT(Diff(t1 - t0, m1 - m0) < (m1 - m0) / 100);
+}
+
+void test_elapse(){
+    uint64_t e0 = sylar::GetElapsedMS();
+    usleep(20 * 1000);
+    uint64_t e1 = sylar::GetElapsedMS();
+    SYLAR_ASSERT(e1 >= e0 + 19);
+
+    // 日志的 %r 是启动以来的毫秒数
+    sylar::Logger::ptr logger(new sylar::Logger("clock"));
+    sylar::LogFormatter::ptr fmt(new sylar::LogFormatter("%r"));
+    sylar::LogEvent::ptr event(new sylar::LogEvent(logger, sylar::LogLevel::INFO, __FILE__, __LINE__
+                ,sylar::GetElapsedMS(), 0, 0, sylar::GetCurrentMS()));
+    uint64_t r = atoll(fmt->format(logger, sylar::LogLevel::INFO, event).c_str());
+    SYLAR_ASSERT(r >= e1 && r <= sylar::GetElapsedMS());
+    SYLAR_LOG_INFO(g_logger) << "elapsed " << r << "ms";
+}
+
+// 记下最后一条日志的时间戳
+class TimeAppender : public sylar::LogAppender{
+public:
+    typedef std::shared_ptr<TimeAppender> ptr;
+    void log(std::shared_ptr<sylar::Logger> logger, sylar::LogLevel::Level level, sylar::LogEvent::ptr event) override{
+        time = event->getTime();
+    }
+    std::string toYamlString() override { return "";}
+
+    uint64_t time = 0;
+};
+
+// 日志时间戳是毫秒, %d 中的 %f 输出3位毫秒
+void test_log_time(){
+    sylar::Logger::ptr logger(new sylar::Logger("clock"));
+    sylar::LogEvent::ptr event(new sylar::LogEvent(logger, sylar::LogLevel::INFO, __FILE__, __LINE__
+                ,0, 0, 0, 1700000000123ul));
+    // 1700000000 % 60 == 20, 秒数与时区无关
+    SYLAR_ASSERT(sylar::LogFormatter("%d{%S.%f}").format(logger, sylar::LogLevel::INFO, event) == "20.123");
+    SYLAR_ASSERT(sylar::LogFormatter("%d{%f|%%f|%S}").format(logger, sylar::LogLevel::INFO, event) == "123|%f|20");
+    event.reset(new sylar::LogEvent(logger, sylar::LogLevel::INFO, __FILE__, __LINE__
+                ,0, 0, 0, 1700000000005ul));
+    SYLAR_ASSERT(sylar::LogFormatter("%d{%S.%f}").format(logger, sylar::LogLevel::INFO, event) == "20.005");
+
+    // 日志宏传入当前的毫秒时间
+    TimeAppender::ptr appender(new TimeAppender);
+    logger->addAppender(appender);
+    uint64_t now = sylar::GetCurrentMS();
+    SYLAR_LOG_INFO(logger) << "now";
+    SYLAR_ASSERT(appender->time >= now && appender->time <= sylar::GetCurrentMS());
+    SYLAR_LOG_INFO(g_logger) << sylar::LogFormatter("%d{%Y-%m-%d %H:%M:%S.%f}").format(logger, sylar::LogLevel::INFO, event);
+}
+
+int main(int argc, char** argv){
+    test_monotonic();
+    SYLAR_LOG_INFO(g_logger) << "test_monotonic ok";
+    test_tsc();
+    SYLAR_LOG_INFO(g_logger) << "test_tsc ok";
+    test_elapse();
+    SYLAR_LOG_INFO(g_logger) << "test_elapse ok";
+    test_log_time();
+    SYLAR_LOG_INFO(g_logger) << "test_log_time ok";
+    return 0;
+}
@@ -1,5 +1,6 @@
 #include "../sylar/config.h"
 #include "../sylar/log.h"
+#include "person.h"
 #include <yaml-cpp/yaml.h>
 
 // 约定
@@ -119,54 +120,6 @@ void test_config(){
 #undef XX_M
 }
 
-class Person {
-public:
-    Person() {}
-    std::string m_name;
-    int m_age = 0;
-    bool m_sex = 0;
-
-    std::string toString() const{
-        std::stringstream ss;
-        ss << "[Person name=" << m_name << " age=" << m_age << " sex=" << m_sex << "]";
-        return ss.str();
-    }
-
-    bool operator== (const Person& oth) const{
-        return m_name == oth.m_name && m_age ==oth.m_age && m_sex == oth.m_sex;
-    }
-};
-
-namespace sylar{
-// 这里的 <> 表示这是对 LexicalCast 模板类的特化
-template<>
-class LexicalCast<std::string, Person>{
-public:
-    Person operator()(const std::string& v){
-        YAML::Node node = YAML::Load(v);
-        Person p;
-        p.m_name = node["name"].as<std::string>();
-        p.m_age = node["age"].as<int>();
-        p.m_sex = node["sex"].as<bool>();
-        return p;
-    }
-};
-
-template<>
-class LexicalCast<Person, std::string>{
-public:
-    std::string operator()(const Person& p){
-        YAML::Node node;
-        node["name"] = p.m_name;
-        node["age"] = p.m_age;
-        node["sex"] = p.m_sex;
-        std::stringstream ss;
-        ss << node;
-        return ss.str();
-    }
-};
-}
-
 sylar::ConfigVar<Person>::ptr g_person = 
     sylar::Config::Lookup("class.person", Person(), "class person");
 
@@ -226,10 +179,21 @@ void test_log(){
 }
 
 
+void test_loadconf(const std::string& path){
+    sylar::Config::LoadFromConfDir(path);
+    std::cout << "system.port=" << g_int_value_config->getValue() << std::endl;
+    std::cout << "class.person=" << g_person->getValue().toString() << std::endl;
+    std::cout << sylar::LoggerMgr::GetInstance()->toYamlString() << std::endl;
+}
+
 int main(int argc, char** argv){
     // test_yaml();
     // test_config();
     // test_class();
+    if(argc > 1){
+        test_loadconf(argv[1]);
+        return 0;
+    }
     test_log();
 
     return 0;
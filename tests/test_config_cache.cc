@@ -0,0 +1,46 @@
+#include "../sylar/config.h"
+#include "../sylar/config_cache.h"
+#include "../sylar/log.h"
+#include <yaml-cpp/yaml.h>
+#include <iostream>
+
+sylar::ConfigVar<int>::ptr g_int_value_config = 
+        sylar::Config::Lookup("system.port", (int)8080, "system port");
+
+sylar::ConfigVar<std::vector<int>>::ptr g_int_vec_value_config = 
+        sylar::Config::Lookup("system.int_vec", std::vector<int>{1,2}, "system int vec");
+
+sylar::ConfigVar<std::map<std::string, int>>::ptr g_str_int_map_value_config = 
+        sylar::Config::Lookup("system.str_int_map", std::map<std::string, int>{{"k", 2}}, "system str int map");
+
+// test.yml中的logs配置会重置root的appender, 这里直接输出到控制台
+
+void print_values(const std::string& prefix){
+    std::cout << prefix << " system.port=" << g_int_value_config->getValue() << std::endl;
+    std::cout << prefix << " system.int_vec=" << g_int_vec_value_config->toString() << std::endl;
+    std::cout << prefix << " system.str_int_map=" << g_str_int_map_value_config->toString() << std::endl;
+}
+
+int main(int argc, char** argv){
+    std::string file = argc > 1 ? argv[1] : "bin/conf/test.yml";
+    std::string cache = file + ".cache";
+    unlink(cache.c_str());
+
+    print_values("before");
+    // 第一次: 缓存不存在, 解析YAML并生成缓存
+    sylar::ConfigCache::LoadFile(file, cache);
+    print_values("yaml");
+
+    g_int_value_config->setValue(0);
+    g_int_vec_value_config->setValue({});
+    // 第二次: 命中缓存, 不解析YAML
+    uint64_t hash = 0;
+    sylar::ConfigCache::HashFile(file, hash);
+    std::cout << "load from cache: " << sylar::ConfigCache::Load(cache, hash) << std::endl;
+    print_values("cache");
+
+    // hash不符视为过期
+    std::cout << "stale cache rejected: " << !sylar::ConfigCache::Load(cache, hash + 1) << std::endl;
+    unlink(cache.c_str());
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include "../sylar/fiber.h"
+#include "../sylar/fiber_stack.h"
+#include "../sylar/thread.h"
+#include "../sylar/log.h"
+#include "../sylar/macro.h"
+#include <vector>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+
+sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+void run_in_fiber(){
+    SYLAR_LOG_INFO(g_logger) << "run_in_fiber begin";
+    sylar::Fiber::YieldToHold();
+    SYLAR_LOG_INFO(g_logger) << "run_in_fiber end";
+    sylar::Fiber::YieldToHold();
+}
+
+void test_fiber(){
+    SYLAR_LOG_INFO(g_logger) << "main begin -1";
+    {
+        sylar::Fiber::GetThis();
+        SYLAR_LOG_INFO(g_logger) << "main begin";
+        sylar::Fiber::ptr fiber(new sylar::Fiber(run_in_fiber));
+        fiber->swapIn();
+        SYLAR_LOG_INFO(g_logger) << "main after swapIn";
+        fiber->swapIn();
+        SYLAR_LOG_INFO(g_logger) << "main after end";
+        fiber->swapIn();
+    }
+    SYLAR_LOG_INFO(g_logger) << "main after end2";
+}
+
+// 浮点寄存器和栈上的局部变量在切换后必须保持不变
+void test_context(){
+    sylar::Fiber::GetThis();
+    double acc = 0;
+    sylar::Fiber::ptr fiber(new sylar::Fiber([&acc](){
+        double local = 1.5;
+        for(int i = 0; i < 3; ++i){
+            acc += local * i;
+            sylar::Fiber::YieldToHold();
+        }
+    }));
+    for(int i = 0; i < 3; ++i){
+        fiber->swapIn();
+    }
+    fiber->swapIn();
+    SYLAR_LOG_INFO(g_logger) << "test_context acc=" << acc << " state=" << fiber->getState();
+
+    // 复用已结束协程的栈
+    fiber->reset([](){
+        throw std::logic_error("fiber exception");
+    });
+    fiber->swapIn();
+    SYLAR_LOG_INFO(g_logger) << "after exception state=" << fiber->getState();
+}
+
+// 栈复用和统计
+void test_stack_pool(){
+    sylar::Fiber::GetThis();
+    std::vector<sylar::Fiber::ptr> fibers;
+    for(int i = 0; i < 32; ++i){
+        fibers.push_back(sylar::Fiber::ptr(new sylar::Fiber([](){}, 100 * 1024)));
+    }
+    for(auto& i : fibers){
+        i->swapIn();
+    }
+    fibers.clear();
+    auto before = sylar::FiberStackPool::GetStats();
+    for(int i = 0; i < 32; ++i){
+        sylar::Fiber::ptr f(new sylar::Fiber([](){}, 100 * 1024));
+        f->swapIn();
+    }
+    auto after = sylar::FiberStackPool::GetStats();
+    SYLAR_LOG_INFO(g_logger) << "stack pool reuse hits=" << after.cache_hits - before.cache_hits
+        << " new_mmaps=" << after.mmaps - before.mmaps
+        << "\n" << after.toYamlString();
+}
+
+// 每层约1KB, 递归有上限(远大于测试用的64KB栈), 没有保护页时也会正常返回
+static int overflow(int n){
+    volatile char buf[1024];
+    buf[0] = n;
+    if(n >= 4096){
+        return buf[0];
+    }
+    return overflow(n + 1) + buf[0];
+}
+
+// 栈溢出必须撞到保护页, 在子进程里验证
+void test_stack_guard(){
+    pid_t pid = fork();
+    if(pid == 0){
+        sylar::Fiber::GetThis();
+        sylar::Fiber::ptr f(new sylar::Fiber([](){
+            overflow(0);
+        }, 64 * 1024));
+        f->swapIn();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    SYLAR_LOG_INFO(g_logger) << "stack overflow child signaled=" << WIFSIGNALED(status)
+        << " sig=" << (WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+    SYLAR_ASSERT(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV);
+}
+
+int main(int argc, char** argv){
+    sylar::Thread::SetName("main");
+    test_context();
+    test_stack_pool();
+    test_stack_guard();
+
+    std::vector<sylar::Thread::ptr> thrs;
+    for(int i = 0; i < 3; ++i){
+        thrs.push_back(sylar::Thread::ptr(
+                    new sylar::Thread(&test_fiber, "name_" + std::to_string(i))));
+    }
+    for(auto i : thrs){
+        i->join();
+    }
+    return 0;
+}
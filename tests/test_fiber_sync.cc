@@ -0,0 +1,167 @@
+#include "../sylar/fiber_sync.h"
+#include "../sylar/channel.h"
+#include "../sylar/scheduler.h"
+#include "../sylar/macro.h"
+#include "../sylar/log.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+// 临界区内让出协程, 计数仍然准确
+void test_mutex(){
+    static sylar::FiberMutex s_mutex;
+    static uint64_t s_count = 0;
+    {
+        sylar::Scheduler sc(4, false, "mutex");
+        sc.start();
+        for(int i = 0; i < 16; ++i){
+            sc.schedule([](){
+                for(int j = 0; j < 2000; ++j){
+                    sylar::FiberMutex::Lock lock(s_mutex);
+                    uint64_t v = s_count;
+                    if(j % 7 == 0){
+                        sylar::Fiber::YieldToReady();
+                    }
+                    s_count = v + 1;
+                }
+            });
+        }
+        sc.stop();
+    }
+    SYLAR_LOG_INFO(g_logger) << "test_mutex count=" << s_count;
+    SYLAR_ASSERT(s_count == 16 * 2000);
+    SYLAR_ASSERT(s_mutex.tryLock());
+    SYLAR_ASSERT(!s_mutex.tryLock());
+    s_mutex.unlock();
+}
+
+// 信号量限制并发数
+void test_semaphore(){
+    static sylar::FiberSemaphore s_sem(2);
+    static std::atomic<int> s_inside {0};
+    static std::atomic<int> s_max {0};
+    {
+        sylar::Scheduler sc(4, false, "sem");
+        sc.start();
+        for(int i = 0; i < 16; ++i){
+            sc.schedule([](){
+                for(int j = 0; j < 100; ++j){
+                    s_sem.wait();
+                    int n = ++s_inside;
+                    int m = s_max;
+                    while(n > m && !s_max.compare_exchange_weak(m, n));
+                    sylar::Fiber::YieldToReady();
+                    --s_inside;
+                    s_sem.notify();
+                }
+            });
+        }
+        sc.stop();
+    }
+    SYLAR_LOG_INFO(g_logger) << "test_semaphore max_inside=" << s_max;
+    SYLAR_ASSERT(s_max <= 2 && s_max >= 1);
+    SYLAR_ASSERT(s_sem.getConcurrency() == 2);
+    SYLAR_ASSERT(s_sem.tryWait() && s_sem.tryWait() && !s_sem.tryWait());
+    s_sem.notify();
+    s_sem.notify();
+}
+
+// 条件变量实现的有界缓冲
+void test_condition(){
+    static sylar::FiberMutex s_mutex;
+    static sylar::FiberCondition s_not_empty;
+    static sylar::FiberCondition s_not_full;
+    static std::deque<int> s_buffer;
+    static uint64_t s_sum = 0;
+    const int producers = 4;
+    const int items = 5000;
+    {
+        sylar::Scheduler sc(2, false, "cond");
+        sc.start();
+        for(int p = 0; p < producers; ++p){
+            sc.schedule([](){
+                for(int i = 1; i <= items; ++i){
+                    sylar::FiberMutex::Lock lock(s_mutex);
+                    s_not_full.wait(lock, [](){ return s_buffer.size() < 8; });
+                    s_buffer.push_back(i);
+                    s_not_empty.notify();
+                }
+            });
+        }
+        sc.schedule([](){
+            for(int i = 0; i < producers * items; ++i){
+                sylar::FiberMutex::Lock lock(s_mutex);
+                s_not_empty.wait(lock, [](){ return !s_buffer.empty(); });
+                s_sum += s_buffer.front();
+                s_buffer.pop_front();
+                s_not_full.notifyAll();
+            }
+        });
+        sc.stop();
+    }
+    SYLAR_LOG_INFO(g_logger) << "test_condition sum=" << s_sum;
+    SYLAR_ASSERT(s_sum == (uint64_t)producers * items * (items + 1) / 2);
+}
+
+// 多生产者多消费者, 关闭后消费者取完剩余元素退出
+void test_channel(){
+    static sylar::Channel<int> s_chan(16);
+    static std::atomic<uint64_t> s_sum {0};
+    static std::atomic<int> s_producers {4};
+    static std::atomic<int> s_consumers_done {0};
+    const int items = 10000;
+    {
+        sylar::Scheduler sc(4, false, "chan");
+        sc.start();
+        for(int p = 0; p < 4; ++p){
+            sc.schedule([](){
+                for(int i = 1; i <= items; ++i){
+                    SYLAR_ASSERT(s_chan.push(i));
+                }
+                if(--s_producers == 0){
+                    s_chan.close();
+                }
+            });
+        }
+        for(int c = 0; c < 3; ++c){
+            sc.schedule([](){
+                int v = 0;
+                while(s_chan.pop(v)){
+                    s_sum += v;
+                }
+                ++s_consumers_done;
+            });
+        }
+        sc.stop();
+    }
+    SYLAR_LOG_INFO(g_logger) << "test_channel sum=" << s_sum;
+    SYLAR_ASSERT(s_sum == 4ull * items * (items + 1) / 2);
+    SYLAR_ASSERT(s_consumers_done == 3);
+    SYLAR_ASSERT(!s_chan.push(1));
+    SYLAR_ASSERT(!s_chan.tryPush(1));
+}
+
+// try操作不挂起, 轮询两个通道
+void test_channel_try(){
+    sylar::Channel<std::string> a(2);
+    sylar::Channel<std::string> b(2);
+    SYLAR_ASSERT(a.tryPush("a1") && a.tryPush("a2") && !a.tryPush("a3"));
+    SYLAR_ASSERT(b.tryPush("b1"));
+    std::string v;
+    int got = 0;
+    while(a.tryPop(v) || b.tryPop(v)){
+        ++got;
+    }
+    SYLAR_ASSERT(got == 3);
+    SYLAR_ASSERT(!a.tryPop(v) && !b.tryPop(v));
+    SYLAR_ASSERT(a.size() == 0 && a.capacity() == 2);
+}
+
+int main(int argc, char** argv){
+    SYLAR_LOG_NAME("system")->setLevel(sylar::LogLevel::INFO);
+    test_mutex();
+    test_semaphore();
+    test_condition();
+    test_channel();
+    test_channel_try();
+    return 0;
+}
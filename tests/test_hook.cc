@@ -0,0 +1,145 @@
+#include "../sylar/hook.h"
+#include "../sylar/iomanager.h"
+#include "../sylar/util.h"
+#include "../sylar/macro.h"
+#include "../sylar/log.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string.h>
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+// 单线程里两个协程各自sleep, 总耗时接近较长的那个而不是两者之和
+void test_sleep(){
+    uint64_t begin = sylar::GetCurrentMS();
+    {
+        sylar::IOManager iom(1, false, "sleep");
+        iom.schedule([](){
+            usleep(200 * 1000);
+            SYLAR_LOG_INFO(g_logger) << "usleep 200ms";
+        });
+        iom.schedule([](){
+            sleep(1);
+            SYLAR_LOG_INFO(g_logger) << "sleep 1s";
+        });
+        iom.schedule([](){
+            struct timespec ts = {0, 300 * 1000 * 1000};
+            nanosleep(&ts, nullptr);
+            SYLAR_LOG_INFO(g_logger) << "nanosleep 300ms";
+        });
+    }
+    uint64_t elapse = sylar::GetCurrentMS() - begin;
+    SYLAR_LOG_INFO(g_logger) << "test_sleep elapse=" << elapse << "ms";
+    SYLAR_ASSERT(elapse >= 1000 && elapse < 1400);
+}
+
+// 不足1ms的睡眠向上取整, 不能退化成只让出一次
+void test_sleep_round(){
+    static uint64_t s_elapse = 0;
+    {
+        sylar::IOManager iom(1, false, "sleep_round");
+        iom.schedule([](){
+            uint64_t begin = sylar::GetMonotonicMS();
+            for(int i = 0; i < 10; ++i){
+                usleep(500);
+            }
+            struct timespec ts = {0, 500 * 1000};
+            struct timespec rem = {1, 1};
+            SYLAR_ASSERT(nanosleep(&ts, &rem) == 0);
+            SYLAR_ASSERT(rem.tv_sec == 0 && rem.tv_nsec == 0);
+            s_elapse = sylar::GetMonotonicMS() - begin;
+
+            ts.tv_nsec = 1000000000;
+            SYLAR_ASSERT(nanosleep(&ts, nullptr) == -1 && errno == EINVAL);
+        });
+    }
+    SYLAR_LOG_INFO(g_logger) << "test_sleep_round elapse=" << s_elapse << "ms";
+    // 定时器精度1ms, 第一次可能在下一个毫秒边界就到期
+    SYLAR_ASSERT(s_elapse >= 9);
+}
+
+static int Listen(sockaddr_in& addr){
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    bind(fd, (sockaddr*)&addr, sizeof(addr));
+    listen(fd, 128);
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr*)&addr, &len);
+    return fd;
+}
+
+// 按阻塞方式写的服务端和客户端在同一个线程里交替执行
+void test_socket(){
+    static std::atomic<int> s_done {0};
+    sylar::IOManager iom(1, false, "socket");
+    iom.schedule([](){
+        sockaddr_in addr;
+        int lfd = Listen(addr);
+
+        sylar::IOManager::GetThis()->schedule([addr](){
+            int sock = socket(AF_INET, SOCK_STREAM, 0);
+            SYLAR_ASSERT(connect(sock, (const sockaddr*)&addr, sizeof(addr)) == 0);
+            // 用户没有设置非阻塞, F_GETFL看到的仍是阻塞
+            SYLAR_ASSERT(!(fcntl(sock, F_GETFL) & O_NONBLOCK));
+            SYLAR_ASSERT(send(sock, "ping", 4, 0) == 4);
+            char buf[16] = {0};
+            SYLAR_ASSERT(recv(sock, buf, sizeof(buf), 0) == 4);
+            SYLAR_ASSERT(memcmp(buf, "pong", 4) == 0);
+
+            // 对端不再发送, 接收超时
+            timeval tv = {0, 100 * 1000};
+            setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            uint64_t begin = sylar::GetCurrentMS();
+            int rt = recv(sock, buf, sizeof(buf), 0);
+            uint64_t elapse = sylar::GetCurrentMS() - begin;
+            SYLAR_LOG_INFO(g_logger) << "recv timeout rt=" << rt << " errno=" << errno
+                                     << " elapse=" << elapse << "ms";
+            SYLAR_ASSERT(rt == -1 && errno == ETIMEDOUT);
+            SYLAR_ASSERT(elapse >= 100 && elapse < 1000);
+
+            // 用户设置非阻塞后保持原来的语义
+            fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+            SYLAR_ASSERT(fcntl(sock, F_GETFL) & O_NONBLOCK);
+            rt = recv(sock, buf, sizeof(buf), 0);
+            SYLAR_ASSERT(rt == -1 && errno == EAGAIN);
+
+            close(sock);
+            ++s_done;
+        });
+
+        int fd = accept(lfd, nullptr, nullptr);
+        SYLAR_ASSERT(fd >= 0);
+        char buf[16] = {0};
+        SYLAR_ASSERT(read(fd, buf, sizeof(buf)) == 4);
+        SYLAR_ASSERT(memcmp(buf, "ping", 4) == 0);
+        SYLAR_ASSERT(write(fd, "pong", 4) == 4);
+        // 等客户端关闭
+        SYLAR_ASSERT(read(fd, buf, sizeof(buf)) == 0);
+        close(fd);
+        close(lfd);
+        ++s_done;
+    });
+    iom.stop();
+    SYLAR_LOG_INFO(g_logger) << "test_socket done=" << s_done;
+    SYLAR_ASSERT(s_done == 2);
+}
+
+// 关闭hook的线程行为不变
+void test_disabled(){
+    SYLAR_ASSERT(!sylar::is_hook_enable());
+    uint64_t begin = sylar::GetCurrentMS();
+    usleep(10 * 1000);
+    SYLAR_ASSERT(sylar::GetCurrentMS() - begin >= 10);
+}
+
+int main(int argc, char** argv){
+    test_disabled();
+    test_sleep();
+    test_sleep_round();
+    test_socket();
+    return 0;
+}
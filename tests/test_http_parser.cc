@@ -0,0 +1,347 @@
+#include "../sylar/http/http_parser.h"
+#include "../sylar/config.h"
+#include "../sylar/macro.h"
+#include "../sylar/log.h"
+#include <string.h>
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+using sylar::http::HttpParser;
+using sylar::http::HttpRequestParser;
+using sylar::http::HttpResponseParser;
+using sylar::http::HttpRequest;
+using sylar::http::HttpResponse;
+using sylar::http::HttpMethod;
+using sylar::http::HttpStatus;
+using sylar::http::StringView;
+
+const char test_request_data[] = "GET /index.html?a=1&b=2#top HTTP/1.1\r\n"
+                                 "Host: www.sylar.top\r\n"
+                                 "User-Agent:  curl/7.81.0 \r\n"
+                                 "Accept: */*\r\n"
+                                 "X-Empty:\r\n"
+                                 "\r\n";
+
+// 一次性传入完整请求, 返回解析器以便检查结果
+static HttpRequestParser::ptr ParseAll(std::string& buf, int expect = 1){
+    HttpRequestParser::ptr parser(new HttpRequestParser);
+    int rt = parser->execute(&buf[0], buf.size());
+    if(rt != expect){
+        SYLAR_LOG_ERROR(g_logger) << "rt=" << rt << " error="
+            << HttpParser::ErrorToString(parser->getError());
+    }
+    SYLAR_ASSERT(rt == expect);
+    return parser;
+}
+
+static void CheckSimple(HttpRequest::ptr req){
+    SYLAR_ASSERT(req->getMethod() == HttpMethod::GET);
+    SYLAR_ASSERT(req->getVersion() == 0x11);
+    SYLAR_ASSERT(req->getUri() == "/index.html?a=1&b=2#top");
+    SYLAR_ASSERT(req->getPath() == "/index.html");
+    SYLAR_ASSERT(req->getQuery() == "a=1&b=2");
+    SYLAR_ASSERT(req->getFragment() == "top");
+    SYLAR_ASSERT(req->getHeaderCount() == 4);
+    SYLAR_ASSERT(req->getHeader("host") == "www.sylar.top");
+    SYLAR_ASSERT(req->getHeader("USER-AGENT") == "curl/7.81.0");
+    SYLAR_ASSERT(req->getHeaderName(2) == "Accept");
+    StringView v;
+    SYLAR_ASSERT(req->hasHeader("x-empty", &v) && v.empty());
+    SYLAR_ASSERT(!req->hasHeader("cookie"));
+    SYLAR_ASSERT(req->getHeader("cookie").data() == nullptr);
+    SYLAR_ASSERT(!req->isClose());
+    SYLAR_ASSERT(req->getBody().empty());
+}
+
+void test_request(){
+    std::string buf = test_request_data;
+    HttpRequestParser::ptr parser = ParseAll(buf);
+    SYLAR_ASSERT(parser->getParsedSize() == buf.size());
+    HttpRequest::ptr req = parser->getData();
+    CheckSimple(req);
+    // 字段直接指向接收缓冲区
+    SYLAR_ASSERT(req->getHeader("host").data() == &buf[0] + buf.find("www.sylar.top"));
+    SYLAR_LOG_INFO(g_logger) << "\n" << *req;
+}
+
+// 每次多收到一个字节, 每次都换一块新的缓冲区, 模拟缓冲区扩容搬移
+void test_incremental(){
+    std::string all = std::string(test_request_data);
+    HttpRequestParser parser;
+    std::string buf;
+    for(size_t i = 1; i <= all.size(); ++i){
+        buf = std::string(all.c_str(), i);
+        int rt = parser.execute(&buf[0], buf.size());
+        SYLAR_ASSERT(rt == (i == all.size() ? 1 : 0));
+        SYLAR_ASSERT(parser.isHeaderFinished() == (i == all.size()));
+    }
+    CheckSimple(parser.getData());
+
+    // 分成两半传入时, 已经扫描过的部分不重新扫描, 结果相同
+    HttpRequestParser parser2;
+    std::string half = all.substr(0, all.size() / 2);
+    SYLAR_ASSERT(parser2.execute(&half[0], half.size()) == 0);
+    SYLAR_ASSERT(parser2.execute(&all[0], all.size()) == 1);
+    CheckSimple(parser2.getData());
+}
+
+void test_content_length(){
+    std::string all = "POST /api/user HTTP/1.1\r\n"
+                      "Content-Type: application/json\r\n"
+                      "Content-Length: 13\r\n"
+                      "\r\n"
+                      "{\"id\":123456}";
+    for(size_t split = 1; split < all.size(); ++split){
+        HttpRequestParser parser;
+        std::string buf = all.substr(0, split);
+        SYLAR_ASSERT(parser.execute(&buf[0], buf.size()) == 0);
+        buf = all;
+        SYLAR_ASSERT(parser.execute(&buf[0], buf.size()) == 1);
+        HttpRequest::ptr req = parser.getData();
+        SYLAR_ASSERT(req->getMethod() == HttpMethod::POST);
+        SYLAR_ASSERT(req->getContentLength() == 13);
+        SYLAR_ASSERT(req->getBody() == "{\"id\":123456}");
+        SYLAR_ASSERT(parser.getParsedSize() == all.size());
+    }
+}
+
+void test_chunked(){
+    std::string all = "POST /upload HTTP/1.1\r\n"
+                      "Transfer-Encoding: gzip, chunked\r\n"
+                      "\r\n"
+                      "5\r\nhello\r\n"
+                      "1;ext=1\r\n \r\n"
+                      "A \r\n0123456789\r\n"
+                      "0\r\n"
+                      "Trailer-Field: x\r\n"
+                      "\r\n";
+    std::string expect = "hello 0123456789";
+
+    std::string buf = all;
+    HttpRequestParser::ptr parser = ParseAll(buf);
+    HttpRequest::ptr req = parser->getData();
+    SYLAR_ASSERT(req->isChunked());
+    SYLAR_ASSERT(req->getBody() == expect);
+    SYLAR_ASSERT(parser->getParsedSize() == all.size());
+
+    // 逐字节传入, 消息体在缓冲区中就地拼接
+    HttpRequestParser parser2;
+    buf.clear();
+    for(size_t i = 0; i < all.size(); ++i){
+        buf.push_back(all[i]);
+        int rt = parser2.execute(&buf[0], buf.size());
+        SYLAR_ASSERT(rt == (i + 1 == all.size() ? 1 : 0));
+    }
+    SYLAR_ASSERT(parser2.getData()->getBody() == expect);
+    SYLAR_ASSERT(parser2.getParsedSize() == all.size());
+
+    // Content-Length和分块同时出现时以分块为准, 之后关闭连接
+    buf = "POST / HTTP/1.1\r\nContent-Length: 100\r\nTransfer-Encoding: chunked\r\n\r\n"
+          "3\r\nabc\r\n0\r\n\r\n";
+    parser = ParseAll(buf);
+    SYLAR_ASSERT(parser->getData()->getBody() == "abc");
+    SYLAR_ASSERT(parser->getData()->isClose());
+}
+
+void test_pipeline(){
+    std::string buf = "GET /1 HTTP/1.1\r\nHost: a\r\n\r\n"
+                      "POST /2 HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc"
+                      "\r\n"
+                      "PUT /3 HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n2\r\nxy\r\n0\r\n\r\n"
+                      "DELETE /4 HTTP/1.1\r\nConnection: close\r\n\r\n"
+                      "GET /5 HTTP/1.1\r\n";
+    const char* paths[] = {"/1", "/2", "/3", "/4"};
+    const char* bodies[] = {"", "abc", "xy", ""};
+    HttpRequestParser parser;
+    size_t offset = 0;
+    for(int i = 0; i < 4; ++i){
+        SYLAR_ASSERT(parser.execute(&buf[offset], buf.size() - offset) == 1);
+        HttpRequest::ptr req = parser.getData();
+        SYLAR_ASSERT(req->getPath() == paths[i]);
+        SYLAR_ASSERT(req->getBody() == bodies[i]);
+        SYLAR_ASSERT(req->isClose() == (i == 3));
+        offset += parser.getParsedSize();
+        parser.reset();
+    }
+    // 最后一个请求不完整
+    SYLAR_ASSERT(parser.execute(&buf[offset], buf.size() - offset) == 0);
+    SYLAR_ASSERT(parser.finish(&buf[offset]) == -1);
+    SYLAR_ASSERT(parser.getError() == HttpParser::UNEXPECTED_EOF);
+}
+
+void test_keep_alive(){
+    struct{
+        const char* req;
+        bool close;
+    } cases[] = {
+        {"GET / HTTP/1.1\r\n\r\n", false},
+        {"GET / HTTP/1.1\r\nConnection: close\r\n\r\n", true},
+        {"GET / HTTP/1.1\r\nConnection: Upgrade, Close\r\n\r\n", true},
+        {"GET / HTTP/1.0\r\n\r\n", true},
+        {"GET / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n", false},
+        {"GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n", false},
+    };
+    for(auto& i : cases){
+        std::string buf = i.req;
+        SYLAR_ASSERT(ParseAll(buf)->getData()->isClose() == i.close);
+    }
+}
+
+void test_uri(){
+    struct{
+        const char* req;
+        const char* path;
+        const char* query;
+    } cases[] = {
+        {"GET http://www.sylar.top/a/b?x=1 HTTP/1.1\r\n\r\n", "/a/b", "x=1"},
+        {"GET http://www.sylar.top HTTP/1.1\r\n\r\n", "/", ""},
+        {"GET https://www.sylar.top:8080?q HTTP/1.1\r\n\r\n", "/", "q"},
+        {"OPTIONS * HTTP/1.1\r\n\r\n", "*", ""},
+        {"CONNECT www.sylar.top:443 HTTP/1.1\r\n\r\n", "www.sylar.top:443", ""},
+        {"GET /?#f HTTP/1.1\r\n\r\n", "/", ""},
+    };
+    for(auto& i : cases){
+        std::string buf = i.req;
+        HttpRequest::ptr req = ParseAll(buf)->getData();
+        SYLAR_ASSERT(req->getPath() == i.path);
+        SYLAR_ASSERT(req->getQuery() == i.query);
+    }
+}
+
+void test_error(){
+    struct{
+        const char* req;
+        int error;
+    } cases[] = {
+        {"GETX / HTTP/1.1\r\n\r\n", HttpParser::INVALID_METHOD},
+        {"GET / HTTP/2.0\r\n\r\n", HttpParser::INVALID_VERSION},
+        {"GET / HTTP/1.1 x\r\n\r\n", HttpParser::INVALID_VERSION},
+        {"GET /\r\n\r\n", HttpParser::INVALID_START_LINE},
+        {"GET ftp:/x HTTP/1.1\r\n\r\n", HttpParser::INVALID_URI},
+        {"GET /a\x01 HTTP/1.1\r\n\r\n", HttpParser::INVALID_URI},
+        {"GET / HTTP/1.1\r\nHost : a\r\n\r\n", HttpParser::INVALID_HEADER},
+        {"GET / HTTP/1.1\r\nHost: a\r\n folded\r\n\r\n", HttpParser::INVALID_HEADER},
+        {"GET / HTTP/1.1\r\nNoColon\r\n\r\n", HttpParser::INVALID_HEADER},
+        {"GET / HTTP/1.1\r\nX: a\rb\r\n\r\n", HttpParser::INVALID_HEADER},
+        {"POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n", HttpParser::INVALID_CONTENT_LENGTH},
+        {"POST / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n", HttpParser::INVALID_CONTENT_LENGTH},
+        {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked, gzip\r\n\r\n", HttpParser::INVALID_TRANSFER_ENCODING},
+        {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n", HttpParser::INVALID_CHUNK},
+        {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n1\r\nab\r\n", HttpParser::INVALID_CHUNK},
+    };
+    for(auto& i : cases){
+        std::string buf = i.req;
+        HttpRequestParser::ptr parser = ParseAll(buf, -1);
+        if(parser->getError() != i.error){
+            SYLAR_LOG_ERROR(g_logger) << i.req << " error="
+                << HttpParser::ErrorToString(parser->getError());
+        }
+        SYLAR_ASSERT(parser->getError() == i.error);
+        SYLAR_ASSERT(parser->hasError() && !parser->isHeaderFinished());
+    }
+}
+
+// 头部和消息体的大小限制来自配置
+void test_limit(){
+    auto buffer_size = sylar::Config::Lookup<uint64_t>("http.request.buffer_size");
+    auto max_body_size = sylar::Config::Lookup<uint64_t>("http.request.max_body_size");
+    buffer_size->setValue(64);
+    max_body_size->setValue(10);
+
+    std::string buf = "GET / HTTP/1.1\r\nCookie: " + std::string(64, 'c') + "\r\n\r\n";
+    SYLAR_ASSERT(ParseAll(buf, -1)->getError() == HttpParser::HEADER_TOO_LARGE);
+    // 没有收到完整的一行时也能发现超限
+    buf = "GET /" + std::string(100, 'a');
+    SYLAR_ASSERT(ParseAll(buf, -1)->getError() == HttpParser::HEADER_TOO_LARGE);
+
+    buf = "POST / HTTP/1.1\r\nContent-Length: 11\r\n\r\n";
+    SYLAR_ASSERT(ParseAll(buf, -1)->getError() == HttpParser::BODY_TOO_LARGE);
+    buf = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\n12345\r\n6\r\n";
+    SYLAR_ASSERT(ParseAll(buf, -1)->getError() == HttpParser::BODY_TOO_LARGE);
+    buf = "POST / HTTP/1.1\r\nContent-Length: 10\r\n\r\n0123456789";
+    SYLAR_ASSERT(ParseAll(buf)->getData()->getBody() == "0123456789");
+
+    buffer_size->setValue(4 * 1024);
+    max_body_size->setValue(64 * 1024 * 1024);
+}
+
+void test_response(){
+    HttpResponse rsp(0x11, false);
+    rsp.setStatus(HttpStatus::NOT_FOUND);
+    rsp.setHeader("Content-Type", "text/plain");
+    rsp.setHeader("Connection", "ignored");
+    rsp.setBody("not found");
+    std::string buf = rsp.toString();
+    SYLAR_LOG_INFO(g_logger) << "\n" << buf;
+
+    HttpResponseParser parser;
+    SYLAR_ASSERT(parser.execute(&buf[0], buf.size()) == 1);
+    HttpResponse::ptr r = parser.getData();
+    SYLAR_ASSERT(r->getStatus() == HttpStatus::NOT_FOUND);
+    SYLAR_ASSERT(r->getReason() == "Not Found");
+    SYLAR_ASSERT(r->getHeader("content-type") == "text/plain");
+    SYLAR_ASSERT(r->getBody() == "not found");
+    SYLAR_ASSERT(!r->isClose());
+    SYLAR_ASSERT(parser.getParsedSize() == buf.size());
+
+    // 空消息体也带Content-Length, 保持连接时对端能判断响应结束
+    HttpResponse empty(0x11, false);
+    buf = empty.toString();
+    SYLAR_ASSERT(buf.find("content-length: 0") != std::string::npos);
+
+    // 没有长度的响应直到连接关闭
+    buf = "HTTP/1.1 200 OK\r\n\r\nuntil close";
+    parser.reset();
+    SYLAR_ASSERT(parser.execute(&buf[0], buf.size()) == 0);
+    SYLAR_ASSERT(parser.finish(&buf[0]) == 1);
+    SYLAR_ASSERT(parser.getData()->getBody() == "until close");
+    SYLAR_ASSERT(parser.getData()->isClose());
+
+    // 204和HEAD的响应没有消息体, 原因短语可以省略
+    buf = "HTTP/1.1 204\r\nContent-Length: 10\r\n\r\n";
+    parser.reset();
+    SYLAR_ASSERT(parser.execute(&buf[0], buf.size()) == 1);
+    SYLAR_ASSERT(parser.getData()->getStatus() == HttpStatus::NO_CONTENT);
+    buf = "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n";
+    parser.reset();
+    parser.setNoBody(true);
+    SYLAR_ASSERT(parser.execute(&buf[0], buf.size()) == 1);
+    SYLAR_ASSERT(parser.getData()->getBody().empty());
+
+    // 分块的响应, 同名字段合并
+    buf = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nVia: a\r\nVia: b\r\n\r\n"
+          "3\r\nabc\r\n3\r\ndef\r\n0\r\n\r\n";
+    parser.reset();
+    SYLAR_ASSERT(parser.execute(&buf[0], buf.size()) == 1);
+    SYLAR_ASSERT(parser.getData()->getBody() == "abcdef");
+    SYLAR_ASSERT(parser.getData()->getHeader("via") == "a, b");
+}
+
+// 请求之间多余的空行被忽略
+void test_leading_crlf(){
+    std::string buf = "\r\n\r\nGET / HTTP/1.1\r\n\r\n";
+    HttpRequestParser::ptr parser = ParseAll(buf);
+    SYLAR_ASSERT(parser->getData()->getPath() == "/");
+    SYLAR_ASSERT(parser->getParsedSize() == buf.size());
+
+    HttpRequestParser empty;
+    buf = "\r\n";
+    SYLAR_ASSERT(empty.execute(&buf[0], buf.size()) == 0);
+    SYLAR_ASSERT(empty.finish(&buf[0]) == 0);
+}
+
+int main(int argc, char** argv){
+    test_request();
+    test_incremental();
+    test_content_length();
+    test_chunked();
+    test_pipeline();
+    test_keep_alive();
+    test_uri();
+    test_error();
+    test_limit();
+    test_response();
+    test_leading_crlf();
+    SYLAR_LOG_INFO(g_logger) << "test_http_parser ok";
+    return 0;
+}
@@ -0,0 +1,323 @@
+#include "../sylar/http/http_server.h"
+#include "../sylar/iomanager.h"
+#include "../sylar/thread.h"
+#include "../sylar/macro.h"
+#include "../sylar/log.h"
+#include <sys/socket.h>
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+using namespace sylar::http;
+
+class NamedServlet : public Servlet{
+public:
+    NamedServlet(const std::string& name)
+        :Servlet(name){
+    }
+    int32_t handle(HttpRequest::ptr request, HttpResponse::ptr response
+                   ,HttpSession::ptr session) override{
+        response->setBody(m_name);
+        return 0;
+    }
+};
+
+static std::string Matched(ServletDispatch::ptr sd, const char* path){
+    return sd->getMatchedServlet(path)->getName();
+}
+
+void test_route(){
+    ServletDispatch::ptr sd(new ServletDispatch);
+    const char* globs[] = {"/static/*", "/static/js/*", "/user/*/info", "/user/*/*",
+                           "/img/*.png", "/img/*.jpg", "/a*b/c", "/*.ico", "/api/v1/*"};
+    for(auto i : globs){
+        sd->addGlobServlet(i, std::make_shared<NamedServlet>(i));
+    }
+    sd->addServlet("/", std::make_shared<NamedServlet>("exact:/"));
+    sd->addServlet("/static/index.html", std::make_shared<NamedServlet>("exact:index"));
+    sd->addServlet("/api/v1/user", std::make_shared<NamedServlet>("exact:user"));
+
+    struct{
+        const char* path;
+        const char* name;
+    } cases[] = {
+        {"/", "exact:/"},
+        {"/static/index.html", "exact:index"},
+        {"/api/v1/user", "exact:user"},
+        {"/api/v1/user/1", "/api/v1/*"},
+        {"/api/v1/", "/api/v1/*"},
+        {"/api/v1", "NotFoundServlet"},
+        {"/static/", "/static/*"},
+        {"/static/css/a.css", "/static/*"},
+        {"/static/js/a.js", "/static/js/*"},
+        {"/static/jsx", "/static/*"},
+        {"/user/10086/info", "/user/*/info"},
+        {"/user/10086/photo", "/user/*/*"},
+        {"/user//info", "NotFoundServlet"},
+        {"/user/10086/info/more", "/user/*/*"},
+        {"/img/logo.png", "/img/*.png"},
+        {"/img/a.b.jpg", "/img/*.jpg"},
+        {"/img/.png", "NotFoundServlet"},
+        {"/img/x/a.png", "NotFoundServlet"},
+        {"/axxb/c", "/a*b/c"},
+        {"/abbb/c", "/a*b/c"},
+        {"/favicon.ico", "/*.ico"},
+        {"/x/favicon.ico", "NotFoundServlet"},
+        {"/nothing", "NotFoundServlet"},
+    };
+    for(auto& i : cases){
+        std::string name = Matched(sd, i.path);
+        if(name != i.name){
+            SYLAR_LOG_ERROR(g_logger) << i.path << " matched " << name << " expect " << i.name;
+        }
+        SYLAR_ASSERT(name == i.name);
+    }
+
+    // 替换和删除后重新编译
+    sd->addGlobServlet("/static/*", std::make_shared<NamedServlet>("static2"));
+    SYLAR_ASSERT(Matched(sd, "/static/a") == "static2");
+    sd->delGlobServlet("/static/*");
+    SYLAR_ASSERT(Matched(sd, "/static/a") == "NotFoundServlet");
+    SYLAR_ASSERT(Matched(sd, "/static/js/a") == "/static/js/*");
+    sd->delServlet("/");
+    SYLAR_ASSERT(Matched(sd, "/") == "NotFoundServlet");
+    SYLAR_ASSERT(!sd->getServlet("/"));
+    SYLAR_ASSERT(sd->getGlobServlet("/*.ico")->getName() == "/*.ico");
+}
+
+// 处理请求时替换默认servlet
+void test_default(){
+    ServletDispatch::ptr sd(new ServletDispatch);
+    Servlet::ptr a = std::make_shared<NamedServlet>("default_a");
+    Servlet::ptr b = std::make_shared<NamedServlet>("default_b");
+    sd->setDefault(a);
+    sylar::Thread thr([sd, a, b](){
+        for(int i = 0; i < 100000; ++i){
+            sd->setDefault(i % 2 ? a : b);
+        }
+    }, "set_default");
+    for(int i = 0; i < 100000; ++i){
+        std::string name = Matched(sd, "/none");
+        SYLAR_ASSERT(name == "default_a" || name == "default_b");
+        SYLAR_ASSERT(sd->getDefault());
+    }
+    thr.join();
+    SYLAR_ASSERT(sd->getDefault() == a);
+}
+
+// 客户端连接, 从中依次读出响应
+class Client{
+public:
+    Client(sylar::Address::ptr addr)
+        :m_sock(sylar::Socket::CreateTCP(addr))
+        ,m_begin(0){
+        SYLAR_ASSERT(m_sock->connect(addr, 1000));
+        m_sock->setRecvTimeout(1000);
+    }
+
+    // 只关闭写方向, 仍可读出服务端的回复
+    void shutdownWrite(){
+        ::shutdown(m_sock->getSocket(), SHUT_WR);
+    }
+
+    void send(const std::string& data){
+        SYLAR_ASSERT(m_sock->send(data.c_str(), data.size()) == (int)data.size());
+    }
+
+    // 连接关闭时返回nullptr
+    HttpResponse::ptr recv(){
+        HttpResponseParser parser;
+        while(true){
+            if(m_buf.size() > m_begin){
+                int rt = parser.execute(&m_buf[m_begin], m_buf.size() - m_begin);
+                SYLAR_ASSERT(rt >= 0);
+                if(rt == 1){
+                    m_begin += parser.getParsedSize();
+                    return parser.getData();
+                }
+            }
+            char tmp[4096];
+            int n = m_sock->recv(tmp, sizeof(tmp));
+            if(n <= 0){
+                return nullptr;
+            }
+            m_buf.append(tmp, n);
+        }
+    }
+private:
+    sylar::Socket::ptr m_sock;
+    std::string m_buf;
+    size_t m_begin;
+};
+
+static HttpServer::ptr StartServer(bool keepalive){
+    HttpServer::ptr server(new HttpServer(keepalive));
+    SYLAR_ASSERT(server->bind(sylar::IPv4Address::Create("127.0.0.1", 0)));
+    auto sd = server->getServletDispatch();
+    sd->addServlet("/hello", [](HttpRequest::ptr req, HttpResponse::ptr rsp
+                                ,HttpSession::ptr session){
+        rsp->setHeader("Content-Type", "text/plain");
+        rsp->setBody("hello");
+        return 0;
+    });
+    sd->addServlet("/echo", [](HttpRequest::ptr req, HttpResponse::ptr rsp
+                               ,HttpSession::ptr session){
+        rsp->setBody(req->getBody().toString() + "|" + req->getQuery().toString());
+        return 0;
+    });
+    sd->addGlobServlet("/static/*", [](HttpRequest::ptr req, HttpResponse::ptr rsp
+                                       ,HttpSession::ptr session){
+        rsp->setBody(req->getPath().toString());
+        return 0;
+    });
+    SYLAR_ASSERT(server->start());
+    return server;
+}
+
+void test_server(){
+    sylar::IOManager iom(2, false, "http");
+    iom.schedule([](){
+        HttpServer::ptr server = StartServer(true);
+        server->setName("test/1.0");
+        sylar::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+
+        // 同一个连接上依次处理多个请求
+        Client client(addr);
+        client.send("GET /hello HTTP/1.1\r\nHost: a\r\n\r\n");
+        HttpResponse::ptr rsp = client.recv();
+        SYLAR_ASSERT(rsp && rsp->getStatus() == HttpStatus::OK);
+        SYLAR_ASSERT(rsp->getBody() == "hello");
+        SYLAR_ASSERT(rsp->getHeader("server") == "test/1.0");
+        SYLAR_ASSERT(!rsp->isClose());
+
+        client.send("GET /static/js/a.js HTTP/1.1\r\n\r\n");
+        rsp = client.recv();
+        SYLAR_ASSERT(rsp->getBody() == "/static/js/a.js");
+
+        client.send("GET /nothing HTTP/1.1\r\n\r\n");
+        rsp = client.recv();
+        SYLAR_ASSERT(rsp->getStatus() == HttpStatus::NOT_FOUND);
+        SYLAR_ASSERT(rsp->getBody().find("test/1.0") != std::string::npos);
+
+        // 一次发出的多个请求(pipelining), 分块消息体
+        client.send("POST /echo?x=1 HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc"
+                    "POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                    "2\r\nde\r\n1\r\nf\r\n0\r\n\r\n"
+                    "GET /hello HTTP/1.1\r\nConnection: close\r\n\r\n");
+        SYLAR_ASSERT(client.recv()->getBody() == "abc|x=1");
+        SYLAR_ASSERT(client.recv()->getBody() == "def|");
+        rsp = client.recv();
+        SYLAR_ASSERT(rsp->getBody() == "hello" && rsp->isClose());
+        SYLAR_ASSERT(!client.recv());
+
+        // 分几次到达的请求, 客户端先关闭保持的连接
+        {
+            Client slow(addr);
+            std::string req = "GET /hello HTTP/1.1\r\nHost: a\r\n\r\n";
+            for(size_t i = 0; i < req.size(); i += 7){
+                slow.send(req.substr(i, 7));
+                usleep(1000);
+            }
+            SYLAR_ASSERT(slow.recv()->getBody() == "hello");
+        }
+
+        // HTTP/1.0 默认不保持连接
+        Client old(addr);
+        old.send("GET /hello HTTP/1.0\r\n\r\n");
+        rsp = old.recv();
+        SYLAR_ASSERT(rsp->isClose() && rsp->getVersion() == 0x10);
+        SYLAR_ASSERT(!old.recv());
+
+        // 格式错误的请求回复400后关闭
+        Client bad(addr);
+        bad.send("GET / HTTP/1.1\r\nBad Header\r\n\r\n");
+        rsp = bad.recv();
+        SYLAR_ASSERT(rsp->getStatus() == HttpStatus::BAD_REQUEST);
+        SYLAR_ASSERT(!bad.recv());
+
+        Client large(addr);
+        large.send("GET / HTTP/1.1\r\nCookie: " + std::string(6000, 'c') + "\r\n\r\n");
+        rsp = large.recv();
+        SYLAR_ASSERT(rsp->getStatus() == HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE);
+
+        server->stop();
+
+        // 不开启keepalive时每个请求后关闭连接
+        server = StartServer(false);
+        addr = server->getSocks()[0]->getLocalAddress();
+        Client once(addr);
+        once.send("GET /hello HTTP/1.1\r\n\r\nGET /hello HTTP/1.1\r\n\r\n");
+        rsp = once.recv();
+        SYLAR_ASSERT(rsp->getBody() == "hello" && rsp->isClose());
+        SYLAR_ASSERT(!once.recv());
+        server->stop();
+    });
+}
+
+// 收集访问日志
+class CollectLogAppender : public sylar::LogAppender{
+public:
+    typedef std::shared_ptr<CollectLogAppender> ptr;
+    void log(std::shared_ptr<sylar::Logger> logger, sylar::LogLevel::Level level, sylar::LogEvent::ptr event) override{
+        MutexType::Lock lock(m_mutex);
+        m_lines.push_back(event->getContent());
+    }
+    std::string toYamlString() override { return "";}
+
+    std::vector<std::string> getLines(){
+        MutexType::Lock lock(m_mutex);
+        return m_lines;
+    }
+private:
+    std::vector<std::string> m_lines;
+};
+
+// 保持的连接正常关闭或空闲连接关闭时, 不回复也不记访问日志
+void test_keepalive_close(){
+    CollectLogAppender::ptr appender(new CollectLogAppender);
+    sylar::Logger::ptr access = SYLAR_LOG_NAME("access");
+    access->addAppender(appender);
+
+    sylar::IOManager iom(2, false, "http_close");
+    iom.schedule([appender](){
+        HttpServer::ptr server = StartServer(true);
+        sylar::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+        {
+            Client client(addr);
+            client.send("GET /hello HTTP/1.1\r\nHost: a\r\n\r\n");
+            HttpResponse::ptr rsp = client.recv();
+            SYLAR_ASSERT(rsp && rsp->getStatus() == HttpStatus::OK && !rsp->isClose());
+            client.shutdownWrite();
+            SYLAR_ASSERT(!client.recv());
+        }
+        {
+            Client idle(addr);
+            idle.shutdownWrite();
+            SYLAR_ASSERT(!idle.recv());
+        }
+        for(int i = 0; i < 100 && server->getConnectionCount() != 0; ++i){
+            usleep(1000);
+        }
+        SYLAR_ASSERT(server->getConnectionCount() == 0);
+        std::vector<std::string> lines = appender->getLines();
+        for(auto& i : lines){
+            SYLAR_LOG_INFO(g_logger) << "access: " << i;
+        }
+        SYLAR_ASSERT(lines.size() == 1);
+        SYLAR_ASSERT(lines[0].find("\"GET /hello HTTP/1.1\" 200") != std::string::npos);
+        server->stop();
+    });
+    iom.stop();
+    access->delAppender(appender);
+}
+
+int main(int argc, char** argv){
+    test_route();
+    SYLAR_LOG_INFO(g_logger) << "test_route ok";
+    test_default();
+    SYLAR_LOG_INFO(g_logger) << "test_default ok";
+    test_server();
+    SYLAR_LOG_INFO(g_logger) << "test_server ok";
+    test_keepalive_close();
+    SYLAR_LOG_INFO(g_logger) << "test_keepalive_close ok";
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include "../sylar/iomanager.h"
+#include "../sylar/macro.h"
+#include "../sylar/util.h"
+#include "../sylar/log.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static void SetNonblock(int fd){
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+// 监听回环地址的随机端口
+static int Listen(sockaddr_in& addr){
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    bind(fd, (sockaddr*)&addr, sizeof(addr));
+    listen(fd, 128);
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr*)&addr, &len);
+    SetNonblock(fd);
+    return fd;
+}
+
+// 非阻塞connect, 可写时回调
+void test_connect(){
+    sockaddr_in addr;
+    int lfd = Listen(addr);
+
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    SetNonblock(sock);
+    int rt = connect(sock, (const sockaddr*)&addr, sizeof(addr));
+    if(rt && errno == EINPROGRESS){
+        SYLAR_LOG_INFO(g_logger) << "add event errno=" << errno << " " << strerror(errno);
+        sylar::IOManager::GetThis()->addEvent(sock, sylar::IOManager::WRITE, [sock, lfd](){
+            SYLAR_LOG_INFO(g_logger) << "write callback";
+            close(sock);
+            close(lfd);
+        });
+    }
+    else{
+        SYLAR_LOG_INFO(g_logger) << "connect rt=" << rt << " errno=" << errno;
+        close(sock);
+        close(lfd);
+    }
+}
+
+// 协程在READ事件上挂起, 对端写入后被恢复; 未触发的事件可以被cancelEvent触发
+void test_resume(){
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    SetNonblock(fds[0]);
+    SetNonblock(fds[1]);
+    sylar::IOManager* iom = sylar::IOManager::GetThis();
+
+    iom->schedule([fds](){
+        char buf[16] = {0};
+        SYLAR_ASSERT(read(fds[0], buf, sizeof(buf)) < 0 && errno == EAGAIN);
+        sylar::IOManager::GetThis()->addEvent(fds[0], sylar::IOManager::READ);
+        sylar::Fiber::YieldToHold();
+        int n = read(fds[0], buf, sizeof(buf));
+        SYLAR_LOG_INFO(g_logger) << "resumed read n=" << n << " buf=" << buf;
+        SYLAR_ASSERT(n == 5);
+
+        // 没有数据的READ事件被cancel后立即恢复
+        sylar::IOManager::GetThis()->addEvent(fds[0], sylar::IOManager::READ);
+        sylar::Fiber::YieldToHold();
+        SYLAR_LOG_INFO(g_logger) << "resumed by cancel";
+        close(fds[0]);
+        close(fds[1]);
+    });
+    iom->schedule([fds](){
+        usleep(10000);
+        SYLAR_ASSERT(write(fds[1], "hello", 5) == 5);
+        usleep(10000);
+        sylar::IOManager::GetThis()->cancelEvent(fds[0], sylar::IOManager::READ);
+    });
+}
+
+// 大量fd时上下文数组扩容
+void test_many_fds(){
+    static std::atomic<int> s_fired {0};
+    sylar::IOManager iom(2, false, "many");
+    std::vector<int> fds;
+    for(int i = 0; i < 200; ++i){
+        int sv[2];
+        socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+        SetNonblock(sv[0]);
+        fds.push_back(sv[0]);
+        fds.push_back(sv[1]);
+        iom.addEvent(sv[0], sylar::IOManager::READ, [](){
+            ++s_fired;
+        });
+    }
+    for(size_t i = 1; i < fds.size(); i += 2){
+        SYLAR_ASSERT(write(fds[i], "x", 1) == 1);
+    }
+    iom.stop();
+    for(auto fd : fds){
+        close(fd);
+    }
+    SYLAR_LOG_INFO(g_logger) << "test_many_fds fired=" << s_fired;
+    SYLAR_ASSERT(s_fired == 200);
+}
+
+static uint64_t GetCpuMS(clockid_t clock){
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000ul + ts.tv_nsec / 1000000;
+}
+
+// 指定线程的任务只唤醒目标线程; 目标线程忙时, 其它空闲线程不因为它的任务空转
+void test_pinned(){
+    sylar::IOManager iom(3, false, "pinned");
+    std::vector<int> ids = iom.getWorkerThreadIds();
+    SYLAR_ASSERT(ids.size() == 3);
+    // 等所有线程进入epoll_wait
+    usleep(50 * 1000);
+    for(int round = 0; round < 3; ++round){
+        for(int id : ids){
+            std::atomic<uint64_t> ran {0};
+            uint64_t begin = sylar::GetMonotonicMS();
+            iom.schedule([&ran, id](){
+                SYLAR_ASSERT(sylar::GetThreadID() == id);
+                ran = sylar::GetMonotonicMS();
+            }, id);
+            while(!ran){
+                usleep(1000);
+            }
+            SYLAR_ASSERT(ran - begin < 500);
+        }
+    }
+
+    std::atomic<bool> done {false};
+    uint64_t cpu = GetCpuMS(CLOCK_PROCESS_CPUTIME_ID);
+    iom.schedule([](){
+        uint64_t end = GetCpuMS(CLOCK_THREAD_CPUTIME_ID) + 200;
+        while(GetCpuMS(CLOCK_THREAD_CPUTIME_ID) < end);
+    }, ids[0]);
+    iom.schedule([&done](){
+        done = true;
+    }, ids[0]);
+    while(!done){
+        usleep(1000);
+    }
+    cpu = GetCpuMS(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+    SYLAR_LOG_INFO(g_logger) << "test_pinned cpu=" << cpu << "ms";
+    // 忙的线程占200ms
+    SYLAR_ASSERT(cpu < 300);
+}
+
+void test1(){
+    sylar::IOManager iom(2, false);
+    iom.schedule(&test_connect);
+    iom.schedule(&test_resume);
+}
+
+int main(int argc, char** argv){
+    test1();
+    test_many_fds();
+    test_pinned();
+    return 0;
+}
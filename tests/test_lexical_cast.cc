@@ -0,0 +1,86 @@
+#include "../sylar/config.h"
+#include <assert.h>
+#include <math.h>
+#include <iostream>
+
+template<class T>
+T from(const std::string& v){
+    return sylar::LexicalCast<std::string, T>()(v);
+}
+
+template<class T>
+std::string to(const T& v){
+    return sylar::LexicalCast<T, std::string>()(v);
+}
+
+// 期望解析失败, 并检查出错位置
+template<class T>
+void expect_error(const std::string& v, size_t pos){
+    try{
+        from<T>(v);
+        std::cout << "expect error: " << v << std::endl;
+        assert(false);
+    }catch(sylar::LexicalCastError& e){
+        std::cout << e.what() << std::endl;
+        assert(e.getPos() == pos);
+    }
+}
+
+void test_int(){
+    assert(from<int>("123") == 123);
+    assert(from<int>("-2147483648") == -2147483648);
+    assert(from<int>("+7") == 7);
+    assert(from<int>("0x1F") == 31);
+    assert(from<int>("0o17") == 15);
+    assert(from<int>("0b101") == 5);
+    assert(from<int>("1e3") == 1000);
+    assert(from<unsigned long long>("18446744073709551615") == 18446744073709551615ULL);
+    assert(to<int>(-42) == "-42");
+    assert(to<unsigned long>(0) == "0");
+
+    expect_error<int>("12x", 2);
+    expect_error<int>("2147483648", 9);
+    expect_error<int>("0x", 2);
+    expect_error<int>("1.5", 0);
+    expect_error<unsigned int>("-1", 0);
+    expect_error<short>("", 0);
+}
+
+void test_float(){
+    assert(from<double>("1e3") == 1000.0);
+    assert(from<double>("-0.25") == -0.25);
+    assert(isinf(from<double>(".inf")));
+    assert(from<double>("-.Inf") < 0);
+    assert(isnan(from<double>(".nan")));
+    assert(from<float>("10.2") == 10.2f);
+    assert(to<float>(10.2f) == "10.2");
+    assert(to<double>(0.1) == "0.1");
+
+    // 随机值往返必须精确还原
+    for(int i = 0; i < 100000; ++i){
+        double d = (rand() - RAND_MAX / 2) * 1e-3 / (rand() + 1);
+        assert(from<double>(to<double>(d)) == d);
+        float f = (float)d;
+        assert(from<float>(to<float>(f)) == f);
+    }
+
+    expect_error<double>("1.2.3", 3);
+    expect_error<double>("1e", 2);
+    expect_error<double>(" 1", 0);
+    expect_error<double>("1e999", 0);
+}
+
+void test_bool(){
+    assert(from<bool>("true") && from<bool>("Yes") && from<bool>("ON") && from<bool>("1"));
+    assert(!from<bool>("false") && !from<bool>("no") && !from<bool>("Off") && !from<bool>("0"));
+    assert(to<bool>(true) == "true");
+    expect_error<bool>("maybe", 0);
+}
+
+int main(int argc, char** argv){
+    test_int();
+    test_float();
+    test_bool();
+    std::cout << "test_lexical_cast ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,227 @@
+#include "../sylar/lockfree/mpmc_queue.h"
+#include "../sylar/lockfree/mpsc_queue.h"
+#include "../sylar/lockfree/object_pool.h"
+#include "../sylar/thread.h"
+#include "../sylar/macro.h"
+#include "../sylar/log.h"
+#include <set>
+#include <sched.h>
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+// 元素编码为 生产者id << 32 | 序号
+static uint64_t Encode(uint64_t producer, uint64_t seq){
+    return producer << 32 | seq;
+}
+
+// 检查每个消费者看到的同一生产者的序号严格递增(FIFO), 并且所有元素恰好出现一次
+static void CheckHistory(const std::vector<std::vector<uint64_t> >& histories,
+                         size_t producers, size_t per_producer){
+    std::vector<std::vector<uint8_t> > seen(producers, std::vector<uint8_t>(per_producer, 0));
+    size_t total = 0;
+    for(auto& h : histories){
+        std::vector<int64_t> last(producers, -1);
+        for(auto v : h){
+            uint64_t p = v >> 32;
+            uint64_t s = v & 0xffffffff;
+            SYLAR_ASSERT(p < producers && s < per_producer);
+            SYLAR_ASSERT2((int64_t)s > last[p], "producer=" << p << " seq=" << s << " last=" << last[p]);
+            last[p] = s;
+            SYLAR_ASSERT(!seen[p][s]);
+            seen[p][s] = 1;
+            ++total;
+        }
+    }
+    SYLAR_ASSERT(total == producers * per_producer);
+}
+
+void test_mpmc(){
+    const size_t producers = 4;
+    const size_t consumers = 4;
+    const size_t per_producer = 200000;
+    sylar::MPMCQueue<uint64_t> queue(64);
+    SYLAR_ASSERT(queue.capacity() == 64);
+    std::atomic<size_t> consumed {0};
+    std::vector<std::vector<uint64_t> > histories(consumers);
+    std::vector<sylar::Thread::ptr> threads;
+
+    for(size_t i = 0; i < producers; ++i){
+        threads.push_back(sylar::Thread::ptr(new sylar::Thread([i, &queue](){
+            for(size_t s = 0; s < per_producer; ++s){
+                while(!queue.push(Encode(i, s))){
+                    sched_yield();
+                }
+            }
+        }, "prod_" + std::to_string(i))));
+    }
+    for(size_t i = 0; i < consumers; ++i){
+        std::vector<uint64_t>* h = &histories[i];
+        threads.push_back(sylar::Thread::ptr(new sylar::Thread([h, &queue, &consumed](){
+            uint64_t v = 0;
+            while(consumed < producers * per_producer){
+                if(queue.pop(v)){
+                    h->push_back(v);
+                    ++consumed;
+                }
+                else{
+                    sched_yield();
+                }
+            }
+        }, "cons_" + std::to_string(i))));
+    }
+    for(auto& t : threads){
+        t->join();
+    }
+    SYLAR_ASSERT(queue.empty());
+    CheckHistory(histories, producers, per_producer);
+    SYLAR_LOG_INFO(g_logger) << "test_mpmc ok items=" << consumed;
+}
+
+void test_mpmc_full(){
+    sylar::MPMCQueue<std::string> queue(4);
+    for(int i = 0; i < 4; ++i){
+        SYLAR_ASSERT(queue.push(std::to_string(i)));
+    }
+    SYLAR_ASSERT(!queue.push("x"));
+    std::string v;
+    for(int i = 0; i < 4; ++i){
+        SYLAR_ASSERT(queue.pop(v) && v == std::to_string(i));
+    }
+    SYLAR_ASSERT(!queue.pop(v));
+}
+
+void test_mpsc(){
+    const size_t producers = 4;
+    const size_t per_producer = 200000;
+    sylar::MPSCQueue<uint64_t> queue;
+    std::vector<std::vector<uint64_t> > histories(1);
+    std::vector<sylar::Thread::ptr> threads;
+    for(size_t i = 0; i < producers; ++i){
+        threads.push_back(sylar::Thread::ptr(new sylar::Thread([i, &queue](){
+            for(size_t s = 0; s < per_producer; ++s){
+                queue.push(Encode(i, s));
+            }
+        }, "prod_" + std::to_string(i))));
+    }
+    uint64_t v = 0;
+    while(histories[0].size() < producers * per_producer){
+        if(queue.pop(v)){
+            histories[0].push_back(v);
+        }
+        else{
+            sched_yield();
+        }
+    }
+    for(auto& t : threads){
+        t->join();
+    }
+    SYLAR_ASSERT(queue.empty());
+    CheckHistory(histories, producers, per_producer);
+    SYLAR_LOG_INFO(g_logger) << "test_mpsc ok items=" << histories[0].size();
+}
+
+struct PoolItem{
+    static std::atomic<int> s_alive;
+    uint64_t magic;
+    uint64_t owner;
+
+    PoolItem(uint64_t o)
+        :magic(0x5EC0A1), owner(o){
+        ++s_alive;
+    }
+    ~PoolItem(){
+        SYLAR_ASSERT(magic == 0x5EC0A1);
+        magic = 0;
+        --s_alive;
+    }
+};
+std::atomic<int> PoolItem::s_alive {0};
+
+typedef sylar::ObjectPool<PoolItem> ItemPool;
+
+// 其它线程释放的块回到分配线程
+void test_pool_remote_free(){
+    const size_t n = 1000;
+    std::vector<PoolItem*> items;
+    std::set<PoolItem*> addrs;
+    for(size_t i = 0; i < n; ++i){
+        items.push_back(ItemPool::New(i));
+        addrs.insert(items.back());
+    }
+    sylar::Thread t([&items](){
+        for(auto i : items){
+            ItemPool::Delete(i);
+        }
+        SYLAR_ASSERT(ItemPool::LocalCached() == 0);
+    }, "free");
+    t.join();
+    SYLAR_ASSERT(PoolItem::s_alive == 0);
+
+    size_t before = ItemPool::LocalCached();
+    items.clear();
+    for(size_t i = 0; i < n; ++i){
+        items.push_back(ItemPool::New(i));
+        SYLAR_ASSERT(addrs.count(items.back()));
+    }
+    for(auto i : items){
+        ItemPool::Delete(i);
+    }
+    SYLAR_ASSERT(ItemPool::LocalCached() == before + n);
+    SYLAR_LOG_INFO(g_logger) << "test_pool_remote_free ok cached=" << ItemPool::LocalCached();
+}
+
+// 多个线程分配后交给随机的线程释放, 检查不会重复分配
+void test_pool_stress(){
+    const size_t threads_count = 4;
+    const size_t per_thread = 200000;
+    std::vector<sylar::MPMCQueue<PoolItem*>*> inboxes;
+    for(size_t i = 0; i < threads_count; ++i){
+        inboxes.push_back(new sylar::MPMCQueue<PoolItem*>(256));
+    }
+    std::atomic<size_t> freed {0};
+    std::vector<sylar::Thread::ptr> threads;
+    for(size_t i = 0; i < threads_count; ++i){
+        threads.push_back(sylar::Thread::ptr(new sylar::Thread([i, &inboxes, &freed](){
+            uint64_t seed = i + 1;
+            auto drain = [&](){
+                PoolItem* received = nullptr;
+                while(inboxes[i]->pop(received)){
+                    ItemPool::Delete(received);
+                    ++freed;
+                }
+            };
+            for(size_t s = 0; s < per_thread; ++s){
+                PoolItem* item = ItemPool::New(i);
+                SYLAR_ASSERT(item->magic == 0x5EC0A1 && item->owner == i);
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                size_t target = (seed >> 33) % threads_count;
+                while(!inboxes[target]->push(item)){
+                    drain();
+                    sched_yield();
+                }
+                drain();
+            }
+            while(freed < threads_count * per_thread){
+                drain();
+                sched_yield();
+            }
+        }, "pool_" + std::to_string(i))));
+    }
+    for(auto& t : threads){
+        t->join();
+    }
+    for(auto q : inboxes){
+        delete q;
+    }
+    SYLAR_ASSERT(PoolItem::s_alive == 0);
+    SYLAR_LOG_INFO(g_logger) << "test_pool_stress ok freed=" << freed;
+}
+
+int main(int argc, char** argv){
+    test_mpmc_full();
+    test_mpmc();
+    test_mpsc();
+    test_pool_remote_free();
+    test_pool_stress();
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include "../sylar/metrics.h"
+#include "../sylar/thread.h"
+#include "../sylar/macro.h"
+#include "../sylar/log.h"
+#include <yaml-cpp/yaml.h>
+#include <stdexcept>
+#include <cmath>
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+void test_counter(){
+    sylar::Counter counter("test.counter");
+    const int threads = 8;
+    const int loops = 100000;
+    std::vector<sylar::Thread::ptr> thrs;
+    for(int i = 0; i < threads; ++i){
+        thrs.push_back(sylar::Thread::ptr(new sylar::Thread([&counter](){
+            for(int j = 0; j < loops; ++j){
+                counter.inc();
+            }
+            counter.inc(10);
+        }, "counter_" + std::to_string(i))));
+    }
+    for(auto& t : thrs){
+        t->join();
+    }
+    SYLAR_ASSERT(counter.getValue() == (uint64_t)threads * (loops + 10));
+    counter.reset();
+    SYLAR_ASSERT(counter.getValue() == 0);
+}
+
+void test_gauge(){
+    sylar::Gauge gauge("test.gauge");
+    gauge.inc();
+    gauge.add(10);
+    gauge.sub(3);
+    gauge.dec();
+    SYLAR_ASSERT(gauge.getValue() == 7);
+    gauge.set(-5);
+    SYLAR_ASSERT(gauge.getValue() == -5);
+
+    // 其它线程的增减在set之后继续累计
+    sylar::Thread t([&gauge](){
+        gauge.add(100);
+    }, "gauge");
+    t.join();
+    SYLAR_ASSERT(gauge.getValue() == 95);
+    gauge.reset();
+    SYLAR_ASSERT(gauge.getValue() == 0);
+}
+
+void test_bucket(){
+    for(uint32_t p = 1; p <= 10; ++p){
+        // 桶编号连续, 每个桶的下界和宽度与编号一致
+        uint32_t last = 0;
+        for(uint64_t v = 0; v < (1ull << (p + 8)); ++v){
+            uint32_t idx = sylar::Histogram::BucketIndex(v, p);
+            SYLAR_ASSERT(idx == last || idx == last + 1);
+            last = idx;
+            uint64_t lower = sylar::Histogram::BucketLower(idx, p);
+            uint64_t width = sylar::Histogram::BucketWidth(idx, p);
+            SYLAR_ASSERT(lower <= v && v < lower + width);
+            // 相对误差上界
+            SYLAR_ASSERT(width == 1 || (double)width / lower <= 1.0 / (1 << p));
+        }
+        uint64_t big[] = {1ull << 40, (1ull << 40) + 12345, ~0ull};
+        for(auto v : big){
+            uint32_t idx = sylar::Histogram::BucketIndex(v, p);
+            uint64_t lower = sylar::Histogram::BucketLower(idx, p);
+            SYLAR_ASSERT(lower <= v && v - lower < sylar::Histogram::BucketWidth(idx, p));
+        }
+    }
+}
+
+void test_histogram(){
+    sylar::Histogram hist("test.hist", "", 5, 40);
+    {
+        sylar::Histogram::Snapshot snap = hist.snapshot();
+        SYLAR_ASSERT(snap.count == 0 && snap.min == 0 && snap.percentile(0.5) == 0);
+    }
+
+    // 1..100000 均匀分布, 分位数误差不超过 2^-6
+    const int threads = 4;
+    const uint64_t n = 100000;
+    std::vector<sylar::Thread::ptr> thrs;
+    for(int i = 0; i < threads; ++i){
+        thrs.push_back(sylar::Thread::ptr(new sylar::Thread([&hist, i, n](){
+            for(uint64_t v = i + 1; v <= n; v += threads){
+                hist.record(v);
+            }
+        }, "hist_" + std::to_string(i))));
+    }
+    for(auto& t : thrs){
+        t->join();
+    }
+    sylar::Histogram::Snapshot snap = hist.snapshot();
+    SYLAR_ASSERT(snap.count == n);
+    SYLAR_ASSERT(snap.sum == n * (n + 1) / 2);
+    SYLAR_ASSERT(snap.min == 1 && snap.max == n);
+    double qs[] = {0.01, 0.25, 0.5, 0.9, 0.99, 0.999};
+    for(auto q : qs){
+        double expect = q * n;
+        double got = snap.percentile(q);
+        SYLAR_ASSERT(std::abs(got - expect) / expect <= 1.0 / 64);
+    }
+    SYLAR_ASSERT(snap.percentile(0) == 1);
+    SYLAR_ASSERT(snap.percentile(1) == n);
+
+    // 超出范围的值计入最后一个桶, 最大值仍然精确
+    hist.record(1ull << 50);
+    snap = hist.snapshot();
+    SYLAR_ASSERT(snap.buckets.back() == 1);
+    SYLAR_ASSERT(snap.max == (1ull << 50));
+    SYLAR_ASSERT(snap.percentile(1) == (1ull << 50));
+
+    hist.reset();
+    snap = hist.snapshot();
+    SYLAR_ASSERT(snap.count == 0 && snap.max == 0 && hist.getCount() == 0);
+    hist.record(7);
+    snap = hist.snapshot();
+    SYLAR_ASSERT(snap.min == 7 && snap.max == 7 && snap.percentile(0.5) == 7);
+}
+
+void test_registry(){
+    sylar::Counter::ptr c = sylar::MetricsRegistry::GetCounter("app.http.requests", "请求数");
+    SYLAR_ASSERT(c && c == sylar::MetricsRegistry::GetCounter("app.http.requests"));
+    SYLAR_ASSERT(c->getDescription() == "请求数");
+    // 类型不同
+    SYLAR_ASSERT(!sylar::MetricsRegistry::GetGauge("app.http.requests"));
+    SYLAR_ASSERT(sylar::MetricsRegistry::Lookup("app.http.requests") == c);
+    SYLAR_ASSERT(!sylar::MetricsRegistry::Lookup("app.none"));
+
+    bool thrown = false;
+    try{
+        sylar::MetricsRegistry::GetCounter("App.Requests");
+    }catch(std::invalid_argument& e){
+        thrown = true;
+    }
+    SYLAR_ASSERT(thrown);
+
+    sylar::Gauge::ptr g = sylar::MetricsRegistry::GetGauge("app.http.connections");
+    sylar::Histogram::ptr h = sylar::MetricsRegistry::GetHistogram("app.http.latency_us");
+    // a.b 和 a.b.c 同时存在
+    sylar::Counter::ptr flat = sylar::MetricsRegistry::GetCounter("app.http.connections.total");
+    c->inc(3);
+    g->set(2);
+    flat->inc();
+    for(uint64_t i = 1; i <= 100; ++i){
+        h->record(i);
+    }
+
+    YAML::Node node = YAML::Load(sylar::MetricsRegistry::ToYamlString());
+    SYLAR_LOG_INFO(g_logger) << "\n" << node;
+    SYLAR_ASSERT(node["app"]["http"]["requests"].as<uint64_t>() == 3);
+    SYLAR_ASSERT(node["app"]["http"]["connections"].as<int64_t>() == 2);
+    SYLAR_ASSERT(node["app.http.connections.total"].as<uint64_t>() == 1);
+    YAML::Node lat = node["app"]["http"]["latency_us"];
+    SYLAR_ASSERT(lat["count"].as<uint64_t>() == 100);
+    SYLAR_ASSERT(lat["max"].as<uint64_t>() == 100);
+    SYLAR_ASSERT(lat["p50"].as<uint64_t>() == 50);
+
+    std::string text = sylar::MetricsRegistry::ToText();
+    SYLAR_LOG_INFO(g_logger) << "\n" << text;
+    SYLAR_ASSERT(text.find("app.http.requests 3\n") != std::string::npos);
+    SYLAR_ASSERT(text.find("app.http.latency_us.count 100\n") != std::string::npos);
+
+    sylar::MetricsRegistry::ResetAll();
+    SYLAR_ASSERT(c->getValue() == 0 && g->getValue() == 0 && h->getCount() == 0);
+    SYLAR_ASSERT(sylar::MetricsRegistry::List().size() == 4);
+}
+
+int main(int argc, char** argv){
+    SYLAR_LOG_INFO(g_logger) << "shard count " << sylar::Metric::GetShardCount();
+    test_counter();
+    SYLAR_LOG_INFO(g_logger) << "test_counter ok";
+    test_gauge();
+    SYLAR_LOG_INFO(g_logger) << "test_gauge ok";
+    test_bucket();
+    SYLAR_LOG_INFO(g_logger) << "test_bucket ok";
+    test_histogram();
+    SYLAR_LOG_INFO(g_logger) << "test_histogram ok";
+    test_registry();
+    SYLAR_LOG_INFO(g_logger) << "test_registry ok";
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include "../sylar/profiler.h"
+#include "../sylar/backtrace.h"
+#include "../sylar/config.h"
+#include "../sylar/fiber.h"
+#include "../sylar/macro.h"
+#include "../sylar/util.h"
+#include "../sylar/log.h"
+#include <time.h>
+#include <stdlib.h>
+#include <vector>
+#include <stdexcept>
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+// 收集 profiler 日志器的输出
+class CollectLogAppender : public sylar::LogAppender{
+public:
+    typedef std::shared_ptr<CollectLogAppender> ptr;
+    void log(std::shared_ptr<sylar::Logger> logger, sylar::LogLevel::Level level, sylar::LogEvent::ptr event) override{
+        MutexType::Lock lock(m_mutex);
+        m_lines.push_back(event->getContent());
+    }
+    std::string toYamlString() override { return "";}
+
+    std::vector<std::string> take(){
+        MutexType::Lock lock(m_mutex);
+        std::vector<std::string> rt;
+        rt.swap(m_lines);
+        return rt;
+    }
+private:
+    std::vector<std::string> m_lines;
+};
+
+static uint64_t GetCpuMS(){
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000ul + ts.tv_nsec / 1000000;
+}
+
+namespace test_prof{
+volatile uint64_t g_sink = 0;
+
+// 消耗ms毫秒的CPU时间
+__attribute__((noinline)) void Spin(uint64_t ms){
+    uint64_t end = GetCpuMS() + ms;
+    uint64_t x = 1;
+    while(GetCpuMS() < end){
+        for(int i = 0; i < 10000; ++i){
+            x = x * 6364136223846793005ull + 1442695040888963407ull;
+        }
+        g_sink = x;
+    }
+}
+
+// 反复抛出/捕获异常和获取调用栈ms毫秒
+__attribute__((noinline)) void Unwind(uint64_t ms){
+    uint64_t end = GetCpuMS() + ms;
+    while(GetCpuMS() < end){
+        try{
+            throw std::runtime_error("unwind");
+        } catch(std::exception& e){
+            g_sink = g_sink + e.what()[0];
+        }
+        g_sink = g_sink + sylar::Backtrace::Capture()->size();
+    }
+}
+}
+
+// 检查folded格式, 返回各行次数之和
+static uint64_t CheckFolded(const std::vector<std::string>& lines, const std::string& leaf, bool& found){
+    uint64_t total = 0;
+    for(auto& line : lines){
+        size_t pos = line.rfind(' ');
+        SYLAR_ASSERT2(pos != std::string::npos && pos + 1 < line.size(), line);
+        char* end = nullptr;
+        uint64_t count = strtoull(line.c_str() + pos + 1, &end, 10);
+        SYLAR_ASSERT2(count > 0 && *end == 0, line);
+        total += count;
+        std::string stack = line.substr(0, pos);
+        size_t leaf_pos = stack.find(leaf);
+        if(leaf_pos != std::string::npos){
+            found = true;
+            SYLAR_LOG_INFO(g_logger) << line;
+        }
+    }
+    return total;
+}
+
+void test_sample(CollectLogAppender::ptr appender){
+    sylar::Config::Lookup<uint32_t>("profiler.hz")->setValue(1000);
+    sylar::Profiler::SetEnabled(true);
+    SYLAR_ASSERT(sylar::Profiler::IsEnabled());
+
+    uint64_t before = sylar::Profiler::GetSampleCount();
+    test_prof::Spin(500);
+    size_t n = sylar::Profiler::Flush();
+    std::vector<std::string> lines = appender->take();
+    SYLAR_LOG_INFO(g_logger) << "samples=" << sylar::Profiler::GetSampleCount() - before
+        << " flushed=" << n << " lines=" << lines.size()
+        << " dropped=" << sylar::Profiler::GetDroppedCount();
+    SYLAR_ASSERT(n > 10);
+    bool found = false;
+    SYLAR_ASSERT(CheckFolded(lines, "test_prof::Spin(unsigned long)", found) == n);
+    SYLAR_ASSERT(found);
+    // 根在前, 叶在后
+    bool ordered = false;
+    for(auto& line : lines){
+        size_t spin = line.find("test_prof::Spin(unsigned long)");
+        size_t main = line.find("main;");
+        if(spin != std::string::npos && main != std::string::npos && main < spin){
+            ordered = true;
+        }
+    }
+    SYLAR_ASSERT(ordered);
+
+    // 协程栈上的采样
+    sylar::Fiber::GetThis();
+    sylar::Fiber::ptr fiber(new sylar::Fiber([](){
+        test_prof::Spin(200);
+    }));
+    fiber->swapIn();
+    found = false;
+    n = sylar::Profiler::Flush();
+    SYLAR_ASSERT(CheckFolded(appender->take(), "test_prof::Spin(unsigned long)", found) == n);
+    SYLAR_ASSERT(found);
+
+    sylar::Profiler::SetEnabled(false);
+    SYLAR_ASSERT(!sylar::Profiler::IsEnabled());
+    appender->take();
+    uint64_t stopped = sylar::Profiler::GetSampleCount();
+    test_prof::Spin(100);
+    SYLAR_ASSERT(sylar::Profiler::GetSampleCount() == stopped);
+    SYLAR_ASSERT(sylar::Profiler::Flush() == 0);
+}
+
+// 展开中的线程不采样, 不能卡死
+void test_unwind(CollectLogAppender::ptr appender){
+    sylar::Config::Lookup<uint32_t>("profiler.hz")->setValue(1000);
+    sylar::Profiler::SetEnabled(true);
+    uint64_t dropped = sylar::Profiler::GetDroppedCount();
+    uint64_t before = sylar::Profiler::GetSampleCount();
+    test_prof::Unwind(500);
+    sylar::Profiler::Flush();
+    appender->take();
+    SYLAR_LOG_INFO(g_logger) << "samples=" << sylar::Profiler::GetSampleCount() - before
+        << " dropped=" << sylar::Profiler::GetDroppedCount() - dropped;
+    SYLAR_ASSERT(sylar::Profiler::GetDroppedCount() > dropped);
+    sylar::Profiler::SetEnabled(false);
+}
+
+int main(int argc, char** argv){
+    CollectLogAppender::ptr appender(new CollectLogAppender);
+    sylar::Logger::ptr logger = SYLAR_LOG_NAME("profiler");
+    logger->addAppender(appender);
+    // 只由测试输出
+    sylar::Config::Lookup<uint32_t>("profiler.flush_interval")->setValue(3600 * 1000);
+
+    test_sample(appender);
+    SYLAR_LOG_INFO(g_logger) << "test_sample ok";
+    test_unwind(appender);
+    SYLAR_LOG_INFO(g_logger) << "test_unwind ok";
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include "../sylar/scheduler.h"
+#include "../sylar/macro.h"
+#include "../sylar/log.h"
+#include <atomic>
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+void test_fiber(){
+    static int s_count = 5;
+    SYLAR_LOG_INFO(g_logger) << "test in fiber s_count=" << s_count;
+
+    usleep(1000);
+    if(--s_count >= 0){
+        sylar::Scheduler::GetThis()->schedule(&test_fiber, sylar::GetThreadID());
+    }
+}
+
+// 外部提交和线程内提交(工作窃取)的任务都要执行且只执行一次
+void test_count(bool use_caller){
+    static std::atomic<int> s_sum {0};
+    s_sum = 0;
+    sylar::Scheduler sc(3, use_caller, "count");
+    sc.start();
+    for(int i = 0; i < 1000; ++i){
+        sc.schedule([](){
+            ++s_sum;
+            // 每个任务再在工作线程内派生10个子任务
+            for(int j = 0; j < 10; ++j){
+                sylar::Scheduler::GetThis()->schedule([](){
+                    ++s_sum;
+                });
+            }
+        });
+    }
+    sc.stop();
+    SYLAR_LOG_INFO(g_logger) << "test_count use_caller=" << use_caller << " sum=" << s_sum;
+    SYLAR_ASSERT(s_sum == 11000);
+}
+
+// 取工作线程id
+class PinScheduler : public sylar::Scheduler{
+public:
+    using Scheduler::Scheduler;
+    const std::vector<int>& getThreadIds() const { return m_threadIds;}
+};
+
+// 指定线程的任务必须在目标线程执行, switchTo后协程运行在目标线程
+void test_pin(){
+    static std::atomic<int> s_wrong {0};
+    static std::atomic<int> s_done {0};
+    PinScheduler sc(4, false, "pin");
+    sc.start();
+    std::stringstream ss;
+    sc.dump(ss);
+    SYLAR_LOG_INFO(g_logger) << ss.str();
+
+    std::vector<int> ids = sc.getThreadIds();
+    for(auto id : ids){
+        for(int i = 0; i < 100; ++i){
+            sc.schedule([id](){
+                if(sylar::GetThreadID() != id){
+                    ++s_wrong;
+                }
+                ++s_done;
+            }, id);
+        }
+    }
+
+    PinScheduler* psc = &sc;
+    sc.schedule([psc, ids](){
+        for(auto id : ids){
+            psc->switchTo(id);
+            if(sylar::GetThreadID() != id){
+                ++s_wrong;
+            }
+        }
+        ++s_done;
+    });
+    sc.stop();
+    SYLAR_LOG_INFO(g_logger) << "test_pin threads=" << ids.size() << " done=" << s_done
+        << " wrong=" << s_wrong;
+    SYLAR_ASSERT(s_wrong == 0);
+    SYLAR_ASSERT(s_done == (int)ids.size() * 100 + 1);
+}
+
+// YieldToReady的协程会被重新调度
+void test_yield(){
+    static std::atomic<int> s_yields {0};
+    sylar::Scheduler sc(2, false, "yield");
+    sc.start();
+    for(int i = 0; i < 10; ++i){
+        sc.schedule([](){
+            for(int j = 0; j < 100; ++j){
+                ++s_yields;
+                sylar::Fiber::YieldToReady();
+            }
+        });
+    }
+    sc.stop();
+    SYLAR_LOG_INFO(g_logger) << "test_yield yields=" << s_yields;
+    SYLAR_ASSERT(s_yields == 1000);
+}
+
+int main(int argc, char** argv){
+    SYLAR_LOG_INFO(g_logger) << "main";
+    sylar::Scheduler sc(3, false, "test");
+    sc.start();
+    sleep(1);
+    SYLAR_LOG_INFO(g_logger) << "schedule";
+    sc.schedule(&test_fiber);
+    sc.stop();
+    SYLAR_LOG_INFO(g_logger) << "over";
+
+    test_count(false);
+    test_count(true);
+    test_pin();
+    test_yield();
+    return 0;
+}
@@ -0,0 +1,348 @@
+#include "../sylar/socket.h"
+#include "../sylar/address.h"
+#include "../sylar/bytearray.h"
+#include "../sylar/iomanager.h"
+#include "../sylar/macro.h"
+#include "../sylar/log.h"
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+// 地址格式化和解析, IPv6的格式与inet_ntop一致
+void test_address(){
+    SYLAR_ASSERT(sylar::IPv4Address::Create("127.0.0.1", 80)->toString() == "127.0.0.1:80");
+    SYLAR_ASSERT(sylar::IPv4Address(INADDR_LOOPBACK, 8080).toString() == "127.0.0.1:8080");
+    SYLAR_ASSERT(sylar::IPv4Address().toString() == "0.0.0.0:0");
+    SYLAR_ASSERT(sylar::IPv4Address::Create("255.255.255.255", 65535)->toString()
+                 == "255.255.255.255:65535");
+    SYLAR_ASSERT(!sylar::IPv4Address::Create("256.1.1.1"));
+
+    SYLAR_ASSERT(sylar::IPv6Address::Create("::1", 80)->toString() == "[::1]:80");
+    SYLAR_ASSERT(sylar::IPv6Address::Create("::")->toString() == "[::]:0");
+    SYLAR_ASSERT(sylar::IPv6Address::Create("1::")->toString() == "[1::]:0");
+    SYLAR_ASSERT(sylar::IPv6Address::Create("1:0:0:2:0:0:0:3")->toString() == "[1:0:0:2::3]:0");
+    SYLAR_ASSERT(sylar::IPv6Address::Create("1:0:2:3:4:5:6:7")->toString() == "[1:0:2:3:4:5:6:7]:0");
+
+    // 随机地址和inet_ntop对比, 跳过inet_ntop输出内嵌IPv4形式的地址
+    for(int i = 0; i < 10000; ++i){
+        uint8_t a[16];
+        for(int j = 0; j < 16; j += 2){
+            uint16_t v = rand() % 2 ? 0 : rand() % 0x10000;
+            a[j] = v >> 8;
+            a[j + 1] = v & 0xFF;
+        }
+        if(memcmp(a, "\0\0\0\0\0\0\0\0\0\0", 10) == 0){
+            continue;
+        }
+        uint16_t port = rand() % 65536;
+        char buf[INET6_ADDRSTRLEN];
+        inet_ntop(AF_INET6, a, buf, sizeof(buf));
+        std::string expect = std::string("[") + buf + "]:" + std::to_string(port);
+        std::string str = sylar::IPv6Address(a, port).toString();
+        if(str != expect){
+            SYLAR_LOG_ERROR(g_logger) << str << " != " << expect;
+        }
+        SYLAR_ASSERT(str == expect);
+    }
+
+    sylar::UnixAddress ua("/tmp/sylar.sock");
+    SYLAR_ASSERT(ua.toString() == "/tmp/sylar.sock");
+    SYLAR_ASSERT(ua.getPath() == "/tmp/sylar.sock");
+    sylar::UnixAddress abstract(std::string("\0sylar", 6));
+    SYLAR_ASSERT(abstract.toString() == "\\0sylar");
+
+    std::vector<sylar::Address::ptr> addrs;
+    SYLAR_ASSERT(sylar::Address::Lookup(addrs, "127.0.0.1:8080", AF_INET, SOCK_STREAM));
+    SYLAR_ASSERT(addrs.size() == 1 && addrs[0]->toString() == "127.0.0.1:8080");
+    addrs.clear();
+    SYLAR_ASSERT(sylar::Address::Lookup(addrs, "[::1]:81", AF_INET6, SOCK_STREAM));
+    SYLAR_ASSERT(addrs[0]->toString() == "[::1]:81");
+    sylar::IPAddress::ptr ip = sylar::Address::LookupAnyIPAddress("10.0.0.1", AF_INET);
+    SYLAR_ASSERT(ip && ip->getPort() == 0);
+    ip->setPort(9);
+    SYLAR_ASSERT(ip->toString() == "10.0.0.1:9");
+    SYLAR_ASSERT(sylar::IPAddress::Create("::ffff:1.2.3.4", 1)->getFamily() == AF_INET6);
+
+    SYLAR_ASSERT(*sylar::IPv4Address::Create("1.2.3.4", 5) == *sylar::IPv4Address::Create("1.2.3.4", 5));
+    SYLAR_ASSERT(*sylar::IPv4Address::Create("1.2.3.4", 5) != *sylar::IPv4Address::Create("1.2.3.4", 6));
+    std::stringstream ss;
+    ss << *sylar::IPv4Address::Create("1.2.3.4", 5);
+    SYLAR_ASSERT(ss.str() == "1.2.3.4:5");
+    SYLAR_LOG_INFO(g_logger) << "test_address ok";
+}
+
+static bool SendAll(sylar::Socket::ptr sock, const void* buf, size_t len){
+    const char* p = (const char*)buf;
+    while(len > 0){
+        int rt = sock->send(p, len);
+        if(rt <= 0){
+            return false;
+        }
+        p += rt;
+        len -= rt;
+    }
+    return true;
+}
+
+static bool RecvAll(sylar::Socket::ptr sock, void* buf, size_t len){
+    char* p = (char*)buf;
+    while(len > 0){
+        int rt = sock->recv(p, len);
+        if(rt <= 0){
+            return false;
+        }
+        p += rt;
+        len -= rt;
+    }
+    return true;
+}
+
+// 按固定模式生成的数据, 接收端按偏移校验
+static char Pattern(size_t i){
+    return (char)(i * 131 + (i >> 9));
+}
+
+static const size_t s_file_size = 3 * 1024 * 1024 + 123;
+static const size_t s_file_offset = 4000;
+static const size_t s_zc_size = 1024 * 1024;
+static const int s_varints = 20000;
+
+static void Server(sylar::Socket::ptr listen_sock){
+    sylar::Socket::ptr sock = listen_sock->accept();
+    SYLAR_ASSERT(sock);
+    SYLAR_LOG_INFO(g_logger) << "accepted " << *sock;
+
+    // 回显
+    char buf[5];
+    SYLAR_ASSERT(RecvAll(sock, buf, 5) && memcmp(buf, "hello", 5) == 0);
+    SYLAR_ASSERT(SendAll(sock, buf, 5));
+
+    // ByteArray分散读: 先读长度, 再直接收进小块ByteArray
+    uint64_t len = 0;
+    SYLAR_ASSERT(RecvAll(sock, &len, sizeof(len)));
+    sylar::ByteArray::ptr ba(new sylar::ByteArray(64));
+    while(ba->getSize() < len){
+        int rt = sock->recv(ba, len - ba->getSize());
+        SYLAR_ASSERT(rt > 0);
+    }
+    ba->setPosition(0);
+    for(int i = 0; i < s_varints; ++i){
+        SYLAR_ASSERT(ba->readInt64() == (int64_t)i * 7919 - 1000000);
+    }
+    SYLAR_ASSERT(ba->getReadSize() == 0);
+
+    // sendFile和spliceFile各发一次文件的后半部分, 以及一次零拷贝发送
+    std::string data;
+    size_t sizes[] = {s_file_size - s_file_offset, s_file_size - s_file_offset, s_zc_size};
+    size_t offsets[] = {s_file_offset, s_file_offset, 0};
+    for(int k = 0; k < 3; ++k){
+        data.resize(sizes[k]);
+        SYLAR_ASSERT(RecvAll(sock, &data[0], data.size()));
+        for(size_t i = 0; i < data.size(); ++i){
+            SYLAR_ASSERT(data[i] == Pattern(i + offsets[k]));
+        }
+    }
+    SYLAR_ASSERT(SendAll(sock, "done", 4));
+}
+
+static void Client(sylar::Address::ptr addr){
+    sylar::Socket::ptr sock = sylar::Socket::CreateTCP(addr);
+    SYLAR_ASSERT(sock->connect(addr));
+    SYLAR_LOG_INFO(g_logger) << "connected " << *sock;
+    int nodelay = 0;
+    SYLAR_ASSERT(sock->getOption(IPPROTO_TCP, TCP_NODELAY, nodelay) && nodelay);
+
+    char buf[5];
+    SYLAR_ASSERT(SendAll(sock, "hello", 5));
+    SYLAR_ASSERT(RecvAll(sock, buf, 5) && memcmp(buf, "hello", 5) == 0);
+
+    // ByteArray聚集写
+    sylar::ByteArray::ptr ba(new sylar::ByteArray(64));
+    for(int i = 0; i < s_varints; ++i){
+        ba->writeInt64((int64_t)i * 7919 - 1000000);
+    }
+    ba->setPosition(0);
+    uint64_t len = ba->getSize();
+    SYLAR_ASSERT(SendAll(sock, &len, sizeof(len)));
+    while(ba->getReadSize() > 0){
+        SYLAR_ASSERT(sock->send(ba) > 0);
+    }
+
+    // 文件
+    char path[] = "/tmp/test_socket_XXXXXX";
+    int fd = mkstemp(path);
+    SYLAR_ASSERT(fd >= 0);
+    unlink(path);
+    std::string content(s_file_size, 0);
+    for(size_t i = 0; i < content.size(); ++i){
+        content[i] = Pattern(i);
+    }
+    SYLAR_ASSERT(write(fd, content.c_str(), content.size()) == (ssize_t)content.size());
+    // count超过文件长度时发到文件末尾为止
+    SYLAR_ASSERT(sock->sendFile(fd, s_file_offset, s_file_size) == (int64_t)(s_file_size - s_file_offset));
+    SYLAR_ASSERT(sock->spliceFile(fd, s_file_offset, s_file_size - s_file_offset)
+                 == (int64_t)(s_file_size - s_file_offset));
+    close(fd);
+
+    // 零拷贝, 内核不支持时退化为普通发送
+    bool zc = sock->setZeroCopy(true);
+    SYLAR_LOG_INFO(g_logger) << "zerocopy supported=" << zc;
+    std::string zdata = content.substr(0, s_zc_size);
+    size_t sent = 0;
+    while(sent < zdata.size()){
+        int rt = sock->sendZeroCopy(&zdata[sent], zdata.size() - sent);
+        SYLAR_ASSERT(rt > 0);
+        sent += rt;
+    }
+    SYLAR_ASSERT(sock->waitZeroCopy() == 0);
+    SYLAR_ASSERT(sock->getZeroCopyPending() == 0);
+    SYLAR_LOG_INFO(g_logger) << "zerocopy copied=" << sock->getZeroCopyCopied();
+
+    SYLAR_ASSERT(RecvAll(sock, buf, 4) && memcmp(buf, "done", 4) == 0);
+}
+
+// 回环上的TCP收发, 服务端和客户端是同一个IOManager里的两个协程
+void test_tcp(){
+    sylar::IOManager iom(2, false, "tcp");
+    iom.schedule([](){
+        sylar::Address::ptr addr = sylar::IPv4Address::Create("127.0.0.1", 0);
+        sylar::Socket::ptr listen_sock = sylar::Socket::CreateTCP(addr);
+        SYLAR_ASSERT(listen_sock->bind(addr));
+        SYLAR_ASSERT(listen_sock->listen());
+        sylar::Address::ptr local = listen_sock->getLocalAddress();
+        SYLAR_LOG_INFO(g_logger) << "listen on " << *local;
+        sylar::IOManager::GetThis()->schedule([local](){
+            Client(local);
+        });
+        Server(listen_sock);
+    });
+}
+
+// 没有服务端时连接失败, 接收超时
+void test_tcp_error(){
+    sylar::IOManager iom(1, false, "tcp_error");
+    iom.schedule([](){
+        sylar::Address::ptr addr = sylar::IPv4Address::Create("127.0.0.1", 0);
+        sylar::Socket::ptr listen_sock = sylar::Socket::CreateTCP(addr);
+        SYLAR_ASSERT(listen_sock->bind(addr) && listen_sock->listen());
+        sylar::Socket::ptr sock = sylar::Socket::CreateTCP(addr);
+        SYLAR_ASSERT(sock->connect(listen_sock->getLocalAddress(), 1000));
+        sock->setRecvTimeout(100);
+        SYLAR_ASSERT(sock->getRecvTimeout() == 100);
+        char c;
+        SYLAR_ASSERT(sock->recv(&c, 1) == -1 && errno == ETIMEDOUT);
+
+        sylar::Address::ptr closed = listen_sock->getLocalAddress();
+        listen_sock->close();
+        sylar::Socket::ptr refused = sylar::Socket::CreateTCP(closed);
+        SYLAR_ASSERT(!refused->connect(closed));
+        SYLAR_ASSERT(!refused->isValid() && !refused->isConnected());
+    });
+}
+
+// 等待零拷贝完成时, 另一个协程正阻塞在同一socket的recv上
+void test_zerocopy_reader(){
+    sylar::IOManager iom(2, false, "zc_reader");
+    iom.schedule([](){
+        sylar::Address::ptr addr = sylar::IPv4Address::Create("127.0.0.1", 0);
+        sylar::Socket::ptr listen_sock = sylar::Socket::CreateTCP(addr);
+        SYLAR_ASSERT(listen_sock->bind(addr) && listen_sock->listen());
+        sylar::Socket::ptr client = sylar::Socket::CreateTCP(addr);
+        SYLAR_ASSERT(client->connect(listen_sock->getLocalAddress(), 1000));
+        sylar::Socket::ptr server = listen_sock->accept();
+        SYLAR_ASSERT(server);
+        if(!client->setZeroCopy(true)){
+            SYLAR_LOG_INFO(g_logger) << "zerocopy not supported, skip";
+            return;
+        }
+
+        sylar::IOManager* iom = sylar::IOManager::GetThis();
+        std::atomic<bool> done {false};
+        iom->schedule([client, &done](){
+            char buf[4];
+            SYLAR_ASSERT(RecvAll(client, buf, 4) && memcmp(buf, "done", 4) == 0);
+            done = true;
+        });
+        // 服务端晚一些才读, 发送完成时错误队列还是空的
+        iom->schedule([server](){
+            usleep(50 * 1000);
+            std::vector<char> buf(s_zc_size);
+            SYLAR_ASSERT(RecvAll(server, &buf[0], buf.size()));
+            SYLAR_ASSERT(SendAll(server, "done", 4));
+        });
+        usleep(10 * 1000);
+
+        std::string data(s_zc_size, 'z');
+        size_t sent = 0;
+        while(sent < data.size()){
+            int rt = client->sendZeroCopy(&data[sent], data.size() - sent);
+            SYLAR_ASSERT(rt > 0);
+            sent += rt;
+        }
+        SYLAR_ASSERT(client->waitZeroCopy() == 0);
+        SYLAR_ASSERT(client->getZeroCopyPending() == 0);
+        while(!done){
+            usleep(1000);
+        }
+    });
+}
+
+void test_udp(){
+    sylar::IOManager iom(1, false, "udp");
+    iom.schedule([](){
+        sylar::Address::ptr addr = sylar::IPv4Address::Create("127.0.0.1", 0);
+        sylar::Socket::ptr server = sylar::Socket::CreateUDP(addr);
+        SYLAR_ASSERT(server->bind(addr));
+        sylar::Address::ptr server_addr = server->getLocalAddress();
+
+        sylar::Socket::ptr client = sylar::Socket::CreateUDP(addr);
+        SYLAR_ASSERT(client->sendTo("datagram", 8, server_addr) == 8);
+
+        char buf[16];
+        sylar::Address::ptr from(new sylar::IPv4Address);
+        SYLAR_ASSERT(server->recvFrom(buf, sizeof(buf), from) == 8);
+        SYLAR_ASSERT(memcmp(buf, "datagram", 8) == 0);
+        SYLAR_ASSERT(std::dynamic_pointer_cast<sylar::IPv4Address>(from)->getPort() != 0);
+    });
+}
+
+void test_unix(){
+    sylar::IOManager iom(1, false, "unix");
+    iom.schedule([](){
+        std::string path = "/tmp/test_socket_" + std::to_string(getpid()) + ".sock";
+        unlink(path.c_str());
+        sylar::Address::ptr addr(new sylar::UnixAddress(path));
+        sylar::Socket::ptr listen_sock = sylar::Socket::CreateUnixTCPSocket();
+        SYLAR_ASSERT(listen_sock->bind(addr) && listen_sock->listen());
+        SYLAR_ASSERT(listen_sock->getLocalAddress()->toString() == path);
+        sylar::IOManager::GetThis()->schedule([addr](){
+            sylar::Socket::ptr sock = sylar::Socket::CreateUnixTCPSocket();
+            SYLAR_ASSERT(sock->connect(addr));
+            SYLAR_ASSERT(SendAll(sock, "unix", 4));
+        });
+        sylar::Socket::ptr sock = listen_sock->accept();
+        char buf[4];
+        SYLAR_ASSERT(sock && RecvAll(sock, buf, 4) && memcmp(buf, "unix", 4) == 0);
+        unlink(path.c_str());
+    });
+}
+
+int main(int argc, char** argv){
+    test_address();
+    test_tcp();
+    SYLAR_LOG_INFO(g_logger) << "test_tcp ok";
+    test_tcp_error();
+    SYLAR_LOG_INFO(g_logger) << "test_tcp_error ok";
+    test_zerocopy_reader();
+    SYLAR_LOG_INFO(g_logger) << "test_zerocopy_reader ok";
+    test_udp();
+    SYLAR_LOG_INFO(g_logger) << "test_udp ok";
+    test_unix();
+    SYLAR_LOG_INFO(g_logger) << "test_unix ok";
+    return 0;
+}
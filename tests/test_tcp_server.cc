@@ -0,0 +1,226 @@
+#include "../sylar/tcp_server.h"
+#include "../sylar/config.h"
+#include "../sylar/iomanager.h"
+#include "../sylar/macro.h"
+#include "../sylar/log.h"
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+// 原样回显直到对端关闭
+class EchoServer : public sylar::TcpServer{
+public:
+    typedef std::shared_ptr<EchoServer> ptr;
+    using TcpServer::TcpServer;
+protected:
+    void handleClient(sylar::Socket::ptr client) override{
+        char buf[1024];
+        while(true){
+            int rt = client->recv(buf, sizeof(buf));
+            if(rt <= 0){
+                break;
+            }
+            if(client->send(buf, rt) != rt){
+                break;
+            }
+        }
+        client->close();
+    }
+};
+
+static bool Echo(sylar::Address::ptr addr, const std::string& msg){
+    sylar::Socket::ptr sock = sylar::Socket::CreateTCP(addr);
+    if(!sock->connect(addr, 1000)){
+        return false;
+    }
+    if(sock->send(msg.c_str(), msg.size()) != (int)msg.size()){
+        return false;
+    }
+    std::string buf(msg.size(), '\0');
+    size_t off = 0;
+    while(off < buf.size()){
+        int rt = sock->recv(&buf[off], buf.size() - off);
+        if(rt <= 0){
+            return false;
+        }
+        off += rt;
+    }
+    return buf == msg;
+}
+
+// 每个工作线程一个SO_REUSEPORT监听socket, 绑定同一个端口, 连接分散到各个socket上都能处理
+void test_echo(){
+    sylar::IOManager iom(2, false, "echo");
+    iom.schedule([](){
+        EchoServer::ptr server(new EchoServer);
+        SYLAR_ASSERT(server->bind(sylar::IPv4Address::Create("127.0.0.1", 0)));
+        std::vector<sylar::Socket::ptr> socks = server->getSocks();
+        SYLAR_ASSERT(socks.size() == 2);
+        sylar::Address::ptr addr = socks[0]->getLocalAddress();
+        SYLAR_ASSERT(socks[1]->getLocalAddress()->toString() == addr->toString());
+        SYLAR_LOG_INFO(g_logger) << server->toString();
+        SYLAR_ASSERT(server->start());
+
+        for(int i = 0; i < 100; ++i){
+            SYLAR_ASSERT(Echo(addr, "hello " + std::to_string(i)));
+        }
+        server->stop();
+        SYLAR_ASSERT(server->isStop());
+        SYLAR_ASSERT(server->getConnectionCount() == 0);
+        SYLAR_ASSERT(server->getSocks().empty());
+
+        sylar::Socket::ptr sock = sylar::Socket::CreateTCP(addr);
+        SYLAR_ASSERT(!sock->connect(addr, 1000));
+    });
+}
+
+// 从配置项读取监听地址和监听socket数
+void test_config(){
+    sylar::Config::Lookup<std::vector<std::string> >("tcp_server.addresses")
+        ->setValue({"127.0.0.1:0"});
+    sylar::Config::Lookup<uint32_t>("tcp_server.workers")->setValue(3);
+
+    {
+        sylar::IOManager iom(1, false, "config");
+        iom.schedule([](){
+            EchoServer::ptr server(new EchoServer);
+            std::vector<sylar::Address::ptr> fails;
+            SYLAR_ASSERT(server->bindConfig(fails) && fails.empty());
+            SYLAR_ASSERT(server->getSocks().size() == 3);
+            SYLAR_ASSERT(server->start());
+            SYLAR_ASSERT(Echo(server->getSocks()[0]->getLocalAddress(), "config"));
+            server->stop();
+        });
+    }
+    sylar::Config::Lookup<uint32_t>("tcp_server.workers")->setValue(0);
+}
+
+// stop等待已有连接结束, 超过drain_timeout后shutdown剩余连接
+void test_drain(){
+    sylar::Config::Lookup<uint64_t>("tcp_server.drain_timeout")->setValue(200);
+
+    sylar::IOManager iom(2, false, "drain");
+    iom.schedule([](){
+        EchoServer::ptr server(new EchoServer);
+        SYLAR_ASSERT(server->bind(sylar::IPv4Address::Create("127.0.0.1", 0)));
+        sylar::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+        SYLAR_ASSERT(server->start());
+
+        // 一个连接很快结束, 一个连接一直不关闭
+        sylar::Socket::ptr idle = sylar::Socket::CreateTCP(addr);
+        SYLAR_ASSERT(idle->connect(addr, 1000));
+        SYLAR_ASSERT(idle->send("x", 1) == 1);
+        char c;
+        SYLAR_ASSERT(idle->recv(&c, 1) == 1);
+        SYLAR_ASSERT(Echo(addr, "short"));
+        // 客户端关闭后服务端的处理协程稍后才返回
+        for(int i = 0; i < 100 && server->getConnectionCount() != 1; ++i){
+            usleep(1000);
+        }
+        SYLAR_ASSERT(server->getConnectionCount() == 1);
+
+        uint64_t start = sylar::GetCurrentMS();
+        server->stop();
+        uint64_t used = sylar::GetCurrentMS() - start;
+        SYLAR_LOG_INFO(g_logger) << "stop used " << used << "ms";
+        SYLAR_ASSERT(used >= 200);
+        SYLAR_ASSERT(server->getConnectionCount() == 0);
+        SYLAR_ASSERT(idle->recv(&c, 1) == 0);
+    });
+}
+
+// 端口被占用(未设置SO_REUSEPORT)时绑定失败, 之前绑定成功的socket不受影响
+void test_bind_fail(){
+    sylar::IOManager iom(1, false, "bind_fail");
+    iom.schedule([](){
+        sylar::Address::ptr any = sylar::IPv4Address::Create("127.0.0.1", 0);
+        sylar::Socket::ptr sock = sylar::Socket::CreateTCP(any);
+        SYLAR_ASSERT(sock->bind(any) && sock->listen());
+
+        EchoServer::ptr server(new EchoServer);
+        SYLAR_ASSERT(server->bind(any));
+        SYLAR_ASSERT(server->getSocks().size() == 1);
+        sylar::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+
+        std::vector<sylar::Address::ptr> addrs{sock->getLocalAddress()};
+        std::vector<sylar::Address::ptr> fails;
+        SYLAR_ASSERT(!server->bind(addrs, fails));
+        SYLAR_ASSERT(fails.size() == 1 && server->getSocks().size() == 1);
+
+        SYLAR_ASSERT(server->start());
+        SYLAR_ASSERT(Echo(addr, "still listening"));
+        server->stop();
+    });
+}
+
+static uint64_t GetCpuMS(){
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000
+        + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1000;
+}
+
+// 文件描述符耗尽时accept退避重试, 不空转; 恢复后继续接受积压的连接
+void test_accept_backoff(){
+    sylar::IOManager iom(2, false, "backoff");
+    iom.schedule([](){
+        EchoServer::ptr server(new EchoServer);
+        SYLAR_ASSERT(server->bind(sylar::IPv4Address::Create("127.0.0.1", 0)));
+        sylar::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+        SYLAR_ASSERT(server->start());
+
+        // 先创建好客户端socket, 再把上限设为最小的空闲fd, 之后accept得到EMFILE
+        static const int s_clients = 8;
+        std::vector<sylar::Socket::ptr> clients;
+        for(int i = 0; i < s_clients; ++i){
+            sylar::Socket::ptr sock = sylar::Socket::CreateTCP(addr);
+            SYLAR_ASSERT(sock->open());
+            clients.push_back(sock);
+        }
+        struct rlimit old_limit;
+        SYLAR_ASSERT(getrlimit(RLIMIT_NOFILE, &old_limit) == 0);
+        int lowest = dup(0);
+        SYLAR_ASSERT(lowest >= 0);
+        close(lowest);
+        struct rlimit limit = old_limit;
+        limit.rlim_cur = lowest;
+        SYLAR_ASSERT(setrlimit(RLIMIT_NOFILE, &limit) == 0);
+
+        for(auto& i : clients){
+            SYLAR_ASSERT(i->connect(addr, 1000));
+        }
+        uint64_t cpu = GetCpuMS();
+        usleep(500 * 1000);
+        cpu = GetCpuMS() - cpu;
+        SYLAR_LOG_INFO(g_logger) << "cpu during EMFILE " << cpu << "ms";
+        SYLAR_ASSERT(cpu < 200);
+        SYLAR_ASSERT(server->getConnectionCount() == 0);
+
+        SYLAR_ASSERT(setrlimit(RLIMIT_NOFILE, &old_limit) == 0);
+        for(int i = 0; i < 200 && server->getConnectionCount() != s_clients; ++i){
+            usleep(10 * 1000);
+        }
+        SYLAR_ASSERT(server->getConnectionCount() == s_clients);
+        for(auto& i : clients){
+            i->close();
+        }
+        server->stop();
+    });
+}
+
+int main(int argc, char** argv){
+    test_echo();
+    SYLAR_LOG_INFO(g_logger) << "test_echo ok";
+    test_config();
+    SYLAR_LOG_INFO(g_logger) << "test_config ok";
+    test_drain();
+    SYLAR_LOG_INFO(g_logger) << "test_drain ok";
+    test_bind_fail();
+    SYLAR_LOG_INFO(g_logger) << "test_bind_fail ok";
+    test_accept_backoff();
+    SYLAR_LOG_INFO(g_logger) << "test_accept_backoff ok";
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "../sylar/thread.h"
+#include "../sylar/log.h"
+#include "../sylar/mutex.h"
+#include "../sylar/macro.h"
+#include "../sylar/config.h"
+#include <vector>
+
+sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+int count = 0;
+sylar::Mutex s_mutex;
+
+void fun1(){
+    SYLAR_LOG_INFO(g_logger) << "name: " << sylar::Thread::GetName()
+                             << " this.name: " << sylar::Thread::GetThis()->getName()
+                             << " id: " << sylar::GetThreadID()
+                             << " this.id: " << sylar::Thread::GetThis()->getId();
+    for(int i = 0; i < 100000; ++i){
+        sylar::Mutex::Lock lock(s_mutex);
+        ++count;
+    }
+}
+
+// 日志事件保存创建它的线程名, 线程退出后仍可以输出
+void test_event_thread_name(){
+    sylar::LogEvent::ptr event;
+    sylar::Thread thr([&event](){
+        event.reset(new sylar::LogEvent(g_logger, sylar::LogLevel::INFO, __FILE__, __LINE__, 0, 0, 0, 0));
+    }, "name_event_thread");
+    thr.join();
+    sylar::LogFormatter fmt("%N");
+    SYLAR_ASSERT(fmt.format(g_logger, sylar::LogLevel::INFO, event) == "name_event_thread");
+}
+
+// 配置项的回调在锁外按修改顺序执行, 回调中可以读本配置项和增删回调
+void test_config_listener(){
+    sylar::ConfigVar<int>* var = sylar::Config::Lookup<int>("test.thread.listener", 0).get();
+    static int s_last = 0;
+    static int s_calls = 0;
+    var->addListener(1, [var](const int& old_value, const int& new_value){
+        SYLAR_ASSERT(old_value == s_last);
+        s_last = new_value;
+        ++s_calls;
+        var->getValue();
+        var->addListener(2, [](const int&, const int&){});
+    });
+    var->setValue(1);
+    SYLAR_ASSERT(s_last == 1 && var->getValue() == 1 && var->getListener(2));
+
+    std::vector<sylar::Thread::ptr> thrs;
+    for(int i = 0; i < 4; ++i){
+        thrs.push_back(sylar::Thread::ptr(new sylar::Thread([var, i](){
+            for(int j = 0; j < 10000; ++j){
+                var->setValue(i * 100000 + j + 2);
+            }
+        }, "name_config_" + std::to_string(i))));
+    }
+    for(auto& i : thrs){
+        i->join();
+    }
+    SYLAR_LOG_INFO(g_logger) << "listener calls=" << s_calls << " value=" << var->getValue();
+    SYLAR_ASSERT(s_last == var->getValue());
+}
+
+int main(int argc, char** argv){
+    g_logger->setFormatter("%d%T%t%T%N%T[%p]%T%m%n");
+    SYLAR_LOG_INFO(g_logger) << "thread test begin";
+    std::vector<sylar::Thread::ptr> thrs;
+    for(int i = 0; i < 5; ++i){
+        sylar::Thread::ptr thr(new sylar::Thread(&fun1, "name_" + std::to_string(i)));
+        thrs.push_back(thr);
+    }
+
+    for(auto& i : thrs){
+        i->join();
+    }
+    sylar::Thread::SetName("main");
+    SYLAR_LOG_INFO(g_logger) << "thread test end count=" << count;
+    SYLAR_ASSERT(count == 500000);
+    test_event_thread_name();
+    test_config_listener();
+    return 0;
+}
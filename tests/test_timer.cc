@@ -0,0 +1,159 @@
+#include "../sylar/iomanager.h"
+#include "../sylar/timer.h"
+#include "../sylar/util.h"
+#include "../sylar/macro.h"
+#include "../sylar/log.h"
+#include <stdlib.h>
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+// 不依赖IOManager, 手动驱动的定时器管理器
+class ManualTimerManager : public sylar::TimerManager{
+public:
+    int notified = 0;
+protected:
+    void onTimerInsertedAtFront() override{
+        ++notified;
+    }
+};
+
+// 循环定时器触发3次后取消, 一次性定时器只触发一次, reset到更早的时间生效
+void test_iomanager_timer(){
+    static std::atomic<int> s_recurring {0};
+    static std::atomic<int> s_once {0};
+    static std::atomic<int> s_reset {0};
+    static sylar::Timer::ptr s_timer;
+    uint64_t begin = sylar::GetMonotonicMS();
+    {
+        sylar::IOManager iom(2, false, "timer");
+        s_timer = iom.addTimer(50, [](){
+            SYLAR_LOG_INFO(g_logger) << "recurring timer " << s_recurring;
+            if(++s_recurring == 3){
+                s_timer->cancel();
+            }
+        }, true);
+        iom.addTimer(120, [](){
+            ++s_once;
+        });
+        // 原定10秒, reset后100ms触发, 否则IOManager要等10秒才停止
+        sylar::Timer::ptr t = iom.addTimer(10000, [](){
+            ++s_reset;
+        });
+        SYLAR_ASSERT(t->reset(100, true));
+    }
+    uint64_t elapse = sylar::GetMonotonicMS() - begin;
+    SYLAR_LOG_INFO(g_logger) << "test_iomanager_timer elapse=" << elapse << "ms";
+    SYLAR_ASSERT(s_recurring == 3);
+    SYLAR_ASSERT(s_once == 1);
+    SYLAR_ASSERT(s_reset == 1);
+    SYLAR_ASSERT(!s_timer->cancel());
+    SYLAR_ASSERT(elapse >= 150 && elapse < 3000);
+    s_timer.reset();
+}
+
+// 条件定时器: 条件对象释放后不再执行
+void test_condition_timer(){
+    static std::atomic<int> s_fired {0};
+    {
+        sylar::IOManager iom(1, false, "cond");
+        std::shared_ptr<int> alive(new int(1));
+        std::shared_ptr<int> dead(new int(2));
+        iom.addConditionTimer(20, [](){ ++s_fired; }, alive);
+        iom.addConditionTimer(20, [](){ s_fired += 100; }, dead);
+        dead.reset();
+        usleep(100 * 1000);
+    }
+    SYLAR_LOG_INFO(g_logger) << "test_condition_timer fired=" << s_fired;
+    SYLAR_ASSERT(s_fired == 1);
+}
+
+// 大量随机延迟的定时器, 跨越第0层和第1层, 一半被取消
+// 检查每个定时器不早于到期时间触发, 且推进及时
+void test_accuracy(){
+    ManualTimerManager mgr;
+    const int N = 2000;
+    std::vector<uint64_t> deadline(N);
+    std::vector<uint64_t> fired(N, 0);
+    std::vector<sylar::Timer::ptr> timers;
+    for(int i = 0; i < N; ++i){
+        uint64_t ms = rand() % 1500;
+        deadline[i] = sylar::GetMonotonicMS() + ms;
+        timers.push_back(mgr.addTimer(ms, [i, &fired](){
+            fired[i] = sylar::GetMonotonicMS();
+        }));
+    }
+    SYLAR_ASSERT(mgr.notified >= 1);
+    for(int i = 0; i < N; i += 2){
+        SYLAR_ASSERT(timers[i]->cancel());
+        SYLAR_ASSERT(!timers[i]->cancel());
+    }
+
+    // 远期定时器只影响下界, 不会触发
+    sylar::Timer::ptr far1 = mgr.addTimer(3600 * 1000, [](){ SYLAR_ASSERT(false); });
+    sylar::Timer::ptr far2 = mgr.addTimer(100ull * 24 * 3600 * 1000, [](){ SYLAR_ASSERT(false); });
+
+    int count = 0;
+    uint64_t max_late = 0;
+    while(count < N / 2){
+        uint64_t next = mgr.getNextTimer();
+        SYLAR_ASSERT(next != ~0ull);
+        if(next > 0){
+            usleep(std::min(next, (uint64_t)5) * 1000);
+        }
+        std::vector<std::function<void()> > cbs;
+        mgr.listExpiredCb(cbs);
+        for(auto& cb : cbs){
+            cb();
+            ++count;
+        }
+    }
+    for(int i = 0; i < N; ++i){
+        if(i % 2 == 0){
+            SYLAR_ASSERT(fired[i] == 0);
+            continue;
+        }
+        SYLAR_ASSERT2(fired[i] >= deadline[i], "i=" << i << " fired=" << fired[i]
+                    << " deadline=" << deadline[i]);
+        max_late = std::max(max_late, fired[i] - deadline[i]);
+    }
+    SYLAR_LOG_INFO(g_logger) << "test_accuracy fired=" << count << " max_late=" << max_late << "ms";
+    SYLAR_ASSERT(max_late < 100);
+
+    SYLAR_ASSERT(mgr.hasTimer());
+    uint64_t next = mgr.getNextTimer();
+    SYLAR_ASSERT(next != ~0ull && next <= 3600 * 1000);
+    SYLAR_ASSERT(far1->cancel());
+    SYLAR_ASSERT(far2->cancel());
+    SYLAR_ASSERT(!mgr.hasTimer());
+    SYLAR_ASSERT(mgr.getNextTimer() == ~0ull);
+}
+
+// refresh把到期时间推后, 期间不触发
+void test_refresh(){
+    ManualTimerManager mgr;
+    int fired = 0;
+    sylar::Timer::ptr t = mgr.addTimer(50, [&fired](){ ++fired; });
+    for(int i = 0; i < 4; ++i){
+        usleep(30 * 1000);
+        SYLAR_ASSERT(t->refresh());
+        std::vector<std::function<void()> > cbs;
+        mgr.listExpiredCb(cbs);
+        SYLAR_ASSERT(cbs.empty());
+    }
+    usleep(60 * 1000);
+    std::vector<std::function<void()> > cbs;
+    mgr.listExpiredCb(cbs);
+    SYLAR_ASSERT(cbs.size() == 1);
+    cbs[0]();
+    SYLAR_ASSERT(fired == 1);
+    SYLAR_ASSERT(!t->refresh());
+    SYLAR_LOG_INFO(g_logger) << "test_refresh ok";
+}
+
+int main(int argc, char** argv){
+    test_iomanager_timer();
+    test_condition_timer();
+    test_accuracy();
+    test_refresh();
+    return 0;
+}
@@ -0,0 +1,33 @@
+#include "../sylar/config_cache.h"
+#include <iostream>
+#include <yaml-cpp/yaml.h>
+
+// 预编译配置: config_compile <input.yml> [output.cache]
+// 输出缺省为 input.yml.cache, 运行时由 ConfigCache::LoadFile 载入
+int main(int argc, char** argv){
+    if(argc < 2){
+        std::cout << "usage: " << argv[0] << " <input.yml> [output.cache]" << std::endl;
+        return 1;
+    }
+    std::string input = argv[1];
+    std::string output = argc > 2 ? argv[2] : input + ".cache";
+
+    uint64_t hash = 0;
+    if(!sylar::ConfigCache::HashFile(input, hash)){
+        std::cout << "open " << input << " failed" << std::endl;
+        return 1;
+    }
+    YAML::Node root;
+    try{
+        root = YAML::LoadFile(input);
+    }catch(std::exception& e){
+        std::cout << "parse " << input << " failed: " << e.what() << std::endl;
+        return 1;
+    }
+    if(!sylar::ConfigCache::Compile(root, hash, output)){
+        std::cout << "compile " << input << " to " << output << " failed" << std::endl;
+        return 1;
+    }
+    std::cout << input << " -> " << output << " hash=" << std::hex << hash << std::endl;
+    return 0;
+}